@@ -1,6 +1,8 @@
 #include <vlib/vlib.h>
+#include <vnet/buffer.h>
 #include <vnet/plugin/plugin.h>
 #include <vpp/app/version.h>
+#include <vpp/stats/stat_segment.h>
 
 typedef struct
 {
@@ -17,16 +19,228 @@ typedef struct
   u32 cur_node;
 } bufmon_per_thread_data_t;
 
+/*
+ * Lifetime tracing follows a fixed sample of 1 in 2^log2_sample buffer
+ * indices. Sampled buffers carry their allocation time, the last node
+ * they were dispatched to and when, in vnet_buffer2 (b)->lifetime.
+ * Whether an index is sampled is a function of the index alone, so
+ * unsampled buffers are never touched.
+ */
+typedef struct
+{
+  /* time from dispatch to a node until the next dispatch or free, in ns,
+   * indexed by node */
+  vlib_histogram_main_t residence;
+  /* all sampled buffer indices, scanned for leaks */
+  u32 *sampled;
+  /* xor'ed with the buffer index, changes on each enable */
+  u32 cookie;
+  u32 log2_sample;
+  /* nodes with a histogram */
+  u32 n_nodes;
+  /* seconds before a sampled buffer is reported as leaked */
+  u32 leak_timeout;
+  f64 ns_per_tick;
+  u8 gauge_registered;
+  int enabled;
+} bufmon_lifetime_main_t;
+
+typedef struct
+{
+  u32 n_leaks;
+  u32 oldest;
+} bufmon_leak_t;
+
 typedef struct
 {
   bufmon_per_thread_data_t *ptd;
+  bufmon_lifetime_main_t lifetime;
   int enabled;
 } bufmon_main_t;
 
 static bufmon_main_t bufmon_main;
 
+/* ~16ns at 4GHz, u32 ticks wrap after ~68s */
+#define BUFMON_TICK_SHIFT 6
+
+#define BUFMON_DEFAULT_SAMPLE	    128
+#define BUFMON_DEFAULT_LEAK_TIMEOUT 30
+
+static_always_inline int
+bufmon_is_sampled (const bufmon_lifetime_main_t *lm, u32 bi)
+{
+  return ((u64) (u32) (bi * 0x9e3779b1) >> (32 - lm->log2_sample)) == 0;
+}
+
+static_always_inline u32
+bufmon_cookie (const bufmon_lifetime_main_t *lm, u32 bi)
+{
+  return bi ^ lm->cookie;
+}
+
+static_always_inline u32
+bufmon_tick (u64 cpu_time)
+{
+  return cpu_time >> BUFMON_TICK_SHIFT;
+}
+
+static_always_inline void
+bufmon_lifetime_record (vlib_main_t *vm, bufmon_lifetime_main_t *lm,
+			const vlib_buffer_t *b, u32 tick)
+{
+  u32 last_node = vnet_buffer2 (b)->lifetime.last_node;
+
+  /* Nodes created since enabling have no histogram */
+  if (PREDICT_TRUE (last_node < lm->n_nodes))
+    vlib_increment_histogram (
+      &lm->residence, vm->thread_index, last_node,
+      (tick - vnet_buffer2 (b)->lifetime.last_tick) * lm->ns_per_tick);
+}
+
+static void
+bufmon_lifetime_alloc (vlib_main_t *vm, u32 *buffers, u32 n_buffers,
+		       u32 node_index)
+{
+  bufmon_lifetime_main_t *lm = &bufmon_main.lifetime;
+  vlib_buffer_t *b;
+  u32 i, tick = 0, now = 0;
+  int stamped = 0;
+
+  for (i = 0; i < n_buffers; i++)
+    {
+      if (PREDICT_TRUE (!bufmon_is_sampled (lm, buffers[i])))
+	continue;
+
+      if (!stamped)
+	{
+	  tick = bufmon_tick (clib_cpu_time_now ());
+	  now = vlib_time_now (vm);
+	  stamped = 1;
+	}
+
+      b = vlib_get_buffer (vm, buffers[i]);
+      vnet_buffer2 (b)->lifetime.cookie = bufmon_cookie (lm, buffers[i]);
+      vnet_buffer2 (b)->lifetime.last_node = node_index;
+      vnet_buffer2 (b)->lifetime.last_tick = tick;
+      vnet_buffer2 (b)->lifetime.alloc_time = now;
+    }
+}
+
+static void
+bufmon_lifetime_free (vlib_main_t *vm, u32 *buffers, u32 n_buffers)
+{
+  bufmon_lifetime_main_t *lm = &bufmon_main.lifetime;
+  vlib_buffer_t *b;
+  u32 i, tick = 0;
+  int stamped = 0;
+
+  for (i = 0; i < n_buffers; i++)
+    {
+      if (PREDICT_TRUE (!bufmon_is_sampled (lm, buffers[i])))
+	continue;
+
+      b = vlib_get_buffer (vm, buffers[i]);
+
+      /* allocated before enabling */
+      if (vnet_buffer2 (b)->lifetime.cookie != bufmon_cookie (lm, buffers[i]))
+	continue;
+
+      if (!stamped)
+	{
+	  tick = bufmon_tick (clib_cpu_time_now ());
+	  stamped = 1;
+	}
+
+      bufmon_lifetime_record (vm, lm, b, tick);
+      vnet_buffer2 (b)->lifetime.cookie = ~bufmon_cookie (lm, buffers[i]);
+    }
+}
+
+static void
+bufmon_lifetime_dispatch (vlib_main_t *vm, vlib_node_runtime_t *node,
+			  vlib_frame_t *frame)
+{
+  bufmon_lifetime_main_t *lm = &bufmon_main.lifetime;
+  u32 *from = vlib_frame_vector_args (frame);
+  u32 tick = bufmon_tick (vm->cpu_time_last_node_dispatch);
+  vlib_buffer_t *b;
+  u32 i;
+
+  for (i = 0; i < frame->n_vectors; i++)
+    {
+      if (PREDICT_TRUE (!bufmon_is_sampled (lm, from[i])))
+	continue;
+
+      b = vlib_get_buffer (vm, from[i]);
+
+      if (PREDICT_TRUE (vnet_buffer2 (b)->lifetime.cookie ==
+			bufmon_cookie (lm, from[i])))
+	bufmon_lifetime_record (vm, lm, b, tick);
+      else
+	{
+	  /* allocated before enabling, or metadata copied from another
+	   * buffer: start tracking from here */
+	  vnet_buffer2 (b)->lifetime.cookie = bufmon_cookie (lm, from[i]);
+	  vnet_buffer2 (b)->lifetime.alloc_time = vlib_time_now (vm);
+	}
+
+      vnet_buffer2 (b)->lifetime.last_node = node->node_index;
+      vnet_buffer2 (b)->lifetime.last_tick = tick;
+    }
+}
+
+/*
+ * Count sampled buffers allocated more than leak_timeout seconds ago, and
+ * optionally break them down by the last node they were dispatched to.
+ * Reads metadata owned by the workers, so the result is approximate.
+ */
+static u32
+bufmon_lifetime_leaks (vlib_main_t *vm, bufmon_leak_t **leaks)
+{
+  bufmon_lifetime_main_t *lm = &bufmon_main.lifetime;
+  u32 now = vlib_time_now (vm);
+  u32 n_nodes = vec_len (vm->node_main.nodes);
+  u32 *bi, age, node_index, n_leaks = 0;
+  vlib_buffer_t *b;
+  bufmon_leak_t *lk;
+
+  vec_foreach (bi, lm->sampled)
+    {
+      b = vlib_get_buffer (vm, bi[0]);
+      if (vnet_buffer2 (b)->lifetime.cookie != bufmon_cookie (lm, bi[0]))
+	continue;
+
+      age = now - vnet_buffer2 (b)->lifetime.alloc_time;
+      if (age < lm->leak_timeout)
+	continue;
+
+      n_leaks++;
+
+      node_index = vnet_buffer2 (b)->lifetime.last_node;
+      if (!leaks || node_index >= n_nodes)
+	continue;
+
+      vec_validate (*leaks, node_index);
+      lk = vec_elt_at_index (*leaks, node_index);
+      lk->n_leaks++;
+      lk->oldest = clib_max (lk->oldest, age);
+    }
+
+  return n_leaks;
+}
+
+static void
+bufmon_leaks_gauge_fn (stat_segment_directory_entry_t *e, u32 index)
+{
+  bufmon_main_t *bm = &bufmon_main;
+
+  e->value =
+    bm->lifetime.enabled ? bufmon_lifetime_leaks (vlib_get_main (), 0) : 0;
+}
+
 static u32
-bufmon_alloc_free_callback (vlib_main_t *vm, u32 n_buffers, const int is_free)
+bufmon_alloc_free_callback (vlib_main_t *vm, u32 *buffers, u32 n_buffers,
+			    const int is_free)
 {
   bufmon_main_t *bm = &bufmon_main;
   bufmon_per_thread_data_t *ptd;
@@ -51,10 +265,21 @@ bufmon_alloc_free_callback (vlib_main_t *vm, u32 n_buffers, const int is_free)
 
   pnd = vec_elt_at_index (ptd->pnd, cur_node);
 
-  if (is_free)
-    pnd->free += n_buffers;
-  else
-    pnd->alloc += n_buffers;
+  if (bm->enabled)
+    {
+      if (is_free)
+	pnd->free += n_buffers;
+      else
+	pnd->alloc += n_buffers;
+    }
+
+  if (bm->lifetime.enabled)
+    {
+      if (is_free)
+	bufmon_lifetime_free (vm, buffers, n_buffers);
+      else
+	bufmon_lifetime_alloc (vm, buffers, n_buffers, cur_node);
+    }
 
   return n_buffers;
 }
@@ -63,14 +288,16 @@ static u32
 bufmon_alloc_callback (vlib_main_t *vm, u8 buffer_pool_index, u32 *buffers,
 		       u32 n_buffers)
 {
-  return bufmon_alloc_free_callback (vm, n_buffers, 0 /* is_free */);
+  return bufmon_alloc_free_callback (vm, buffers, n_buffers,
+				     0 /* is_free */);
 }
 
 static u32
 bufmon_free_callback (vlib_main_t *vm, u8 buffer_pool_index, u32 *buffers,
 		      u32 n_buffers)
 {
-  return bufmon_alloc_free_callback (vm, n_buffers, 1 /* is_free */);
+  return bufmon_alloc_free_callback (vm, buffers, n_buffers,
+				     1 /* is_free */);
 }
 
 static u32
@@ -113,15 +340,22 @@ bufmon_dispatch_wrapper (vlib_main_t *vm, vlib_node_runtime_t *node,
   vec_validate_aligned (ptd->pnd, node->node_index, CLIB_CACHE_LINE_BYTES);
   pnd = vec_elt_at_index (ptd->pnd, node->node_index);
 
-  if (frame)
+  if (frame && bm->enabled)
     pnd->in += bufmon_count_buffers (vm, frame);
 
+  if (frame && bm->lifetime.enabled)
+    bufmon_lifetime_dispatch (vm, node, frame);
+
   pending_frames = vec_len (nm->pending_frames);
   ptd->cur_node = node->node_index;
 
   rv = node->function (vm, node, frame);
 
   ptd->cur_node = ~0;
+
+  if (!bm->enabled)
+    return rv;
+
   for (; pending_frames < vec_len (nm->pending_frames); pending_frames++)
     {
       vlib_pending_frame_t *p =
@@ -137,7 +371,8 @@ bufmon_unregister_callbacks (vlib_main_t *vm)
 {
   vlib_buffer_set_alloc_free_callback (vm, 0, 0);
   foreach_vlib_main ()
-    vlib_node_set_dispatch_wrapper (this_vlib_main, 0);
+    if (this_vlib_main->dispatch_wrapper_fn == bufmon_dispatch_wrapper)
+      vlib_node_set_dispatch_wrapper (this_vlib_main, 0);
 }
 
 static clib_error_t *
@@ -155,10 +390,14 @@ bufmon_register_callbacks (vlib_main_t *vm)
   return 0;
 
 err1:
+  /* leave alone the wrapper that is in the way */
   foreach_vlib_main ()
-    vlib_node_set_dispatch_wrapper (this_vlib_main, 0);
-err0:
+    if (this_vlib_main->dispatch_wrapper_fn == bufmon_dispatch_wrapper)
+      vlib_node_set_dispatch_wrapper (this_vlib_main, 0);
   vlib_buffer_set_alloc_free_callback (vm, 0, 0);
+  return clib_error_return (0, "another dispatch wrapper is already "
+			       "registered");
+err0:
   return clib_error_return (0, "failed to register callback");
 }
 
@@ -171,22 +410,99 @@ bufmon_enable_disable (vlib_main_t *vm, int enable)
     {
       if (bm->enabled)
 	return 0;
-      clib_error_t *error = bufmon_register_callbacks (vm);
-      if (error)
-	return error;
+      if (!bm->lifetime.enabled)
+	{
+	  clib_error_t *error = bufmon_register_callbacks (vm);
+	  if (error)
+	    return error;
+	}
       bm->enabled = 1;
     }
   else
     {
       if (!bm->enabled)
 	return 0;
-      bufmon_unregister_callbacks (vm);
+      if (!bm->lifetime.enabled)
+	bufmon_unregister_callbacks (vm);
       bm->enabled = 0;
     }
 
   return 0;
 }
 
+static clib_error_t *
+bufmon_lifetime_enable_disable (vlib_main_t *vm, int enable, u32 sample,
+				u32 leak_timeout)
+{
+  bufmon_main_t *bm = &bufmon_main;
+  bufmon_lifetime_main_t *lm = &bm->lifetime;
+  vlib_buffer_main_t *bufm = vm->buffer_main;
+  clib_error_t *error = 0;
+  u32 *buffers = 0, *bi, seed;
+  vlib_buffer_pool_t *bp;
+
+  if (!enable)
+    {
+      if (lm->enabled && !bm->enabled)
+	bufmon_unregister_callbacks (vm);
+      lm->enabled = 0;
+      return 0;
+    }
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  if (!lm->enabled && !bm->enabled)
+    {
+      error = bufmon_register_callbacks (vm);
+      if (error)
+	goto done;
+    }
+
+  vec_validate_aligned (bm->ptd, vlib_get_n_threads () - 1,
+			CLIB_CACHE_LINE_BYTES);
+
+  /* A new cookie invalidates all stamps from earlier runs */
+  seed = clib_cpu_time_now ();
+  lm->cookie = random_u32 (&seed);
+  lm->log2_sample = min_log2 (sample);
+  lm->leak_timeout = leak_timeout;
+  lm->ns_per_tick =
+    (1 << BUFMON_TICK_SHIFT) * vm->clib_time.seconds_per_clock * 1e9;
+
+  vec_reset_length (lm->sampled);
+  vec_foreach (bp, bufm->buffer_pools)
+    {
+      vec_reset_length (buffers);
+      buffers = vlib_buffer_pool_get_all_buffers (vm, bp->index, buffers);
+      vec_foreach (bi, buffers)
+	if (bufmon_is_sampled (lm, bi[0]))
+	  vec_add1 (lm->sampled, bi[0]);
+    }
+  vec_free (buffers);
+
+  /* ns, exact below 2, then 2 sub-buckets per power of two up to ~68s */
+  lm->residence.name = "buffer-residence";
+  lm->residence.stat_segment_name = "/bufmon/residence";
+  lm->residence.log2_sub_buckets = 1;
+  lm->residence.n_buckets = 74;
+  lm->n_nodes = vec_len (vm->node_main.nodes);
+  vlib_validate_histogram (&lm->residence, lm->n_nodes - 1);
+  vlib_clear_histograms (&lm->residence);
+
+  if (!lm->gauge_registered)
+    {
+      u8 *name = format (0, "/bufmon/leaks%c", 0);
+      stat_segment_register_gauge (name, bufmon_leaks_gauge_fn, 0);
+      lm->gauge_registered = 1;
+    }
+
+  lm->enabled = 1;
+
+done:
+  vlib_worker_thread_barrier_release (vm);
+  return error;
+}
+
 static clib_error_t *
 set_buffer_traces (vlib_main_t *vm, unformat_input_t *input,
 		   vlib_cli_command_t *cmd)
@@ -298,6 +614,9 @@ clear_buffer_traces (vlib_main_t *vm, unformat_input_t *input,
     vec_foreach (pnd, ptd->pnd)
       vec_reset_length (pnd);
 
+  if (bufmon_main.lifetime.residence.counters)
+    vlib_clear_histograms (&bufmon_main.lifetime.residence);
+
   return 0;
 }
 
@@ -307,6 +626,138 @@ VLIB_CLI_COMMAND (clear_buffers_trace_command, static) = {
   .function = clear_buffer_traces,
 };
 
+static clib_error_t *
+set_buffer_lifetime (vlib_main_t *vm, unformat_input_t *input,
+		     vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  u32 sample = BUFMON_DEFAULT_SAMPLE;
+  u32 leak_timeout = BUFMON_DEFAULT_LEAK_TIMEOUT;
+  int on = 1;
+
+  if (unformat_user (input, unformat_line_input, line_input))
+    {
+      while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+	{
+	  if (unformat (line_input, "on"))
+	    on = 1;
+	  else if (unformat (line_input, "off"))
+	    on = 0;
+	  else if (unformat (line_input, "sample %u", &sample))
+	    ;
+	  else if (unformat (line_input, "leak-timeout %u", &leak_timeout))
+	    ;
+	  else
+	    {
+	      unformat_free (line_input);
+	      return clib_error_return (0, "unknown input `%U'",
+					format_unformat_error, line_input);
+	    }
+	}
+      unformat_free (line_input);
+    }
+
+  if (sample == 0 || !is_pow2 (sample))
+    return clib_error_return (0, "sample must be a power of two");
+
+  if (leak_timeout == 0)
+    return clib_error_return (0, "leak-timeout must be non-zero");
+
+  return bufmon_lifetime_enable_disable (vm, on, sample, leak_timeout);
+}
+
+/*?
+ * Track the lifetime of 1 in <n> buffers: time spent after each node
+ * until the next node or free, and buffers still allocated after
+ * leak-timeout seconds.
+ *
+ * @cliexpar
+ * @cliexcmd{set buffer lifetime on sample 128 leak-timeout 30}
+?*/
+VLIB_CLI_COMMAND (set_buffer_lifetime_command, static) = {
+  .path = "set buffer lifetime",
+  .short_help = "set buffer lifetime [on|off] [sample <n>] "
+		"[leak-timeout <seconds>]",
+  .function = set_buffer_lifetime,
+};
+
+static u8 *
+format_bufmon_ns (u8 *s, va_list *args)
+{
+  u64 ns = va_arg (*args, u64);
+
+  if (ns < 1000)
+    return format (s, "%luns", ns);
+  if (ns < 1000000)
+    return format (s, "%.1fus", ns * 1e-3);
+  if (ns < 1000000000)
+    return format (s, "%.1fms", ns * 1e-6);
+  return format (s, "%.1fs", ns * 1e-9);
+}
+
+static clib_error_t *
+show_buffer_lifetime (vlib_main_t *vm, unformat_input_t *input,
+		      vlib_cli_command_t *cmd)
+{
+  bufmon_lifetime_main_t *lm = &bufmon_main.lifetime;
+  vlib_histogram_main_t *hm = &lm->residence;
+  bufmon_leak_t *leaks = 0, *lk;
+  u64 total;
+  u32 node_index, n_leaks;
+
+  if (!lm->enabled)
+    {
+      vlib_cli_output (vm, "buffer lifetime tracing is off");
+      return 0;
+    }
+
+  vlib_cli_output (vm, "sample 1/%u (%u buffers), leak-timeout %us",
+		   1 << lm->log2_sample, vec_len (lm->sampled),
+		   lm->leak_timeout);
+
+  /* Percentiles are bucket lower bounds */
+  vlib_cli_output (vm, "%30s%16s%12s%12s%12s", "Node", "Samples", "p50",
+		   "p99", "Max");
+  for (node_index = 0; node_index < lm->n_nodes; node_index++)
+    {
+      total = vlib_histogram_count (hm, VLIB_HISTOGRAM_ALL_THREADS, node_index);
+      if (total == 0)
+	continue;
+
+      vlib_cli_output (
+	vm, "%30U%16lu%12U%12U%12U", format_vlib_node_name, vm, node_index,
+	total, format_bufmon_ns,
+	vlib_histogram_percentile (hm, VLIB_HISTOGRAM_ALL_THREADS, node_index,
+				   50),
+	format_bufmon_ns,
+	vlib_histogram_percentile (hm, VLIB_HISTOGRAM_ALL_THREADS, node_index,
+				   99),
+	format_bufmon_ns,
+	vlib_histogram_percentile (hm, VLIB_HISTOGRAM_ALL_THREADS, node_index,
+				   100));
+    }
+
+  n_leaks = bufmon_lifetime_leaks (vm, &leaks);
+  vlib_cli_output (vm, "\nsuspected leaks: %u sampled buffers", n_leaks);
+  if (n_leaks)
+    {
+      vlib_cli_output (vm, "%30s%16s%12s", "Last node", "Buffers", "Oldest");
+      vec_foreach (lk, leaks)
+	if (lk->n_leaks)
+	  vlib_cli_output (vm, "%30U%16u%11us", format_vlib_node_name, vm,
+			   lk - leaks, lk->n_leaks, lk->oldest);
+    }
+  vec_free (leaks);
+
+  return 0;
+}
+
+VLIB_CLI_COMMAND (show_buffer_lifetime_command, static) = {
+  .path = "show buffer lifetime",
+  .short_help = "show buffer lifetime",
+  .function = show_buffer_lifetime,
+};
+
 VLIB_PLUGIN_REGISTER () = {
   .version = VPP_BUILD_VER,
   .description = "Buffers monitoring plugin",
@@ -1098,66 +1098,308 @@ aes_gcm (u8x16u * in, u8x16u * out, u8x16u * addt, u8x16u * iv, u8x16u * tag,
   return 1;
 }
 
-static_always_inline u32
-aes_ops_enc_aes_gcm (vlib_main_t * vm, vnet_crypto_op_t * ops[],
-		     u32 n_ops, aes_key_size_t ks)
+/* multi-buffer mode: small ops are assigned to independent lanes and each
+   step runs the AES rounds for 4 consecutive counter blocks of every lane
+   (one 512-bit register per packet with VAES), so the rounds of different
+   packets are interleaved instead of short packets leaving the pipeline
+   mostly idle. GHASH of each step's ciphertext is independent of the next
+   step's rounds, so the two overlap. */
+#if defined(__VAES__) || defined(__AVX512F__)
+#define AES_GCM_MB_N_LANES 8
+#else
+#define AES_GCM_MB_N_LANES 4
+#endif
+
+/* ops up to cm->aes_gcm_mb_max_bytes go through the multi-buffer path if
+   the vector has at least this many ops */
+#define AES_GCM_MB_MIN_OPS 4
+#define AES_GCM_MB_OPS_PER_CHUNK 64
+
+typedef union
 {
-  crypto_native_main_t *cm = &crypto_native_main;
-  vnet_crypto_op_t *op = ops[0];
+  u8x16 x1[4];
+#ifdef __VAES__
+  u8x64 x4;
+#endif
+} aes_gcm_mb_blocks_t;
+
+typedef struct
+{
+  vnet_crypto_op_t *op;
   aes_gcm_key_data_t *kd;
-  u32 n_left = n_ops;
+  u8x16u *src;
+  u8x16u *dst;
+  u32 n_left;
+  u8 is_first;
+  u32x4 Y;
+  u8x16 T;
+  u8x16 EY0;
+} aes_gcm_mb_lane_t;
 
+static_always_inline void
+aes_gcm_mb_lane_init (aes_gcm_mb_lane_t * l, vnet_crypto_op_t * op,
+		      int is_encrypt)
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+  aes_gcm_key_data_t *kd;
 
-next:
   kd = (aes_gcm_key_data_t *) cm->key_data[op->key_index];
-  aes_gcm ((u8x16u *) op->src, (u8x16u *) op->dst, (u8x16u *) op->aad,
-	   (u8x16u *) op->iv, (u8x16u *) op->tag, op->len, op->aad_len,
-	   op->tag_len, kd, AES_KEY_ROUNDS (ks), /* is_encrypt */ 1);
-  op->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+  l->op = op;
+  l->kd = kd;
+  l->src = (u8x16u *) op->src;
+  l->dst = (u8x16u *) op->dst;
+  l->n_left = op->len;
+  l->is_first = 1;
+  l->T = aes_gcm_ghash ((u8x16) { }, kd, (u8x16u *) op->aad, op->aad_len);
+
+  /* Y0, its encryption is used for the tag */
+  l->Y = (u32x4) aes_load_partial ((u8x16u *) op->iv, 12) + ctr_inv_1;
+}
 
-  if (--n_left)
+static_always_inline void
+aes_gcm_mb_lane_xor (aes_gcm_mb_lane_t * l, u8x16 * ks, int n_blocks,
+		     int is_encrypt)
+{
+  u8x16u *ct = is_encrypt ? l->dst : l->src;
+  u32 n_bytes = clib_min (l->n_left, n_blocks * 16);
+
+  if (n_bytes == n_blocks * 16)
     {
-      op += 1;
-      goto next;
+      if (!is_encrypt)
+	l->T = aes_gcm_ghash_blocks (l->T, l->kd, ct, n_blocks);
+      for (int i = 0; i < n_blocks; i++)
+	l->dst[i] = l->src[i] ^ ks[i];
+      if (is_encrypt)
+	l->T = aes_gcm_ghash_blocks (l->T, l->kd, ct, n_blocks);
+      l->src += n_blocks;
+      l->dst += n_blocks;
+      l->n_left -= n_bytes;
+      return;
     }
 
-  return n_ops;
+  /* decryption may be in place, so hash the ciphertext first */
+  if (!is_encrypt)
+    l->T = aes_gcm_ghash (l->T, l->kd, ct, n_bytes);
+
+  for (int i = 0; i < n_blocks && l->n_left; i++)
+    {
+      if (l->n_left >= 16)
+	{
+	  l->dst[0] = l->src[0] ^ ks[i];
+	  l->src++;
+	  l->dst++;
+	  l->n_left -= 16;
+	}
+      else
+	{
+	  u8x16 d = aes_load_partial (l->src, l->n_left);
+	  aes_store_partial (l->dst, d ^ ks[i], l->n_left);
+	  l->n_left = 0;
+	}
+    }
+
+  if (is_encrypt)
+    l->T = aes_gcm_ghash (l->T, l->kd, ct, n_bytes);
 }
 
-static_always_inline u32
-aes_ops_dec_aes_gcm (vlib_main_t * vm, vnet_crypto_op_t * ops[], u32 n_ops,
-		     aes_key_size_t ks)
+static_always_inline int
+aes_gcm_mb_lane_final (aes_gcm_mb_lane_t * l, int is_encrypt)
 {
-  crypto_native_main_t *cm = &crypto_native_main;
-  vnet_crypto_op_t *op = ops[0];
-  aes_gcm_key_data_t *kd;
-  u32 n_left = n_ops;
-  int rv;
+  vnet_crypto_op_t *op = l->op;
+  u8x16u *tag = (u8x16u *) op->tag;
+  u8 tag_len = op->tag_len & 0xf;
+  u8x16 r, T;
 
-next:
-  kd = (aes_gcm_key_data_t *) cm->key_data[op->key_index];
-  rv = aes_gcm ((u8x16u *) op->src, (u8x16u *) op->dst, (u8x16u *) op->aad,
-		(u8x16u *) op->iv, (u8x16u *) op->tag, op->len,
-		op->aad_len, op->tag_len, kd, AES_KEY_ROUNDS (ks),
-		/* is_encrypt */ 0);
+  r = (u8x16) ((u64x2) { op->len, op->aad_len } << 3);
+  T = ghash_mul (r ^ l->T, l->kd->Hi[NUM_HI - 1]);
+  T = u8x16_reflect (T) ^ l->EY0;
 
-  if (rv)
+  if (is_encrypt)
     {
-      op->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+      if (tag_len)
+	aes_store_partial (tag, T, tag_len);
+      else
+	tag[0] = T;
     }
   else
     {
-      op->status = VNET_CRYPTO_OP_STATUS_FAIL_BAD_HMAC;
-      n_ops--;
+      u16 tag_mask = tag_len ? (1 << tag_len) - 1 : 0xffff;
+      if ((u8x16_msb_mask (tag[0] == T) & tag_mask) != tag_mask)
+	return 0;
     }
+  return 1;
+}
+
+static_always_inline void
+aes_gcm_mb_rounds (aes_gcm_mb_lane_t * lanes, aes_gcm_mb_blocks_t * r,
+		   int aes_rounds)
+{
+  int i, j;
 
-  if (--n_left)
+  for (j = 0; j < AES_GCM_MB_N_LANES; j++)
     {
-      op += 1;
-      goto next;
+#ifdef __VAES__
+      u32x16 Y4 = u32x16_splat_u32x4 (lanes[j].Y - ctr_inv_1);
+      r[j].x4 = (u8x64) (Y4 + ctr_inv_1234) ^ lanes[j].kd->Ke4[0];
+#else
+      for (int k = 0; k < 4; k++)
+	r[j].x1[k] = (u8x16) (lanes[j].Y + k * ctr_inv_1) ^ lanes[j].kd->Ke[0];
+#endif
+      lanes[j].Y += 4 * ctr_inv_1;
     }
 
-  return n_ops;
+  for (i = 1; i < aes_rounds; i++)
+    for (j = 0; j < AES_GCM_MB_N_LANES; j++)
+#ifdef __VAES__
+      r[j].x4 = aes_enc_round_x4 (r[j].x4, lanes[j].kd->Ke4[i]);
+#else
+      for (int k = 0; k < 4; k++)
+	r[j].x1[k] = aes_enc_round (r[j].x1[k], lanes[j].kd->Ke[i]);
+#endif
+
+  for (j = 0; j < AES_GCM_MB_N_LANES; j++)
+#ifdef __VAES__
+    r[j].x4 = aes_enc_last_round_x4 (r[j].x4, lanes[j].kd->Ke4[aes_rounds]);
+#else
+    for (int k = 0; k < 4; k++)
+      r[j].x1[k] = aes_enc_last_round (r[j].x1[k],
+				       lanes[j].kd->Ke[aes_rounds]);
+#endif
+}
+
+static_always_inline u32
+aes_gcm_mb (vnet_crypto_op_t * ops[], u32 n_ops, int aes_rounds,
+	    int is_encrypt)
+{
+  aes_gcm_mb_lane_t lanes[AES_GCM_MB_N_LANES], *l;
+  aes_gcm_mb_blocks_t r[AES_GCM_MB_N_LANES];
+  u32 n_active = 0, n_fail = 0;
+  int i;
+
+  for (i = 0; i < AES_GCM_MB_N_LANES; i++)
+    {
+      if (n_ops)
+	{
+	  aes_gcm_mb_lane_init (lanes + i, (ops++)[0], is_encrypt);
+	  n_ops--;
+	  n_active++;
+	}
+      else
+	{
+	  /* idle lanes run on a valid key and the results are ignored */
+	  lanes[i] = lanes[0];
+	  lanes[i].op = 0;
+	}
+    }
+
+  while (n_active)
+    {
+      aes_gcm_mb_rounds (lanes, r, aes_rounds);
+
+      for (i = 0; i < AES_GCM_MB_N_LANES; i++)
+	{
+	  l = lanes + i;
+
+	  if (l->op == 0)
+	    continue;
+
+	  /* first step of an op also produces E(K, Y0) */
+	  if (l->is_first)
+	    {
+	      l->EY0 = r[i].x1[0];
+	      l->is_first = 0;
+	      aes_gcm_mb_lane_xor (l, r[i].x1 + 1, 3, is_encrypt);
+	    }
+	  else
+	    aes_gcm_mb_lane_xor (l, r[i].x1, 4, is_encrypt);
+
+	  if (l->n_left)
+	    continue;
+
+	  if (aes_gcm_mb_lane_final (l, is_encrypt))
+	    l->op->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+	  else
+	    {
+	      l->op->status = VNET_CRYPTO_OP_STATUS_FAIL_BAD_HMAC;
+	      n_fail++;
+	    }
+
+	  /* refill the lane */
+	  if (n_ops)
+	    {
+	      aes_gcm_mb_lane_init (l, (ops++)[0], is_encrypt);
+	      n_ops--;
+	    }
+	  else
+	    {
+	      l->op = 0;
+	      n_active--;
+	    }
+	}
+    }
+
+  return n_fail;
+}
+
+static_always_inline u32
+aes_ops_aes_gcm (vlib_main_t * vm, vnet_crypto_op_t * ops[], u32 n_ops,
+		 aes_key_size_t ks, int is_encrypt)
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+  vnet_crypto_op_t *mb_ops[AES_GCM_MB_OPS_PER_CHUNK], *op;
+  aes_gcm_key_data_t *kd;
+  u32 i, n_mb = 0, n_fail = 0, mb_max_bytes = 0;
+
+  if (n_ops >= AES_GCM_MB_MIN_OPS)
+    mb_max_bytes = cm->aes_gcm_mb_max_bytes;
+
+  for (i = 0; i < n_ops; i++)
+    {
+      op = ops[i];
+
+      if (mb_max_bytes && op->len <= mb_max_bytes)
+	{
+	  mb_ops[n_mb++] = op;
+	  if (n_mb == AES_GCM_MB_OPS_PER_CHUNK)
+	    {
+	      n_fail += aes_gcm_mb (mb_ops, n_mb, AES_KEY_ROUNDS (ks),
+				    is_encrypt);
+	      n_mb = 0;
+	    }
+	  continue;
+	}
+
+      kd = (aes_gcm_key_data_t *) cm->key_data[op->key_index];
+      if (aes_gcm ((u8x16u *) op->src, (u8x16u *) op->dst,
+		   (u8x16u *) op->aad, (u8x16u *) op->iv, (u8x16u *) op->tag,
+		   op->len, op->aad_len, op->tag_len, kd, AES_KEY_ROUNDS (ks),
+		   is_encrypt))
+	op->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+      else
+	{
+	  op->status = VNET_CRYPTO_OP_STATUS_FAIL_BAD_HMAC;
+	  n_fail++;
+	}
+    }
+
+  if (n_mb)
+    n_fail += aes_gcm_mb (mb_ops, n_mb, AES_KEY_ROUNDS (ks), is_encrypt);
+
+  return n_ops - n_fail;
+}
+
+static_always_inline u32
+aes_ops_enc_aes_gcm (vlib_main_t * vm, vnet_crypto_op_t * ops[],
+		     u32 n_ops, aes_key_size_t ks)
+{
+  return aes_ops_aes_gcm (vm, ops, n_ops, ks, /* is_encrypt */ 1);
+}
+
+static_always_inline u32
+aes_ops_dec_aes_gcm (vlib_main_t * vm, vnet_crypto_op_t * ops[], u32 n_ops,
+		     aes_key_size_t ks)
+{
+  return aes_ops_aes_gcm (vm, ops, n_ops, ks, /* is_encrypt */ 0);
 }
 
 static_always_inline void *
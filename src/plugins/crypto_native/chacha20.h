@@ -0,0 +1,413 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef __crypto_native_chacha20_h__
+#define __crypto_native_chacha20_h__
+
+/*
+ * ChaCha20 (RFC 8439) computed on several independent blocks at once.
+ * Each vector lane holds the state of one block, so lanes may belong to
+ * different packets, keys and nonces and are filled from a queue of
+ * pending blocks.
+ */
+
+#ifdef __VAES__
+#define CHACHA20_N_LANES 16
+typedef u32x16 chacha20_lanes_t;
+#elif defined(__AVX2__)
+#define CHACHA20_N_LANES 8
+typedef u32x8 chacha20_lanes_t;
+#else
+#define CHACHA20_N_LANES 4
+typedef u32x4 chacha20_lanes_t;
+#endif
+
+#define CHACHA20_BLOCK_SIZE 64
+
+/* Packet data is read and written with word sized accesses, through
+ * memcpy so the compiler doesn't assume the words don't alias the
+ * bytes accessed by other word sizes later on */
+static_always_inline u32
+chacha20_load_u32 (const u8 *p)
+{
+  u32 v;
+  __builtin_memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+static_always_inline void
+chacha20_store_u32 (u8 *p, u32 v)
+{
+  __builtin_memcpy (p, &v, sizeof (v));
+}
+
+static_always_inline u64
+poly1305_load_u64 (const u8 *p)
+{
+  u64 v;
+  __builtin_memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+static_always_inline void
+poly1305_store_u64 (u8 *p, u64 v)
+{
+  __builtin_memcpy (p, &v, sizeof (v));
+}
+
+typedef struct
+{
+  u32 key[8];
+} chacha20_key_t;
+
+typedef union
+{
+  chacha20_lanes_t v[16];
+  u32 w[16][CHACHA20_N_LANES];
+} chacha20_lanes_state_t;
+
+typedef struct
+{
+  chacha20_lanes_state_t state;
+  /* per lane output, the keystream is xored with src or stored if src is
+   * NULL */
+  u8 *src[CHACHA20_N_LANES];
+  u8 *dst[CHACHA20_N_LANES];
+  u8 n_bytes[CHACHA20_N_LANES];
+  u32 n_lanes;
+} chacha20_ctx_t;
+
+static_always_inline chacha20_lanes_t
+chacha20_rotl (chacha20_lanes_t x, int n)
+{
+  return (x << n) | (x >> (32 - n));
+}
+
+#define chacha20_quarter_round(x, a, b, c, d)                                 \
+  do                                                                          \
+    {                                                                         \
+      x[a] += x[b];                                                           \
+      x[d] = chacha20_rotl (x[d] ^ x[a], 16);                                 \
+      x[c] += x[d];                                                           \
+      x[b] = chacha20_rotl (x[b] ^ x[c], 12);                                 \
+      x[a] += x[b];                                                           \
+      x[d] = chacha20_rotl (x[d] ^ x[a], 8);                                  \
+      x[c] += x[d];                                                           \
+      x[b] = chacha20_rotl (x[b] ^ x[c], 7);                                  \
+    }                                                                         \
+  while (0)
+
+/* Replace the lanes' input state with their keystream blocks */
+static_always_inline void
+chacha20_lanes_block (chacha20_lanes_state_t *st)
+{
+  chacha20_lanes_t x[16];
+  int i;
+
+  for (i = 0; i < 16; i++)
+    x[i] = st->v[i];
+
+  for (i = 0; i < 10; i++)
+    {
+      chacha20_quarter_round (x, 0, 4, 8, 12);
+      chacha20_quarter_round (x, 1, 5, 9, 13);
+      chacha20_quarter_round (x, 2, 6, 10, 14);
+      chacha20_quarter_round (x, 3, 7, 11, 15);
+      chacha20_quarter_round (x, 0, 5, 10, 15);
+      chacha20_quarter_round (x, 1, 6, 11, 12);
+      chacha20_quarter_round (x, 2, 7, 8, 13);
+      chacha20_quarter_round (x, 3, 4, 9, 14);
+    }
+
+  for (i = 0; i < 16; i++)
+    st->v[i] += x[i];
+}
+
+/* Run the queued lanes and write their output */
+static_always_inline void
+chacha20_lanes_flush (chacha20_ctx_t *ctx)
+{
+  chacha20_lanes_state_t *st = &ctx->state;
+  u32 l, i, n;
+
+  if (ctx->n_lanes == 0)
+    return;
+
+  chacha20_lanes_block (st);
+
+  for (l = 0; l < ctx->n_lanes; l++)
+    {
+      u8 *src = ctx->src[l], *dst = ctx->dst[l];
+      n = ctx->n_bytes[l];
+
+      if (PREDICT_TRUE (n == CHACHA20_BLOCK_SIZE && src))
+	{
+	  for (i = 0; i < 16; i++)
+	    chacha20_store_u32 (dst + 4 * i,
+				chacha20_load_u32 (src + 4 * i) ^ st->w[i][l]);
+	}
+      else
+	{
+	  u32 ks[16];
+
+	  for (i = 0; i < 16; i++)
+	    ks[i] = st->w[i][l];
+
+	  if (src)
+	    for (i = 0; i < n; i++)
+	      dst[i] = src[i] ^ ((u8 *) ks)[i];
+	  else
+	    clib_memcpy_fast (dst, ks, n);
+	}
+    }
+
+  ctx->n_lanes = 0;
+}
+
+static_always_inline void
+chacha20_ctx_init (chacha20_ctx_t *ctx)
+{
+  /* "expand 32-byte k" */
+  ctx->state.v[0] = (chacha20_lanes_t) {} + 0x61707865;
+  ctx->state.v[1] = (chacha20_lanes_t) {} + 0x3320646e;
+  ctx->state.v[2] = (chacha20_lanes_t) {} + 0x79622d32;
+  ctx->state.v[3] = (chacha20_lanes_t) {} + 0x6b206574;
+  ctx->n_lanes = 0;
+}
+
+/** Queue one block of keystream for (key, nonce, counter). The keystream
+    is xored with n_bytes of src into dst, or just stored into dst when src
+    is NULL. Lanes are run once all are in use.
+*/
+static_always_inline void
+chacha20_enqueue_block (chacha20_ctx_t *ctx, const chacha20_key_t *key,
+			const u8 *nonce, u32 counter, u8 *src, u8 *dst,
+			u32 n_bytes)
+{
+  chacha20_lanes_state_t *st = &ctx->state;
+  u32 l = ctx->n_lanes, i;
+
+  for (i = 0; i < 8; i++)
+    st->w[4 + i][l] = key->key[i];
+  st->w[12][l] = counter;
+  st->w[13][l] = chacha20_load_u32 (nonce);
+  st->w[14][l] = chacha20_load_u32 (nonce + 4);
+  st->w[15][l] = chacha20_load_u32 (nonce + 8);
+
+  ctx->src[l] = src;
+  ctx->dst[l] = dst;
+  ctx->n_bytes[l] = n_bytes;
+
+  if (++ctx->n_lanes == CHACHA20_N_LANES)
+    {
+      chacha20_lanes_flush (ctx);
+      /* the constants were overwritten by the keystream */
+      chacha20_ctx_init (ctx);
+    }
+}
+
+/** Queue the keystream for len bytes starting at block counter */
+static_always_inline void
+chacha20_enqueue (chacha20_ctx_t *ctx, const chacha20_key_t *key,
+		  const u8 *nonce, u32 counter, u8 *src, u8 *dst, u32 len)
+{
+  while (len >= CHACHA20_BLOCK_SIZE)
+    {
+      chacha20_enqueue_block (ctx, key, nonce, counter++, src, dst,
+			      CHACHA20_BLOCK_SIZE);
+      src += CHACHA20_BLOCK_SIZE;
+      dst += CHACHA20_BLOCK_SIZE;
+      len -= CHACHA20_BLOCK_SIZE;
+    }
+
+  if (len)
+    chacha20_enqueue_block (ctx, key, nonce, counter, src, dst, len);
+}
+
+static_always_inline void
+chacha20_ctx_flush (chacha20_ctx_t *ctx)
+{
+  if (ctx->n_lanes == 0)
+    return;
+  chacha20_lanes_flush (ctx);
+  chacha20_ctx_init (ctx);
+}
+
+/*
+ * Poly1305 (RFC 8439), 44/44/42 bit limbs
+ */
+
+typedef struct
+{
+  u64 r[3];
+  u64 s[2];
+  u64 h[3];
+  u64 pad[2];
+} poly1305_t;
+
+#define POLY1305_MASK44 0xfffffffffffULL
+#define POLY1305_MASK42 0x3ffffffffffULL
+
+static_always_inline void
+poly1305_init (poly1305_t *p, const u8 key[32])
+{
+  u64 t0 = poly1305_load_u64 (key);
+  u64 t1 = poly1305_load_u64 (key + 8);
+
+  /* r &= 0xffffffc0ffffffc0ffffffc0fffffff */
+  p->r[0] = t0 & 0xffc0fffffffULL;
+  p->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+  p->r[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+
+  p->s[0] = p->r[1] * (5 << 2);
+  p->s[1] = p->r[2] * (5 << 2);
+
+  p->h[0] = p->h[1] = p->h[2] = 0;
+
+  p->pad[0] = poly1305_load_u64 (key + 16);
+  p->pad[1] = poly1305_load_u64 (key + 24);
+}
+
+/* Absorb n_blocks full 16 byte blocks */
+static_always_inline void
+poly1305_blocks (poly1305_t *p, const u8 *m, uword n_blocks)
+{
+  u64 r0 = p->r[0], r1 = p->r[1], r2 = p->r[2];
+  u64 s1 = p->s[0], s2 = p->s[1];
+  u64 h0 = p->h[0], h1 = p->h[1], h2 = p->h[2];
+  u128 d0, d1, d2;
+  u64 t0, t1, c;
+
+  while (n_blocks--)
+    {
+      t0 = poly1305_load_u64 (m);
+      t1 = poly1305_load_u64 (m + 8);
+
+      h0 += t0 & POLY1305_MASK44;
+      h1 += ((t0 >> 44) | (t1 << 20)) & POLY1305_MASK44;
+      h2 += ((t1 >> 24) & POLY1305_MASK42) | (1ULL << 40);
+
+      d0 = (u128) h0 * r0 + (u128) h1 * s2 + (u128) h2 * s1;
+      d1 = (u128) h0 * r1 + (u128) h1 * r0 + (u128) h2 * s2;
+      d2 = (u128) h0 * r2 + (u128) h1 * r1 + (u128) h2 * r0;
+
+      c = (u64) (d0 >> 44);
+      h0 = (u64) d0 & POLY1305_MASK44;
+      d1 += c;
+      c = (u64) (d1 >> 44);
+      h1 = (u64) d1 & POLY1305_MASK44;
+      d2 += c;
+      c = (u64) (d2 >> 42);
+      h2 = (u64) d2 & POLY1305_MASK42;
+      h0 += c * 5;
+      c = h0 >> 44;
+      h0 &= POLY1305_MASK44;
+      h1 += c;
+
+      m += 16;
+    }
+
+  p->h[0] = h0;
+  p->h[1] = h1;
+  p->h[2] = h2;
+}
+
+/* Absorb len bytes, zero padded to a multiple of 16 as in the AEAD */
+static_always_inline void
+poly1305_update_padded (poly1305_t *p, const u8 *m, uword len)
+{
+  u8 last[16] = {};
+
+  poly1305_blocks (p, m, len / 16);
+
+  if (len % 16)
+    {
+      clib_memcpy_fast (last, m + (len & ~15), len % 16);
+      poly1305_blocks (p, last, 1);
+    }
+}
+
+static_always_inline void
+poly1305_final (poly1305_t *p, u8 tag[16])
+{
+  u64 h0 = p->h[0], h1 = p->h[1], h2 = p->h[2];
+  u64 g0, g1, g2, c, t0, t1;
+
+  /* fully carry h */
+  c = h1 >> 44;
+  h1 &= POLY1305_MASK44;
+  h2 += c;
+  c = h2 >> 42;
+  h2 &= POLY1305_MASK42;
+  h0 += c * 5;
+  c = h0 >> 44;
+  h0 &= POLY1305_MASK44;
+  h1 += c;
+  c = h1 >> 44;
+  h1 &= POLY1305_MASK44;
+  h2 += c;
+  c = h2 >> 42;
+  h2 &= POLY1305_MASK42;
+  h0 += c * 5;
+  c = h0 >> 44;
+  h0 &= POLY1305_MASK44;
+  h1 += c;
+
+  /* compute h - p, and select it if h >= p */
+  g0 = h0 + 5;
+  c = g0 >> 44;
+  g0 &= POLY1305_MASK44;
+  g1 = h1 + c;
+  c = g1 >> 44;
+  g1 &= POLY1305_MASK44;
+  g2 = h2 + c - (1ULL << 42);
+
+  c = (g2 >> 63) - 1;
+  g0 &= c;
+  g1 &= c;
+  g2 &= c;
+  c = ~c;
+  h0 = (h0 & c) | g0;
+  h1 = (h1 & c) | g1;
+  h2 = (h2 & c) | g2;
+
+  /* h = h + pad */
+  t0 = p->pad[0];
+  t1 = p->pad[1];
+
+  h0 += t0 & POLY1305_MASK44;
+  c = h0 >> 44;
+  h0 &= POLY1305_MASK44;
+  h1 += (((t0 >> 44) | (t1 << 20)) & POLY1305_MASK44) + c;
+  c = h1 >> 44;
+  h1 &= POLY1305_MASK44;
+  h2 += ((t1 >> 24) & POLY1305_MASK42) + c;
+  h2 &= POLY1305_MASK42;
+
+  poly1305_store_u64 (tag, h0 | (h1 << 44));
+  poly1305_store_u64 (tag + 8, (h1 >> 20) | (h2 << 24));
+}
+
+#endif /* __crypto_native_chacha20_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
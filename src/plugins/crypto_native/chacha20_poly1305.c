@@ -0,0 +1,170 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/plugin/plugin.h>
+#include <vnet/crypto/crypto.h>
+#include <crypto_native/crypto_native.h>
+#include <crypto_native/chacha20.h>
+
+#if __GNUC__ > 4  && !__clang__ && CLIB_DEBUG == 0
+#pragma GCC optimize ("O3")
+#endif
+
+/* ops whose one time Poly1305 keys are generated in the same lanes */
+#define CHACHA20_POLY1305_OPS_PER_CHUNK 32
+
+static_always_inline void
+chacha20_poly1305_calc_tag (const u8 poly_key[32], vnet_crypto_op_t *op,
+			    const u8 *ct, u8 tag[16])
+{
+  u64 lens[2] = { op->aad_len, op->len };
+  poly1305_t p;
+
+  poly1305_init (&p, poly_key);
+  poly1305_update_padded (&p, op->aad, op->aad_len);
+  poly1305_update_padded (&p, ct, op->len);
+  poly1305_blocks (&p, (u8 *) lens, 1);
+  poly1305_final (&p, tag);
+}
+
+static_always_inline u32
+chacha20_poly1305_ops (vlib_main_t *vm, vnet_crypto_op_t *ops[], u32 n_ops,
+		       int is_encrypt)
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+  u8 poly_keys[CHACHA20_POLY1305_OPS_PER_CHUNK][32];
+  chacha20_key_t *kd;
+  chacha20_ctx_t ctx;
+  vnet_crypto_op_t *op;
+  u32 n_left = n_ops, n_fail = 0, n, i, j;
+  u8 tag[16], diff;
+
+  chacha20_ctx_init (&ctx);
+
+  while (n_left)
+    {
+      n = clib_min (n_left, CHACHA20_POLY1305_OPS_PER_CHUNK);
+
+      /* block 0 of each op's keystream is its Poly1305 key */
+      for (i = 0; i < n; i++)
+	{
+	  op = ops[i];
+	  kd = (chacha20_key_t *) cm->key_data[op->key_index];
+	  chacha20_enqueue_block (&ctx, kd, op->iv, 0, 0, poly_keys[i], 32);
+	}
+      chacha20_ctx_flush (&ctx);
+
+      /* data blocks of all ops share the lanes, starting at block 1 */
+      for (i = 0; i < n; i++)
+	{
+	  op = ops[i];
+	  kd = (chacha20_key_t *) cm->key_data[op->key_index];
+
+	  if (!is_encrypt)
+	    {
+	      /* authenticate before the ciphertext may be overwritten */
+	      ASSERT (op->tag_len <= 16);
+	      chacha20_poly1305_calc_tag (poly_keys[i], op, op->src, tag);
+	      for (diff = 0, j = 0; j < op->tag_len; j++)
+		diff |= tag[j] ^ op->tag[j];
+
+	      if (diff)
+		{
+		  op->status = VNET_CRYPTO_OP_STATUS_FAIL_BAD_HMAC;
+		  n_fail++;
+		  continue;
+		}
+	    }
+
+	  chacha20_enqueue (&ctx, kd, op->iv, 1, op->src, op->dst, op->len);
+	  op->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+	}
+      chacha20_ctx_flush (&ctx);
+
+      if (is_encrypt)
+	for (i = 0; i < n; i++)
+	  {
+	    op = ops[i];
+	    ASSERT (op->tag_len <= 16);
+	    chacha20_poly1305_calc_tag (poly_keys[i], op, op->dst, tag);
+	    clib_memcpy_fast (op->tag, tag, op->tag_len);
+	  }
+
+      ops += n;
+      n_left -= n;
+    }
+
+  return n_ops - n_fail;
+}
+
+static u32
+chacha20_poly1305_ops_enc (vlib_main_t *vm, vnet_crypto_op_t *ops[],
+			   u32 n_ops)
+{
+  return chacha20_poly1305_ops (vm, ops, n_ops, /* is_encrypt */ 1);
+}
+
+static u32
+chacha20_poly1305_ops_dec (vlib_main_t *vm, vnet_crypto_op_t *ops[],
+			   u32 n_ops)
+{
+  return chacha20_poly1305_ops (vm, ops, n_ops, /* is_encrypt */ 0);
+}
+
+static void *
+chacha20_poly1305_key_exp (vnet_crypto_key_t *key)
+{
+  chacha20_key_t *kd;
+
+  kd = clib_mem_alloc_aligned (sizeof (*kd), CLIB_CACHE_LINE_BYTES);
+  clib_memcpy_fast (kd->key, key->data, sizeof (kd->key));
+  return kd;
+}
+
+clib_error_t *
+#ifdef __VAES__
+crypto_native_chacha20_poly1305_init_icl (vlib_main_t *vm)
+#elif __AVX512F__
+crypto_native_chacha20_poly1305_init_skx (vlib_main_t *vm)
+#elif __AVX2__
+crypto_native_chacha20_poly1305_init_hsw (vlib_main_t *vm)
+#elif __aarch64__
+crypto_native_chacha20_poly1305_init_neon (vlib_main_t *vm)
+#else
+crypto_native_chacha20_poly1305_init_slm (vlib_main_t *vm)
+#endif
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+
+  vnet_crypto_register_ops_handler (vm, cm->crypto_engine_index,
+				    VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC,
+				    chacha20_poly1305_ops_enc);
+  vnet_crypto_register_ops_handler (vm, cm->crypto_engine_index,
+				    VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC,
+				    chacha20_poly1305_ops_dec);
+  cm->key_fn[VNET_CRYPTO_ALG_CHACHA20_POLY1305] = chacha20_poly1305_key_exp;
+  return 0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
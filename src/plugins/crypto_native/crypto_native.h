@@ -26,12 +26,19 @@ typedef struct
   u8x16 cbc_iv[16];
 } crypto_native_per_thread_data_t;
 
+/* upper bound for the multi-buffer AES-GCM op size, keeps the low byte of
+   the counter from wrapping */
+#define CRYPTO_NATIVE_AES_GCM_MB_MAX_BYTES 1024
+
 typedef struct
 {
   u32 crypto_engine_index;
   crypto_native_per_thread_data_t *per_thread_data;
   crypto_native_key_fn_t *key_fn[VNET_CRYPTO_N_ALGS];
   void **key_data;
+
+  /* AES-GCM ops up to this size use the multi-buffer path, 0 disables */
+  u32 aes_gcm_mb_max_bytes;
 } crypto_native_main_t;
 
 extern crypto_native_main_t crypto_native_main;
@@ -41,6 +48,7 @@ extern crypto_native_main_t crypto_native_main;
 #define _(v) \
 clib_error_t __clib_weak *crypto_native_aes_cbc_init_##v (vlib_main_t * vm); \
 clib_error_t __clib_weak *crypto_native_aes_gcm_init_##v (vlib_main_t * vm); \
+clib_error_t __clib_weak *crypto_native_chacha20_poly1305_init_##v (vlib_main_t * vm); \
 
 foreach_crypto_native_march_variant;
 #undef _
@@ -126,6 +126,31 @@ crypto_native_init (vlib_main_t * vm)
     goto error;
 #endif
 
+  if (0);
+#if __x86_64__
+  else if (crypto_native_chacha20_poly1305_init_icl &&
+	   clib_cpu_supports_vaes ())
+    error = crypto_native_chacha20_poly1305_init_icl (vm);
+  else if (crypto_native_chacha20_poly1305_init_skx &&
+	   clib_cpu_supports_avx512f ())
+    error = crypto_native_chacha20_poly1305_init_skx (vm);
+  else if (crypto_native_chacha20_poly1305_init_hsw &&
+	   clib_cpu_supports_avx2 ())
+    error = crypto_native_chacha20_poly1305_init_hsw (vm);
+  else if (crypto_native_chacha20_poly1305_init_slm)
+    error = crypto_native_chacha20_poly1305_init_slm (vm);
+#endif
+#if __aarch64__
+  else if (crypto_native_chacha20_poly1305_init_neon)
+    error = crypto_native_chacha20_poly1305_init_neon (vm);
+#endif
+  else
+    error =
+      clib_error_return (0, "No ChaCha20-Poly1305 implemenation available");
+
+  if (error)
+    goto error;
+
   vnet_crypto_register_key_handler (vm, cm->crypto_engine_index,
 				    crypto_native_key_handler);
 
@@ -144,6 +169,30 @@ VLIB_INIT_FUNCTION (crypto_native_init) =
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+crypto_native_config (vlib_main_t * vm, unformat_input_t * input)
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "aes-gcm-multi-buffer-max-bytes %u",
+		    &cm->aes_gcm_mb_max_bytes))
+	{
+	  if (cm->aes_gcm_mb_max_bytes > CRYPTO_NATIVE_AES_GCM_MB_MAX_BYTES)
+	    return clib_error_return (0, "aes-gcm-multi-buffer-max-bytes "
+				      "must be <= %u",
+				      CRYPTO_NATIVE_AES_GCM_MB_MAX_BYTES);
+	}
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+  return 0;
+}
+
+VLIB_CONFIG_FUNCTION (crypto_native_config, "crypto-native");
+
 #include <vpp/app/version.h>
 
 /* *INDENT-OFF* */
@@ -18,17 +18,50 @@
 #ifndef __crypto_sw_scheduler_h__
 #define __crypto_sw_scheduler_h__
 
-#define CRYPTO_SW_SCHEDULER_QUEUE_SIZE 64
+#define CRYPTO_SW_SCHEDULER_QUEUE_SIZE 128
 #define CRYPTO_SW_SCHEDULER_QUEUE_MASK (CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1)
 
+/* frames with at least this many elements are queued as two half-frame
+   jobs, so another worker can steal one half */
+#define CRYPTO_SW_SCHEDULER_SPLIT_MIN_ELTS 32
+
+typedef enum
+{
+  CRYPTO_SW_SCHEDULER_JOB_STATE_FREE = 0,
+  CRYPTO_SW_SCHEDULER_JOB_STATE_PENDING,
+  CRYPTO_SW_SCHEDULER_JOB_STATE_WORK_IN_PROGRESS,
+  CRYPTO_SW_SCHEDULER_JOB_STATE_DONE,
+} __clib_packed crypto_sw_scheduler_job_state_t;
+
+/* a range of elements of a frame, claimed as a whole by one worker */
+typedef struct
+{
+  vnet_crypto_async_frame_t *frame;
+  u16 first_elt;
+  u16 n_elts;
+  crypto_sw_scheduler_job_state_t state;
+  u8 has_error;
+} crypto_sw_scheduler_job_t;
+
+/* head and tail are only written by the owner thread, other workers only
+   claim jobs between tail and head. Jobs are returned to the owner in
+   order, so stealing never reorders frames */
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   u32 head;
   u32 tail;
-  vnet_crypto_async_frame_t *jobs[0];
+  crypto_sw_scheduler_job_t jobs[0];
 } crypto_sw_scheduler_queue_t;
 
+typedef struct
+{
+  u64 n_frames;		/* frames enqueued by this thread */
+  u64 n_split;		/* frames split into two jobs */
+  u64 n_elts_own;	/* own elements processed */
+  u64 n_elts_stolen;	/* elements processed for other threads */
+} crypto_sw_scheduler_stats_t;
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -38,6 +71,10 @@ typedef struct
   vnet_crypto_op_t *chained_crypto_ops;
   vnet_crypto_op_t *chained_integ_ops;
   vnet_crypto_op_chunk_t *chunks;
+  /* threads to take jobs from, own thread first, then the ones on the
+     same numa node */
+  u32 *victims;
+  crypto_sw_scheduler_stats_t stats;
   u8 self_crypto_enabled;
 } crypto_sw_scheduler_per_thread_data_t;
 
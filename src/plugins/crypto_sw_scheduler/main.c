@@ -73,6 +73,22 @@ crypto_sw_scheduler_key_handler (vlib_main_t * vm, vnet_crypto_key_op_t kop,
     }
 }
 
+static_always_inline void
+crypto_sw_scheduler_job_init (crypto_sw_scheduler_queue_t * q, u32 slot,
+			      vnet_crypto_async_frame_t * frame,
+			      u16 first_elt, u16 n_elts)
+{
+  crypto_sw_scheduler_job_t *j;
+
+  j = q->jobs + (slot & CRYPTO_SW_SCHEDULER_QUEUE_MASK);
+
+  j->frame = frame;
+  j->first_elt = first_elt;
+  j->n_elts = n_elts;
+  j->has_error = 0;
+  clib_atomic_store_rel_n (&j->state, CRYPTO_SW_SCHEDULER_JOB_STATE_PENDING);
+}
+
 static int
 crypto_sw_scheduler_frame_enqueue (vlib_main_t * vm,
 				   vnet_crypto_async_frame_t * frame)
@@ -81,59 +97,165 @@ crypto_sw_scheduler_frame_enqueue (vlib_main_t * vm,
   crypto_sw_scheduler_per_thread_data_t *ptd
     = vec_elt_at_index (cm->per_thread_data, vm->thread_index);
   crypto_sw_scheduler_queue_t *q = ptd->queues[frame->op];
-  u64 head = q->head;
+  u32 head = q->head, n_free, n_half;
+
+  n_free = CRYPTO_SW_SCHEDULER_QUEUE_SIZE - (head - q->tail);
 
-  if (q->jobs[head & CRYPTO_SW_SCHEDULER_QUEUE_MASK])
+  if (n_free == 0)
     {
       u32 n_elts = frame->n_elts, i;
       for (i = 0; i < n_elts; i++)
 	frame->elts[i].status = VNET_CRYPTO_OP_STATUS_FAIL_ENGINE_ERR;
       return -1;
     }
-  q->jobs[head & CRYPTO_SW_SCHEDULER_QUEUE_MASK] = frame;
-  head += 1;
-  CLIB_MEMORY_STORE_BARRIER ();
-  q->head = head;
+
+  /* big frames are queued as two halves so an idle worker can steal one */
+  if (n_free > 1 && frame->n_elts >= CRYPTO_SW_SCHEDULER_SPLIT_MIN_ELTS)
+    {
+      n_half = frame->n_elts / 2;
+      crypto_sw_scheduler_job_init (q, head++, frame, 0, n_half);
+      crypto_sw_scheduler_job_init (q, head++, frame, n_half,
+				    frame->n_elts - n_half);
+      ptd->stats.n_split++;
+    }
+  else
+    crypto_sw_scheduler_job_init (q, head++, frame, 0, frame->n_elts);
+
+  ptd->stats.n_frames++;
+  clib_atomic_store_rel_n (&q->head, head);
   return 0;
 }
 
-static_always_inline vnet_crypto_async_frame_t *
-crypto_sw_scheduler_get_pending_frame (crypto_sw_scheduler_queue_t * q)
+static_always_inline crypto_sw_scheduler_job_t *
+crypto_sw_scheduler_get_pending_job (crypto_sw_scheduler_queue_t * q)
 {
-  vnet_crypto_async_frame_t *f;
+  crypto_sw_scheduler_job_t *j;
+  /* tail before head, so the snapshot never has tail past head */
+  u32 tail = clib_atomic_load_acq_n (&q->tail);
+  u32 head = clib_atomic_load_acq_n (&q->head);
   u32 i;
-  u32 tail = q->tail;
-  u32 head = q->head;
 
-  for (i = tail; i < head; i++)
+  for (i = tail; i != head; i++)
     {
-      f = q->jobs[i & CRYPTO_SW_SCHEDULER_QUEUE_MASK];
-      if (!f)
+      j = q->jobs + (i & CRYPTO_SW_SCHEDULER_QUEUE_MASK);
+      if (j->state != CRYPTO_SW_SCHEDULER_JOB_STATE_PENDING)
 	continue;
+      /* the slot may have been reused since head was read, but whatever
+         job is pending in it is valid work */
       if (clib_atomic_bool_cmp_and_swap
-	  (&f->state, VNET_CRYPTO_FRAME_STATE_PENDING,
-	   VNET_CRYPTO_FRAME_STATE_WORK_IN_PROGRESS))
+	  (&j->state, CRYPTO_SW_SCHEDULER_JOB_STATE_PENDING,
+	   CRYPTO_SW_SCHEDULER_JOB_STATE_WORK_IN_PROGRESS))
+	return j;
+    }
+  return 0;
+}
+
+/* own queue first, then workers on the same numa node, then the rest;
+   every thread starts the scan after itself to spread the stealing */
+static void
+crypto_sw_scheduler_init_victims (crypto_sw_scheduler_per_thread_data_t *
+				  ptd, u32 thread_index)
+{
+  crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
+  u32 n_threads = vec_len (cm->per_thread_data), *remote = 0, i, j;
+  int numa = vlib_worker_threads[thread_index].numa_id;
+
+  vec_add1 (ptd->victims, thread_index);
+
+  for (i = 1; i < n_threads; i++)
+    {
+      j = (thread_index + i) % n_threads;
+      if (vlib_worker_threads[j].numa_id == numa)
+	vec_add1 (ptd->victims, j);
+      else
+	vec_add1 (remote, j);
+    }
+
+  vec_append (ptd->victims, remote);
+  vec_free (remote);
+}
+
+static_always_inline crypto_sw_scheduler_job_t *
+crypto_sw_scheduler_steal_job (vlib_main_t * vm,
+			       vnet_crypto_async_op_id_t async_op_id)
+{
+  crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
+  crypto_sw_scheduler_per_thread_data_t *ptd =
+    cm->per_thread_data + vm->thread_index;
+  crypto_sw_scheduler_job_t *j;
+  u32 *victim;
+
+  if (!ptd->self_crypto_enabled)
+    return 0;
+
+  if (PREDICT_FALSE (ptd->victims == 0))
+    crypto_sw_scheduler_init_victims (ptd, vm->thread_index);
+
+  vec_foreach (victim, ptd->victims)
+    {
+      j = crypto_sw_scheduler_get_pending_job (
+	cm->per_thread_data[victim[0]].queues[async_op_id]);
+      if (j)
 	{
-	  return f;
+	  if (victim == ptd->victims)
+	    ptd->stats.n_elts_own += j->n_elts;
+	  else
+	    ptd->stats.n_elts_stolen += j->n_elts;
+	  return j;
 	}
     }
-  return NULL;
+
+  return 0;
+}
+
+static_always_inline void
+crypto_sw_scheduler_job_done (crypto_sw_scheduler_job_t * j, u8 state,
+			      u32 * nb_elts_processed,
+			      u32 * enqueue_thread_idx)
+{
+  *nb_elts_processed = j->n_elts;
+  *enqueue_thread_idx = j->frame->enqueue_thread_index;
+  j->has_error = state != VNET_CRYPTO_FRAME_STATE_SUCCESS;
+
+  /* frame may be returned to its owner from here on */
+  clib_atomic_store_rel_n (&j->state, CRYPTO_SW_SCHEDULER_JOB_STATE_DONE);
 }
 
 static_always_inline vnet_crypto_async_frame_t *
 crypto_sw_scheduler_get_completed_frame (crypto_sw_scheduler_queue_t * q)
 {
-  vnet_crypto_async_frame_t *f = 0;
-  if (q->jobs[q->tail & CRYPTO_SW_SCHEDULER_QUEUE_MASK]
-      && q->jobs[q->tail & CRYPTO_SW_SCHEDULER_QUEUE_MASK]->state
-      >= VNET_CRYPTO_FRAME_STATE_SUCCESS)
+  crypto_sw_scheduler_job_t *j;
+  vnet_crypto_async_frame_t *f;
+  u32 i = q->tail, head = q->head;
+  u8 has_error = 0;
+
+  if (i == head)
+    return 0;
+
+  f = q->jobs[i & CRYPTO_SW_SCHEDULER_QUEUE_MASK].frame;
+
+  /* all jobs of the frame at the tail must be done */
+  while (1)
     {
-      u32 tail = q->tail;
-      CLIB_MEMORY_STORE_BARRIER ();
-      q->tail++;
-      f = q->jobs[tail & CRYPTO_SW_SCHEDULER_QUEUE_MASK];
-      q->jobs[tail & CRYPTO_SW_SCHEDULER_QUEUE_MASK] = 0;
+      j = q->jobs + (i & CRYPTO_SW_SCHEDULER_QUEUE_MASK);
+      if (clib_atomic_load_acq_n (&j->state) !=
+	  CRYPTO_SW_SCHEDULER_JOB_STATE_DONE)
+	return 0;
+      has_error |= j->has_error;
+      if (j->first_elt + j->n_elts == f->n_elts)
+	break;
+      i++;
     }
+
+  for (; q->tail != i + 1; q->tail++)
+    {
+      j = q->jobs + (q->tail & CRYPTO_SW_SCHEDULER_QUEUE_MASK);
+      j->frame = 0;
+      clib_atomic_store_rel_n (&j->state, CRYPTO_SW_SCHEDULER_JOB_STATE_FREE);
+    }
+
+  f->state = has_error ? VNET_CRYPTO_FRAME_STATE_ELT_ERROR :
+			 VNET_CRYPTO_FRAME_STATE_SUCCESS;
   return f;
 }
 
@@ -332,36 +454,23 @@ crypto_sw_scheduler_dequeue_aead (vlib_main_t * vm,
 				  u32 * enqueue_thread_idx)
 {
   crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
-  crypto_sw_scheduler_per_thread_data_t *ptd = 0;
-  crypto_sw_scheduler_queue_t *q = 0;
-  vnet_crypto_async_frame_t *f = 0;
+  crypto_sw_scheduler_per_thread_data_t *ptd;
+  crypto_sw_scheduler_job_t *j;
+  vnet_crypto_async_frame_t *f;
   vnet_crypto_async_frame_elt_t *fe;
   u32 *bi;
   u32 n_elts;
-  int i = 0;
   u8 state = VNET_CRYPTO_FRAME_STATE_SUCCESS;
 
-  if (cm->per_thread_data[vm->thread_index].self_crypto_enabled)
-    {
-      /* *INDENT-OFF* */
-      vec_foreach_index (i, cm->per_thread_data)
-      {
-        ptd = cm->per_thread_data + i;
-        q = ptd->queues[async_op_id];
-        f = crypto_sw_scheduler_get_pending_frame (q);
-        if (f)
-          break;
-      }
-      /* *INDENT-ON* */
-    }
-
   ptd = cm->per_thread_data + vm->thread_index;
+  j = crypto_sw_scheduler_steal_job (vm, async_op_id);
 
-  if (f)
+  if (j)
     {
-      *nb_elts_processed = n_elts = f->n_elts;
-      fe = f->elts;
-      bi = f->buffer_indices;
+      f = j->frame;
+      n_elts = j->n_elts;
+      fe = f->elts + j->first_elt;
+      bi = f->buffer_indices + j->first_elt;
 
       vec_reset_length (ptd->crypto_ops);
       vec_reset_length (ptd->chained_crypto_ops);
@@ -381,8 +490,8 @@ crypto_sw_scheduler_dequeue_aead (vlib_main_t * vm,
       process_ops (vm, f, ptd->crypto_ops, &state);
       process_chained_ops (vm, f, ptd->chained_crypto_ops, ptd->chunks,
 			   &state);
-      f->state = state;
-      *enqueue_thread_idx = f->enqueue_thread_index;
+      crypto_sw_scheduler_job_done (j, state, nb_elts_processed,
+				    enqueue_thread_idx);
     }
 
   return crypto_sw_scheduler_get_completed_frame (ptd->queues[async_op_id]);
@@ -398,32 +507,18 @@ crypto_sw_scheduler_dequeue_link (vlib_main_t * vm,
 				  u32 * enqueue_thread_idx)
 {
   crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
-  crypto_sw_scheduler_per_thread_data_t *ptd = 0;
-  crypto_sw_scheduler_queue_t *q = 0;
-  vnet_crypto_async_frame_t *f = 0;
+  crypto_sw_scheduler_per_thread_data_t *ptd;
+  crypto_sw_scheduler_job_t *j;
+  vnet_crypto_async_frame_t *f;
   vnet_crypto_async_frame_elt_t *fe;
   u32 *bi;
   u32 n_elts;
-  int i = 0;
   u8 state = VNET_CRYPTO_FRAME_STATE_SUCCESS;
 
-  if (cm->per_thread_data[vm->thread_index].self_crypto_enabled)
-    {
-      /* *INDENT-OFF* */
-      vec_foreach_index (i, cm->per_thread_data)
-      {
-        ptd = cm->per_thread_data + i;
-        q = ptd->queues[async_op_id];
-        f = crypto_sw_scheduler_get_pending_frame (q);
-        if (f)
-          break;
-      }
-      /* *INDENT-ON* */
-    }
-
   ptd = cm->per_thread_data + vm->thread_index;
+  j = crypto_sw_scheduler_steal_job (vm, async_op_id);
 
-  if (f)
+  if (j)
     {
       vec_reset_length (ptd->crypto_ops);
       vec_reset_length (ptd->integ_ops);
@@ -431,9 +526,10 @@ crypto_sw_scheduler_dequeue_link (vlib_main_t * vm,
       vec_reset_length (ptd->chained_integ_ops);
       vec_reset_length (ptd->chunks);
 
-      *nb_elts_processed = n_elts = f->n_elts;
-      fe = f->elts;
-      bi = f->buffer_indices;
+      f = j->frame;
+      n_elts = j->n_elts;
+      fe = f->elts + j->first_elt;
+      bi = f->buffer_indices + j->first_elt;
 
       while (n_elts--)
 	{
@@ -469,8 +565,8 @@ crypto_sw_scheduler_dequeue_link (vlib_main_t * vm,
 			       &state);
 	}
 
-      f->state = state;
-      *enqueue_thread_idx = f->enqueue_thread_index;
+      crypto_sw_scheduler_job_done (j, state, nb_elts_processed,
+				    enqueue_thread_idx);
     }
 
   return crypto_sw_scheduler_get_completed_frame (ptd->queues[async_op_id]);
@@ -547,22 +643,31 @@ sw_scheduler_show_workers (vlib_main_t * vm, unformat_input_t * input,
 			   vlib_cli_command_t * cmd)
 {
   crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
+  crypto_sw_scheduler_per_thread_data_t *ptd;
   u32 i;
 
-  vlib_cli_output (vm, "%-7s%-20s%-8s", "ID", "Name", "Crypto");
+  vlib_cli_output (vm, "%-7s%-20s%-8s%-6s%-12s%-12s%-12s%-12s", "ID",
+		   "Name", "Crypto", "Numa", "Frames", "Split", "Own",
+		   "Stolen");
   for (i = 1; i < vlib_thread_main.n_vlib_mains; i++)
     {
-      vlib_cli_output (vm, "%-7d%-20s%-8s", vlib_get_worker_index (i),
+      ptd = cm->per_thread_data + i;
+      vlib_cli_output (vm, "%-7d%-20s%-8s%-6d%-12lu%-12lu%-12lu%-12lu",
+		       vlib_get_worker_index (i),
 		       (vlib_worker_threads + i)->name,
-		       cm->
-		       per_thread_data[i].self_crypto_enabled ? "on" : "off");
+		       ptd->self_crypto_enabled ? "on" : "off",
+		       (vlib_worker_threads + i)->numa_id,
+		       ptd->stats.n_frames, ptd->stats.n_split,
+		       ptd->stats.n_elts_own, ptd->stats.n_elts_stolen);
     }
 
   return 0;
 }
 
 /*?
- * This command displays sw_scheduler workers.
+ * This command displays sw_scheduler workers and their crypto load:
+ * frames enqueued and split into half-frame jobs, and elements processed
+ * from the worker's own queues or stolen from other workers.
  *
  * @cliexpar
  * Example of how to show workers:
@@ -639,8 +744,9 @@ crypto_sw_scheduler_init (vlib_main_t * vm)
   clib_error_t *error = 0;
   crypto_sw_scheduler_per_thread_data_t *ptd;
 
-  u32 queue_size = CRYPTO_SW_SCHEDULER_QUEUE_SIZE * sizeof (void *)
-    + sizeof (crypto_sw_scheduler_queue_t);
+  u32 queue_size =
+    CRYPTO_SW_SCHEDULER_QUEUE_SIZE * sizeof (crypto_sw_scheduler_job_t) +
+    sizeof (crypto_sw_scheduler_queue_t);
 
   vec_validate_aligned (cm->per_thread_data, tm->n_vlib_mains - 1,
 			CLIB_CACHE_LINE_BYTES);
@@ -307,7 +307,8 @@ vlib_pcap_dispatch_trace_configure (vlib_pcap_dispatch_trace_args_t *a)
 	  tm = &this_vlib_main->trace_main;
 	  tm->filter_flag = 0;
 	  tm->filter_count = 0;
-	  vlib_node_set_dispatch_wrapper (this_vlib_main, 0);
+	  if (this_vlib_main->dispatch_wrapper_fn == dispatch_pcap_trace)
+	    vlib_node_set_dispatch_wrapper (this_vlib_main, 0);
 	}
       vec_reset_length (dtm->dispatch_buffer_trace_nodes);
       if (pm->n_packets_captured)
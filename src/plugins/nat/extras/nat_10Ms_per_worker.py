@@ -0,0 +1,45 @@
+from trex_stl_lib.api import *
+
+# nat_10Ms.py with the flows spread over the whole source port range, so
+# that RSS distributes them evenly across VPP workers. Use with the
+# nat_dynamic_per_worker config, or nat_dynamic for the handoff baseline,
+# and compare the rates once all sessions are open.
+# The number of flows can be changed with '-t flows=<n>'.
+
+
+class STLS1:
+    def create_stream(self, flows):
+        base_pkt = Ether() / IP(dst="2.2.0.1") / UDP(dport=12)
+
+        pad = Padding()
+        if len(base_pkt) < 64:
+            pad_len = 64 - len(base_pkt)
+            pad.load = "\x00" * pad_len
+
+        vm = STLVM()
+
+        vm.tuple_var(
+            name="tuple",
+            ip_min="10.0.0.3",
+            ip_max="10.0.0.255",
+            port_min=1025,
+            port_max=65535,
+            limit_flows=flows,
+        )
+
+        vm.write(fv_name="tuple.ip", pkt_offset="IP.src")
+        vm.fix_chksum()
+
+        vm.write(fv_name="tuple.port", pkt_offset="UDP.sport")
+
+        pkt = STLPktBuilder(pkt=base_pkt / pad, vm=vm)
+
+        return STLStream(packet=pkt, mode=STLTXCont())
+
+    def get_streams(self, direction=0, flows=10000000, **kwargs):
+        return [self.create_stream(int(flows))]
+
+
+# dynamic load - used for trex console or simulator
+def register():
+    return STLS1()
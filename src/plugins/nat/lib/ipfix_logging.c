@@ -36,6 +36,7 @@ nat_ipfix_logging_main_t nat_ipfix_logging_main;
 #define MAX_FRAGMENTS_IP6_LEN 33
 #define NAT64_BIB_LEN 38
 #define NAT64_SES_LEN 62
+#define NAT44_PORT_BLOCK_LEN 25
 
 #define NAT44_SESSION_CREATE_FIELD_COUNT 8
 #define NAT_ADDRESSES_EXHAUTED_FIELD_COUNT 3
@@ -45,6 +46,7 @@ nat_ipfix_logging_main_t nat_ipfix_logging_main;
 #define MAX_FRAGMENTS_FIELD_COUNT 5
 #define NAT64_BIB_FIELD_COUNT 8
 #define NAT64_SES_FIELD_COUNT 12
+#define NAT44_PORT_BLOCK_FIELD_COUNT 7
 
 typedef struct
 {
@@ -198,6 +200,13 @@ nat_template_rewrite (flow_report_main_t * frm,
       update_template_id(&silm->nat64_ses_template_id,
                          fr->template_id);
     }
+  else if (event == NAT44_PORT_BLOCK_ALLOC)
+    {
+      field_count = NAT44_PORT_BLOCK_FIELD_COUNT;
+
+      update_template_id (&silm->nat44_port_block_template_id,
+			  fr->template_id);
+    }
   else if (event == QUOTA_EXCEEDED)
     {
       if (quota_event == MAX_ENTRIES_PER_USER)
@@ -326,6 +335,23 @@ nat_template_rewrite (flow_report_main_t * frm,
       f->e_id_length = ipfix_e_id_length (0, ingressVRFID, 4);
       f++;
     }
+  else if (event == NAT44_PORT_BLOCK_ALLOC)
+    {
+      f->e_id_length = ipfix_e_id_length (0, observationTimeMilliseconds, 8);
+      f++;
+      f->e_id_length = ipfix_e_id_length (0, natEvent, 1);
+      f++;
+      f->e_id_length = ipfix_e_id_length (0, sourceIPv4Address, 4);
+      f++;
+      f->e_id_length = ipfix_e_id_length (0, postNATSourceIPv4Address, 4);
+      f++;
+      f->e_id_length = ipfix_e_id_length (0, portRangeStart, 2);
+      f++;
+      f->e_id_length = ipfix_e_id_length (0, portRangeEnd, 2);
+      f++;
+      f->e_id_length = ipfix_e_id_length (0, ingressVRFID, 4);
+      f++;
+    }
   else if (event == QUOTA_EXCEEDED)
     {
       if (quota_event == MAX_ENTRIES_PER_USER)
@@ -483,6 +509,19 @@ nat_template_rewrite_nat64_session (flow_report_main_t * frm,
 				collector_port, NAT64_SESSION_CREATE, 0);
 }
 
+u8 *
+nat_template_rewrite_nat44_port_block (flow_report_main_t *frm,
+				       flow_report_t *fr,
+				       ip4_address_t *collector_address,
+				       ip4_address_t *src_address,
+				       u16 collector_port,
+				       ipfix_report_element_t *elts,
+				       u32 n_elts, u32 *stream_index)
+{
+  return nat_template_rewrite (frm, fr, collector_address, src_address,
+			       collector_port, NAT44_PORT_BLOCK_ALLOC, 0);
+}
+
 static inline void
 nat_ipfix_header_create (flow_report_main_t * frm,
 			  vlib_buffer_t * b0, u32 * offset)
@@ -1248,6 +1287,103 @@ nat_ipfix_logging_nat64_ses (u32 thread_index, u8 nat_event,
   sitd->nat64_ses_next_record_offset = offset;
 }
 
+static void
+nat_ipfix_logging_nat44_pb (u32 thread_index, u8 nat_event, u32 src_ip,
+			    u32 nat_src_ip, u16 start_port, u16 end_port,
+			    u32 fib_index, int do_flush)
+{
+  nat_ipfix_logging_main_t *silm = &nat_ipfix_logging_main;
+  nat_ipfix_per_thread_data_t *sitd = &silm->per_thread_data[thread_index];
+  flow_report_main_t *frm = &flow_report_main;
+  vlib_frame_t *f;
+  vlib_buffer_t *b0 = 0;
+  u32 bi0 = ~0;
+  u32 offset;
+  vlib_main_t *vm = vlib_get_main ();
+  u64 now;
+  u16 template_id;
+  u32 vrf_id;
+
+  now = (u64) ((vlib_time_now (vm) - silm->vlib_time_0) * 1e3);
+  now += silm->milisecond_time_0;
+
+  b0 = sitd->nat44_port_block_buffer;
+
+  if (PREDICT_FALSE (b0 == 0))
+    {
+      if (do_flush)
+	return;
+
+      if (vlib_buffer_alloc (vm, &bi0, 1) != 1)
+	return;
+
+      b0 = sitd->nat44_port_block_buffer = vlib_get_buffer (vm, bi0);
+      offset = 0;
+    }
+  else
+    {
+      bi0 = vlib_get_buffer_index (vm, b0);
+      offset = sitd->nat44_port_block_next_record_offset;
+    }
+
+  f = sitd->nat44_port_block_frame;
+  if (PREDICT_FALSE (f == 0))
+    {
+      u32 *to_next;
+      f = vlib_get_frame_to_node (vm, ip4_lookup_node.index);
+      sitd->nat44_port_block_frame = f;
+      to_next = vlib_frame_vector_args (f);
+      to_next[0] = bi0;
+      f->n_vectors = 1;
+    }
+
+  if (PREDICT_FALSE (offset == 0))
+    nat_ipfix_header_create (frm, b0, &offset);
+
+  if (PREDICT_TRUE (do_flush == 0))
+    {
+      u64 time_stamp = clib_host_to_net_u64 (now);
+      clib_memcpy_fast (b0->data + offset, &time_stamp, sizeof (time_stamp));
+      offset += sizeof (time_stamp);
+
+      clib_memcpy_fast (b0->data + offset, &nat_event, sizeof (nat_event));
+      offset += sizeof (nat_event);
+
+      clib_memcpy_fast (b0->data + offset, &src_ip, sizeof (src_ip));
+      offset += sizeof (src_ip);
+
+      clib_memcpy_fast (b0->data + offset, &nat_src_ip, sizeof (nat_src_ip));
+      offset += sizeof (nat_src_ip);
+
+      start_port = clib_host_to_net_u16 (start_port);
+      clib_memcpy_fast (b0->data + offset, &start_port, sizeof (start_port));
+      offset += sizeof (start_port);
+
+      end_port = clib_host_to_net_u16 (end_port);
+      clib_memcpy_fast (b0->data + offset, &end_port, sizeof (end_port));
+      offset += sizeof (end_port);
+
+      vrf_id = fib_table_get_table_id (fib_index, FIB_PROTOCOL_IP4);
+      vrf_id = clib_host_to_net_u32 (vrf_id);
+      clib_memcpy_fast (b0->data + offset, &vrf_id, sizeof (vrf_id));
+      offset += sizeof (vrf_id);
+
+      b0->current_length += NAT44_PORT_BLOCK_LEN;
+    }
+
+  if (PREDICT_FALSE (do_flush ||
+		     (offset + NAT44_PORT_BLOCK_LEN) > frm->path_mtu))
+    {
+      template_id =
+	clib_atomic_fetch_or (&silm->nat44_port_block_template_id, 0);
+      nat_ipfix_send (frm, f, b0, template_id);
+      sitd->nat44_port_block_frame = 0;
+      sitd->nat44_port_block_buffer = 0;
+      offset = 0;
+    }
+  sitd->nat44_port_block_next_record_offset = offset;
+}
+
 void
 nat_ipfix_flush (u32 thread_index)
 {
@@ -1263,6 +1399,7 @@ nat_ipfix_flush (u32 thread_index)
                                 0, 0, 0, 0, 0, 0, 0, do_flush);
   nat_ipfix_logging_nat64_ses (thread_index,
                                0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, do_flush);
+  nat_ipfix_logging_nat44_pb (thread_index, 0, 0, 0, 0, 0, 0, do_flush);
 }
 
 int
@@ -1496,6 +1633,32 @@ nat_ipfix_logging_nat64_session (u32 thread_index,
                                dst_port, nat_dst_port, vrf_id, 0);
 }
 
+/**
+ * @brief Generate NAT44 port block allocation or release event
+ *
+ * @param thread_index thread index
+ * @param src_ip       source (subscriber) IPv4 address
+ * @param nat_src_ip   translated source IPv4 address
+ * @param start_port   first port of the block in host byte order
+ * @param end_port     last port of the block in host byte order
+ * @param fib_index    subscriber FIB index
+ * @param is_create    non-zero if block allocated, zero if released
+ */
+void
+nat_ipfix_logging_nat44_port_block (u32 thread_index, u32 src_ip,
+				    u32 nat_src_ip, u16 start_port,
+				    u16 end_port, u32 fib_index, u8 is_create)
+{
+  u8 nat_event;
+
+  skip_if_disabled ();
+
+  nat_event = is_create ? NAT44_PORT_BLOCK_ALLOC : NAT44_PORT_BLOCK_DEALLOC;
+
+  nat_ipfix_logging_nat44_pb (thread_index, nat_event, src_ip, nat_src_ip,
+			      start_port, end_port, fib_index, 0);
+}
+
 vlib_frame_t *
 data_callback (flow_report_main_t * frm, flow_report_t * fr,
                vlib_frame_t * f, u32 * to_next, u32 node_index)
@@ -1538,6 +1701,12 @@ nat_ipfix_logging_enable_disable (int enable, u32 domain_id, u16 src_port)
   a.src_port = src_port ? src_port : UDP_DST_PORT_ipfix;
   a.flow_data_callback = data_callback;
 
+  if (enable)
+    {
+      silm->domain_id = a.domain_id;
+      silm->src_port = a.src_port;
+    }
+
   a.rewrite_callback = nat_template_rewrite_nat44_session;
   rv = vnet_flow_report_add_del (frm, &a, NULL);
   if (rv)
@@ -1586,6 +1755,14 @@ nat_ipfix_logging_enable_disable (int enable, u32 domain_id, u16 src_port)
       return -1;
     }
 
+  if (silm->port_block_enabled)
+    {
+      a.rewrite_callback = nat_template_rewrite_nat44_port_block;
+      rv = vnet_flow_report_add_del (frm, &a, NULL);
+      if (rv)
+	return -1;
+    }
+
   // if endpoint dependent per user max entries is also required
   /*
   a.rewrite_callback = nat_template_rewrite_max_entries_per_usr;
@@ -1622,6 +1799,43 @@ nat_ipfix_logging_init (vlib_main_t * vm)
   vec_validate (silm->per_thread_data, tm->n_vlib_mains - 1);
 }
 
+/**
+ * @brief Enable/disable NAT44 port block event logging
+ *
+ * The port block template is only exported while port block events are
+ * logged, the reports of the other events are not affected.
+ *
+ * @param enable 1 if enable, 0 if disable
+ *
+ * @returns 0 if success
+ */
+int
+nat_ipfix_logging_port_block_enable_disable (int enable)
+{
+  nat_ipfix_logging_main_t *silm = &nat_ipfix_logging_main;
+  flow_report_main_t *frm = &flow_report_main;
+  vnet_flow_report_add_del_args_t a;
+  u8 e = enable ? 1 : 0;
+
+  if (silm->port_block_enabled == e)
+    return 0;
+  silm->port_block_enabled = e;
+
+  if (!clib_atomic_fetch_or (&silm->enabled, 0))
+    return 0;
+
+  clib_memset (&a, 0, sizeof (a));
+  a.is_add = e;
+  a.domain_id = silm->domain_id;
+  a.src_port = silm->src_port;
+  a.flow_data_callback = data_callback;
+  a.rewrite_callback = nat_template_rewrite_nat44_port_block;
+  if (vnet_flow_report_add_del (frm, &a, NULL))
+    return -1;
+
+  return 0;
+}
+
 static uword
 ipfix_flush_process (vlib_main_t *vm,
 		     vlib_node_runtime_t *rt,
@@ -32,6 +32,8 @@ typedef enum {
   NAT64_BIB_DELETE = 11,
   NAT_PORTS_EXHAUSTED = 12,
   QUOTA_EXCEEDED = 13,
+  NAT44_PORT_BLOCK_ALLOC = 16,
+  NAT44_PORT_BLOCK_DEALLOC = 17,
 } nat_event_t;
 
 typedef enum {
@@ -52,6 +54,7 @@ typedef struct {
   vlib_buffer_t *max_frags_ip6_buffer;
   vlib_buffer_t *nat64_bib_buffer;
   vlib_buffer_t *nat64_ses_buffer;
+  vlib_buffer_t *nat44_port_block_buffer;
 
   /** frames containing ipfix buffers */
   vlib_frame_t *nat44_session_frame;
@@ -63,6 +66,7 @@ typedef struct {
   vlib_frame_t *max_frags_ip6_frame;
   vlib_frame_t *nat64_bib_frame;
   vlib_frame_t *nat64_ses_frame;
+  vlib_frame_t *nat44_port_block_frame;
 
   /** next record offset */
   u32 nat44_session_next_record_offset;
@@ -74,6 +78,7 @@ typedef struct {
   u32 max_frags_ip6_next_record_offset;
   u32 nat64_bib_next_record_offset;
   u32 nat64_ses_next_record_offset;
+  u32 nat44_port_block_next_record_offset;
 
 } nat_ipfix_per_thread_data_t;
 
@@ -98,6 +103,14 @@ typedef struct {
   u16 max_frags_ip6_template_id;
   u16 nat64_bib_template_id;
   u16 nat64_ses_template_id;
+  u16 nat44_port_block_template_id;
+
+  /** port block events logged, template exported on demand */
+  u8 port_block_enabled;
+
+  /** observation domain and source port the reports were added with */
+  u32 domain_id;
+  u16 src_port;
 
   /** stream index */
   u32 stream_index;
@@ -116,6 +129,7 @@ int nat_ipfix_logging_enabled ();
 
 void nat_ipfix_logging_init (vlib_main_t * vm);
 int nat_ipfix_logging_enable_disable (int enable, u32 domain_id, u16 src_port);
+int nat_ipfix_logging_port_block_enable_disable (int enable);
 void nat_ipfix_logging_nat44_ses_create (u32 thread_index, u32 src_ip,
                                           u32 nat_src_ip,
                                           nat_protocol_t nat_proto,
@@ -144,5 +158,9 @@ void nat_ipfix_logging_nat64_bib(u32 thread_index,
                                  ip4_address_t * nat_src_ip, u8 proto,
                                  u16 src_port, u16 nat_src_port,
                                  u32 vrf_id, u8 is_create);
+void nat_ipfix_logging_nat44_port_block (u32 thread_index, u32 src_ip,
+					 u32 nat_src_ip, u16 start_port,
+					 u16 end_port, u32 fib_index,
+					 u8 is_create);
 
 #endif /* __included_nat_lib_ipfix_logging_h__ */
@@ -29,6 +29,17 @@ void nat_syslog_nat44_apmdel (u32 ssubix, u32 sfibix, ip4_address_t * isaddr,
 			      u16 isport, ip4_address_t * xsaddr, u16 xsport,
 			      nat_protocol_t proto);
 
+/* port block mapping, the whole block range is logged as XSPORT */
+void nat_syslog_nat44_port_block_add (u32 ssubix, u32 sfibix,
+				      ip4_address_t *isaddr,
+				      ip4_address_t *xsaddr, u16 start_port,
+				      u16 end_port);
+
+void nat_syslog_nat44_port_block_del (u32 ssubix, u32 sfibix,
+				      ip4_address_t *isaddr,
+				      ip4_address_t *xsaddr, u16 start_port,
+				      u16 end_port);
+
 void
 nat_syslog_dslite_apmadd (u32 ssubix, ip6_address_t * sv6enc,
 			  ip4_address_t * isaddr, u16 isport,
@@ -233,11 +233,15 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index,
 {
       per_vrf_sessions_unregister_session (s, thread_index);
 
-      if (nat_ed_ses_i2o_flow_hash_add_del (sm, thread_index, s, 0))
-	nat_elog_warn (sm, "flow hash del failed");
+      /* unlinked already, the flow may have a new session by now */
+      if (!nat44_ed_is_session_expired (s))
+	{
+	  if (nat_ed_ses_i2o_flow_hash_add_del (sm, thread_index, s, 0))
+	    nat_elog_warn (sm, "flow hash del failed");
 
-      if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 0))
-	nat_elog_warn (sm, "flow hash del failed");
+	  if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 0))
+	    nat_elog_warn (sm, "flow hash del failed");
+	}
 
       if (na44_ed_is_fwd_bypass_session (s))
 	{
@@ -248,7 +252,7 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index,
 	nat_affinity_unlock (s->ext_host_addr, s->out2in.addr, s->nat_proto,
 			     s->out2in.port);
 
-      if (!is_ha)
+      if (!is_ha && !nat44_ed_is_port_block_session (s))
 	nat_syslog_nat44_sdel (
 	  0, s->in2out.fib_index, &s->in2out.addr, s->in2out.port,
 	  &s->ext_host_nat_addr, s->ext_host_nat_port, &s->out2in.addr,
@@ -258,7 +262,7 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index,
       if (snat_is_unk_proto_session (s))
 	return;
 
-      if (!is_ha)
+      if (!is_ha && !nat44_ed_is_port_block_session (s))
 	{
 	  /* log NAT event */
 	  nat_ipfix_logging_nat44_ses_delete (
@@ -280,6 +284,9 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index,
       snat_free_outside_address_and_port (sm->addresses, thread_index,
 					  &s->out2in.addr, s->out2in.port,
 					  s->nat_proto);
+
+      if (nat44_ed_is_port_block_session (s))
+	nat44_ed_port_block_put_port (sm, thread_index, s);
 }
 
 static int
@@ -384,6 +391,16 @@ nat44_ed_add_del_addr_to_fib_foreach_addr_only_sm (u32 sw_if_index, u8 is_add)
     }
 }
 
+static void
+nat44_ed_port_blocks_free (snat_address_t *ap)
+{
+  uword **bitmap;
+
+  vec_foreach (bitmap, ap->busy_port_blocks_per_thread)
+    clib_bitmap_free (*bitmap);
+  vec_free (ap->busy_port_blocks_per_thread);
+}
+
 int
 nat44_ed_add_address (ip4_address_t *addr, u32 vrf_id, u8 twice_nat)
 {
@@ -435,6 +452,8 @@ nat44_ed_add_address (ip4_address_t *addr, u32 vrf_id, u8 twice_nat)
 			   tm->n_vlib_mains - 1, 0);
   foreach_nat_protocol
 #undef _
+  ap->busy_port_blocks_per_thread = 0;
+  vec_validate (ap->busy_port_blocks_per_thread, tm->n_vlib_mains - 1);
 
     if (!twice_nat)
   {
@@ -517,7 +536,7 @@ nat44_ed_del_address (ip4_address_t addr, u8 delete_sm, u8 twice_nat)
 	  vec_foreach (ses_index, ses_to_be_removed)
 	    {
 	      ses = pool_elt_at_index (tsm->sessions, ses_index[0]);
-	      nat_ed_session_delete (sm, ses, tsm - sm->per_thread_data, 1);
+	      nat_ed_session_delete (sm, ses, tsm - sm->per_thread_data);
 	    }
 	  vec_free (ses_to_be_removed);
 	}
@@ -526,6 +545,7 @@ nat44_ed_del_address (ip4_address_t addr, u8 delete_sm, u8 twice_nat)
 #define _(N, i, n, s) vec_free (a->busy_##n##_ports_per_thread);
   foreach_nat_protocol
 #undef _
+  nat44_ed_port_blocks_free (a);
 
     if (!twice_nat)
   {
@@ -589,7 +609,7 @@ nat_ed_static_mapping_del_sessions (snat_main_t * sm,
   vec_foreach (ses_index, indexes_to_free)
   {
     s = pool_elt_at_index (tsm->sessions, *ses_index);
-    nat_ed_session_delete (sm, s, tsm - sm->per_thread_data, 1);
+    nat_ed_session_delete (sm, s, tsm - sm->per_thread_data);
   }
   vec_free (indexes_to_free);
 }
@@ -1100,14 +1120,25 @@ nat44_ed_del_static_mapping (ip4_address_t l_addr, ip4_address_t e_addr,
   if (!sm->static_mapping_only || sm->static_mapping_connection_tracking)
     {
       // delete sessions for static mapping
-      if (sm->num_workers > 1)
-	tsm = vec_elt_at_index (sm->per_thread_data, m->workers[0]);
+      if (sm->per_worker_flows)
+	{
+	  // any worker might have created sessions for the mapping
+	  vec_foreach (tsm, sm->per_thread_data)
+	    nat_ed_static_mapping_del_sessions (
+	      sm, tsm, m->local_addr, m->local_port, m->proto, fib_index,
+	      is_sm_addr_only (flags), e_addr, e_port);
+	}
       else
-	tsm = vec_elt_at_index (sm->per_thread_data, sm->num_workers);
+	{
+	  if (sm->num_workers > 1)
+	    tsm = vec_elt_at_index (sm->per_thread_data, m->workers[0]);
+	  else
+	    tsm = vec_elt_at_index (sm->per_thread_data, sm->num_workers);
 
-      nat_ed_static_mapping_del_sessions (
-	sm, tsm, m->local_addr, m->local_port, m->proto, fib_index,
-	is_sm_addr_only (flags), e_addr, e_port);
+	  nat_ed_static_mapping_del_sessions (
+	    sm, tsm, m->local_addr, m->local_port, m->proto, fib_index,
+	    is_sm_addr_only (flags), e_addr, e_port);
+	}
     }
 
   fib_table_unlock (fib_index, FIB_PROTOCOL_IP4, sm->fib_src_low);
@@ -1132,6 +1163,27 @@ nat44_ed_del_static_mapping (ip4_address_t l_addr, ip4_address_t e_addr,
   return 0;
 }
 
+static void
+nat_ed_lb_local_del_sessions (snat_main_t *sm,
+			      snat_main_per_thread_data_t *tsm,
+			      nat44_lb_addr_port_t *local)
+{
+  snat_session_t *s;
+
+  pool_foreach (s, tsm->sessions)
+    {
+      if (!(nat44_ed_is_lb_session (s)))
+	continue;
+
+      if ((s->in2out.addr.as_u32 != local->addr.as_u32) ||
+	  s->in2out.port != local->port)
+	continue;
+
+      nat_free_session_data (sm, s, tsm - sm->per_thread_data, 0);
+      nat_ed_session_delete (sm, s, tsm - sm->per_thread_data);
+    }
+}
+
 int
 nat44_ed_add_lb_static_mapping (ip4_address_t e_addr, u16 e_port,
 				nat_protocol_t proto,
@@ -1286,7 +1338,6 @@ nat44_ed_del_lb_static_mapping (ip4_address_t e_addr, u16 e_port,
 
   nat44_lb_addr_port_t *local;
   snat_main_per_thread_data_t *tsm;
-  snat_session_t *s;
   int i;
 
   if (!sm->enabled)
@@ -1355,30 +1406,26 @@ nat44_ed_del_lb_static_mapping (ip4_address_t e_addr, u16 e_port,
 	    }
 	}
 
-      if (sm->num_workers > 1)
+      if (sm->per_worker_flows)
 	{
-	  ip4_header_t ip = {
-	    .src_address = local->addr,
-	  };
-	  tsm = vec_elt_at_index (
-	    sm->per_thread_data,
-	    nat44_ed_get_in2out_worker_index (0, &ip, m->fib_index, 0));
+	  vec_foreach (tsm, sm->per_thread_data)
+	    nat_ed_lb_local_del_sessions (sm, tsm, local);
 	}
       else
-	tsm = vec_elt_at_index (sm->per_thread_data, sm->num_workers);
-
-      /* Delete sessions */
-      pool_foreach (s, tsm->sessions)
 	{
-	  if (!(nat44_ed_is_lb_session (s)))
-	    continue;
-
-	  if ((s->in2out.addr.as_u32 != local->addr.as_u32) ||
-	      s->in2out.port != local->port)
-	    continue;
+	  if (sm->num_workers > 1)
+	    {
+	      ip4_header_t ip = {
+		.src_address = local->addr,
+	      };
+	      tsm = vec_elt_at_index (
+		sm->per_thread_data,
+		nat44_ed_get_in2out_worker_index (0, &ip, m->fib_index, 0));
+	    }
+	  else
+	    tsm = vec_elt_at_index (sm->per_thread_data, sm->num_workers);
 
-	  nat_free_session_data (sm, s, tsm - sm->per_thread_data, 0);
-	  nat_ed_session_delete (sm, s, tsm - sm->per_thread_data, 1);
+	  nat_ed_lb_local_del_sessions (sm, tsm, local);
 	}
     }
 
@@ -1406,7 +1453,6 @@ nat44_ed_add_del_lb_static_mapping_local (ip4_address_t e_addr, u16 e_port,
   clib_bihash_kv_8_8_t kv, value;
   nat44_lb_addr_port_t *local, *prev_local, *match_local = 0;
   snat_main_per_thread_data_t *tsm;
-  snat_session_t *s;
   u32 *locals = 0;
   uword *bitmap = 0;
   int i;
@@ -1483,30 +1529,27 @@ nat44_ed_add_del_lb_static_mapping_local (ip4_address_t e_addr, u16 e_port,
 	    nat_elog_err (sm, "static_mapping_by_local key del failed");
 	}
 
-      if (sm->num_workers > 1)
+      if (sm->per_worker_flows)
 	{
-	  ip4_header_t ip = {
-	    .src_address = local->addr,
-	  };
-	  tsm = vec_elt_at_index (
-	    sm->per_thread_data,
-	    nat44_ed_get_in2out_worker_index (0, &ip, m->fib_index, 0));
+	  vec_foreach (tsm, sm->per_thread_data)
+	    nat_ed_lb_local_del_sessions (sm, tsm, match_local);
 	}
       else
-	tsm = vec_elt_at_index (sm->per_thread_data, sm->num_workers);
-
-      /* Delete sessions */
-      pool_foreach (s, tsm->sessions) {
-	  if (!(nat44_ed_is_lb_session (s)))
-	    continue;
-
-	  if ((s->in2out.addr.as_u32 != match_local->addr.as_u32) ||
-	      s->in2out.port != match_local->port)
-	    continue;
+	{
+	  if (sm->num_workers > 1)
+	    {
+	      ip4_header_t ip = {
+		.src_address = local->addr,
+	      };
+	      tsm = vec_elt_at_index (
+		sm->per_thread_data,
+		nat44_ed_get_in2out_worker_index (0, &ip, m->fib_index, 0));
+	    }
+	  else
+	    tsm = vec_elt_at_index (sm->per_thread_data, sm->num_workers);
 
-	  nat_free_session_data (sm, s, tsm - sm->per_thread_data, 0);
-	  nat_ed_session_delete (sm, s, tsm - sm->per_thread_data, 1);
-      }
+	  nat_ed_lb_local_del_sessions (sm, tsm, match_local);
+	}
 
       pool_put (m->locals, match_local);
     }
@@ -1662,18 +1705,17 @@ nat44_ed_add_interface (u32 sw_if_index, u8 is_inside)
 	{
 	  return 0;
 	}
-      if (sm->num_workers > 1)
-	{
-	  del_feature_name = !is_inside ? "nat44-in2out-worker-handoff" :
-					  "nat44-out2in-worker-handoff";
-	  feature_name = "nat44-handoff-classify";
-	}
+      if (!is_inside)
+	del_feature_name = nat_ed_in2out_handoff_enabled (sm) ?
+			     "nat44-in2out-worker-handoff" :
+			     "nat-pre-in2out";
       else
-	{
-	  del_feature_name = !is_inside ? "nat-pre-in2out" : "nat-pre-out2in";
-
-	  feature_name = "nat44-ed-classify";
-	}
+	del_feature_name = nat_ed_out2in_handoff_enabled (sm) ?
+			     "nat44-out2in-worker-handoff" :
+			     "nat-pre-out2in";
+      feature_name = nat_ed_out2in_handoff_enabled (sm) ?
+		       "nat44-handoff-classify" :
+		       "nat44-ed-classify";
 
       rv = ip4_sv_reass_enable_disable_with_refcnt (sw_if_index, 1);
       if (rv)
@@ -1685,15 +1727,14 @@ nat44_ed_add_interface (u32 sw_if_index, u8 is_inside)
     }
   else
     {
-      if (sm->num_workers > 1)
-	{
-	  feature_name = is_inside ? "nat44-in2out-worker-handoff" :
-				     "nat44-out2in-worker-handoff";
-	}
+      if (is_inside)
+	feature_name = nat_ed_in2out_handoff_enabled (sm) ?
+			 "nat44-in2out-worker-handoff" :
+			 "nat-pre-in2out";
       else
-	{
-	  feature_name = is_inside ? "nat-pre-in2out" : "nat-pre-out2in";
-	}
+	feature_name = nat_ed_out2in_handoff_enabled (sm) ?
+			 "nat44-out2in-worker-handoff" :
+			 "nat-pre-out2in";
 
       nat_validate_interface_counters (sm, sw_if_index);
       rv = ip4_sv_reass_enable_disable_with_refcnt (sw_if_index, 1);
@@ -1765,17 +1806,17 @@ nat44_ed_del_interface (u32 sw_if_index, u8 is_inside)
 
   if (nat44_ed_is_interface_inside (i) && nat44_ed_is_interface_outside (i))
     {
-      if (sm->num_workers > 1)
-	{
-	  del_feature_name = "nat44-handoff-classify";
-	  feature_name = !is_inside ? "nat44-in2out-worker-handoff" :
-				      "nat44-out2in-worker-handoff";
-	}
+      del_feature_name = nat_ed_out2in_handoff_enabled (sm) ?
+			   "nat44-handoff-classify" :
+			   "nat44-ed-classify";
+      if (!is_inside)
+	feature_name = nat_ed_in2out_handoff_enabled (sm) ?
+			 "nat44-in2out-worker-handoff" :
+			 "nat-pre-in2out";
       else
-	{
-	  del_feature_name = "nat44-ed-classify";
-	  feature_name = !is_inside ? "nat-pre-in2out" : "nat-pre-out2in";
-	}
+	feature_name = nat_ed_out2in_handoff_enabled (sm) ?
+			 "nat44-out2in-worker-handoff" :
+			 "nat-pre-out2in";
 
       rv = ip4_sv_reass_enable_disable_with_refcnt (sw_if_index, 0);
       if (rv)
@@ -1798,15 +1839,14 @@ nat44_ed_del_interface (u32 sw_if_index, u8 is_inside)
     }
   else
     {
-      if (sm->num_workers > 1)
-	{
-	  feature_name = is_inside ? "nat44-in2out-worker-handoff" :
-				     "nat44-out2in-worker-handoff";
-	}
+      if (is_inside)
+	feature_name = nat_ed_in2out_handoff_enabled (sm) ?
+			 "nat44-in2out-worker-handoff" :
+			 "nat-pre-in2out";
       else
-	{
-	  feature_name = is_inside ? "nat-pre-in2out" : "nat-pre-out2in";
-	}
+	feature_name = nat_ed_out2in_handoff_enabled (sm) ?
+			 "nat44-out2in-worker-handoff" :
+			 "nat-pre-out2in";
 
       rv = ip4_sv_reass_enable_disable_with_refcnt (sw_if_index, 0);
       if (rv)
@@ -1872,7 +1912,7 @@ nat44_ed_add_output_interface (u32 sw_if_index)
       return VNET_API_ERROR_VALUE_EXIST;
     }
 
-  if (sm->num_workers > 1)
+  if (nat_ed_in2out_handoff_enabled (sm))
     {
       rv = ip4_sv_reass_enable_disable_with_refcnt (sw_if_index, 1);
       if (rv)
@@ -1906,7 +1946,11 @@ nat44_ed_add_output_interface (u32 sw_if_index)
 	  return rv;
 	}
 
-      vnet_feature_enable_disable ("ip4-unicast", "nat-pre-out2in",
+      // per-worker flows still hand off out2in by outside port
+      vnet_feature_enable_disable ("ip4-unicast",
+				   nat_ed_out2in_handoff_enabled (sm) ?
+				     "nat44-out2in-worker-handoff" :
+				     "nat-pre-out2in",
 				   sw_if_index, 1, 0, 0);
       vnet_feature_enable_disable ("ip4-output", "nat-pre-in2out-output",
 				   sw_if_index, 1, 0, 0);
@@ -1965,7 +2009,7 @@ nat44_ed_del_output_interface (u32 sw_if_index)
       return VNET_API_ERROR_NO_SUCH_ENTRY;
     }
 
-  if (sm->num_workers > 1)
+  if (nat_ed_in2out_handoff_enabled (sm))
     {
       rv = ip4_sv_reass_enable_disable_with_refcnt (sw_if_index, 0);
       if (rv)
@@ -1999,7 +2043,11 @@ nat44_ed_del_output_interface (u32 sw_if_index)
 	  return rv;
 	}
 
-      vnet_feature_enable_disable ("ip4-unicast", "nat-pre-out2in",
+      // per-worker flows still hand off out2in by outside port
+      vnet_feature_enable_disable ("ip4-unicast",
+				   nat_ed_out2in_handoff_enabled (sm) ?
+				     "nat44-out2in-worker-handoff" :
+				     "nat-pre-out2in",
 				   sw_if_index, 0, 0, 0);
       vnet_feature_enable_disable ("ip4-output", "nat-pre-in2out-output",
 				   sw_if_index, 0, 0, 0);
@@ -2063,6 +2111,28 @@ nat44_ed_set_frame_queue_nelts (u32 frame_queue_nelts)
   return 0;
 }
 
+int
+nat44_ed_set_port_block_size (u16 port_block_size)
+{
+  snat_main_t *sm = &snat_main;
+
+  if (port_block_size > sm->port_per_thread)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  if (port_block_size == sm->port_block_size)
+    return 0;
+
+  /* blocks of the old size can't be tracked anymore, they are logged as
+   * released with the size they were allocated with */
+  if (sm->enabled)
+    nat44_ed_sessions_clear ();
+
+  sm->port_block_size = port_block_size;
+  nat_ipfix_logging_port_block_enable_disable (port_block_size != 0);
+
+  return 0;
+}
+
 static void
 nat44_ed_update_outside_fib_cb (ip4_main_t *im, uword opaque, u32 sw_if_index,
 				u32 new_fib_index, u32 old_fib_index)
@@ -2373,8 +2443,17 @@ nat44_plugin_enable (nat44_config_t c)
       return 1;
     }
 
+  /* the worker set, and so the ports per thread, may have changed since
+   * the port block size was set */
+  if (sm->port_block_size > sm->port_per_thread)
+    {
+      nat_log_err ("port block size exceeds the ports per thread");
+      return 1;
+    }
+
   sm->static_mapping_only = c.static_mapping_only;
   sm->static_mapping_connection_tracking = c.connection_tracking;
+  sm->per_worker_flows = c.per_worker_flows;
 
   sm->forwarding_enabled = 0;
   sm->mss_clamping = 0;
@@ -2435,6 +2514,10 @@ nat44_plugin_enable (nat44_config_t c)
   sm->enabled = 1;
   sm->rconfig = c;
 
+  /* kick the session expiry */
+  vlib_process_signal_event (vlib_get_main (),
+			     nat44_ed_expire_process_node.index, 0, 0);
+
   return 0;
 }
 
@@ -2448,6 +2531,7 @@ nat44_addresses_free (snat_address_t ** addresses)
       vec_free (ap->busy_##n##_ports_per_thread);
       foreach_nat_protocol
     #undef _
+      nat44_ed_port_blocks_free (ap);
     }
   vec_free (*addresses);
   *addresses = 0;
@@ -2514,6 +2598,12 @@ nat44_plugin_disable ()
 
   sm->forwarding_enabled = 0;
 
+  if (sm->port_block_size)
+    {
+      sm->port_block_size = 0;
+      nat_ipfix_logging_port_block_enable_disable (0);
+    }
+
   sm->enabled = 0;
   clib_memset (&sm->rconfig, 0, sizeof (sm->rconfig));
 
@@ -2549,7 +2639,7 @@ nat44_ed_forwarding_enable_disable (u8 is_enable)
 	{
 	  s = pool_elt_at_index (tsm->sessions, ses_index[0]);
 	  nat_free_session_data (sm, s, tsm - sm->per_thread_data, 0);
-	  nat_ed_session_delete (sm, s, tsm - sm->per_thread_data, 1);
+	  nat_ed_session_delete (sm, s, tsm - sm->per_thread_data);
 	}
 
       vec_free (ses_to_be_removed);
@@ -2593,6 +2683,155 @@ snat_free_outside_address_and_port (snat_address_t *addresses,
     }
 }
 
+static void
+nat44_ed_port_block_log (snat_main_t *sm, u32 thread_index,
+			 nat_ed_port_block_t *pb, u8 is_add)
+{
+  u16 end_port = pb->start_port + sm->port_block_size - 1;
+
+  nat_ipfix_logging_nat44_port_block (
+    thread_index, pb->user_addr.as_u32, pb->addr.as_u32, pb->start_port,
+    end_port, pb->user_fib_index, is_add);
+  if (is_add)
+    nat_syslog_nat44_port_block_add (0, pb->user_fib_index, &pb->user_addr,
+				     &pb->addr, pb->start_port, end_port);
+  else
+    nat_syslog_nat44_port_block_del (0, pb->user_fib_index, &pb->user_addr,
+				     &pb->addr, pb->start_port, end_port);
+}
+
+nat_ed_port_block_t *
+nat44_ed_port_block_alloc (snat_main_t *sm, u32 thread_index,
+			   ip4_address_t user_addr, u32 user_fib_index)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  nat_ed_port_block_t *pb;
+  snat_address_t *a = 0;
+  u32 n_blocks, n_addresses, i, block = ~0;
+  uword *p, key;
+  u8 pass;
+
+  n_addresses = vec_len (sm->addresses);
+  if (!sm->port_block_size || !n_addresses)
+    return 0;
+
+  n_blocks = sm->port_per_thread / sm->port_block_size;
+
+  /* prefer addresses of the subscriber's vrf, start at an address derived
+   * from the subscriber so that the blocks are spread over the pool */
+  for (pass = 0; pass < 2 && block == ~0; pass++)
+    {
+      for (i = 0; i < n_addresses; i++)
+	{
+	  a = sm->addresses + (user_addr.as_u32 + i) % n_addresses;
+	  if (pass == 0 && a->fib_index != user_fib_index)
+	    continue;
+	  if (pass == 1 && a->fib_index != ~0)
+	    continue;
+	  block = clib_bitmap_first_clear (
+	    a->busy_port_blocks_per_thread[thread_index]);
+	  if (block < n_blocks)
+	    break;
+	  block = ~0;
+	}
+    }
+
+  if (block == ~0)
+    return 0;
+
+  a->busy_port_blocks_per_thread[thread_index] = clib_bitmap_set (
+    a->busy_port_blocks_per_thread[thread_index], block, 1);
+
+  pool_get_zero (tsm->port_blocks, pb);
+  pb->user_addr = user_addr;
+  pb->user_fib_index = user_fib_index;
+  pb->addr = a->addr;
+  pb->start_port = 1024 + sm->port_per_thread * tsm->snat_thread_index +
+		   block * sm->port_block_size;
+
+  /* link the block at the head of the subscriber's chain */
+  key = nat_ed_port_block_user_key (user_addr, user_fib_index);
+  p = hash_get (tsm->port_block_by_user, key);
+  pb->next = p ? p[0] : ~0;
+  hash_set (tsm->port_block_by_user, key, pb - tsm->port_blocks);
+
+  nat44_ed_port_block_log (sm, thread_index, pb, 1);
+  return pb;
+}
+
+void
+nat44_ed_port_block_free (snat_main_t *sm, u32 thread_index,
+			  nat_ed_port_block_t *pb)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  nat_ed_port_block_t *prev = 0;
+  snat_address_t *a;
+  u32 index = pb - tsm->port_blocks, i;
+  uword *p, key;
+
+  key = nat_ed_port_block_user_key (pb->user_addr, pb->user_fib_index);
+  p = hash_get (tsm->port_block_by_user, key);
+  ASSERT (p);
+  for (i = p[0]; i != index; i = prev->next)
+    prev = pool_elt_at_index (tsm->port_blocks, i);
+  if (prev)
+    prev->next = pb->next;
+  else if (pb->next != ~0)
+    hash_set (tsm->port_block_by_user, key, pb->next);
+  else
+    hash_unset (tsm->port_block_by_user, key);
+
+  a = nat44_ed_get_address (sm, pb->addr);
+  if (a)
+    {
+      i = (pb->start_port - 1024 -
+	   sm->port_per_thread * tsm->snat_thread_index) /
+	  sm->port_block_size;
+      a->busy_port_blocks_per_thread[thread_index] = clib_bitmap_set (
+	a->busy_port_blocks_per_thread[thread_index], i, 0);
+    }
+
+  nat44_ed_port_block_log (sm, thread_index, pb, 0);
+  pool_put (tsm->port_blocks, pb);
+}
+
+void
+nat44_ed_port_block_put_port (snat_main_t *sm, u32 thread_index,
+			      snat_session_t *s)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  nat_ed_port_block_t *pb;
+  u16 port = clib_net_to_host_u16 (s->out2in.port);
+  uword *p;
+  u32 i;
+
+  p = hash_get (tsm->port_block_by_user,
+		nat_ed_port_block_user_key (s->in2out.addr,
+					    s->in2out.fib_index));
+  if (!p)
+    return;
+
+  for (i = p[0]; i != ~0; i = pb->next)
+    {
+      pb = pool_elt_at_index (tsm->port_blocks, i);
+      if (pb->addr.as_u32 == s->out2in.addr.as_u32 &&
+	  port >= pb->start_port &&
+	  port < pb->start_port + sm->port_block_size)
+	{
+	  ASSERT (pb->n_sessions >= 1);
+	  if (--pb->n_sessions == 0)
+	    nat44_ed_port_block_free (sm, thread_index, pb);
+	  else
+	    {
+	      /* the port is free again, hand it out next */
+	      pb->cursor = port - pb->start_port;
+	      pb->full = 0;
+	    }
+	  return;
+	}
+    }
+}
+
 int
 snat_static_mapping_match (vlib_main_t *vm, snat_main_t *sm,
 			   ip4_address_t match_addr, u16 match_port,
@@ -2655,7 +2894,7 @@ snat_static_mapping_match (vlib_main_t *vm, snat_main_t *sm,
 	      goto end;
 	    }
 	  // pick locals matching this worker
-	  if (PREDICT_FALSE (sm->num_workers > 1))
+	  if (PREDICT_FALSE (nat_ed_in2out_handoff_enabled (sm)))
 	    {
 	      u32 thread_index = vlib_get_thread_index ();
               pool_foreach_index (i, m->locals)
@@ -2764,6 +3003,11 @@ nat44_ed_get_in2out_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
   clib_bihash_kv_16_8_t kv16, value16;
 
   u32 fib_index = rx_fib_index;
+
+  // the receiving worker owns its sessions
+  if (sm->per_worker_flows)
+    return vlib_get_thread_index ();
+
   if (b)
     {
       if (PREDICT_FALSE (is_output))
@@ -2893,6 +3137,10 @@ nat44_ed_get_out2in_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
 
   proto = ip_proto_to_nat_proto (ip->protocol);
 
+  // no shared flow table, the outside port identifies the owner
+  if (sm->per_worker_flows)
+    goto no_session;
+
   if (PREDICT_FALSE (proto == NAT_PROTOCOL_ICMP))
     {
       ip4_address_t lookup_saddr, lookup_daddr;
@@ -2934,6 +3182,7 @@ nat44_ed_get_out2in_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
       return next_worker_index;
     }
 
+no_session:
   /* first try static mappings without port */
   if (PREDICT_FALSE (pool_elts (sm->static_mappings)))
     {
@@ -3084,36 +3333,35 @@ static void
 nat44_ed_worker_db_init (snat_main_per_thread_data_t *tsm, u32 translations,
 			 u32 translation_buckets)
 {
-  dlist_elt_t *head;
-
   pool_alloc (tsm->sessions, translations);
-  pool_alloc (tsm->lru_pool, translations);
-
-  pool_get (tsm->lru_pool, head);
-  tsm->tcp_trans_lru_head_index = head - tsm->lru_pool;
-  clib_dlist_init (tsm->lru_pool, tsm->tcp_trans_lru_head_index);
-
-  pool_get (tsm->lru_pool, head);
-  tsm->tcp_estab_lru_head_index = head - tsm->lru_pool;
-  clib_dlist_init (tsm->lru_pool, tsm->tcp_estab_lru_head_index);
 
-  pool_get (tsm->lru_pool, head);
-  tsm->udp_lru_head_index = head - tsm->lru_pool;
-  clib_dlist_init (tsm->lru_pool, tsm->udp_lru_head_index);
-
-  pool_get (tsm->lru_pool, head);
-  tsm->icmp_lru_head_index = head - tsm->lru_pool;
-  clib_dlist_init (tsm->lru_pool, tsm->icmp_lru_head_index);
-
-  pool_get (tsm->lru_pool, head);
-  tsm->unk_proto_lru_head_index = head - tsm->lru_pool;
-  clib_dlist_init (tsm->lru_pool, tsm->unk_proto_lru_head_index);
+  tw_timer_wheel_init_1t_3w_1024sl_ov (&tsm->session_timers, 0,
+				       NAT_ED_SESSION_TIMER_TICK,
+				       NAT_ED_EXPIRE_WALK_BUDGET);
 }
 
 static void
 reinit_ed_flow_hash ()
 {
   snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm;
+
+  if (sm->per_worker_flows)
+    {
+      // each worker only holds the flows of its own sessions, main thread
+      // creates none when there are workers
+      vec_foreach (tsm, sm->per_thread_data)
+	{
+	  if (sm->num_workers && tsm == sm->per_thread_data)
+	    continue;
+	  clib_bihash_init_16_8 (&tsm->flow_hash, "ed-worker-flow-hash",
+				 2 * sm->translation_buckets, 0);
+	  clib_bihash_set_kvp_format_fn_16_8 (&tsm->flow_hash,
+					      format_ed_session_kvp);
+	}
+      return;
+    }
+
   // we expect 2 flows per session, so multiply translation_buckets by 2
   clib_bihash_init_16_8 (
     &sm->flow_hash, "ed-flow-hash",
@@ -3156,7 +3404,18 @@ nat44_ed_db_init (u32 translations, u32 translation_buckets)
 static void
 nat44_ed_worker_db_free (snat_main_per_thread_data_t *tsm)
 {
-  pool_free (tsm->lru_pool);
+  snat_main_t *sm = &snat_main;
+  nat_ed_port_block_t *pb;
+
+  /* the sessions go away without being deleted one by one, end the
+   * allocation of every block still in use in the logs */
+  pool_foreach (pb, tsm->port_blocks)
+    nat44_ed_port_block_log (sm, tsm - sm->per_thread_data, pb, 0);
+
+  tw_timer_wheel_free_1t_3w_1024sl_ov (&tsm->session_timers);
+  vec_free (tsm->expired_sessions);
+  pool_free (tsm->port_blocks);
+  hash_free (tsm->port_block_by_user);
   pool_free (tsm->sessions);
   vec_free (tsm->per_vrf_sessions_vec);
 }
@@ -3169,6 +3428,8 @@ nat44_ed_db_free ()
 
   pool_free (sm->static_mappings);
   clib_bihash_free_16_8 (&sm->flow_hash);
+  vec_foreach (tsm, sm->per_thread_data)
+    clib_bihash_free_16_8 (&tsm->flow_hash);
   clib_bihash_free_8_8 (&sm->static_mapping_by_local);
   clib_bihash_free_8_8 (&sm->static_mapping_by_external);
 
@@ -3186,9 +3447,17 @@ nat44_ed_sessions_clear ()
 {
   snat_main_t *sm = &snat_main;
   snat_main_per_thread_data_t *tsm;
+  snat_address_t *a;
+  uword **bitmap;
 
   reinit_ed_flow_hash ();
 
+  vec_foreach (a, sm->addresses)
+    {
+      vec_foreach (bitmap, a->busy_port_blocks_per_thread)
+	clib_bitmap_zero (*bitmap);
+    }
+
   if (sm->pat)
     {
       vec_foreach (tsm, sm->per_thread_data)
@@ -3478,28 +3747,185 @@ nat44_ed_del_session (snat_main_t *sm, ip4_address_t *addr, u16 port,
     }
 
   fib_index = fib_table_find (FIB_PROTOCOL_IP4, vrf_id);
-  ip.dst_address.as_u32 = ip.src_address.as_u32 = addr->as_u32;
-  if (sm->num_workers > 1)
-    tsm = vec_elt_at_index (
-      sm->per_thread_data,
-      nat44_ed_get_in2out_worker_index (0, &ip, fib_index, 0));
-  else
-    tsm = vec_elt_at_index (sm->per_thread_data, sm->num_workers);
-
   init_ed_k (&kv, *addr, port, *eh_addr, eh_port, fib_index, proto);
-  if (clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+
+  if (sm->per_worker_flows)
     {
-      return VNET_API_ERROR_NO_SUCH_ENTRY;
+      vec_foreach (tsm, sm->per_thread_data)
+	{
+	  if (clib_bihash_is_initialised_16_8 (&tsm->flow_hash) &&
+	      !clib_bihash_search_16_8 (&tsm->flow_hash, &kv, &value))
+	    break;
+	}
+      if (tsm == vec_end (sm->per_thread_data))
+	return VNET_API_ERROR_NO_SUCH_ENTRY;
+    }
+  else
+    {
+      ip.dst_address.as_u32 = ip.src_address.as_u32 = addr->as_u32;
+      if (sm->num_workers > 1)
+	tsm = vec_elt_at_index (
+	  sm->per_thread_data,
+	  nat44_ed_get_in2out_worker_index (0, &ip, fib_index, 0));
+      else
+	tsm = vec_elt_at_index (sm->per_thread_data, sm->num_workers);
+
+      if (clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+	{
+	  return VNET_API_ERROR_NO_SUCH_ENTRY;
+	}
     }
 
   if (pool_is_free_index (tsm->sessions, ed_value_get_session_index (&value)))
     return VNET_API_ERROR_UNSPECIFIED;
   s = pool_elt_at_index (tsm->sessions, ed_value_get_session_index (&value));
   nat_free_session_data (sm, s, tsm - sm->per_thread_data, 0);
-  nat_ed_session_delete (sm, s, tsm - sm->per_thread_data, 1);
+  nat_ed_session_delete (sm, s, tsm - sm->per_thread_data);
+  return 0;
+}
+
+#define foreach_nat44_ed_expire_error                                         \
+  _ (EXPIRED, "expired sessions")
+
+typedef enum
+{
+#define _(sym, str) NAT44_ED_EXPIRE_ERROR_##sym,
+  foreach_nat44_ed_expire_error
+#undef _
+    NAT44_ED_EXPIRE_N_ERROR,
+} nat44_ed_expire_error_t;
+
+static char *nat44_ed_expire_error_strings[] = {
+#define _(sym, string) string,
+  foreach_nat44_ed_expire_error
+#undef _
+};
+
+/*
+ * Per thread session expiry walk, reclaims the sessions whose expiry timer
+ * fired, and those the packet path found expired and queued. Timers fire no
+ * later than the session expires, a session heard of since its timer was
+ * started gets its timer re-armed for the time left.
+ * At most NAT_ED_EXPIRE_WALK_BUDGET sessions are handled per dispatch, the
+ * rest is left for the next one.
+ */
+static uword
+nat44_ed_expire_walk_fn (vlib_main_t *vm, vlib_node_runtime_t *node,
+			 vlib_frame_t *frame)
+{
+  snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm;
+  u32 thread_index = vm->thread_index;
+  u32 n_walked = 0, n_expired = 0, *si;
+  snat_session_t *s;
+  f64 now, expire;
+
+  if (!sm->enabled || !sm->pat)
+    return 0;
+
+  tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+  now = vlib_time_now (vm);
+
+  if (vec_len (tsm->expired_sessions) < NAT_ED_EXPIRE_WALK_BUDGET)
+    {
+      u32 i = vec_len (tsm->expired_sessions);
+
+      tsm->expired_sessions = tw_timer_expire_timers_vec_1t_3w_1024sl_ov (
+	&tsm->session_timers, now, tsm->expired_sessions);
+
+      for (; i < vec_len (tsm->expired_sessions); i++)
+	{
+	  s = pool_elt_at_index (tsm->sessions, tsm->expired_sessions[i]);
+	  s->timer_handle = ~0;
+	}
+    }
+
+  vec_foreach (si, tsm->expired_sessions)
+    {
+      if (n_walked == NAT_ED_EXPIRE_WALK_BUDGET)
+	break;
+      n_walked++;
+
+      /* deleted or re-armed since its timer fired */
+      if (pool_is_free_index (tsm->sessions, *si))
+	continue;
+      s = pool_elt_at_index (tsm->sessions, *si);
+      if (s->timer_handle != ~0)
+	continue;
+
+      expire = nat44_session_get_expire_time (sm, s, s->last_heard);
+      if (nat44_ed_is_session_expired (s) || now >= expire)
+	{
+	  nat_free_session_data (sm, s, thread_index, 0);
+	  nat_ed_session_delete (sm, s, thread_index);
+	  n_expired++;
+	}
+      else
+	nat_ed_session_timer_start (tsm, s, now, expire);
+    }
+
+  if (n_walked)
+    vec_delete (tsm->expired_sessions, n_walked, 0);
+
+  vlib_node_increment_counter (vm, node->node_index,
+			       NAT44_ED_EXPIRE_ERROR_EXPIRED, n_expired);
+  return 0;
+}
+
+VLIB_REGISTER_NODE (nat44_ed_expire_walk_node) = {
+  .function = nat44_ed_expire_walk_fn,
+  .name = "nat44-ed-expire-walk",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_INTERRUPT,
+  .n_errors = NAT44_ED_EXPIRE_N_ERROR,
+  .error_strings = nat44_ed_expire_error_strings,
+};
+
+/*
+ * Main thread process interrupting the expiry walk of each thread once
+ * per timer tick, or right away while a walk has sessions left over.
+ */
+static uword
+nat44_ed_expire_process_fn (vlib_main_t *vm, vlib_node_runtime_t *rt,
+			    vlib_frame_t *f)
+{
+  snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm;
+  vlib_main_t *thread_vm;
+  f64 timeout;
+
+  while (1)
+    {
+      if (!sm->enabled || !sm->pat)
+	{
+	  /* wait for the plugin to be enabled */
+	  vlib_process_wait_for_event (vm);
+	  vlib_process_get_events (vm, 0);
+	  continue;
+	}
+
+      timeout = NAT_ED_SESSION_TIMER_TICK;
+      vec_foreach (tsm, sm->per_thread_data)
+	{
+	  thread_vm = vlib_get_main_by_index (tsm - sm->per_thread_data);
+	  if (!thread_vm)
+	    continue;
+	  vlib_node_set_interrupt_pending (thread_vm,
+					   nat44_ed_expire_walk_node.index);
+	  if (vec_len (tsm->expired_sessions))
+	    timeout = 1e-4;
+	}
+      vlib_process_suspend (vm, timeout);
+    }
   return 0;
 }
 
+VLIB_REGISTER_NODE (nat44_ed_expire_process_node) = {
+  .function = nat44_ed_expire_process_fn,
+  .name = "nat44-ed-expire-process",
+  .type = VLIB_NODE_TYPE_PROCESS,
+};
+
 VLIB_NODE_FN (nat_default_node) (vlib_main_t * vm,
 				 vlib_node_runtime_t * node,
 				 vlib_frame_t * frame)
@@ -31,6 +31,7 @@
 #include <vppinfra/hash.h>
 #include <vppinfra/dlist.h>
 #include <vppinfra/error.h>
+#include <vppinfra/tw_timer_1t_3w_1024sl_ov.h>
 #include <vlibapi/api.h>
 
 #include <nat/lib/lib.h>
@@ -39,6 +40,12 @@
 /* default number of worker handoff frame queue elements */
 #define NAT_FQ_NELTS_DEFAULT 64
 
+/* session expiry timer wheel tick in seconds */
+#define NAT_ED_SESSION_TIMER_TICK 0.1
+
+/* maximum number of expired session timers handled per walk dispatch */
+#define NAT_ED_EXPIRE_WALK_BUDGET 256
+
 /* NAT buffer flags */
 #define SNAT_FLAG_HAIRPINNING (1 << 0)
 
@@ -47,7 +54,8 @@
   _ (0x00, IS_ENDPOINT_INDEPENDENT)                                           \
   _ (0x01, IS_ENDPOINT_DEPENDENT)                                             \
   _ (0x02, IS_STATIC_MAPPING_ONLY)                                            \
-  _ (0x04, IS_CONNECTION_TRACKING)
+  _ (0x04, IS_CONNECTION_TRACKING)                                            \
+  _ (0x10, IS_PER_WORKER_FLOWS)
 
 typedef enum nat44_config_flags_t_
 {
@@ -61,6 +69,7 @@ typedef struct
   /* nat44 plugin features */
   u8 static_mapping_only;
   u8 connection_tracking;
+  u8 per_worker_flows;
 
   u32 inside_vrf;
   u32 outside_vrf;
@@ -180,6 +189,8 @@ typedef enum
 #define SNAT_SESSION_FLAG_AFFINITY	     (1 << 6)
 #define SNAT_SESSION_FLAG_EXACT_ADDRESS	     (1 << 7)
 #define SNAT_SESSION_FLAG_HAIRPINNING	     (1 << 8)
+#define SNAT_SESSION_FLAG_PORT_BLOCK	     (1 << 9)
+#define SNAT_SESSION_FLAG_EXPIRED	     (1 << 10)
 
 /* NAT interface flags */
 #define NAT_INTERFACE_FLAG_IS_INSIDE 1
@@ -316,11 +327,9 @@ typedef CLIB_PACKED(struct
   /* Flags */
   u32 flags;
 
-  /* head of LRU list in which this session is tracked */
-  u32 lru_head_index;
-  /* index in global LRU list */
-  u32 lru_index;
-  f64 last_lru_update;
+  /* expiry timer handle, ~0 while the timer has fired and the session
+   * waits for the expire walk */
+  u32 timer_handle;
 
   /* Last heard timer */
   f64 last_heard;
@@ -362,8 +371,31 @@ typedef struct
   u32 busy_##n##_port_refcounts[65535];
   foreach_nat_protocol
 #undef _
+  /* port block allocation - bitmap of the busy blocks of each thread's
+   * port range, indexed by thread index */
+  uword **busy_port_blocks_per_thread;
 } snat_address_t;
 
+/* block of outside ports owned by a subscriber */
+typedef struct
+{
+  /* subscriber address and fib index */
+  ip4_address_t user_addr;
+  u32 user_fib_index;
+  /* outside address */
+  ip4_address_t addr;
+  /* first port of the block in host byte order */
+  u16 start_port;
+  /* offset in the block of the port to try next */
+  u16 cursor;
+  /* number of sessions using the block */
+  u32 n_sessions;
+  /* next block of the same subscriber, ~0 for the last one */
+  u32 next;
+  /* every port was found in use, skipped until one of its sessions ends */
+  u8 full;
+} nat_ed_port_block_t;
+
 typedef struct
 {
   u32 fib_index;
@@ -473,13 +505,16 @@ typedef struct
   /* Pool of doubly-linked list elements */
   dlist_elt_t *list_pool;
 
-  /* LRU session list - head is stale, tail is fresh */
-  dlist_elt_t *lru_pool;
-  u32 tcp_trans_lru_head_index;
-  u32 tcp_estab_lru_head_index;
-  u32 udp_lru_head_index;
-  u32 icmp_lru_head_index;
-  u32 unk_proto_lru_head_index;
+  /* session expiry timers */
+  TWT (tw_timer_wheel) session_timers;
+
+  /* sessions whose timer fired, pending the expire walk */
+  u32 *expired_sessions;
+
+  /* port blocks owned by the subscribers of this thread */
+  nat_ed_port_block_t *port_blocks;
+  /* subscriber (fib index, address) to the index of its newest block */
+  uword *port_block_by_user;
 
   /* NAT thread index */
   u32 snat_thread_index;
@@ -489,6 +524,10 @@ typedef struct
 
   per_vrf_sessions_t *per_vrf_sessions_vec;
 
+  /* Endpoint dependent lookup table of this worker's sessions,
+   * used instead of the shared one with per worker flows */
+  clib_bihash_16_8_t flow_hash;
+
 } snat_main_per_thread_data_t;
 
 struct snat_main_s;
@@ -593,6 +632,15 @@ typedef struct snat_main_s
   u8 static_mapping_only;
   u8 static_mapping_connection_tracking;
 
+  /* Each worker keeps its own flow table, in2out packets are not handed
+   * off, out2in packets are handed off to the worker whose port range the
+   * outside port belongs to */
+  u8 per_worker_flows;
+
+  /* Port block allocation - number of outside ports allocated to
+   * a subscriber at once, 0 if ports are allocated one by one */
+  u16 port_block_size;
+
   /* Is translation memory size calculated or user defined */
   u8 translation_memory_size_set;
 
@@ -693,6 +741,8 @@ extern snat_main_t snat_main;
 
 // nat pre ed next_node feature classification
 extern vlib_node_registration_t nat_default_node;
+extern vlib_node_registration_t nat44_ed_expire_walk_node;
+extern vlib_node_registration_t nat44_ed_expire_process_node;
 extern vlib_node_registration_t nat_pre_in2out_node;
 extern vlib_node_registration_t nat_pre_out2in_node;
 
@@ -790,6 +840,27 @@ nat44_ed_is_exact_address_session (snat_session_t *s)
   return s->flags & SNAT_SESSION_FLAG_EXACT_ADDRESS;
 }
 
+/** \brief Check if NAT session got its outside port from a port block.
+    @param s NAT session
+    @return true if NAT session port is from a port block
+*/
+always_inline bool
+nat44_ed_is_port_block_session (snat_session_t *s)
+{
+  return s->flags & SNAT_SESSION_FLAG_PORT_BLOCK;
+}
+
+/** \brief Check if NAT session was found expired by the packet path and
+    only waits for the expire walk to reclaim it.
+    @param s NAT session
+    @return true if NAT session is unlinked from the flow hash
+*/
+always_inline bool
+nat44_ed_is_session_expired (snat_session_t *s)
+{
+  return s->flags & SNAT_SESSION_FLAG_EXPIRED;
+}
+
 /** \brief Check if NAT interface is inside.
     @param i NAT interface
     @return true if inside interface
@@ -1046,6 +1117,19 @@ void nat44_ed_sessions_clear ();
 
 int nat44_ed_set_frame_queue_nelts (u32 frame_queue_nelts);
 
+int nat44_ed_set_port_block_size (u16 port_block_size);
+
+nat_ed_port_block_t *nat44_ed_port_block_alloc (snat_main_t *sm,
+						u32 thread_index,
+						ip4_address_t user_addr,
+						u32 user_fib_index);
+
+void nat44_ed_port_block_free (snat_main_t *sm, u32 thread_index,
+			       nat_ed_port_block_t *pb);
+
+void nat44_ed_port_block_put_port (snat_main_t *sm, u32 thread_index,
+				   snat_session_t *s);
+
 typedef enum
 {
   NAT_ED_TRNSL_ERR_SUCCESS = 0,
@@ -49,6 +49,7 @@ vl_api_nat44_ed_plugin_enable_disable_t_handler (
     {
       c.static_mapping_only = mp->flags & NAT44_API_IS_STATIC_MAPPING_ONLY;
       c.connection_tracking = mp->flags & NAT44_API_IS_CONNECTION_TRACKING;
+      c.per_worker_flows = mp->flags & NAT44_API_IS_PER_WORKER_FLOWS;
 
       c.inside_vrf = ntohl (mp->inside_vrf);
       c.outside_vrf = ntohl (mp->outside_vrf);
@@ -91,6 +92,32 @@ vl_api_nat44_ed_show_fq_options_t_handler (
   /* clang-format on */
 }
 
+static void
+vl_api_nat44_ed_set_port_block_size_t_handler (
+  vl_api_nat44_ed_set_port_block_size_t *mp)
+{
+  snat_main_t *sm = &snat_main;
+  vl_api_nat44_ed_set_port_block_size_reply_t *rmp;
+  int rv = 0;
+  rv = nat44_ed_set_port_block_size (ntohs (mp->port_block_size));
+  REPLY_MACRO (VL_API_NAT44_ED_SET_PORT_BLOCK_SIZE_REPLY);
+}
+
+static void
+vl_api_nat44_ed_show_port_block_size_t_handler (
+  vl_api_nat44_ed_show_port_block_size_t *mp)
+{
+  snat_main_t *sm = &snat_main;
+  vl_api_nat44_ed_show_port_block_size_reply_t *rmp;
+  int rv = 0;
+  /* clang-format off */
+  REPLY_MACRO2_ZERO (VL_API_NAT44_ED_SHOW_PORT_BLOCK_SIZE_REPLY,
+  ({
+    rmp->port_block_size = htons (sm->port_block_size);
+  }));
+  /* clang-format on */
+}
+
 /* Old API calls hold back because of deprecation
  * nat44_ed replacement should be used */
 
@@ -1443,6 +1470,8 @@ vl_api_nat44_show_running_config_t_handler (
 	rmp->flags |= NAT44_IS_STATIC_MAPPING_ONLY;
       if (rc->connection_tracking)
 	rmp->flags |= NAT44_IS_CONNECTION_TRACKING;
+      if (rc->per_worker_flows)
+	rmp->flags |= NAT44_IS_PER_WORKER_FLOWS;
     }));
 }
 
@@ -1661,6 +1690,21 @@ vl_api_nat44_user_session_dump_t_handler (vl_api_nat44_user_session_dump_t *
   clib_memcpy (&ukey.addr, mp->ip_address, 4);
   ip.src_address.as_u32 = ukey.addr.as_u32;
   ukey.fib_index = fib_table_find (FIB_PROTOCOL_IP4, ntohl (mp->vrf_id));
+
+  if (sm->per_worker_flows)
+    {
+      // user's sessions might be spread across all workers
+      vec_foreach (tsm, sm->per_thread_data)
+	{
+	  pool_foreach (s, tsm->sessions)
+	    {
+	      if (s->in2out.addr.as_u32 == ukey.addr.as_u32)
+		send_nat44_user_session_details (s, reg, mp->context);
+	    }
+	}
+      return;
+    }
+
   if (sm->num_workers > 1)
     tsm = vec_elt_at_index (
       sm->per_thread_data,
@@ -54,6 +54,8 @@ nat44_ed_enable_disable_command_fn (vlib_main_t *vm, unformat_input_t *input,
 	      c.connection_tracking = 1;
 	    }
 	}
+      else if (unformat (line_input, "per-worker-flows"))
+	c.per_worker_flows = 1;
       else if (unformat (line_input, "inside-vrf %u", &c.inside_vrf));
       else if (unformat (line_input, "outside-vrf %u", &c.outside_vrf));
       else if (unformat (line_input, "sessions %u", &c.sessions));
@@ -288,12 +290,14 @@ nat44_show_hash_command_fn (vlib_main_t * vm, unformat_input_t * input,
   vlib_cli_output (vm, "%U",
 		   format_bihash_8_8, &sm->static_mapping_by_external,
 		   verbose);
-      vlib_cli_output (vm, "%U", format_bihash_16_8, &sm->flow_hash, verbose);
+  if (!sm->per_worker_flows)
+    vlib_cli_output (vm, "%U", format_bihash_16_8, &sm->flow_hash, verbose);
   vec_foreach_index (i, sm->per_thread_data)
   {
     vlib_cli_output (vm, "-------- thread %d %s --------\n",
 		     i, vlib_worker_threads[i].name);
-    vlib_cli_output (vm, "%U", format_bihash_16_8, &sm->flow_hash, verbose);
+    vlib_cli_output (vm, "%U", format_bihash_16_8, nat_ed_flow_hash (sm, i),
+		     verbose);
   }
 
       vlib_cli_output (vm, "%U", format_bihash_16_8, &nam->affinity_hash,
@@ -453,37 +457,10 @@ done:
 }
 
 static void
-nat44_show_lru_summary (vlib_main_t * vm, snat_main_per_thread_data_t * tsm,
-			u64 now, u64 sess_timeout_time)
+nat44_show_expiry_summary (vlib_main_t *vm, snat_main_per_thread_data_t *tsm)
 {
-  snat_main_t *sm = &snat_main;
-  dlist_elt_t *oldest_elt;
-  snat_session_t *s;
-  u32 oldest_index;
-
-  if (tsm->lru_pool)
-    {
-#define _(n, d)                                                               \
-  oldest_index =                                                              \
-    clib_dlist_remove_head (tsm->lru_pool, tsm->n##_lru_head_index);          \
-  if (~0 != oldest_index)                                                     \
-    {                                                                         \
-      oldest_elt = pool_elt_at_index (tsm->lru_pool, oldest_index);           \
-      s = pool_elt_at_index (tsm->sessions, oldest_elt->value);               \
-      sess_timeout_time =                                                     \
-	s->last_heard + (f64) nat44_session_get_timeout (sm, s);              \
-      vlib_cli_output (vm, d " LRU min session timeout %llu (now %llu)",      \
-		       sess_timeout_time, now);                               \
-      clib_dlist_addhead (tsm->lru_pool, tsm->n##_lru_head_index,             \
-			  oldest_index);                                      \
-    }
-      _ (tcp_estab, "established tcp");
-      _ (tcp_trans, "transitory tcp");
-      _ (udp, "udp");
-      _ (unk_proto, "unknown protocol");
-      _ (icmp, "icmp");
-#undef _
-    }
+  vlib_cli_output (vm, "sessions pending expiry walk: %u",
+		   vec_len (tsm->expired_sessions));
 }
 
 static clib_error_t *
@@ -515,6 +492,9 @@ nat44_show_summary_command_fn (vlib_main_t * vm, unformat_input_t * input,
     vlib_cli_output (vm, "max translations per thread: %u fib %u",
 		     sm->max_translations_per_fib[fib], fib);
 
+  if (sm->port_block_size)
+    vlib_cli_output (vm, "port block size: %u", sm->port_block_size);
+
   if (sm->num_workers > 1)
     {
       vec_foreach (tsm, sm->per_thread_data)
@@ -557,7 +537,7 @@ nat44_show_summary_command_fn (vlib_main_t * vm, unformat_input_t * input,
                 break;
               }
           }
-          nat44_show_lru_summary (vm, tsm, now, sess_timeout_time);
+          nat44_show_expiry_summary (vm, tsm);
           count += pool_elts (tsm->sessions);
         }
     }
@@ -602,7 +582,7 @@ nat44_show_summary_command_fn (vlib_main_t * vm, unformat_input_t * input,
             break;
           }
       }
-      nat44_show_lru_summary (vm, tsm, now, sess_timeout_time);
+      nat44_show_expiry_summary (vm, tsm);
       count = pool_elts (tsm->sessions);
     }
 
@@ -626,6 +606,8 @@ nat44_show_addresses_command_fn (vlib_main_t * vm, unformat_input_t * input,
 {
   snat_main_t *sm = &snat_main;
   snat_address_t *ap;
+  uword **bitmap;
+  u32 busy_blocks;
 
   vlib_cli_output (vm, "NAT44 pool addresses:");
   vec_foreach (ap, sm->addresses)
@@ -640,6 +622,13 @@ nat44_show_addresses_command_fn (vlib_main_t * vm, unformat_input_t * input,
       vlib_cli_output (vm, "  %d busy %s ports", ap->busy_##n##_ports, s);
       foreach_nat_protocol
     #undef _
+      if (sm->port_block_size)
+	{
+	  busy_blocks = 0;
+	  vec_foreach (bitmap, ap->busy_port_blocks_per_thread)
+	    busy_blocks += clib_bitmap_count_set_bits (*bitmap);
+	  vlib_cli_output (vm, "  %u busy port blocks", busy_blocks);
+	}
     }
   vlib_cli_output (vm, "NAT44 twice-nat pool addresses:");
   vec_foreach (ap, sm->twice_nat_addresses)
@@ -1732,6 +1721,44 @@ done:
   return error;
 }
 
+static clib_error_t *
+set_port_block_size_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  clib_error_t *error = 0;
+  u32 port_block_size = ~0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, NAT44_ED_EXPECTED_ARGUMENT);
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "%u", &port_block_size))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+  if (port_block_size > 0xffff)
+    {
+      error = clib_error_return (0, "invalid port block size");
+      goto done;
+    }
+  if (nat44_ed_set_port_block_size (port_block_size) != 0)
+    {
+      error = clib_error_return (0, "port block size exceeds the number of "
+				    "ports per thread");
+      goto done;
+    }
+done:
+  unformat_free (line_input);
+  return error;
+}
+
 /*?
  * @cliexpar
  * @cliexstart{nat44}
@@ -1744,12 +1771,16 @@ done:
  *  vpp# nat44-ed enable static-mapping connection-tracking
  * To set inside-vrf outside-vrf, use:
  *  vpp# nat44 enable inside-vrf <id> outside-vrf <id>
+ * To keep a flow table per worker and never hand off packets between
+ * workers, when both directions of every flow are steered to the same
+ * worker, use:
+ *  vpp# nat44 enable per-worker-flows
  * @cliexend
 ?*/
 VLIB_CLI_COMMAND (nat44_ed_enable_disable_command, static) = {
   .path = "nat44",
   .short_help = "nat44 <enable [sessions <max-number>] [static-mapping-only "
-		"connection-tracking] [inside-vrf <vrf-id>] "
+		"connection-tracking] [per-worker-flows] [inside-vrf <vrf-id>] "
 		"[outside-vrf <vrf-id>]>|disable",
   .function = nat44_ed_enable_disable_command_fn,
 };
@@ -1829,6 +1860,20 @@ VLIB_CLI_COMMAND (set_frame_queue_nelts_command, static) = {
   .short_help = "set nat frame-queue-nelts <number>",
 };
 
+/*?
+ * @cliexpar
+ * @cliexstart{set nat44 port-block-size}
+ * Allocate outside ports to each inside host in blocks of given size and
+ * log only the block allocation instead of every session, 0 disables:
+ *  vpp# set nat44 port-block-size 64
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (set_port_block_size_command, static) = {
+  .path = "set nat44 port-block-size",
+  .function = set_port_block_size_command_fn,
+  .short_help = "set nat44 port-block-size <size>",
+};
+
 /*?
  * @cliexpar
  * @cliexstart{nat set logging level}
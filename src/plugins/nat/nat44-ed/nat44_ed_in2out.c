@@ -164,6 +164,27 @@ snat_not_translate_fast (snat_main_t *sm, vlib_node_runtime_t *node,
   return 1;
 }
 
+static_always_inline int
+nat_ed_alloc_port_refcount_inc (snat_main_t *sm, snat_address_t *a,
+				u32 nat_proto, u32 thread_index, u16 port)
+{
+#define _(N, i, n, s)                                                         \
+  case NAT_PROTOCOL_##N:                                                      \
+    ++a->busy_##n##_port_refcounts[port];                                     \
+    a->busy_##n##_ports_per_thread[thread_index]++;                           \
+    a->busy_##n##_ports++;                                                    \
+    break;
+  switch (nat_proto)
+    {
+      foreach_nat_protocol;
+    default:
+      nat_elog_info (sm, "unknown protocol");
+      return 1;
+    }
+#undef _
+  return 0;
+}
+
 static int
 nat_ed_alloc_addr_and_port_with_snat_address (
   snat_main_t *sm, u32 nat_proto, u32 thread_index, snat_address_t *a,
@@ -194,20 +215,9 @@ nat_ed_alloc_addr_and_port_with_snat_address (
       s->o2i.match.dport = clib_host_to_net_u16 (port);
       if (0 == nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 2))
 	{
-#define _(N, i, n, s)                                                         \
-  case NAT_PROTOCOL_##N:                                                      \
-    ++a->busy_##n##_port_refcounts[port];                                     \
-    a->busy_##n##_ports_per_thread[thread_index]++;                           \
-    a->busy_##n##_ports++;                                                    \
-    break;
-	  switch (nat_proto)
-	    {
-	      foreach_nat_protocol;
-	    default:
-	      nat_elog_info (sm, "unknown protocol");
-	      return 1;
-	    }
-#undef _
+	  if (nat_ed_alloc_port_refcount_inc (sm, a, nat_proto, thread_index,
+					      port))
+	    return 1;
 	  *outside_addr = a->addr;
 	  *outside_port = clib_host_to_net_u16 (port);
 	  return 0;
@@ -276,6 +286,117 @@ nat_ed_alloc_addr_and_port (snat_main_t *sm, u32 rx_fib_index, u32 nat_proto,
   return 1;
 }
 
+static_always_inline int
+nat_ed_block_port_try (snat_main_t *sm, u32 nat_proto, u32 thread_index,
+		       snat_session_t *s, u16 port)
+{
+  if (NAT_PROTOCOL_ICMP == nat_proto)
+    {
+      s->o2i.match.sport = clib_host_to_net_u16 (port);
+    }
+  s->o2i.match.dport = clib_host_to_net_u16 (port);
+  return nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 2);
+}
+
+static int
+nat_ed_alloc_port_from_block (snat_main_t *sm, u32 nat_proto,
+			      u32 thread_index, nat_ed_port_block_t *pb,
+			      snat_session_t *s, ip4_address_t *outside_addr,
+			      u16 *outside_port)
+{
+  const u16 size = sm->port_block_size;
+  snat_address_t *a;
+  u16 port, i;
+
+  if (pb->full)
+    return 1;
+
+  a = nat44_ed_get_address (sm, pb->addr);
+  if (!a)
+    return 1;
+
+  s->o2i.match.daddr = pb->addr;
+  /* first try port suggested by caller */
+  port = clib_net_to_host_u16 (*outside_port);
+  if (port >= pb->start_port && port < pb->start_port + size &&
+      0 == nat_ed_block_port_try (sm, nat_proto, thread_index, s, port))
+    goto found;
+
+  /* then go on from where the previous allocation stopped, so that ports
+   * handed out before are not probed again */
+  for (i = 0; i < size; i++)
+    {
+      port = pb->start_port + pb->cursor;
+      if (++pb->cursor == size)
+	pb->cursor = 0;
+      if (0 == nat_ed_block_port_try (sm, nat_proto, thread_index, s, port))
+	goto found;
+    }
+
+  /* skip the block until one of its sessions ends */
+  pb->full = 1;
+  return 1;
+
+found:
+  if (nat_ed_alloc_port_refcount_inc (sm, a, nat_proto, thread_index, port))
+    return 1;
+  pb->n_sessions++;
+  *outside_addr = pb->addr;
+  *outside_port = clib_host_to_net_u16 (port);
+  return 0;
+}
+
+static int
+nat_ed_port_block_alloc_addr_and_port (snat_main_t *sm, u32 rx_fib_index,
+				       u32 nat_proto, u32 thread_index,
+				       ip4_address_t s_addr, snat_session_t *s,
+				       ip4_address_t *outside_addr,
+				       u16 *outside_port)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  nat_ed_port_block_t *pb;
+  uword *p;
+  u32 i;
+
+  /* first try the blocks the subscriber already owns */
+  p = hash_get (tsm->port_block_by_user,
+		nat_ed_port_block_user_key (s_addr, rx_fib_index));
+  for (i = p ? p[0] : ~0; i != ~0; i = pb->next)
+    {
+      pb = pool_elt_at_index (tsm->port_blocks, i);
+      if (!nat_ed_alloc_port_from_block (sm, nat_proto, thread_index, pb, s,
+					 outside_addr, outside_port))
+	return 0;
+    }
+
+  pb = nat44_ed_port_block_alloc (sm, thread_index, s_addr, rx_fib_index);
+  if (!pb)
+    {
+      /* a block full towards one destination may still have ports free
+       * towards this one, look again before giving up */
+      for (i = p ? p[0] : ~0; i != ~0; i = pb->next)
+	{
+	  pb = pool_elt_at_index (tsm->port_blocks, i);
+	  if (!pb->full)
+	    continue;
+	  pb->full = 0;
+	  if (!nat_ed_alloc_port_from_block (sm, nat_proto, thread_index, pb,
+					     s, outside_addr, outside_port))
+	    return 0;
+	}
+      nat_ipfix_logging_addresses_exhausted (thread_index, 0);
+      return 1;
+    }
+
+  if (nat_ed_alloc_port_from_block (sm, nat_proto, thread_index, pb, s,
+				    outside_addr, outside_port))
+    {
+      nat44_ed_port_block_free (sm, thread_index, pb);
+      return 1;
+    }
+  return 0;
+}
+
 static_always_inline u32
 nat_outside_fib_index_lookup (snat_main_t * sm, ip4_address_t addr)
 {
@@ -352,14 +473,11 @@ slow_path_ed (vlib_main_t *vm, snat_main_t *sm, vlib_buffer_t *b,
   if (PREDICT_FALSE
       (nat44_ed_maximum_sessions_exceeded (sm, rx_fib_index, thread_index)))
     {
-      if (!nat_lru_free_one (sm, thread_index, now))
-	{
-	  b->error = node->errors[NAT_IN2OUT_ED_ERROR_MAX_SESSIONS_EXCEEDED];
-	  nat_ipfix_logging_max_sessions (thread_index,
-					  sm->max_translations_per_thread);
-	  nat_elog_notice (sm, "maximum sessions exceeded");
-	  return NAT_NEXT_DROP;
-	}
+      b->error = node->errors[NAT_IN2OUT_ED_ERROR_MAX_SESSIONS_EXCEEDED];
+      nat_ipfix_logging_max_sessions (thread_index,
+				      sm->max_translations_per_thread);
+      nat_elog_notice (sm, "maximum sessions exceeded");
+      return NAT_NEXT_DROP;
     }
 
   outside_fib_index = sm->outside_fib_index;
@@ -442,14 +560,27 @@ slow_path_ed (vlib_main_t *vm, snat_main_t *sm, vlib_buffer_t *b,
 	}
       nat_6t_flow_txfib_rewrite_set (&s->o2i, rx_fib_index);
 
-      if (nat_ed_alloc_addr_and_port (
-	    sm, rx_fib_index, nat_proto, thread_index, l_addr,
-	    sm->port_per_thread, tsm->snat_thread_index, s, &outside_addr,
-	    &outside_port))
+      if (sm->port_block_size)
+	{
+	  if (nat_ed_port_block_alloc_addr_and_port (
+		sm, rx_fib_index, nat_proto, thread_index, l_addr, s,
+		&outside_addr, &outside_port))
+	    {
+	      nat_elog_notice (sm, "addresses exhausted");
+	      b->error = node->errors[NAT_IN2OUT_ED_ERROR_OUT_OF_PORTS];
+	      nat_ed_session_delete (sm, s, thread_index);
+	      return NAT_NEXT_DROP;
+	    }
+	  s->flags |= SNAT_SESSION_FLAG_PORT_BLOCK;
+	}
+      else if (nat_ed_alloc_addr_and_port (
+		 sm, rx_fib_index, nat_proto, thread_index, l_addr,
+		 sm->port_per_thread, tsm->snat_thread_index, s,
+		 &outside_addr, &outside_port))
 	{
 	  nat_elog_notice (sm, "addresses exhausted");
 	  b->error = node->errors[NAT_IN2OUT_ED_ERROR_OUT_OF_PORTS];
-	  nat_ed_session_delete (sm, s, thread_index, 1);
+	  nat_ed_session_delete (sm, s, thread_index);
 	  return NAT_NEXT_DROP;
 	}
       s->out2in.addr = outside_addr;
@@ -520,18 +651,20 @@ slow_path_ed (vlib_main_t *vm, snat_main_t *sm, vlib_buffer_t *b,
       goto error;
     }
 
-  /* log NAT event */
-  nat_ipfix_logging_nat44_ses_create (thread_index,
-				      s->in2out.addr.as_u32,
-				      s->out2in.addr.as_u32,
-				      s->nat_proto,
-				      s->in2out.port,
-				      s->out2in.port, s->in2out.fib_index);
-
-  nat_syslog_nat44_sadd (0, s->in2out.fib_index, &s->in2out.addr,
-			 s->in2out.port, &s->ext_host_nat_addr,
-			 s->ext_host_nat_port, &s->out2in.addr, s->out2in.port,
-			 &s->ext_host_addr, s->ext_host_port, s->nat_proto, 0);
+  /* log NAT event, sessions of a port block are covered by the block
+   * allocation record */
+  if (!nat44_ed_is_port_block_session (s))
+    {
+      nat_ipfix_logging_nat44_ses_create (
+	thread_index, s->in2out.addr.as_u32, s->out2in.addr.as_u32,
+	s->nat_proto, s->in2out.port, s->out2in.port, s->in2out.fib_index);
+
+      nat_syslog_nat44_sadd (0, s->in2out.fib_index, &s->in2out.addr,
+			     s->in2out.port, &s->ext_host_nat_addr,
+			     s->ext_host_nat_port, &s->out2in.addr,
+			     s->out2in.port, &s->ext_host_addr,
+			     s->ext_host_port, s->nat_proto, 0);
+    }
 
   per_vrf_sessions_register_session (s, thread_index);
 
@@ -545,8 +678,10 @@ error:
 	  snat_free_outside_address_and_port (sm->addresses, thread_index,
 					      &outside_addr, outside_port,
 					      nat_proto);
+	  if (nat44_ed_is_port_block_session (s))
+	    nat44_ed_port_block_put_port (sm, thread_index, s);
 	}
-      nat_ed_session_delete (sm, s, thread_index, 1);
+      nat_ed_session_delete (sm, s, thread_index);
     }
   *sessionp = s = NULL;
   return NAT_NEXT_DROP;
@@ -565,7 +700,8 @@ nat44_ed_not_translate (vlib_main_t *vm, snat_main_t *sm,
 	     sm->outside_fib_index, ip->protocol);
 
   /* NAT packet aimed at external address if has active sessions */
-  if (clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (clib_bihash_search_16_8 (nat_ed_flow_hash (sm, vm->thread_index), &kv,
+			       &value))
     {
       /* or is static mappings */
       ip4_address_t placeholder_addr;
@@ -622,7 +758,8 @@ nat_not_translate_output_feature_fwd (snat_main_t * sm, ip4_header_t * ip,
 		 ip->protocol);
     }
 
-  if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (!clib_bihash_search_16_8 (nat_ed_flow_hash (sm, thread_index), &kv,
+				&value))
     {
       ASSERT (thread_index == ed_value_get_thread_index (&value));
       s =
@@ -639,8 +776,6 @@ nat_not_translate_output_feature_fwd (snat_main_t * sm, ip4_header_t * ip,
 	  nat44_session_update_counters (s, now,
 					 vlib_buffer_length_in_chain (vm, b),
 					 thread_index);
-	  /* Per-user LRU list maintenance */
-	  nat44_session_update_lru (sm, s, thread_index);
 	  return 1;
 	}
       else
@@ -667,7 +802,8 @@ nat44_ed_not_translate_output_feature (snat_main_t *sm, vlib_buffer_t *b,
   /* src NAT check */
   init_ed_k (&kv, ip->src_address, src_port, ip->dst_address, dst_port,
 	     tx_fib_index, ip->protocol);
-  if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (!clib_bihash_search_16_8 (nat_ed_flow_hash (sm, thread_index), &kv,
+				&value))
     {
       ASSERT (thread_index == ed_value_get_thread_index (&value));
       s =
@@ -677,7 +813,7 @@ nat44_ed_not_translate_output_feature (snat_main_t *sm, vlib_buffer_t *b,
 	  && (!s->tcp_closed_timestamp || now >= s->tcp_closed_timestamp))
 	{
 	  nat_free_session_data (sm, s, thread_index, 0);
-	  nat_ed_session_delete (sm, s, thread_index, 1);
+	  nat_ed_session_delete (sm, s, thread_index);
 	}
       return 1;
     }
@@ -705,7 +841,8 @@ nat44_ed_not_translate_output_feature (snat_main_t *sm, vlib_buffer_t *b,
 
   init_ed_k (&kv, ip->dst_address, dst_port, ip->src_address, src_port,
 	     rx_fib_index, ip->protocol);
-  if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (!clib_bihash_search_16_8 (nat_ed_flow_hash (sm, thread_index), &kv,
+				&value))
     {
       ASSERT (thread_index == ed_value_get_thread_index (&value));
       s =
@@ -805,8 +942,6 @@ out:
       /* Accounting */
       nat44_session_update_counters (
 	s, now, vlib_buffer_length_in_chain (vm, b), thread_index);
-      /* Per-user LRU list maintenance */
-      nat44_session_update_lru (sm, s, thread_index);
     }
   *s_p = s;
   return next;
@@ -868,7 +1003,8 @@ nat44_ed_in2out_slowpath_unknown_proto (snat_main_t *sm, vlib_buffer_t *b,
 	    {
 	      init_ed_k (&s_kv, s->out2in.addr, 0, ip->dst_address, 0,
 			 outside_fib_index, ip->protocol);
-	      if (clib_bihash_search_16_8 (&sm->flow_hash, &s_kv, &s_value))
+	      if (clib_bihash_search_16_8 (nat_ed_flow_hash (sm, thread_index),
+					   &s_kv, &s_value))
 		{
 		  new_src_addr = s->out2in.addr;
 		}
@@ -882,7 +1018,8 @@ nat44_ed_in2out_slowpath_unknown_proto (snat_main_t *sm, vlib_buffer_t *b,
 	    {
 	      init_ed_k (&s_kv, sm->addresses[i].addr, 0, ip->dst_address, 0,
 			 outside_fib_index, ip->protocol);
-	      if (clib_bihash_search_16_8 (&sm->flow_hash, &s_kv, &s_value))
+	      if (clib_bihash_search_16_8 (nat_ed_flow_hash (sm, thread_index),
+					   &s_kv, &s_value))
 		{
 		  new_src_addr = sm->addresses[i].addr;
 		}
@@ -937,14 +1074,14 @@ nat44_ed_in2out_slowpath_unknown_proto (snat_main_t *sm, vlib_buffer_t *b,
   if (nat_ed_ses_i2o_flow_hash_add_del (sm, thread_index, s, 1))
     {
       nat_elog_notice (sm, "in2out flow hash add failed");
-      nat_ed_session_delete (sm, s, thread_index, 1);
+      nat_ed_session_delete (sm, s, thread_index);
       return NULL;
     }
 
   if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 1))
     {
       nat_elog_notice (sm, "out2in flow hash add failed");
-      nat_ed_session_delete (sm, s, thread_index, 1);
+      nat_ed_session_delete (sm, s, thread_index);
       return NULL;
     }
 
@@ -953,8 +1090,6 @@ nat44_ed_in2out_slowpath_unknown_proto (snat_main_t *sm, vlib_buffer_t *b,
   /* Accounting */
   nat44_session_update_counters (s, now, vlib_buffer_length_in_chain (vm, b),
 				 thread_index);
-  /* Per-user LRU list maintenance */
-  nat44_session_update_lru (sm, s, thread_index);
 
   return s;
 }
@@ -1107,7 +1242,8 @@ nat44_ed_in2out_fast_path_node_fn_inline (vlib_main_t *vm,
 		 lookup.fib_index, lookup.proto);
 
       // lookup flow
-      if (clib_bihash_search_16_8 (&sm->flow_hash, &kv0, &value0))
+      if (clib_bihash_search_16_8 (nat_ed_flow_hash (sm, thread_index), &kv0,
+				   &value0))
 	{
 	  // flow does not exist go slow path
 	  next[0] = def_slow;
@@ -1125,9 +1261,8 @@ nat44_ed_in2out_fast_path_node_fn_inline (vlib_main_t *vm,
 
       if (PREDICT_FALSE (per_vrf_sessions_is_expired (s0, thread_index)))
 	{
-	  // session is closed, go slow path
-	  nat_free_session_data (sm, s0, thread_index, 0);
-	  nat_ed_session_delete (sm, s0, thread_index, 1);
+	  // session is closed, go slow path, freed by the expire walk
+	  nat_ed_session_expire (sm, s0, thread_index);
 	  next[0] = NAT_NEXT_OUT2IN_ED_SLOW_PATH;
 	  goto trace0;
 	}
@@ -1154,9 +1289,8 @@ nat44_ed_in2out_fast_path_node_fn_inline (vlib_main_t *vm,
 	s0->last_heard + (f64) nat44_session_get_timeout (sm, s0);
       if (now >= sess_timeout_time)
 	{
-	  nat_free_session_data (sm, s0, thread_index, 0);
-	  nat_ed_session_delete (sm, s0, thread_index, 1);
-	  // session is closed, go slow path
+	  // session is closed, go slow path, freed by the expire walk
+	  nat_ed_session_expire (sm, s0, thread_index);
 	  next[0] = def_slow;
 	  goto trace0;
 	}
@@ -1176,7 +1310,7 @@ nat44_ed_in2out_fast_path_node_fn_inline (vlib_main_t *vm,
 	{
 	  translation_error = NAT_ED_TRNSL_ERR_FLOW_MISMATCH;
 	  nat_free_session_data (sm, s0, thread_index, 0);
-	  nat_ed_session_delete (sm, s0, thread_index, 1);
+	  nat_ed_session_delete (sm, s0, thread_index);
 	  next[0] = NAT_NEXT_DROP;
 	  b0->error = node->errors[NAT_IN2OUT_ED_ERROR_TRNSL_FAILED];
 	  goto trace0;
@@ -1187,7 +1321,7 @@ nat44_ed_in2out_fast_path_node_fn_inline (vlib_main_t *vm,
 	     vm, sm, b0, ip0, f, proto0, is_output_feature)))
 	{
 	  nat_free_session_data (sm, s0, thread_index, 0);
-	  nat_ed_session_delete (sm, s0, thread_index, 1);
+	  nat_ed_session_delete (sm, s0, thread_index);
 	  next[0] = NAT_NEXT_DROP;
 	  b0->error = node->errors[NAT_IN2OUT_ED_ERROR_TRNSL_FAILED];
 	  goto trace0;
@@ -1218,8 +1352,6 @@ nat44_ed_in2out_fast_path_node_fn_inline (vlib_main_t *vm,
       nat44_session_update_counters (s0, now,
 				     vlib_buffer_length_in_chain (vm, b0),
 				     thread_index);
-      /* Per-user LRU list maintenance */
-      nat44_session_update_lru (sm, s0, thread_index);
 
     trace0:
       if (PREDICT_FALSE
@@ -1341,7 +1473,7 @@ nat44_ed_in2out_slow_path_node_fn_inline (vlib_main_t *vm,
 		   vm, sm, b0, ip0, &s0->i2o, proto0, is_output_feature)))
 	    {
 	      nat_free_session_data (sm, s0, thread_index, 0);
-	      nat_ed_session_delete (sm, s0, thread_index, 1);
+	      nat_ed_session_delete (sm, s0, thread_index);
 	      next[0] = NAT_NEXT_DROP;
 	      b0->error = node->errors[NAT_IN2OUT_ED_ERROR_TRNSL_FAILED];
 	      goto trace0;
@@ -1363,7 +1495,7 @@ nat44_ed_in2out_slow_path_node_fn_inline (vlib_main_t *vm,
 		   vm, sm, b0, ip0, &s0->i2o, proto0, is_output_feature)))
 	    {
 	      nat_free_session_data (sm, s0, thread_index, 0);
-	      nat_ed_session_delete (sm, s0, thread_index, 1);
+	      nat_ed_session_delete (sm, s0, thread_index);
 	      next[0] = NAT_NEXT_DROP;
 	      b0->error = node->errors[NAT_IN2OUT_ED_ERROR_TRNSL_FAILED];
 	      goto trace0;
@@ -1378,7 +1510,8 @@ nat44_ed_in2out_slow_path_node_fn_inline (vlib_main_t *vm,
 		 vnet_buffer (b0)->ip.reass.l4_src_port, ip0->dst_address,
 		 vnet_buffer (b0)->ip.reass.l4_dst_port, rx_fib_index0,
 		 ip0->protocol);
-      if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv0, &value0))
+      if (!clib_bihash_search_16_8 (nat_ed_flow_hash (sm, thread_index), &kv0,
+				    &value0))
 	{
 	  ASSERT (thread_index == ed_value_get_thread_index (&value0));
 	  s0 =
@@ -1388,7 +1521,7 @@ nat44_ed_in2out_slow_path_node_fn_inline (vlib_main_t *vm,
 	  if (s0->tcp_closed_timestamp && now >= s0->tcp_closed_timestamp)
 	    {
 	      nat_free_session_data (sm, s0, thread_index, 0);
-	      nat_ed_session_delete (sm, s0, thread_index, 1);
+	      nat_ed_session_delete (sm, s0, thread_index);
 	      s0 = NULL;
 	    }
 	}
@@ -1443,7 +1576,7 @@ nat44_ed_in2out_slow_path_node_fn_inline (vlib_main_t *vm,
 	     vm, sm, b0, ip0, &s0->i2o, proto0, is_output_feature)))
 	{
 	  nat_free_session_data (sm, s0, thread_index, 0);
-	  nat_ed_session_delete (sm, s0, thread_index, 1);
+	  nat_ed_session_delete (sm, s0, thread_index);
 	  next[0] = NAT_NEXT_DROP;
 	  b0->error = node->errors[NAT_IN2OUT_ED_ERROR_TRNSL_FAILED];
 	  goto trace0;
@@ -1465,8 +1598,6 @@ nat44_ed_in2out_slow_path_node_fn_inline (vlib_main_t *vm,
       nat44_session_update_counters (s0, now,
 				     vlib_buffer_length_in_chain
 				     (vm, b0), thread_index);
-      /* Per-user LRU list maintenance */
-      nat44_session_update_lru (sm, s0, thread_index);
 
     trace0:
       if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)
@@ -269,32 +269,53 @@ nat44_ed_maximum_sessions_exceeded (snat_main_t *sm, u32 fib_index,
   return translations >= sm->max_translations_per_fib[fib_index];
 }
 
-static_always_inline int
-nat_ed_lru_insert (snat_main_per_thread_data_t *tsm, snat_session_t *s,
-		   f64 now, u8 proto)
+/* time at which a session last heard of at given time may be reclaimed */
+always_inline f64
+nat44_session_get_expire_time (snat_main_t *sm, snat_session_t *s,
+			       f64 last_heard)
 {
-  dlist_elt_t *lru_list_elt;
-  pool_get (tsm->lru_pool, lru_list_elt);
-  s->lru_index = lru_list_elt - tsm->lru_pool;
-  switch (proto)
-    {
-    case IP_PROTOCOL_UDP:
-      s->lru_head_index = tsm->udp_lru_head_index;
-      break;
-    case IP_PROTOCOL_TCP:
-      s->lru_head_index = tsm->tcp_trans_lru_head_index;
-      break;
-    case IP_PROTOCOL_ICMP:
-      s->lru_head_index = tsm->icmp_lru_head_index;
-      break;
-    default:
-      s->lru_head_index = tsm->unk_proto_lru_head_index;
-      break;
-    }
-  clib_dlist_addtail (tsm->lru_pool, s->lru_head_index, s->lru_index);
-  lru_list_elt->value = s - tsm->sessions;
-  s->last_lru_update = now;
-  return 1;
+  f64 expire = last_heard + (f64) nat44_session_get_timeout (sm, s);
+
+  if (s->tcp_closed_timestamp && s->tcp_closed_timestamp < expire)
+    return s->tcp_closed_timestamp;
+  return expire;
+}
+
+static_always_inline u64
+nat_ed_session_timer_ticks (snat_main_per_thread_data_t *tsm, f64 now,
+			    f64 expire)
+{
+  if (expire <= now)
+    return 1;
+  return (u64) ((expire - now) * tsm->session_timers.ticks_per_second) + 1;
+}
+
+static_always_inline void
+nat_ed_session_timer_start (snat_main_per_thread_data_t *tsm,
+			    snat_session_t *s, f64 now, f64 expire)
+{
+  s->timer_handle = tw_timer_start_1t_3w_1024sl_ov (
+    &tsm->session_timers, s - tsm->sessions, 0,
+    nat_ed_session_timer_ticks (tsm, now, expire));
+}
+
+/* re-arm the timer of a session whose TCP state, and so its timeout, just
+ * changed; the expiry may move in or out. Packets which only refresh
+ * last_heard leave the timer alone, the expire walk re-arms timers firing
+ * early */
+static_always_inline void
+nat_ed_session_timer_update (snat_main_t *sm,
+			     snat_main_per_thread_data_t *tsm,
+			     snat_session_t *s, f64 now)
+{
+  /* already fired, the expire walk takes care of it */
+  if (s->timer_handle == ~0)
+    return;
+
+  tw_timer_update_1t_3w_1024sl_ov (
+    &tsm->session_timers, s->timer_handle,
+    nat_ed_session_timer_ticks (tsm, now,
+				nat44_session_get_expire_time (sm, s, now)));
 }
 
 static_always_inline void
@@ -313,6 +334,50 @@ nat_6t_flow_to_ed_kv (clib_bihash_kv_16_8_t *kv, nat_6t_flow_t *f,
 	      session_idx);
 }
 
+static_always_inline snat_address_t *
+nat44_ed_get_address (snat_main_t *sm, ip4_address_t addr)
+{
+  snat_address_t *a;
+
+  vec_foreach (a, sm->addresses)
+    {
+      if (a->addr.as_u32 == addr.as_u32)
+	return a;
+    }
+  return 0;
+}
+
+/* port block table key of a subscriber */
+static_always_inline u64
+nat_ed_port_block_user_key (ip4_address_t addr, u32 fib_index)
+{
+  return (u64) fib_index << 32 | addr.as_u32;
+}
+
+/* flow table holding the sessions of given thread */
+static_always_inline clib_bihash_16_8_t *
+nat_ed_flow_hash (snat_main_t *sm, u32 thread_index)
+{
+  if (sm->per_worker_flows)
+    return &vec_elt (sm->per_thread_data, thread_index).flow_hash;
+  return &sm->flow_hash;
+}
+
+/* in2out packets are handed off to the worker owning the inside host,
+ * with per-worker flows the receiving worker owns the session */
+static_always_inline int
+nat_ed_in2out_handoff_enabled (snat_main_t *sm)
+{
+  return sm->num_workers > 1 && !sm->per_worker_flows;
+}
+
+/* out2in packets are handed off to the worker owning the outside port */
+static_always_inline int
+nat_ed_out2in_handoff_enabled (snat_main_t *sm)
+{
+  return sm->num_workers > 1;
+}
+
 static_always_inline int
 nat_ed_ses_i2o_flow_hash_add_del (snat_main_t *sm, u32 thread_idx,
 				  snat_session_t *s, int is_add)
@@ -331,7 +396,8 @@ nat_ed_ses_i2o_flow_hash_add_del (snat_main_t *sm, u32 thread_idx,
     }
 
   ASSERT (thread_idx == s->thread_index);
-  return clib_bihash_add_del_16_8 (&sm->flow_hash, &kv, is_add);
+  return clib_bihash_add_del_16_8 (nat_ed_flow_hash (sm, thread_idx), &kv,
+				   is_add);
 }
 
 static_always_inline int
@@ -351,81 +417,54 @@ nat_ed_ses_o2i_flow_hash_add_del (snat_main_t *sm, u32 thread_idx,
       nat_6t_l3_l4_csum_calc (&s->o2i);
     }
   ASSERT (thread_idx == s->thread_index);
-  return clib_bihash_add_del_16_8 (&sm->flow_hash, &kv, is_add);
+  return clib_bihash_add_del_16_8 (nat_ed_flow_hash (sm, thread_idx), &kv,
+				   is_add);
 }
 
 always_inline void
-nat_ed_session_delete (snat_main_t *sm, snat_session_t *ses, u32 thread_index,
-		       int lru_delete
-		       /* delete from global LRU list */)
+nat_ed_session_delete (snat_main_t *sm, snat_session_t *ses, u32 thread_index)
 {
   snat_main_per_thread_data_t *tsm =
     vec_elt_at_index (sm->per_thread_data, thread_index);
 
-  if (lru_delete)
+  if (ses->timer_handle != ~0)
+    tw_timer_stop_1t_3w_1024sl_ov (&tsm->session_timers, ses->timer_handle);
+  /* the flow may have a new session under the same keys by now */
+  if (!nat44_ed_is_session_expired (ses))
     {
-      clib_dlist_remove (tsm->lru_pool, ses->lru_index);
+      if (nat_ed_ses_i2o_flow_hash_add_del (sm, thread_index, ses, 0))
+	nat_elog_warn (sm, "flow hash del failed");
+      if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, ses, 0))
+	nat_elog_warn (sm, "flow hash del failed");
     }
-  pool_put_index (tsm->lru_pool, ses->lru_index);
-  if (nat_ed_ses_i2o_flow_hash_add_del (sm, thread_index, ses, 0))
-    nat_elog_warn (sm, "flow hash del failed");
-  if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, ses, 0))
-    nat_elog_warn (sm, "flow hash del failed");
   pool_put (tsm->sessions, ses);
   vlib_set_simple_counter (&sm->total_sessions, thread_index, 0,
 			   pool_elts (tsm->sessions));
 }
 
-static_always_inline int
-nat_lru_free_one_with_head (snat_main_t *sm, int thread_index, f64 now,
-			    u32 head_index)
+/* Packet path counterpart of nat_ed_session_delete for a session found
+ * expired. Only unlink it from the flow hash, so the flow gets a new
+ * session, and queue it for the expire walk, which logs the deletion,
+ * releases the outside port and frees it. */
+always_inline void
+nat_ed_session_expire (snat_main_t *sm, snat_session_t *ses, u32 thread_index)
 {
-  snat_session_t *s = NULL;
-  dlist_elt_t *oldest_elt;
-  f64 sess_timeout_time;
-  u32 oldest_index;
-  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
-  oldest_index = clib_dlist_remove_head (tsm->lru_pool, head_index);
-  if (~0 != oldest_index)
-    {
-      oldest_elt = pool_elt_at_index (tsm->lru_pool, oldest_index);
-      s = pool_elt_at_index (tsm->sessions, oldest_elt->value);
+  snat_main_per_thread_data_t *tsm =
+    vec_elt_at_index (sm->per_thread_data, thread_index);
 
-      sess_timeout_time =
-	s->last_heard + (f64) nat44_session_get_timeout (sm, s);
-      if (now >= sess_timeout_time ||
-	  (s->tcp_closed_timestamp && now >= s->tcp_closed_timestamp))
-	{
-	  nat_free_session_data (sm, s, thread_index, 0);
-	  nat_ed_session_delete (sm, s, thread_index, 0);
-	  return 1;
-	}
-      else
-	{
-	  clib_dlist_addhead (tsm->lru_pool, head_index, oldest_index);
-	}
-    }
-  return 0;
-}
+  if (nat_ed_ses_i2o_flow_hash_add_del (sm, thread_index, ses, 0))
+    nat_elog_warn (sm, "flow hash del failed");
+  if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, ses, 0))
+    nat_elog_warn (sm, "flow hash del failed");
+  ses->flags |= SNAT_SESSION_FLAG_EXPIRED;
 
-static_always_inline int
-nat_lru_free_one (snat_main_t *sm, int thread_index, f64 now)
-{
-  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
-  int rc = 0;
-#define _(p)                                                                  \
-  if ((rc = nat_lru_free_one_with_head (sm, thread_index, now,                \
-					tsm->p##_lru_head_index)))            \
-    {                                                                         \
-      return rc;                                                              \
+  /* a fired timer already queued it */
+  if (ses->timer_handle != ~0)
+    {
+      tw_timer_stop_1t_3w_1024sl_ov (&tsm->session_timers, ses->timer_handle);
+      ses->timer_handle = ~0;
+      vec_add1 (tsm->expired_sessions, ses - tsm->sessions);
     }
-  _ (tcp_trans);
-  _ (udp);
-  _ (unk_proto);
-  _ (icmp);
-  _ (tcp_estab);
-#undef _
-  return 0;
 }
 
 static_always_inline snat_session_t *
@@ -433,13 +472,24 @@ nat_ed_session_alloc (snat_main_t *sm, u32 thread_index, f64 now, u8 proto)
 {
   snat_session_t *s;
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
-
-  nat_lru_free_one (sm, thread_index, now);
+  u32 timeout;
 
   pool_get (tsm->sessions, s);
   clib_memset (s, 0, sizeof (*s));
 
-  nat_ed_lru_insert (tsm, s, now, proto);
+  switch (proto)
+    {
+    case IP_PROTOCOL_TCP:
+      timeout = sm->timeouts.tcp.transitory;
+      break;
+    case IP_PROTOCOL_ICMP:
+      timeout = sm->timeouts.icmp;
+      break;
+    default:
+      timeout = sm->timeouts.udp;
+      break;
+    }
+  nat_ed_session_timer_start (tsm, s, now, now + timeout);
 
   s->ha_last_refreshed = now;
   vlib_set_simple_counter (&sm->total_sessions, thread_index, 0,
@@ -761,6 +811,8 @@ nat44_set_tcp_session_state_i2o (snat_main_t *sm, f64 now, snat_session_t *ses,
   u8 tcp_flags = vnet_buffer (b)->ip.reass.icmp_type_or_tcp_flags;
   u32 tcp_ack_number = vnet_buffer (b)->ip.reass.tcp_ack_number;
   u32 tcp_seq_number = vnet_buffer (b)->ip.reass.tcp_seq_number;
+  u8 old_state = ses->state;
+
   if ((ses->state == 0) && (tcp_flags & TCP_FLAG_RST))
     ses->state = NAT44_SES_RST;
   if ((ses->state == NAT44_SES_RST) && !(tcp_flags & TCP_FLAG_RST))
@@ -783,22 +835,12 @@ nat44_set_tcp_session_state_i2o (snat_main_t *sm, f64 now, snat_session_t *ses,
 	  if (nat44_is_ses_closed (ses))
 	    { // if session is now closed, save the timestamp
 	      ses->tcp_closed_timestamp = now + sm->timeouts.tcp.transitory;
-	      ses->last_lru_update = now;
 	    }
 	}
     }
 
-  // move the session to proper LRU
-  if (ses->state)
-    {
-      ses->lru_head_index = tsm->tcp_trans_lru_head_index;
-    }
-  else
-    {
-      ses->lru_head_index = tsm->tcp_estab_lru_head_index;
-    }
-  clib_dlist_remove (tsm->lru_pool, ses->lru_index);
-  clib_dlist_addtail (tsm->lru_pool, ses->lru_head_index, ses->lru_index);
+  if (ses->state != old_state)
+    nat_ed_session_timer_update (sm, tsm, ses, now);
 }
 
 always_inline void
@@ -807,6 +849,8 @@ nat44_set_tcp_session_state_o2i (snat_main_t *sm, f64 now, snat_session_t *ses,
 				 u32 tcp_seq_number, u32 thread_index)
 {
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  u8 old_state = ses->state;
+
   if ((ses->state == 0) && (tcp_flags & TCP_FLAG_RST))
     ses->state = NAT44_SES_RST;
   if ((ses->state == NAT44_SES_RST) && !(tcp_flags & TCP_FLAG_RST))
@@ -828,20 +872,10 @@ nat44_set_tcp_session_state_o2i (snat_main_t *sm, f64 now, snat_session_t *ses,
       if (nat44_is_ses_closed (ses))
 	{ // if session is now closed, save the timestamp
 	  ses->tcp_closed_timestamp = now + sm->timeouts.tcp.transitory;
-	  ses->last_lru_update = now;
 	}
     }
-  // move the session to proper LRU
-  if (ses->state)
-    {
-      ses->lru_head_index = tsm->tcp_trans_lru_head_index;
-    }
-  else
-    {
-      ses->lru_head_index = tsm->tcp_estab_lru_head_index;
-    }
-  clib_dlist_remove (tsm->lru_pool, ses->lru_index);
-  clib_dlist_addtail (tsm->lru_pool, ses->lru_head_index, ses->lru_index);
+  if (ses->state != old_state)
+    nat_ed_session_timer_update (sm, tsm, ses, now);
 }
 
 always_inline void
@@ -853,21 +887,6 @@ nat44_session_update_counters (snat_session_t *s, f64 now, uword bytes,
   s->total_bytes += bytes;
 }
 
-/** \brief Per-user LRU list maintenance */
-always_inline void
-nat44_session_update_lru (snat_main_t *sm, snat_session_t *s, u32 thread_index)
-{
-  /* don't update too often - timeout is in magnitude of seconds anyway */
-  if (s->last_heard > s->last_lru_update + 1)
-    {
-      clib_dlist_remove (sm->per_thread_data[thread_index].lru_pool,
-			 s->lru_index);
-      clib_dlist_addtail (sm->per_thread_data[thread_index].lru_pool,
-			  s->lru_head_index, s->lru_index);
-      s->last_lru_update = s->last_heard;
-    }
-}
-
 #endif /* __included_nat44_ed_inlines_h__ */
 
 /*
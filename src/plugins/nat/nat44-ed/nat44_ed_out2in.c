@@ -129,7 +129,8 @@ next_src_nat (snat_main_t *sm, ip4_header_t *ip, u16 src_port, u16 dst_port,
 
   init_ed_k (&kv, ip->src_address, src_port, ip->dst_address, dst_port,
 	     rx_fib_index, ip->protocol);
-  if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (!clib_bihash_search_16_8 (
+	nat_ed_flow_hash (sm, vlib_get_thread_index ()), &kv, &value))
     return 1;
 
   return 0;
@@ -252,13 +253,11 @@ icmp_out2in_ed_slow_path (snat_main_t *sm, vlib_buffer_t *b, ip4_header_t *ip,
       /* Accounting */
       nat44_session_update_counters (
 	s, now, vlib_buffer_length_in_chain (vm, b), thread_index);
-      /* Per-user LRU list maintenance */
-      nat44_session_update_lru (sm, s, thread_index);
     }
 out:
   if (NAT_NEXT_DROP == next && s)
     {
-      nat_ed_session_delete (sm, s, thread_index, 1);
+      nat_ed_session_delete (sm, s, thread_index);
       s = 0;
     }
   *s_p = s;
@@ -413,7 +412,9 @@ create_session_for_static_mapping_ed (
       return 0;
     }
 
-  s = nat_ed_session_alloc (sm, thread_index, now, nat_proto);
+  ip = vlib_buffer_get_current (b);
+
+  s = nat_ed_session_alloc (sm, thread_index, now, ip->protocol);
   if (!s)
     {
       b->error = node->errors[NAT_OUT2IN_ED_ERROR_MAX_SESSIONS_EXCEEDED];
@@ -421,8 +422,6 @@ create_session_for_static_mapping_ed (
       return 0;
     }
 
-  ip = vlib_buffer_get_current (b);
-
   s->ext_host_addr.as_u32 = ip->src_address.as_u32;
   s->ext_host_port =
     nat_proto == NAT_PROTOCOL_ICMP ? 0 : vnet_buffer (b)->ip.reass.l4_src_port;
@@ -458,7 +457,7 @@ create_session_for_static_mapping_ed (
   if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 1))
     {
       b->error = node->errors[NAT_OUT2IN_ED_ERROR_HASH_ADD_FAILED];
-      nat_ed_session_delete (sm, s, thread_index, 1);
+      nat_ed_session_delete (sm, s, thread_index);
       nat_elog_warn (sm, "out2in flow hash add failed");
       return 0;
     }
@@ -512,7 +511,7 @@ create_session_for_static_mapping_ed (
 	  snat_free_outside_address_and_port (
 	    sm->twice_nat_addresses, thread_index, &s->ext_host_nat_addr,
 	    s->ext_host_nat_port, s->nat_proto);
-	  nat_ed_session_delete (sm, s, thread_index, 1);
+	  nat_ed_session_delete (sm, s, thread_index);
 	  return 0;
 	}
 
@@ -576,7 +575,7 @@ create_session_for_static_mapping_ed (
 	{
 	  nat_elog_warn (sm, "out2in flow hash del failed");
 	}
-      nat_ed_session_delete (sm, s, thread_index, 1);
+      nat_ed_session_delete (sm, s, thread_index);
       return 0;
     }
 
@@ -637,7 +636,8 @@ create_bypass_for_fwd (snat_main_t *sm, vlib_buffer_t *b, snat_session_t *s,
   init_ed_k (&kv, lookup_saddr, lookup_sport, lookup_daddr, lookup_dport,
 	     rx_fib_index, lookup_protocol);
 
-  if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (!clib_bihash_search_16_8 (nat_ed_flow_hash (sm, thread_index), &kv,
+				&value))
     {
       ASSERT (thread_index == ed_value_get_thread_index (&value));
       s =
@@ -691,7 +691,7 @@ create_bypass_for_fwd (snat_main_t *sm, vlib_buffer_t *b, snat_session_t *s,
       if (nat_ed_ses_i2o_flow_hash_add_del (sm, thread_index, s, 1))
 	{
 	  nat_elog_notice (sm, "in2out flow add failed");
-	  nat_ed_session_delete (sm, s, thread_index, 1);
+	  nat_ed_session_delete (sm, s, thread_index);
 	  return;
 	}
 
@@ -708,8 +708,6 @@ create_bypass_for_fwd (snat_main_t *sm, vlib_buffer_t *b, snat_session_t *s,
 
   /* Accounting */
   nat44_session_update_counters (s, now, 0, thread_index);
-  /* Per-user LRU list maintenance */
-  nat44_session_update_lru (sm, s, thread_index);
 }
 
 static snat_session_t *
@@ -764,7 +762,7 @@ nat44_ed_out2in_slowpath_unknown_proto (snat_main_t *sm, vlib_buffer_t *b,
   if (nat_ed_ses_i2o_flow_hash_add_del (sm, thread_index, s, 1))
     {
       nat_elog_notice (sm, "in2out key add failed");
-      nat_ed_session_delete (sm, s, thread_index, 1);
+      nat_ed_session_delete (sm, s, thread_index);
       return NULL;
     }
 
@@ -775,7 +773,7 @@ nat44_ed_out2in_slowpath_unknown_proto (snat_main_t *sm, vlib_buffer_t *b,
   if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 1))
     {
       nat_elog_notice (sm, "out2in flow hash add failed");
-      nat_ed_session_delete (sm, s, thread_index, 1);
+      nat_ed_session_delete (sm, s, thread_index);
       return NULL;
     }
 
@@ -784,8 +782,6 @@ nat44_ed_out2in_slowpath_unknown_proto (snat_main_t *sm, vlib_buffer_t *b,
   /* Accounting */
   nat44_session_update_counters (s, now, vlib_buffer_length_in_chain (vm, b),
 				 thread_index);
-  /* Per-user LRU list maintenance */
-  nat44_session_update_lru (sm, s, thread_index);
 
   return s;
 }
@@ -917,7 +913,8 @@ nat44_ed_out2in_fast_path_node_fn_inline (vlib_main_t * vm,
 		 lookup.fib_index, lookup.proto);
 
       // lookup flow
-      if (clib_bihash_search_16_8 (&sm->flow_hash, &kv0, &value0))
+      if (clib_bihash_search_16_8 (nat_ed_flow_hash (sm, thread_index), &kv0,
+				   &value0))
 	{
 	  // flow does not exist go slow path
 	  slow_path_reason = NAT_ED_SP_REASON_LOOKUP_FAILED;
@@ -934,9 +931,8 @@ nat44_ed_out2in_fast_path_node_fn_inline (vlib_main_t * vm,
 
       if (PREDICT_FALSE (per_vrf_sessions_is_expired (s0, thread_index)))
 	{
-	  // session is closed, go slow path
-	  nat_free_session_data (sm, s0, thread_index, 0);
-	  nat_ed_session_delete (sm, s0, thread_index, 1);
+	  // session is closed, go slow path, freed by the expire walk
+	  nat_ed_session_expire (sm, s0, thread_index);
 	  slow_path_reason = NAT_ED_SP_REASON_VRF_EXPIRED;
 	  next[0] = NAT_NEXT_OUT2IN_ED_SLOW_PATH;
 	  goto trace0;
@@ -965,9 +961,8 @@ nat44_ed_out2in_fast_path_node_fn_inline (vlib_main_t * vm,
 	s0->last_heard + (f64) nat44_session_get_timeout (sm, s0);
       if (now >= sess_timeout_time)
 	{
-	  // session is closed, go slow path
-	  nat_free_session_data (sm, s0, thread_index, 0);
-	  nat_ed_session_delete (sm, s0, thread_index, 1);
+	  // session is closed, go slow path, freed by the expire walk
+	  nat_ed_session_expire (sm, s0, thread_index);
 	  slow_path_reason = NAT_ED_SP_SESS_EXPIRED;
 	  next[0] = NAT_NEXT_OUT2IN_ED_SLOW_PATH;
 	  goto trace0;
@@ -1015,7 +1010,7 @@ nat44_ed_out2in_fast_path_node_fn_inline (vlib_main_t * vm,
 		  //                       thread_index);
 		  translation_error = NAT_ED_TRNSL_ERR_FLOW_MISMATCH;
 		  nat_free_session_data (sm, s0, thread_index, 0);
-		  nat_ed_session_delete (sm, s0, thread_index, 1);
+		  nat_ed_session_delete (sm, s0, thread_index);
 		  next[0] = NAT_NEXT_DROP;
 		  b0->error = node->errors[NAT_OUT2IN_ED_ERROR_TRNSL_FAILED];
 		  goto trace0;
@@ -1064,8 +1059,6 @@ nat44_ed_out2in_fast_path_node_fn_inline (vlib_main_t * vm,
       nat44_session_update_counters (s0, now,
 				     vlib_buffer_length_in_chain (vm, b0),
 				     thread_index);
-      /* Per-user LRU list maintenance */
-      nat44_session_update_lru (sm, s0, thread_index);
 
     trace0:
       if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)
@@ -1223,7 +1216,8 @@ nat44_ed_out2in_slow_path_node_fn_inline (vlib_main_t * vm,
 		 ip0->protocol);
 
       s0 = NULL;
-      if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv0, &value0))
+      if (!clib_bihash_search_16_8 (nat_ed_flow_hash (sm, thread_index), &kv0,
+				    &value0))
 	{
 	  ASSERT (thread_index == ed_value_get_thread_index (&value0));
 	  s0 =
@@ -1233,7 +1227,7 @@ nat44_ed_out2in_slow_path_node_fn_inline (vlib_main_t * vm,
 	  if (s0->tcp_closed_timestamp && now >= s0->tcp_closed_timestamp)
 	    {
 	      nat_free_session_data (sm, s0, thread_index, 0);
-	      nat_ed_session_delete (sm, s0, thread_index, 1);
+	      nat_ed_session_delete (sm, s0, thread_index);
 	      s0 = NULL;
 	    }
 	}
@@ -1345,8 +1339,6 @@ nat44_ed_out2in_slow_path_node_fn_inline (vlib_main_t * vm,
       nat44_session_update_counters (s0, now,
 				     vlib_buffer_length_in_chain (vm, b0),
 				     thread_index);
-      /* Per-user LRU list maintenance */
-      nat44_session_update_lru (sm, s0, thread_index);
 
     trace0:
       if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)
@@ -47,9 +47,12 @@ perfmon_reset (vlib_main_t *vm)
   perfmon_main_t *pm = &perfmon_main;
   uword page_size = clib_mem_get_page_size ();
 
-  if (pm->is_running)
-    for (int i = 0; i < vlib_get_n_threads (); i++)
+  /* leave alone a wrapper someone else installed */
+  for (int i = 0; i < vlib_get_n_threads (); i++)
+    if (pm->dispatch_wrapper &&
+	vlib_get_main_by_index (i)->dispatch_wrapper_fn == pm->dispatch_wrapper)
       vlib_node_set_dispatch_wrapper (vlib_get_main_by_index (i), 0);
+  pm->dispatch_wrapper = 0;
 
   for (int i = 0; i < vec_len (pm->fds_to_close); i++)
     close (pm->fds_to_close[i]);
@@ -247,9 +250,18 @@ perfmon_start (vlib_main_t *vm, perfmon_bundle_t *b)
 
 	ASSERT (funcs[b->offset_type]);
 
+      /* the wrapper slot is exclusive, don't take it over */
       for (int i = 0; i < vlib_get_n_threads (); i++)
-	vlib_node_set_dispatch_wrapper (vlib_get_main_by_index (i),
-					funcs[b->offset_type]);
+	if (vlib_node_set_dispatch_wrapper (vlib_get_main_by_index (i),
+					    funcs[b->offset_type]))
+	  {
+	    while (--i >= 0)
+	      vlib_node_set_dispatch_wrapper (vlib_get_main_by_index (i), 0);
+	    perfmon_reset (vm);
+	    return clib_error_return (0, "another dispatch wrapper is "
+					 "already registered");
+	  }
+      pm->dispatch_wrapper = funcs[b->offset_type];
     }
 
   pm->sample_time = vlib_time_now (vm);
@@ -270,7 +282,10 @@ perfmon_stop (vlib_main_t *vm)
   if (pm->active_bundle->type == PERFMON_BUNDLE_TYPE_NODE)
     {
       for (int i = 0; i < vlib_get_n_threads (); i++)
-	vlib_node_set_dispatch_wrapper (vlib_get_main_by_index (i), 0);
+	if (vlib_get_main_by_index (i)->dispatch_wrapper_fn ==
+	    pm->dispatch_wrapper)
+	  vlib_node_set_dispatch_wrapper (vlib_get_main_by_index (i), 0);
+      pm->dispatch_wrapper = 0;
     }
 
   for (int i = 0; i < n_groups; i++)
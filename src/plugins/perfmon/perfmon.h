@@ -170,6 +170,8 @@ typedef struct
   uword *source_by_name;
   perfmon_bundle_t *active_bundle;
   int is_running;
+  /* node dispatch wrapper installed while running, if any */
+  vlib_node_function_t *dispatch_wrapper;
   f64 sample_time;
   int *group_fds;
   int *fds_to_close;
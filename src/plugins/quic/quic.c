@@ -648,65 +648,103 @@ quic_connection_closed (quic_ctx_t * ctx)
     }
 }
 
-static int
-quic_send_datagram (session_t *udp_session, struct iovec *packet,
-		    quicly_address_t *dest, quicly_address_t *src)
+static void
+quic_build_dgram_hdr (session_t *udp_session, session_dgram_hdr_t *hdr,
+		      u32 len, quicly_address_t *dest)
 {
-  u32 max_enqueue, len;
-  session_dgram_hdr_t hdr;
-  svm_fifo_t *f;
   transport_connection_t *tc;
-  int ret;
 
-  len = packet->iov_len;
-  f = udp_session->tx_fifo;
   tc = session_get_transport (udp_session);
-  max_enqueue = svm_fifo_max_enqueue (f);
-  if (max_enqueue < SESSION_CONN_HDR_LEN + len)
-    {
-      QUIC_ERR ("Too much data to send, max_enqueue %u, len %u",
-		max_enqueue, len + SESSION_CONN_HDR_LEN);
-      return QUIC_ERROR_FULL_FIFO;
-    }
 
   /*  Build packet header for fifo */
-  hdr.data_length = len;
-  hdr.data_offset = 0;
-  hdr.is_ip4 = tc->is_ip4;
-  clib_memcpy (&hdr.lcl_ip, &tc->lcl_ip, sizeof (ip46_address_t));
-  hdr.lcl_port = tc->lcl_port;
+  hdr->data_length = len;
+  hdr->data_offset = 0;
+  hdr->is_ip4 = tc->is_ip4;
+  clib_memcpy (&hdr->lcl_ip, &tc->lcl_ip, sizeof (ip46_address_t));
+  hdr->lcl_port = tc->lcl_port;
 
   /*  Read dest address from quicly-provided sockaddr */
-  if (hdr.is_ip4)
+  if (hdr->is_ip4)
     {
       QUIC_ASSERT (dest->sa.sa_family == AF_INET);
       struct sockaddr_in *sa4 = (struct sockaddr_in *) &dest->sa;
-      hdr.rmt_port = sa4->sin_port;
-      hdr.rmt_ip.ip4.as_u32 = sa4->sin_addr.s_addr;
+      hdr->rmt_port = sa4->sin_port;
+      hdr->rmt_ip.ip4.as_u32 = sa4->sin_addr.s_addr;
     }
   else
     {
       QUIC_ASSERT (dest->sa.sa_family == AF_INET6);
       struct sockaddr_in6 *sa6 = (struct sockaddr_in6 *) &dest->sa;
-      hdr.rmt_port = sa6->sin6_port;
-      clib_memcpy_fast (&hdr.rmt_ip.ip6, &sa6->sin6_addr, 16);
+      hdr->rmt_port = sa6->sin6_port;
+      clib_memcpy_fast (&hdr->rmt_ip.ip6, &sa6->sin6_addr, 16);
     }
+}
 
-  svm_fifo_seg_t segs[2] = { { (u8 *) &hdr, sizeof (hdr) },
-			     { packet->iov_base, len } };
+/**
+ * Enqueue datagrams built by one quicly_send call to the udp session's fifo
+ * with a single fifo tail update. As with one enqueue per datagram, those
+ * that fit are enqueued when the fifo can't take all of them.
+ */
+static int
+quic_send_datagrams (session_t *udp_session, struct iovec *packets,
+		     u32 n_packets, quicly_address_t *dest,
+		     quicly_address_t *src)
+{
+  session_dgram_hdr_t hdrs[QUIC_SEND_PACKET_VEC_SIZE];
+  svm_fifo_seg_t segs[2 * QUIC_SEND_PACKET_VEC_SIZE];
+  u32 max_enqueue, len = 0, n_fit, i;
+  svm_fifo_t *f;
+  int ret;
 
-  ret = svm_fifo_enqueue_segments (f, segs, 2, 0 /* allow partial */);
-  if (PREDICT_FALSE (ret < 0))
+  ASSERT (n_packets <= QUIC_SEND_PACKET_VEC_SIZE);
+
+  f = udp_session->tx_fifo;
+  max_enqueue = svm_fifo_max_enqueue (f);
+  for (n_fit = 0; n_fit < n_packets; n_fit++)
     {
-      QUIC_ERR ("Not enough space to enqueue dgram");
-      return QUIC_ERROR_FULL_FIFO;
+      if (len + SESSION_CONN_HDR_LEN + packets[n_fit].iov_len > max_enqueue)
+	break;
+      len += SESSION_CONN_HDR_LEN + packets[n_fit].iov_len;
     }
 
-  quic_increment_counter (QUIC_ERROR_TX_PACKETS, 1);
+  for (i = 0; i < n_fit; i++)
+    {
+      quic_build_dgram_hdr (udp_session, &hdrs[i], packets[i].iov_len, dest);
+      segs[2 * i].data = (u8 *) &hdrs[i];
+      segs[2 * i].len = sizeof (hdrs[i]);
+      segs[2 * i + 1].data = packets[i].iov_base;
+      segs[2 * i + 1].len = packets[i].iov_len;
+    }
+
+  if (n_fit)
+    {
+      ret = svm_fifo_enqueue_segments (f, segs, 2 * n_fit,
+				       0 /* allow partial */);
+      if (PREDICT_FALSE (ret < 0))
+	{
+	  QUIC_ERR ("Not enough space to enqueue dgram");
+	  return QUIC_ERROR_FULL_FIFO;
+	}
+      quic_increment_counter (QUIC_ERROR_TX_PACKETS, n_fit);
+    }
+
+  if (n_fit < n_packets)
+    {
+      QUIC_ERR ("Too much data to send, max_enqueue %u, len %u", max_enqueue,
+		len + SESSION_CONN_HDR_LEN + packets[n_fit].iov_len);
+      return QUIC_ERROR_FULL_FIFO;
+    }
 
   return 0;
 }
 
+static int
+quic_send_datagram (session_t *udp_session, struct iovec *packet,
+		    quicly_address_t *dest, quicly_address_t *src)
+{
+  return quic_send_datagrams (udp_session, packet, 1, dest, src);
+}
+
 static int
 quic_send_packets (quic_ctx_t * ctx)
 {
@@ -714,9 +752,10 @@ quic_send_packets (quic_ctx_t * ctx)
   uint8_t
     buf[QUIC_SEND_PACKET_VEC_SIZE * quic_get_quicly_ctx_from_ctx (ctx)
 				      ->transport_params.max_udp_payload_size];
+  vlib_main_t *vm = vlib_get_main ();
   session_t *udp_session;
   quicly_conn_t *conn;
-  size_t num_packets, i, max_packets;
+  size_t num_packets, max_packets;
   quicly_address_t dest, src;
   u32 n_sent = 0;
   int err = 0;
@@ -743,18 +782,19 @@ quic_send_packets (quic_ctx_t * ctx)
 	break;
 
       num_packets = max_packets;
-      if ((err = quicly_send (conn, &dest, &src, packets, &num_packets, buf,
-			      sizeof (buf))))
-	goto quicly_error;
 
-      for (i = 0; i != num_packets; ++i)
-	{
+      /* Packets are encrypted in batches once quicly built all of them */
+      quic_crypto_defer_enc (vm);
+      err = quicly_send (conn, &dest, &src, packets, &num_packets, buf,
+			 sizeof (buf));
+      quic_crypto_end_defer_enc (vm);
+      if (err)
+	goto quicly_error;
 
-	  if ((err =
-		 quic_send_datagram (udp_session, &packets[i], &dest, &src)))
-	    goto quicly_error;
+      if (num_packets && (err = quic_send_datagrams (udp_session, packets,
+						     num_packets, &dest, &src)))
+	goto quicly_error;
 
-	}
       n_sent += num_packets;
     }
   while (num_packets > 0 && num_packets == max_packets);
@@ -2573,6 +2613,7 @@ quic_init (vlib_main_t * vm)
 	  qm->per_thread_crypto_key_indices[i] = vnet_crypto_key_add (
 	    vm, VNET_CRYPTO_ALG_AES_256_CTR, empty_key, 32);
 	}
+      quic_crypto_batch_init (vm, num_threads);
     }
 
   qm->max_packets_per_key = DEFAULT_MAX_PACKETS_PER_KEY;
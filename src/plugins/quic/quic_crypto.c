@@ -34,6 +34,38 @@ typedef struct crypto_key_
   u16 key_len;
 } crypto_key_t;
 
+/* Number of vnet crypto keys per thread used for deferred encryption.
+ * Enough for aead and header protection keys of all epochs */
+#define QUIC_CRYPTO_BATCH_N_KEYS 8
+
+/* Header protection state of a deferred packet */
+typedef struct quic_crypto_batch_pkt_
+{
+  u8 *base;
+  size_t first_byte_at;
+  size_t payload_from;
+  vnet_crypto_op_id_t hp_op_id;
+  u32 hp_key_index;
+  u8 hp_mask[16];
+} quic_crypto_batch_pkt_t;
+
+/* Per thread batch of packets whose encryption is deferred until the
+ * datagrams built by quicly_send are handed to udp */
+typedef struct quic_crypto_batch_
+{
+  vnet_crypto_op_t *aead_ops;
+  vnet_crypto_op_t *hp_ops;
+  quic_crypto_batch_pkt_t *pkts;
+  u8 *ivs;
+  crypto_key_t keys[QUIC_CRYPTO_BATCH_N_KEYS];
+  u32 key_indices[QUIC_CRYPTO_BATCH_N_KEYS];
+  u32 keys_in_use;
+  u8 next_key;
+  u8 is_deferred;
+} quic_crypto_batch_t;
+
+static quic_crypto_batch_t *quic_crypto_batches;
+
 struct cipher_context_t
 {
   ptls_cipher_context_t super;
@@ -124,11 +156,9 @@ Exit:
   return ret;
 }
 
-static u32
-quic_crypto_set_key (crypto_key_t *key)
+static void
+quic_crypto_load_key (u32 key_id, crypto_key_t *key)
 {
-  u8 thread_index = vlib_get_thread_index ();
-  u32 key_id = quic_main.per_thread_crypto_key_indices[thread_index];
   vnet_crypto_key_t *vnet_key = vnet_crypto_get_key (key_id);
   vlib_main_t *vm = vlib_get_main ();
   vnet_crypto_engine_t *engine;
@@ -143,10 +173,193 @@ quic_crypto_set_key (crypto_key_t *key)
   vec_foreach (engine, cm->engines)
     if (engine->key_op_handler)
       engine->key_op_handler (vm, VNET_CRYPTO_KEY_OP_ADD, key_id);
+}
 
+static u32
+quic_crypto_set_key (crypto_key_t *key)
+{
+  u8 thread_index = vlib_get_thread_index ();
+  u32 key_id = quic_main.per_thread_crypto_key_indices[thread_index];
+
+  quic_crypto_load_key (key_id, key);
   return key_id;
 }
 
+static inline int
+quic_crypto_key_is_equal (crypto_key_t *a, crypto_key_t *b)
+{
+  return (a->algo == b->algo && a->key_len == b->key_len &&
+	  !memcmp (a->key, b->key, a->key_len));
+}
+
+/**
+ * Get vnet crypto key for a deferred op. Keys stay loaded across batches,
+ * so engines are only reprogrammed when a connection's keys change.
+ */
+static u32
+quic_crypto_batch_key (vlib_main_t *vm, quic_crypto_batch_t *b,
+		       crypto_key_t *key)
+{
+  u32 i;
+
+  for (i = 0; i < QUIC_CRYPTO_BATCH_N_KEYS; i++)
+    if (quic_crypto_key_is_equal (&b->keys[i], key))
+      {
+	b->keys_in_use |= 1 << i;
+	return b->key_indices[i];
+      }
+
+  /* Callers flush pending ops if they could use all keys */
+  ASSERT (b->keys_in_use != (1 << QUIC_CRYPTO_BATCH_N_KEYS) - 1);
+
+  while (b->keys_in_use & (1 << b->next_key))
+    b->next_key = (b->next_key + 1) % QUIC_CRYPTO_BATCH_N_KEYS;
+
+  i = b->next_key;
+  b->next_key = (b->next_key + 1) % QUIC_CRYPTO_BATCH_N_KEYS;
+  clib_memcpy_fast (&b->keys[i], key, sizeof (*key));
+  quic_crypto_load_key (b->key_indices[i], key);
+  b->keys_in_use |= 1 << i;
+
+  return b->key_indices[i];
+}
+
+static void
+quic_crypto_batch_add (vlib_main_t *vm, quic_crypto_batch_t *b,
+		       struct cipher_context_t *hp_ctx,
+		       struct aead_crypto_context_t *aead_ctx, u8 *base,
+		       size_t first_byte_at, size_t payload_from, size_t inlen)
+{
+  quic_crypto_batch_pkt_t *pkt;
+  vnet_crypto_op_t *op;
+  u32 key_index, hp_key_index;
+
+  /* Make sure both keys can be loaded without evicting keys that pending
+   * ops still use */
+  if (count_set_bits (b->keys_in_use) > QUIC_CRYPTO_BATCH_N_KEYS - 2)
+    quic_crypto_flush_enc (vm);
+
+  key_index = quic_crypto_batch_key (vm, b, &aead_ctx->key);
+  hp_key_index = quic_crypto_batch_key (vm, b, &hp_ctx->key);
+
+  vec_add2_aligned (b->aead_ops, op, 1, CLIB_CACHE_LINE_BYTES);
+  vnet_crypto_op_init (op, aead_ctx->id);
+  op->aad = base + first_byte_at;
+  op->aad_len = payload_from - first_byte_at;
+  op->key_index = key_index;
+  op->src = op->dst = base + payload_from;
+  op->len = inlen;
+  op->tag_len = aead_ctx->super.algo->tag_size;
+  op->tag = op->src + inlen;
+  vec_add (b->ivs, aead_ctx->iv, PTLS_MAX_IV_SIZE);
+
+  vec_add2 (b->pkts, pkt, 1);
+  pkt->base = base;
+  pkt->first_byte_at = first_byte_at;
+  pkt->payload_from = payload_from;
+  pkt->hp_op_id = hp_ctx->id;
+  pkt->hp_key_index = hp_key_index;
+}
+
+void
+quic_crypto_defer_enc (vlib_main_t *vm)
+{
+  quic_crypto_batch_t *b;
+
+  /* Not initialized if vnet crypto is not available */
+  if (PREDICT_FALSE (!quic_crypto_batches))
+    return;
+
+  b = vec_elt_at_index (quic_crypto_batches, vm->thread_index);
+  ASSERT (!vec_len (b->aead_ops));
+  b->is_deferred = 1;
+}
+
+/**
+ * Encrypt all deferred packets. Packet protection for all packets is done
+ * in one call to the crypto engines and header protection, which samples
+ * the ciphertext, in a second one.
+ */
+void
+quic_crypto_flush_enc (vlib_main_t *vm)
+{
+  quic_crypto_batch_pkt_t *pkt;
+  quic_crypto_batch_t *b;
+  vnet_crypto_op_t *op;
+  u32 n_ops, i, j;
+  u8 *first_byte;
+
+  b = vec_elt_at_index (quic_crypto_batches, vm->thread_index);
+  n_ops = vec_len (b->aead_ops);
+  if (!n_ops)
+    return;
+
+  /* Vector may have grown while ops were added, so fix up pointers now */
+  for (i = 0; i < n_ops; i++)
+    b->aead_ops[i].iv = b->ivs + i * PTLS_MAX_IV_SIZE;
+
+  vnet_crypto_process_ops (vm, b->aead_ops, n_ops);
+
+  vec_validate_aligned (b->hp_ops, n_ops - 1, CLIB_CACHE_LINE_BYTES);
+  for (i = 0; i < n_ops; i++)
+    {
+      assert (b->aead_ops[i].status == VNET_CRYPTO_OP_STATUS_COMPLETED);
+      pkt = &b->pkts[i];
+      op = &b->hp_ops[i];
+      vnet_crypto_op_init (op, pkt->hp_op_id);
+      clib_memset (pkt->hp_mask, 0, sizeof (pkt->hp_mask));
+      op->iv = pkt->base + pkt->payload_from - QUICLY_SEND_PN_SIZE +
+	       QUICLY_MAX_PN_SIZE;
+      op->key_index = pkt->hp_key_index;
+      op->src = op->dst = pkt->hp_mask;
+      op->len = sizeof (pkt->hp_mask);
+    }
+
+  vnet_crypto_process_ops (vm, b->hp_ops, n_ops);
+
+  for (i = 0; i < n_ops; i++)
+    {
+      assert (b->hp_ops[i].status == VNET_CRYPTO_OP_STATUS_COMPLETED);
+      pkt = &b->pkts[i];
+      first_byte = pkt->base + pkt->first_byte_at;
+      first_byte[0] ^= pkt->hp_mask[0] &
+		       (QUICLY_PACKET_IS_LONG_HEADER (first_byte[0]) ? 0xf :
+								       0x1f);
+      for (j = 0; j != QUICLY_SEND_PN_SIZE; ++j)
+	pkt->base[pkt->payload_from + j - QUICLY_SEND_PN_SIZE] ^=
+	  pkt->hp_mask[j + 1];
+    }
+
+  vec_reset_length (b->aead_ops);
+  vec_reset_length (b->pkts);
+  vec_reset_length (b->ivs);
+  b->keys_in_use = 0;
+}
+
+void
+quic_crypto_end_defer_enc (vlib_main_t *vm)
+{
+  if (PREDICT_FALSE (!quic_crypto_batches))
+    return;
+
+  quic_crypto_flush_enc (vm);
+  quic_crypto_batches[vm->thread_index].is_deferred = 0;
+}
+
+void
+quic_crypto_batch_init (vlib_main_t *vm, u32 n_threads)
+{
+  u8 empty_key[32] = {};
+  quic_crypto_batch_t *b;
+  u32 i;
+
+  vec_validate (quic_crypto_batches, n_threads - 1);
+  vec_foreach (b, quic_crypto_batches)
+    for (i = 0; i < QUIC_CRYPTO_BATCH_N_KEYS; i++)
+      b->key_indices[i] = vnet_crypto_key_add (
+	vm, VNET_CRYPTO_ALG_AES_256_CTR, empty_key, 32);
+}
+
 static size_t
 quic_crypto_aead_decrypt (quic_ctx_t *qctx, ptls_aead_context_t *_ctx,
 			  void *_output, const void *input, size_t inlen,
@@ -285,14 +498,24 @@ quic_crypto_encrypt_packet (struct st_quicly_crypto_engine_t *engine,
     datagram.len - payload_from - packet_protect_ctx->algo->tag_size;
   const void *aad = datagram.base + first_byte_at;
   size_t aadlen = payload_from - first_byte_at;
+  quic_crypto_batch_t *b;
+
+  ptls_aead__build_iv (aead_ctx->super.algo, aead_ctx->iv,
+		       aead_ctx->static_iv, packet_number);
+
+  b = vec_elt_at_index (quic_crypto_batches, vm->thread_index);
+  if (b->is_deferred)
+    {
+      quic_crypto_batch_add (vm, b, hp_ctx, aead_ctx, datagram.base,
+			     first_byte_at, payload_from, inlen);
+      return;
+    }
 
   /* Build AEAD encrypt crypto operation */
   vnet_crypto_op_init (&aead_ctx->op, aead_ctx->id);
   aead_ctx->op.aad = (u8 *) aad;
   aead_ctx->op.aad_len = aadlen;
   aead_ctx->op.iv = aead_ctx->iv;
-  ptls_aead__build_iv (aead_ctx->super.algo, aead_ctx->op.iv,
-		       aead_ctx->static_iv, packet_number);
   aead_ctx->op.key_index = quic_crypto_set_key (&aead_ctx->key);
   aead_ctx->op.src = (u8 *) input;
   aead_ctx->op.dst = output;
@@ -27,6 +27,10 @@ int quic_encrypt_ticket_cb (ptls_encrypt_ticket_t * _self, ptls_t * tls,
 			    ptls_iovec_t src);
 void quic_crypto_decrypt_packet (quic_ctx_t * qctx,
 				 quic_rx_packet_ctx_t * pctx);
+void quic_crypto_batch_init (vlib_main_t *vm, u32 n_threads);
+void quic_crypto_defer_enc (vlib_main_t *vm);
+void quic_crypto_flush_enc (vlib_main_t *vm);
+void quic_crypto_end_defer_enc (vlib_main_t *vm);
 
 #endif /* __included_vpp_quic_crypto_h__ */
 /*
@@ -0,0 +1,590 @@
+/*
+ * timeline.c - per-thread span tracer with Chrome trace export
+ *
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <vlib/vlib.h>
+#include <vlibapi/api.h>
+#include <vnet/plugin/plugin.h>
+#include <vpp/app/version.h>
+
+#define foreach_timeline_category                                             \
+  _ (NODE, node)                                                              \
+  _ (BARRIER, barrier)                                                        \
+  _ (API, api)                                                                \
+  _ (HANDOFF, handoff)
+
+typedef enum
+{
+#define _(n, s) TIMELINE_CATEGORY_##n,
+  foreach_timeline_category
+#undef _
+    TIMELINE_N_CATEGORIES,
+} timeline_category_t;
+
+static char *timeline_category_names[] = {
+#define _(n, s) #s,
+  foreach_timeline_category
+#undef _
+};
+
+#define TIMELINE_ALL_CATEGORIES pow2_mask (TIMELINE_N_CATEGORIES)
+#define TIMELINE_DEFAULT_LOG2_EVENTS 14
+
+/*
+ * A span is recorded once, when it ends, so a wrapped ring never holds
+ * a begin without its end.
+ */
+typedef struct
+{
+  u64 start;
+  u64 end;
+  /* node index, barrier caller, api message id or frame queue index */
+  u32 name;
+  /* vectors, where it makes sense */
+  u32 arg;
+  u32 category;
+} timeline_event_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* ring of the most recent spans */
+  timeline_event_t *events;
+  /* spans recorded since the timeline was turned on */
+  u64 n_recorded;
+  /* start of the span in progress, per category */
+  u64 span_start[TIMELINE_N_CATEGORIES];
+} timeline_per_thread_t;
+
+typedef struct
+{
+  timeline_per_thread_t *per_thread;
+  u32 log2_events_per_thread;
+
+  /* categories currently hooked, 0 if off */
+  u32 categories;
+
+  /* record node dispatches which processed nothing */
+  u8 record_idle_nodes;
+
+  /* barrier callers seen by the main thread, by string address */
+  const char **barrier_callers;
+  uword *barrier_caller_by_ptr;
+
+  /* callback vectors are only swapped under the barrier, never init'd */
+  clib_spinlock_t callback_lock;
+} timeline_main_t;
+
+static timeline_main_t timeline_main = {
+  .log2_events_per_thread = TIMELINE_DEFAULT_LOG2_EVENTS,
+};
+
+static_always_inline void
+timeline_record (timeline_per_thread_t *ptd, u32 category, u32 name, u32 arg,
+		 u64 start, u64 end)
+{
+  timeline_main_t *tm = &timeline_main;
+  timeline_event_t *e;
+
+  e = ptd->events +
+      (ptd->n_recorded++ & pow2_mask (tm->log2_events_per_thread));
+  e->start = start;
+  e->end = end;
+  e->name = name;
+  e->arg = arg;
+  e->category = category;
+}
+
+static void
+timeline_node_callback (vlib_node_runtime_perf_callback_data_t *data,
+			vlib_node_runtime_perf_callback_args_t *args)
+{
+  timeline_main_t *tm = &timeline_main;
+  timeline_per_thread_t *ptd;
+  u64 *start;
+
+  ptd = vec_elt_at_index (tm->per_thread, args->vm->thread_index);
+  start = ptd->span_start + TIMELINE_CATEGORY_NODE;
+
+  if (args->call_type == VLIB_NODE_RUNTIME_PERF_BEFORE)
+    *start = args->cpu_time_now;
+  else if (args->call_type == VLIB_NODE_RUNTIME_PERF_AFTER && *start)
+    {
+      /* Idle polls of input nodes would fill the ring in no time */
+      if (args->packets || tm->record_idle_nodes)
+	timeline_record (ptd, TIMELINE_CATEGORY_NODE, args->node->node_index,
+			 args->packets, *start, args->cpu_time_now);
+      *start = 0;
+    }
+}
+
+static u32
+timeline_barrier_caller_index (const char *caller)
+{
+  timeline_main_t *tm = &timeline_main;
+  uword *p;
+
+  p = hash_get (tm->barrier_caller_by_ptr, pointer_to_uword (caller));
+  if (p)
+    return p[0];
+
+  hash_set (tm->barrier_caller_by_ptr, pointer_to_uword (caller),
+	    vec_len (tm->barrier_callers));
+  vec_add1 (tm->barrier_callers, caller);
+  return vec_len (tm->barrier_callers) - 1;
+}
+
+/*
+ * On the main thread the span covers sync to release, on workers the time
+ * spent parked. The difference between the two is the time it took the
+ * slowest worker to reach the barrier.
+ */
+static void
+timeline_barrier_callback (vlib_main_t *vm, u64 t, int leave)
+{
+  timeline_main_t *tm = &timeline_main;
+  timeline_per_thread_t *ptd;
+  u64 *start;
+  u32 name = 0;
+
+  ptd = vec_elt_at_index (tm->per_thread, vm->thread_index);
+  start = ptd->span_start + TIMELINE_CATEGORY_BARRIER;
+
+  if (!leave)
+    {
+      *start = t;
+      return;
+    }
+
+  /* Turned on while the barrier was held */
+  if (*start == 0)
+    return;
+
+  if (vm->thread_index == 0 && vlib_worker_threads[0].barrier_caller)
+    name = timeline_barrier_caller_index (
+      vlib_worker_threads[0].barrier_caller);
+
+  timeline_record (ptd, TIMELINE_CATEGORY_BARRIER, name, 0, *start, t);
+  *start = 0;
+}
+
+static void
+timeline_api_callback (api_main_t *am, u32 id, int before_or_after)
+{
+  timeline_main_t *tm = &timeline_main;
+  timeline_per_thread_t *ptd;
+  u64 *start;
+
+  ptd = vec_elt_at_index (tm->per_thread, vlib_get_thread_index ());
+  start = ptd->span_start + TIMELINE_CATEGORY_API;
+
+  if (before_or_after == 0)
+    *start = clib_cpu_time_now ();
+  else if (*start)
+    {
+      timeline_record (ptd, TIMELINE_CATEGORY_API, id, 0, *start,
+		       clib_cpu_time_now ());
+      *start = 0;
+    }
+}
+
+static void
+timeline_handoff_callback (vlib_main_t *vm, u32 fq_index, u32 n_vectors,
+			   u64 t)
+{
+  timeline_main_t *tm = &timeline_main;
+  timeline_per_thread_t *ptd;
+
+  ptd = vec_elt_at_index (tm->per_thread, vm->thread_index);
+  timeline_record (ptd, TIMELINE_CATEGORY_HANDOFF, fq_index, n_vectors, t,
+		   clib_cpu_time_now ());
+}
+
+/* Call with the barrier held */
+static void
+timeline_set_callbacks (u32 categories, int enable)
+{
+  timeline_main_t *tm = &timeline_main;
+  api_main_t *am = vlibapi_get_main ();
+  u32 i;
+
+  for (i = 0; i < vlib_get_n_threads (); i++)
+    {
+      vlib_main_t *ovm = vlib_get_main_by_index (i);
+      if (ovm == 0)
+	continue;
+
+      if (categories & (1 << TIMELINE_CATEGORY_NODE))
+	clib_callback_data_enable_disable (
+	  &ovm->vlib_node_runtime_perf_callbacks, timeline_node_callback,
+	  enable);
+
+      if (categories & (1 << TIMELINE_CATEGORY_BARRIER))
+	clib_callback_enable_disable (
+	  ovm->barrier_perf_callbacks, ovm->barrier_perf_callbacks_tmp,
+	  tm->callback_lock, timeline_barrier_callback, enable);
+
+      if (categories & (1 << TIMELINE_CATEGORY_HANDOFF))
+	clib_callback_enable_disable (
+	  ovm->handoff_perf_callbacks, ovm->handoff_perf_callbacks_tmp,
+	  tm->callback_lock, timeline_handoff_callback, enable);
+    }
+
+  if (categories & (1 << TIMELINE_CATEGORY_API))
+    clib_callback_enable_disable (am->perf_counter_cbs,
+				  am->perf_counter_cbs_tmp, tm->callback_lock,
+				  timeline_api_callback, enable);
+}
+
+static void
+timeline_enable_disable (vlib_main_t *vm, u32 categories,
+			 u32 log2_events_per_thread)
+{
+  timeline_main_t *tm = &timeline_main;
+  timeline_per_thread_t *ptd;
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  timeline_set_callbacks (tm->categories, 0 /* disable */);
+  tm->categories = 0;
+
+  /* Keep what was recorded around for saving, until turned on again */
+  if (categories)
+    {
+      vec_validate_aligned (tm->per_thread, vlib_get_n_threads () - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      vec_foreach (ptd, tm->per_thread)
+	{
+	  vec_free (ptd->events);
+	  vec_validate_aligned (ptd->events, pow2_mask (log2_events_per_thread),
+				CLIB_CACHE_LINE_BYTES);
+	  ptd->n_recorded = 0;
+	  clib_memset (ptd->span_start, 0, sizeof (ptd->span_start));
+	}
+      tm->log2_events_per_thread = log2_events_per_thread;
+
+      timeline_set_callbacks (categories, 1 /* enable */);
+      tm->categories = categories;
+    }
+
+  vlib_worker_thread_barrier_release (vm);
+}
+
+static clib_error_t *
+set_timeline_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			 vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  timeline_main_t *tm = &timeline_main;
+  clib_error_t *error = 0;
+  int is_enable = tm->categories != 0;
+  u32 categories = 0;
+  u32 n_events = 1 << tm->log2_events_per_thread;
+  u8 record_idle_nodes = 0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "on"))
+	is_enable = 1;
+      else if (unformat (line_input, "off"))
+	is_enable = 0;
+      else if (unformat (line_input, "events-per-thread %u", &n_events))
+	;
+      else if (unformat (line_input, "idle-nodes"))
+	record_idle_nodes = 1;
+      else if (unformat (line_input, "node"))
+	categories |= 1 << TIMELINE_CATEGORY_NODE;
+      else if (unformat (line_input, "barrier"))
+	categories |= 1 << TIMELINE_CATEGORY_BARRIER;
+      else if (unformat (line_input, "api"))
+	categories |= 1 << TIMELINE_CATEGORY_API;
+      else if (unformat (line_input, "handoff"))
+	categories |= 1 << TIMELINE_CATEGORY_HANDOFF;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (n_events < 1024 || !is_pow2 (n_events))
+    {
+      error = clib_error_return (
+	0, "events-per-thread must be a power of 2, at least 1024");
+      goto done;
+    }
+
+  if (categories == 0)
+    categories = TIMELINE_ALL_CATEGORIES;
+
+  tm->record_idle_nodes = record_idle_nodes;
+  timeline_enable_disable (vm, is_enable ? categories : 0,
+			   min_log2 (n_events));
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Record node dispatches, barrier syncs, binary API handlers and frame
+ * queue handoffs as spans in per-thread rings. Turning the timeline on
+ * discards previously recorded spans. Without a category, all are recorded.
+ *
+ * @cliexpar
+ * @cliexcmd{set timeline on events-per-thread 65536 node barrier}
+?*/
+VLIB_CLI_COMMAND (set_timeline_command, static) = {
+  .path = "set timeline",
+  .short_help = "set timeline [on|off] [events-per-thread <n>] [node] "
+		"[barrier] [api] [handoff] [idle-nodes]",
+  .function = set_timeline_command_fn,
+};
+
+static u8 *
+format_timeline_event_json (u8 *s, va_list *args)
+{
+  timeline_main_t *tm = &timeline_main;
+  vlib_main_t *vm = va_arg (*args, vlib_main_t *);
+  timeline_event_t *e = va_arg (*args, timeline_event_t *);
+  u32 thread_index = va_arg (*args, u32);
+  int pid = va_arg (*args, int);
+  vlib_thread_main_t *thm = vlib_get_thread_main ();
+  api_main_t *am = vlibapi_get_main ();
+  f64 us_per_clock = vm->clib_time.seconds_per_clock * 1e6;
+  u64 base = vm->clib_time.init_cpu_time;
+
+  s = format (s, "{\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,",
+	      timeline_category_names[e->category], pid, thread_index);
+  s = format (s, "\"ts\":%.3f,\"dur\":%.3f,",
+	      (f64) (e->start - base) * us_per_clock,
+	      (f64) (e->end - e->start) * us_per_clock);
+
+  switch (e->category)
+    {
+    case TIMELINE_CATEGORY_NODE:
+      s = format (s, "\"name\":\"%U\",\"args\":{\"vectors\":%u}}",
+		  format_vlib_node_name, vm, e->name, e->arg);
+      break;
+    case TIMELINE_CATEGORY_BARRIER:
+      if (thread_index == 0)
+	s = format (s,
+		    "\"name\":\"barrier-sync\",\"args\":{\"caller\":\"%s\"}}",
+		    e->name < vec_len (tm->barrier_callers) ?
+		      tm->barrier_callers[e->name] :
+		      "unknown");
+      else
+	s = format (s, "\"name\":\"barrier-wait\"}");
+      break;
+    case TIMELINE_CATEGORY_API:
+      s = format (s, "\"name\":\"%s\"}",
+		  e->name < vec_len (am->msg_names) && am->msg_names[e->name] ?
+		    am->msg_names[e->name] :
+		    "unknown");
+      break;
+    case TIMELINE_CATEGORY_HANDOFF:
+      s = format (s, "\"name\":\"handoff-%U\",\"args\":{\"vectors\":%u}}",
+		  format_vlib_node_name, vm,
+		  vec_elt (thm->frame_queue_mains, e->name).node_index, e->arg);
+      break;
+    }
+
+  return s;
+}
+
+/* Chrome trace event format, which Perfetto and chrome://tracing load */
+static clib_error_t *
+timeline_write_file (vlib_main_t *vm, char *file)
+{
+  timeline_main_t *tm = &timeline_main;
+  timeline_per_thread_t *ptd;
+  timeline_event_t **events = 0, *e;
+  clib_error_t *error = 0;
+  u8 *s = 0;
+  int fd, pid = getpid ();
+  u32 i, sep = ' ';
+
+  /* Take a consistent copy, then let the workers go */
+  vlib_worker_thread_barrier_sync (vm);
+  vec_foreach (ptd, tm->per_thread)
+    {
+      timeline_event_t *copy = 0;
+      u64 n = clib_min (ptd->n_recorded, vec_len (ptd->events));
+      u64 j;
+
+      for (j = ptd->n_recorded - n; j < ptd->n_recorded; j++)
+	vec_add1 (copy,
+		  ptd->events[j & pow2_mask (tm->log2_events_per_thread)]);
+      vec_add1 (events, copy);
+    }
+  vlib_worker_thread_barrier_release (vm);
+
+  fd = open (file, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  if (fd < 0)
+    {
+      error = clib_error_return_unix (0, "open `%s'", file);
+      goto done;
+    }
+
+  s = format (s, "{\"traceEvents\":[");
+  for (i = 0; i < vec_len (events); i++)
+    {
+      s = format (s, "%c{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+		     "\"tid\":%u,\"args\":{\"name\":\"%s\"}}\n",
+		  sep, pid, i,
+		  i < vec_len (vlib_worker_threads) ?
+		    (char *) vlib_worker_threads[i].name :
+		    "unknown");
+      sep = ',';
+
+      vec_foreach (e, events[i])
+	{
+	  s = format (s, ",%U\n", format_timeline_event_json, vm, e, i, pid);
+	  if (vec_len (s) >= 64 << 10)
+	    {
+	      if (write (fd, s, vec_len (s)) != vec_len (s))
+		{
+		  error = clib_error_return_unix (0, "write `%s'", file);
+		  goto done;
+		}
+	      vec_reset_length (s);
+	    }
+	}
+    }
+  s = format (s, "]}\n");
+
+  if (write (fd, s, vec_len (s)) != vec_len (s))
+    error = clib_error_return_unix (0, "write `%s'", file);
+
+done:
+  if (fd >= 0)
+    close (fd);
+  for (i = 0; i < vec_len (events); i++)
+    vec_free (events[i]);
+  vec_free (events);
+  vec_free (s);
+  return error;
+}
+
+static clib_error_t *
+timeline_save_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			  vlib_cli_command_t *cmd)
+{
+  char *file, *chroot_file;
+  clib_error_t *error;
+
+  if (!unformat (input, "%s", &file))
+    return clib_error_return (0, "expected file name, got `%U'",
+			      format_unformat_error, input);
+
+  /* It's fairly hard to get "../oopsie" through unformat; just in case */
+  if (strstr (file, "..") || strchr (file, '/'))
+    {
+      error = clib_error_return (0, "illegal characters in filename '%s'",
+				 file);
+      vec_free (file);
+      return error;
+    }
+
+  chroot_file = (char *) format (0, "/tmp/%s%c", file, 0);
+  vec_free (file);
+
+  error = timeline_write_file (vm, chroot_file);
+  if (!error)
+    vlib_cli_output (vm, "Saved timeline to %s", chroot_file);
+
+  vec_free (chroot_file);
+  return error;
+}
+
+/*?
+ * Save the recorded spans in the Chrome trace event format, to be loaded
+ * in ui.perfetto.dev or chrome://tracing. Span start times are relative to
+ * process start.
+ *
+ * @cliexpar
+ * @cliexcmd{timeline save timeline.json}
+?*/
+VLIB_CLI_COMMAND (timeline_save_command, static) = {
+  .path = "timeline save",
+  .short_help = "timeline save <filename> (saves spans in /tmp/<filename>)",
+  .function = timeline_save_command_fn,
+  .is_mp_safe = 1,
+};
+
+static clib_error_t *
+show_timeline_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			  vlib_cli_command_t *cmd)
+{
+  timeline_main_t *tm = &timeline_main;
+  timeline_per_thread_t *ptd;
+  u8 *s = 0;
+  u32 i;
+
+  for (i = 0; i < TIMELINE_N_CATEGORIES; i++)
+    if (tm->categories & (1 << i))
+      s = format (s, " %s", timeline_category_names[i]);
+
+  vlib_cli_output (vm, "timeline %s%v, %u events per thread%s",
+		   tm->categories ? "on:" : "off", s,
+		   1 << tm->log2_events_per_thread,
+		   tm->record_idle_nodes ? ", idle nodes" : "");
+  vec_free (s);
+
+  vlib_cli_output (vm, "%=8s%=16s%=16s", "Thread", "Recorded", "In ring");
+  vec_foreach (ptd, tm->per_thread)
+    vlib_cli_output (vm, "%=8u%=16lu%=16lu", ptd - tm->per_thread,
+		     ptd->n_recorded,
+		     clib_min (ptd->n_recorded, vec_len (ptd->events)));
+
+  return 0;
+}
+
+VLIB_CLI_COMMAND (show_timeline_command, static) = {
+  .path = "show timeline",
+  .short_help = "show timeline",
+  .function = show_timeline_command_fn,
+};
+
+static clib_error_t *
+timeline_init (vlib_main_t *vm)
+{
+  timeline_main_t *tm = &timeline_main;
+
+  tm->barrier_caller_by_ptr = hash_create (0, sizeof (uword));
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (timeline_init);
+
+VLIB_PLUGIN_REGISTER () = {
+  .version = VPP_BUILD_VER,
+  .description = "Per-thread span timeline",
+};
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
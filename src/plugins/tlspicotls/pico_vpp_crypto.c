@@ -27,6 +27,23 @@ typedef void (*ptls_vpp_do_transform_fn) (ptls_cipher_context_t *, void *,
 vnet_crypto_main_t *cm = &crypto_main;
 extern picotls_main_t picotls_main;
 
+#define PTLS_VPP_CRYPTO_MAX_AAD_SIZE 16
+
+/* Per thread batch of deferred record encryptions */
+typedef struct ptls_vpp_crypto_batch_
+{
+  vnet_crypto_op_t *ops;
+  vnet_crypto_op_chunk_t *chunks;
+  u8 *ivs;
+  u8 *aads;
+  /* App data that stays valid until the batch is flushed */
+  const u8 *src_start;
+  const u8 *src_end;
+  u8 is_deferred;
+} ptls_vpp_crypto_batch_t;
+
+static ptls_vpp_crypto_batch_t *ptls_vpp_crypto_batches;
+
 struct cipher_context_t
 {
   ptls_cipher_context_t super;
@@ -170,6 +187,24 @@ ptls_vpp_crypto_aead_encrypt_update (ptls_aead_context_t * _ctx, void *output,
 				     const void *input, size_t inlen)
 {
   struct vpp_aead_context_t *ctx = (struct vpp_aead_context_t *) _ctx;
+  ptls_vpp_crypto_batch_t *b;
+
+  b = vec_elt_at_index (ptls_vpp_crypto_batches, vlib_get_thread_index ());
+
+  /* If encryption is deferred, the input must outlive this call. Second
+   * update carries the inner content type from picotls' stack, and picotls
+   * builds some records, e.g. post-handshake messages, in temporary memory
+   * it frees before returning. Only app data registered with
+   * ptls_vpp_crypto_defer_src is left in place, anything else is staged in
+   * the output buffer and encrypted in place */
+  if (b->is_deferred && output != input &&
+      (ctx->chunk_index == 1 || (const u8 *) input < b->src_start ||
+       (const u8 *) input + inlen > b->src_end))
+    {
+      clib_memcpy_fast (output, input, inlen);
+      input = output;
+    }
+
   ctx->chunks[ctx->chunk_index].dst = output;
   ctx->chunks[ctx->chunk_index].src = (void *) input;
   ctx->chunks[ctx->chunk_index].len = inlen;
@@ -184,10 +219,29 @@ ptls_vpp_crypto_aead_encrypt_final (ptls_aead_context_t * _ctx, void *_output)
 {
   struct vlib_main_t *vm = vlib_get_main ();
   struct vpp_aead_context_t *ctx = (struct vpp_aead_context_t *) _ctx;
+  ptls_vpp_crypto_batch_t *b;
+  vnet_crypto_op_t *op;
+  u8 *aad;
 
   ctx->op.tag = _output;
   ctx->op.tag_len = ctx->super.algo->tag_size;
 
+  b = vec_elt_at_index (ptls_vpp_crypto_batches, vm->thread_index);
+  if (b->is_deferred)
+    {
+      /* Record is encrypted in place by ptls_vpp_crypto_flush_enc. Keep
+       * copies of per record iv and aad as ctx and picotls reuse them */
+      ASSERT (ctx->op.aad_len <= PTLS_VPP_CRYPTO_MAX_AAD_SIZE);
+      vec_add2_aligned (b->ops, op, 1, CLIB_CACHE_LINE_BYTES);
+      clib_memcpy_fast (op, &ctx->op, sizeof (*op));
+      op->chunk_index = vec_len (b->chunks);
+      vec_add (b->chunks, ctx->chunks, 2);
+      vec_add (b->ivs, ctx->iv, PTLS_MAX_IV_SIZE);
+      vec_add2 (b->aads, aad, PTLS_VPP_CRYPTO_MAX_AAD_SIZE);
+      clib_memcpy_fast (aad, ctx->op.aad, ctx->op.aad_len);
+      return ctx->super.algo->tag_size;
+    }
+
   vnet_crypto_process_chained_ops (vm, &(ctx->op), ctx->chunks, 1);
   assert (ctx->op.status == VNET_CRYPTO_OP_STATUS_COMPLETED);
 
@@ -345,6 +399,80 @@ ptls_cipher_suite_t *ptls_vpp_crypto_cipher_suites[] =
   NULL
 };
 
+void
+ptls_vpp_crypto_defer_enc (u32 thread_index)
+{
+  ptls_vpp_crypto_batch_t *b;
+
+  b = vec_elt_at_index (ptls_vpp_crypto_batches, thread_index);
+  ASSERT (!vec_len (b->ops));
+  b->is_deferred = 1;
+}
+
+/**
+ * Register the app data passed to the next ptls_send. It must stay valid
+ * until the deferred records are flushed, so it can be encrypted from
+ * where it is, other record input is copied.
+ */
+void
+ptls_vpp_crypto_defer_src (u32 thread_index, const void *src, u32 len)
+{
+  ptls_vpp_crypto_batch_t *b;
+
+  b = vec_elt_at_index (ptls_vpp_crypto_batches, thread_index);
+  b->src_start = src;
+  b->src_end = (const u8 *) src + len;
+}
+
+/**
+ * Encrypt all records deferred since the last flush with one call into the
+ * crypto engines, so they can be processed in parallel.
+ */
+void
+ptls_vpp_crypto_flush_enc (vlib_main_t *vm, u32 thread_index)
+{
+  ptls_vpp_crypto_batch_t *b;
+  vnet_crypto_op_t *op;
+  u32 n_ops, i;
+
+  b = vec_elt_at_index (ptls_vpp_crypto_batches, thread_index);
+  n_ops = vec_len (b->ops);
+  if (!n_ops)
+    return;
+
+  /* Vectors may have grown while ops were added, so fix up pointers now */
+  for (i = 0; i < n_ops; i++)
+    {
+      op = &b->ops[i];
+      op->iv = b->ivs + i * PTLS_MAX_IV_SIZE;
+      op->aad = b->aads + i * PTLS_VPP_CRYPTO_MAX_AAD_SIZE;
+    }
+
+  vnet_crypto_process_chained_ops (vm, b->ops, b->chunks, n_ops);
+
+  for (i = 0; i < n_ops; i++)
+    assert (b->ops[i].status == VNET_CRYPTO_OP_STATUS_COMPLETED);
+
+  vec_reset_length (b->ops);
+  vec_reset_length (b->chunks);
+  vec_reset_length (b->ivs);
+  vec_reset_length (b->aads);
+}
+
+void
+ptls_vpp_crypto_end_defer_enc (vlib_main_t *vm, u32 thread_index)
+{
+  ptls_vpp_crypto_flush_enc (vm, thread_index);
+  ptls_vpp_crypto_batches[thread_index].is_deferred = 0;
+  ptls_vpp_crypto_defer_src (thread_index, 0, 0);
+}
+
+void
+ptls_vpp_crypto_init (u32 n_threads)
+{
+  vec_validate (ptls_vpp_crypto_batches, n_threads - 1);
+}
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -17,9 +17,16 @@
 #define __included_pico_vpp_crypto_h__
 
 #include <picotls.h>
+#include <vlib/vlib.h>
 
 extern ptls_cipher_suite_t *ptls_vpp_crypto_cipher_suites[];
 
+void ptls_vpp_crypto_init (u32 n_threads);
+void ptls_vpp_crypto_defer_enc (u32 thread_index);
+void ptls_vpp_crypto_defer_src (u32 thread_index, const void *src, u32 len);
+void ptls_vpp_crypto_flush_enc (vlib_main_t *vm, u32 thread_index);
+void ptls_vpp_crypto_end_defer_enc (vlib_main_t *vm, u32 thread_index);
+
 #endif /* __included_pico_vpp_crypto_h__ */
 
 /*
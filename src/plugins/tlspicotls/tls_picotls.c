@@ -492,6 +492,7 @@ ptls_app_to_tcp_write (picotls_ctx_t *ptls_ctx, session_t *app_session,
   const int n_app_segs = 2, min_chunk = 2048;
   svm_fifo_seg_t app_fs[n_app_segs], tcp_fs[n_tcp_segs];
   picotls_main_t *pm = &picotls_main;
+  vlib_main_t *vm = vlib_get_main ();
   ptls_buffer_t _buf, *buf = &_buf;
   svm_fifo_t *app_tx_fifo;
   u8 is_nocopy, *app_buf;
@@ -509,6 +510,10 @@ ptls_app_to_tcp_write (picotls_ctx_t *ptls_ctx, session_t *app_session,
   if (n_tcp_segs <= 0)
     return 0;
 
+  /* Records are encrypted in place in the tcp fifo and handed to the crypto
+   * engines in batches instead of one op per record */
+  ptls_vpp_crypto_defer_enc (thread_index);
+
   while ((left = len - read) && ti < n_tcp_segs)
     {
       /* If we wrote something and are left with few bytes, postpone write
@@ -520,8 +525,10 @@ ptls_app_to_tcp_write (picotls_ctx_t *ptls_ctx, session_t *app_session,
       if (app_fs[i].len < min_chunk && min_chunk < left)
 	{
 	  app_buf_len = app_fs[i].len + app_fs[i + 1].len;
-	  app_buf = pm->rx_bufs[thread_index];
+	  /* Scratch buffer is reused, so deferred records must be done */
+	  ptls_vpp_crypto_flush_enc (vm, thread_index);
 	  vec_validate (pm->rx_bufs[thread_index], app_buf_len);
+	  app_buf = pm->rx_bufs[thread_index];
 	  clib_memcpy_fast (pm->rx_bufs[thread_index], app_fs[i].data,
 			    app_fs[i].len);
 	  clib_memcpy_fast (pm->rx_bufs[thread_index] + app_fs[i].len,
@@ -542,6 +549,8 @@ ptls_app_to_tcp_write (picotls_ctx_t *ptls_ctx, session_t *app_session,
 
       deq_len = ptls_compute_deq_len (ptls_ctx, tcp_fs[ti].len, app_buf_len,
 				      max_enq, &is_nocopy);
+      /* App fifo and scratch buffer outlive the deferred records */
+      ptls_vpp_crypto_defer_src (thread_index, app_buf, deq_len);
       if (is_nocopy)
 	{
 	  ptls_buffer_init (buf, tcp_fs[ti].data, tcp_fs[ti].len);
@@ -564,6 +573,7 @@ ptls_app_to_tcp_write (picotls_ctx_t *ptls_ctx, session_t *app_session,
 	  assert (rv == 0);
 	  wrote += buf->off;
 
+	  ptls_vpp_crypto_flush_enc (vm, thread_index);
 	  left = ptls_copy_buf_to_fs (buf, buf->off, tcp_fs, &ti, n_tcp_segs);
 	  assert (left == 0);
 	}
@@ -582,6 +592,8 @@ ptls_app_to_tcp_write (picotls_ctx_t *ptls_ctx, session_t *app_session,
 	}
     }
 
+  ptls_vpp_crypto_end_defer_enc (vm, thread_index);
+
   if (read)
     {
       svm_fifo_dequeue_drop (app_tx_fifo, read);
@@ -753,6 +765,7 @@ tls_picotls_init (vlib_main_t * vm)
   vec_validate (pm->tx_bufs, num_threads - 1);
 
   clib_rwlock_init (&picotls_main.crypto_keys_rw_lock);
+  ptls_vpp_crypto_init (num_threads);
 
   tls_register_engine (&picotls_engine, CRYPTO_ENGINE_PICOTLS);
 
@@ -25,11 +25,13 @@ enum
 {
   type_simple = 0,
   type_combined,
+  type_histogram,
 };
 
 enum
 {
   test_expand = 0,
+  test_buckets,
 };
 
 /*
@@ -162,6 +164,93 @@ test_combined_counter_expand (vlib_main_t *vm)
   return 0;
 }
 
+/*
+ * Verify that the lower bound of every histogram bucket, as seen by stat
+ * segment clients, maps back to that bucket in vpp, that increments land
+ * in the right histogram and that percentiles are read back from them.
+ */
+static clib_error_t *
+test_histogram_buckets (vlib_main_t *vm)
+{
+  vlib_histogram_main_t hm = {
+    .name = "test-histogram-buckets",
+    .stat_segment_name = "/vlib/test-histogram-buckets",
+  };
+  u32 log2_sub, b, thread_index = vm->thread_index;
+  clib_error_t *error = 0;
+  u64 min;
+
+  for (log2_sub = 0; log2_sub <= 4; log2_sub += 2)
+    {
+      hm.log2_sub_buckets = log2_sub;
+      hm.n_buckets = (48 - log2_sub) << log2_sub;
+      for (b = 1; b < hm.n_buckets; b++)
+	{
+	  min = stat_segment_histogram_bucket_min (log2_sub, b);
+	  if (vlib_histogram_bucket_min (&hm, b) != min ||
+	      vlib_histogram_bucket (&hm, min) != b ||
+	      vlib_histogram_bucket (&hm, min - 1) != b - 1)
+	    return clib_error_return (0,
+				      "failed bucket %u min %lu log2 sub %u",
+				      b, min, log2_sub);
+	}
+      if (vlib_histogram_bucket (&hm, ~0ULL) != hm.n_buckets - 1)
+	return clib_error_return (0, "failed last bucket log2 sub %u",
+				  log2_sub);
+    }
+
+  hm.log2_sub_buckets = 2;
+  hm.n_buckets = 16;
+  vlib_validate_histogram (&hm, 1);
+  if (vlib_histogram_n_histograms (&hm) != 2)
+    {
+      error = clib_error_return (0, "failed histogram count %u",
+				 vlib_histogram_n_histograms (&hm));
+      goto done;
+    }
+
+  vlib_increment_histogram (&hm, thread_index, 1, 5);
+  vlib_increment_histogram (&hm, thread_index, 1, 1 << 20);
+  /* 5 is in [5, 6), bucket 5; 2^20 overflows into the last bucket */
+  if (hm.counters[thread_index][16 + 5] != 1 ||
+      hm.counters[thread_index][16 + 15] != 1 ||
+      hm.counters[thread_index][5] != 0)
+    {
+      error = clib_error_return (0, "failed histogram increment");
+      goto done;
+    }
+
+  /* 98 samples in bucket 3, then one each in bucket 5 and 15 [28, 32) */
+  for (b = 0; b < 98; b++)
+    vlib_increment_histogram (&hm, thread_index, 1, 3);
+  if (vlib_histogram_count (&hm, VLIB_HISTOGRAM_ALL_THREADS, 1) != 100 ||
+      vlib_histogram_count (&hm, thread_index, 0) != 0 ||
+      vlib_histogram_percentile (&hm, thread_index, 0, 50) != 0 ||
+      vlib_histogram_percentile (&hm, thread_index, 1, 0) != 3 ||
+      vlib_histogram_percentile (&hm, thread_index, 1, 50) != 3 ||
+      vlib_histogram_percentile (&hm, VLIB_HISTOGRAM_ALL_THREADS, 1, 99) !=
+	5 ||
+      vlib_histogram_percentile (&hm, thread_index, 1, 100) != 28)
+    error = clib_error_return (0, "failed histogram percentile");
+
+done:
+  vlib_free_histogram (&hm);
+  return error;
+}
+
+static clib_error_t *
+test_histogram (vlib_main_t *vm, int test_case)
+{
+  switch (test_case)
+    {
+    case test_buckets:
+      return test_histogram_buckets (vm);
+
+    default:
+      return clib_error_return (0, "no such test");
+    }
+}
+
 static clib_error_t *
 test_simple_counter (vlib_main_t *vm, int test_case)
 {
@@ -212,8 +301,12 @@ test_counter_command_fn (vlib_main_t *vm, unformat_input_t *input,
 	counter_type = type_simple;
       else if (unformat (input, "combined"))
 	counter_type = type_combined;
+      else if (unformat (input, "histogram"))
+	counter_type = type_histogram;
       else if (unformat (input, "expand"))
 	test_case = test_expand;
+      else if (unformat (input, "buckets"))
+	test_case = test_buckets;
       else
 	return clib_error_return (0, "unknown input '%U'",
 				  format_unformat_error, input);
@@ -232,6 +325,10 @@ test_counter_command_fn (vlib_main_t *vm, unformat_input_t *input,
       error = test_combined_counter (vm, test_case);
       break;
 
+    case type_histogram:
+      error = test_histogram (vm, test_case);
+      break;
+
     default:
       return clib_error_return (0, "no such test");
     }
@@ -241,7 +338,7 @@ test_counter_command_fn (vlib_main_t *vm, unformat_input_t *input,
 
 VLIB_CLI_COMMAND (test_counter_command, static) = {
   .path = "test counter",
-  .short_help = "test counter [simple | combined] expand",
+  .short_help = "test counter [simple | combined] expand | histogram buckets",
   .function = test_counter_command_fn,
 };
 
@@ -857,6 +857,8 @@ test_crypto_perf (vlib_main_t * vm, crypto_test_main_t * tm)
   vnet_crypto_op_t *ops1 = 0, *ops2 = 0, *op1, *op2;
   vnet_crypto_alg_data_t *ad = vec_elt_at_index (cm->algs, tm->alg);
   vnet_crypto_key_index_t key_index = ~0;
+  vnet_crypto_ops_handler_t *saved_handlers[2] = { 0 };
+  vnet_crypto_op_id_t op_ids[2] = { 0 };
   u8 key[32];
   int buffer_size = vlib_buffer_get_default_data_size (vm);
   u64 seed = clib_cpu_time_now ();
@@ -965,6 +967,46 @@ test_crypto_perf (vlib_main_t * vm, crypto_test_main_t * tm)
 	*(u64 *) (b->data + j) = 1 + random_u64 (&seed);
     }
 
+  /* run against a given engine instead of the active one, e.g. to compare
+     a native implementation with openssl */
+  if (tm->engine)
+    {
+      vnet_crypto_engine_t *ce;
+      uword *p;
+
+      vec_add1 (tm->engine, 0);
+      p = hash_get_mem (cm->engine_index_by_name, tm->engine);
+      if (!p)
+	{
+	  err = clib_error_return (0, "unknown crypto engine '%s'",
+				   tm->engine);
+	  goto done;
+	}
+      ce = vec_elt_at_index (cm->engines, p[0]);
+
+      op_ids[0] = ops1->op;
+      if (ot != VNET_CRYPTO_OP_TYPE_HMAC)
+	op_ids[1] = ops2->op;
+
+      for (i = 0; i < 2; i++)
+	if (op_ids[i] && ce->ops_handlers[op_ids[i]] == 0)
+	  {
+	    err = clib_error_return (0, "engine '%s' doesn't implement %U",
+				     tm->engine, format_vnet_crypto_alg,
+				     tm->alg);
+	    goto done;
+	  }
+
+      for (i = 0; i < 2; i++)
+	if (op_ids[i])
+	  {
+	    saved_handlers[i] = cm->ops_handlers[op_ids[i]];
+	    cm->ops_handlers[op_ids[i]] = ce->ops_handlers[op_ids[i]];
+	  }
+
+      vlib_cli_output (vm, "   engine %s", tm->engine);
+    }
+
   for (i = 0; i < 5; i++)
     {
       for (j = 0; j < warmup_rounds; j++)
@@ -1009,6 +1051,10 @@ test_crypto_perf (vlib_main_t * vm, crypto_test_main_t * tm)
     }
 
 done:
+  for (i = 0; i < 2; i++)
+    if (saved_handlers[i])
+      cm->ops_handlers[op_ids[i]] = saved_handlers[i];
+
   if (n_alloc)
     vlib_buffer_free (vm, buffer_indices, n_alloc);
 
@@ -1027,6 +1073,7 @@ test_crypto_command_fn (vlib_main_t * vm,
 {
   crypto_test_main_t *tm = &crypto_test_main;
   unittest_crypto_test_registration_t *tr;
+  clib_error_t *err;
   int is_perf = 0;
 
   tr = tm->test_registrations;
@@ -1051,22 +1098,32 @@ test_crypto_command_fn (vlib_main_t * vm,
 	;
       else if (unformat (input, "buffer-size %u", &tm->buffer_size))
 	;
+      else if (unformat (input, "engine %s", &tm->engine))
+	;
       else
-	return clib_error_return (0, "unknown input '%U'",
-				  format_unformat_error, input);
+	{
+	  vec_free (tm->engine);
+	  return clib_error_return (0, "unknown input '%U'",
+				    format_unformat_error, input);
+	}
     }
 
   if (is_perf)
-    return test_crypto_perf (vm, tm);
+    err = test_crypto_perf (vm, tm);
   else
-    return test_crypto (vm, tm);
+    err = test_crypto (vm, tm);
+
+  vec_free (tm->engine);
+  return err;
 }
 
 /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (test_crypto_command, static) =
 {
   .path = "test crypto",
-  .short_help = "test crypto",
+  .short_help = "test crypto [verbose|detail] [perf <alg> [engine <name>] "
+		"[buffers <n>] [rounds <n>] [warmup-rounds <n>] "
+		"[buffer-size <n>]]",
   .function = test_crypto_command_fn,
 };
 /* *INDENT-ON* */
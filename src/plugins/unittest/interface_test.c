@@ -14,6 +14,9 @@
  */
 
 #include <vnet/vnet.h>
+#include <vnet/devices/devices.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/interface/rx_queue_funcs.h>
 
 static clib_error_t *
 test_interface_command_fn (vlib_main_t * vm,
@@ -66,6 +69,125 @@ VLIB_CLI_COMMAND (test_interface_command, static) =
 };
 /* *INDENT-ON* */
 
+static uword
+test_rx_balance_input (vlib_main_t *vm, vlib_node_runtime_t *node,
+		       vlib_frame_t *frame)
+{
+  return 0;
+}
+
+VLIB_REGISTER_NODE (test_rx_balance_input_node, static) = {
+  .function = test_rx_balance_input,
+  .name = "test-rx-balance-input",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_DISABLED,
+};
+
+static u32
+test_rx_balance_n_moved (vnet_main_t *vnm, u32 *queue_indices, u32 to)
+{
+  u32 *qi, n_moved = 0;
+
+  vec_foreach (qi, queue_indices)
+    n_moved += vnet_hw_if_get_rx_queue (vnm, *qi)->thread_index == to;
+  return n_moved;
+}
+
+/*
+ * Give a loopback two rx queues on the first worker and fake the load
+ * rx balancing samples: full internal node frames on that worker, all
+ * received on the loopback, while the second worker stays idle. Exactly
+ * one queue must move to the idle worker, and stay there. Rx balancing
+ * must be on, sampling every <interval> seconds, with no holddown.
+ */
+static clib_error_t *
+test_interface_rx_balance_command_fn (vlib_main_t *vm,
+				      unformat_input_t *input,
+				      vlib_cli_command_t *cmd)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vlib_combined_counter_main_t *cm =
+    vnm->interface_main.combined_sw_if_counters + VNET_INTERFACE_COUNTER_RX;
+  u32 sw_if_index, hw_if_index, busy, idle, *queue_indices = 0;
+  u32 i, n_loads, n_moved = 0;
+  clib_error_t *error = 0;
+  vlib_main_t *busy_vm;
+  f64 interval = 0.1;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "interval %f", &interval))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (vdm->last_worker_thread_index <= vdm->first_worker_thread_index)
+    return clib_error_return (0, "rx balance test needs 2 workers");
+
+  busy = vdm->first_worker_thread_index;
+  idle = busy + 1;
+  busy_vm = vlib_get_main_by_index (busy);
+
+  if (vnet_create_loopback_interface (&sw_if_index, 0, 0, 0))
+    return clib_error_return (0, "failed to create a loopback");
+  hw_if_index = vnet_get_sw_interface (vnm, sw_if_index)->hw_if_index;
+
+  vnet_hw_if_set_input_node (vnm, hw_if_index,
+			     test_rx_balance_input_node.index);
+  for (i = 0; i < 2; i++)
+    vec_add1 (queue_indices,
+	      vnet_hw_if_register_rx_queue (vnm, hw_if_index, i, busy));
+  vnet_hw_if_update_runtime_data (vnm, hw_if_index);
+
+  /*
+   * Load the busy worker 4 times per interval, so no sample sees it idle.
+   * Keep loading for a few intervals after the move, a second queue must
+   * not follow the first one.
+   */
+  n_loads = 200;
+  for (i = 0; i < n_loads; i++)
+    {
+      vlib_worker_thread_barrier_sync (vm);
+      busy_vm->internal_node_calls += 1;
+      busy_vm->internal_node_vectors += VLIB_FRAME_SIZE;
+      vlib_increment_combined_counter (cm, busy, sw_if_index,
+				       VLIB_FRAME_SIZE, VLIB_FRAME_SIZE * 64);
+      vlib_worker_thread_barrier_release (vm);
+
+      vlib_process_suspend (vm, interval / 4);
+
+      if (n_moved)
+	continue;
+      n_moved = test_rx_balance_n_moved (vnm, queue_indices, idle);
+      if (n_moved)
+	n_loads = i + 1 + 3 * 4;
+    }
+
+  n_moved = test_rx_balance_n_moved (vnm, queue_indices, idle);
+  if (n_moved != 1)
+    error = clib_error_return (0, "rx balance failed, %u of %u queues moved",
+			       n_moved, vec_len (queue_indices));
+  else
+    vlib_cli_output (vm, "moved %u of %u queues", n_moved,
+		     vec_len (queue_indices));
+
+  vnet_hw_if_unregister_all_rx_queues (vnm, hw_if_index);
+  vnet_hw_if_update_runtime_data (vnm, hw_if_index);
+  vnet_delete_loopback_interface (sw_if_index);
+  vec_free (queue_indices);
+
+  return error;
+}
+
+VLIB_CLI_COMMAND (test_interface_rx_balance_command, static) = {
+  .path = "test interface rx-balance",
+  .short_help = "test interface rx-balance [interval <sec>]",
+  .function = test_interface_rx_balance_command_fn,
+};
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
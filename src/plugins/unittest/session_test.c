@@ -18,6 +18,8 @@
 #include <vnet/session/application.h>
 #include <vnet/session/session.h>
 #include <vnet/session/session_rules_table.h>
+#include <vnet/session/session_hh.h>
+#include <vpp/stats/stat_segment.h>
 #include <vnet/tcp/tcp.h>
 #include <sys/epoll.h>
 
@@ -2013,6 +2015,85 @@ session_test_mq_basic (vlib_main_t * vm, unformat_input_t * input)
   return 0;
 }
 
+static int
+session_test_heavy_hitters (vlib_main_t *vm, unformat_input_t *input)
+{
+  session_hh_main_t *hm = &session_hh_main;
+  u32 n_mice = 2000, n_elephants = 4, topk = 4, round, i, rank, gauge;
+  u64 estimate, elephant_bytes;
+  session_handle_t sh;
+  session_hh_wrk_t *hw;
+  int verbose = 0;
+  f64 now;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "verbose"))
+	verbose = 1;
+      else
+	{
+	  vlib_cli_output (vm, "parse error: '%U'", format_unformat_error,
+			   input);
+	  return -1;
+	}
+    }
+
+  /* No decay while the test runs */
+  session_hh_enable_disable (1, topk, 1e9);
+  hw = vec_elt_at_index (hm->wrk, vm->thread_index);
+  now = hw->last_export;
+
+  /*
+   * Skewed load: many mice sending 100B per round and a few elephants,
+   * elephant j sending (j + 1) * 64kB per round. Handles of elephants are
+   * n_mice + j.
+   */
+  for (round = 0; round < 10; round++)
+    {
+      for (i = 0; i < n_mice; i++)
+	session_hh_update (vm->thread_index, i, SESSION_HH_BYTES, 100, now);
+      for (i = 0; i < n_elephants; i++)
+	session_hh_update (vm->thread_index, n_mice + i, SESSION_HH_BYTES,
+			   (i + 1) << 16, now);
+    }
+
+  SESSION_TEST (hw->trackers[SESSION_HH_BYTES].n_entries == topk,
+		"%u heavy hitters tracked",
+		hw->trackers[SESSION_HH_BYTES].n_entries);
+  SESSION_TEST (hw->trackers[SESSION_HH_EVENTS].n_entries == 0,
+		"no heavy hitters by events");
+
+  /* Force an export to the stats segment */
+  session_hh_update (vm->thread_index, 0, SESSION_HH_BYTES, 100,
+		     now + 2 * SESSION_HH_EXPORT_INTERVAL);
+
+  for (rank = 0; rank < topk; rank++)
+    {
+      i = n_elephants - 1 - rank;
+      gauge = hm->handle_gauges[SESSION_HH_BYTES]
+			       [vm->thread_index * SESSION_HH_MAX_TOPK + rank];
+      sh = stat_segment_main.directory_vector[gauge].index;
+      estimate =
+	vlib_get_simple_counter (&hm->estimates[SESSION_HH_BYTES], rank);
+      elephant_bytes = 10 * ((i + 1) << 16);
+      if (verbose)
+	vlib_cli_output (vm, "rank %u handle %lu estimate %lu", rank, sh,
+			 estimate);
+      SESSION_TEST (sh == n_mice + i, "rank %u is elephant %u, got %lu",
+		    rank, i, sh);
+      /* Count-min sketch only overestimates */
+      SESSION_TEST (estimate >= elephant_bytes &&
+		      estimate < elephant_bytes + (elephant_bytes >> 3),
+		    "rank %u estimate %lu for %lu bytes", rank, estimate,
+		    elephant_bytes);
+    }
+
+  session_hh_enable_disable (0, 0, 0);
+  SESSION_TEST (!hm->is_enabled, "heavy hitters disabled");
+
+  return 0;
+}
+
 static clib_error_t *
 session_test (vlib_main_t * vm,
 	      unformat_input_t * input, vlib_cli_command_t * cmd_arg)
@@ -2039,6 +2120,8 @@ session_test (vlib_main_t * vm,
 	res = session_test_mq_speed (vm, input);
       else if (unformat (input, "mq-basic"))
 	res = session_test_mq_basic (vm, input);
+      else if (unformat (input, "heavy-hitters"))
+	res = session_test_heavy_hitters (vm, input);
       else if (unformat (input, "all"))
 	{
 	  if ((res = session_test_basic (vm, input)))
@@ -2057,6 +2140,8 @@ session_test (vlib_main_t * vm,
 	    goto done;
 	  if ((res = session_test_mq_basic (vm, input)))
 	    goto done;
+	  if ((res = session_test_heavy_hitters (vm, input)))
+	    goto done;
 	}
       else
 	break;
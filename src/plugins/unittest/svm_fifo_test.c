@@ -989,6 +989,50 @@ sfifo_test_fifo5 (vlib_main_t * vm, unformat_input_t * input)
   SFIFO_TEST ((ooo_seg->length == 200), "first seg length %u expected %u",
 	      ooo_seg->length, 200);
 
+  /*
+   * Add 50 one byte holes in reverse order and check lookup rbtree is
+   * consistent with the list
+   */
+  ft_fifo_free (fs, f);
+  f = fifo_prepare (fs, fifo_size);
+
+  for (i = 49; i >= 0; i--)
+    svm_fifo_enqueue_with_offset (f, 2 * i + 1, 1, &test_data[2 * i + 1]);
+
+  SFIFO_TEST ((svm_fifo_n_ooo_segments (f) == 50),
+	      "number of ooo segments %u", svm_fifo_n_ooo_segments (f));
+  /* rbtree also holds the tnil sentinel */
+  SFIFO_TEST ((rb_tree_n_nodes (&f->ooo_seg_lookup) == 51),
+	      "number of rbtree nodes %u", rb_tree_n_nodes (&f->ooo_seg_lookup));
+  ooo_seg = svm_fifo_first_ooo_segment (f);
+  for (i = 0; i < 50 && ooo_seg; i++)
+    {
+      SFIFO_TEST ((ooo_seg->start == 2 * i + 1),
+		  "seg %u start %u expected %u", i, ooo_seg->start, 2 * i + 1);
+      ooo_seg = ooo_seg_next (f, ooo_seg);
+    }
+
+  /* Fill all holes but the first. Segments should merge into one */
+  for (i = 1; i < 50; i++)
+    svm_fifo_enqueue_with_offset (f, 2 * i, 1, &test_data[2 * i]);
+
+  SFIFO_TEST ((svm_fifo_n_ooo_segments (f) == 1),
+	      "number of ooo segments %u", svm_fifo_n_ooo_segments (f));
+  SFIFO_TEST ((rb_tree_n_nodes (&f->ooo_seg_lookup) == 2),
+	      "number of rbtree nodes %u", rb_tree_n_nodes (&f->ooo_seg_lookup));
+  ooo_seg = svm_fifo_first_ooo_segment (f);
+  SFIFO_TEST ((ooo_seg->start == 1), "first seg start %u expected %u",
+	      ooo_seg->start, 1);
+  SFIFO_TEST ((ooo_seg->length == 99), "first seg length %u expected %u",
+	      ooo_seg->length, 99);
+
+  rv = svm_fifo_enqueue (f, 1, test_data);
+  SFIFO_TEST ((rv == 100), "managed to enqueue %u expected %u", rv, 100);
+  SFIFO_TEST ((svm_fifo_n_ooo_segments (f) == 0),
+	      "number of ooo segments %u", svm_fifo_n_ooo_segments (f));
+  SFIFO_TEST ((rb_tree_n_nodes (&f->ooo_seg_lookup) == 1),
+	      "number of rbtree nodes %u", rb_tree_n_nodes (&f->ooo_seg_lookup));
+
   ft_fifo_free (fs, f);
   ft_fifo_segment_free (fsm, fs);
   vec_free (test_data);
@@ -318,6 +318,121 @@ VLIB_CLI_COMMAND (test_linearize_speed_command, static) = {
   .function = test_linearize_speed_fn,
 };
 
+static int
+buffer_cache_test (vlib_main_t *vm)
+{
+  u8 bpi = vlib_buffer_pool_get_default_for_numa (vm, vm->numa_node);
+  vlib_buffer_pool_t *bp = vlib_get_buffer_pool (vm, bpi);
+  vlib_buffer_pool_thread_t *bpt =
+    vec_elt_at_index (bp->threads, vm->thread_index);
+  u32 *bufs = 0, *low = 0, n, n_alloc, size;
+  int i, ret = 0;
+
+  TEST (bp->cache_max_size >= VLIB_BUFFER_POOL_PER_THREAD_CACHE_MIN_SZ &&
+	  bp->cache_max_size <= VLIB_BUFFER_POOL_PER_THREAD_CACHE_MAX_SZ,
+	"cache size limit %u in range", bp->cache_max_size);
+  TEST (bp->cache_max_size == VLIB_BUFFER_POOL_PER_THREAD_CACHE_MIN_SZ ||
+	  (u64) bp->cache_max_size * vlib_get_n_threads () *
+	      VLIB_BUFFER_POOL_CACHE_SHARE <=
+	    bp->n_buffers,
+	"caches of %u threads bounded to a share of %u buffers",
+	vlib_get_n_threads (), bp->n_buffers);
+
+  /* alternating trips to the pool grow the cache up to the limit */
+  n = bp->cache_max_size;
+  vec_validate (bufs, n - 1);
+  for (i = 0; i < 8; i++)
+    {
+      n_alloc = vlib_buffer_alloc_from_pool (vm, bufs, n, bpi);
+      TEST (n_alloc == n, "allocated %u of %u buffers", n_alloc, n);
+      vlib_buffer_free (vm, bufs, n);
+      TEST (bpt->cache_size <= bp->cache_max_size,
+	    "cache size %u within limit %u", bpt->cache_size,
+	    bp->cache_max_size);
+    }
+  TEST (bpt->cache_size == bp->cache_max_size, "cache grown to %u",
+	bpt->cache_size);
+
+  /* and a pool running low shrinks it */
+  size = bpt->cache_size;
+  n = bp->n_avail - bp->n_buffers / 16;
+  vec_validate (low, n - 1);
+  n_alloc = vlib_buffer_alloc_from_pool (vm, low, n, bpi);
+  TEST (n_alloc == n, "allocated %u of %u buffers", n_alloc, n);
+  n_alloc = vlib_buffer_alloc_from_pool (vm, bufs, vec_len (bufs), bpi);
+  vlib_buffer_free (vm, bufs, n_alloc);
+  vlib_buffer_free (vm, low, n);
+  TEST (bpt->cache_size < size, "cache shrunk from %u to %u", size,
+	bpt->cache_size);
+
+  ret = 1;
+err:
+  vec_free (bufs);
+  vec_free (low);
+  return ret;
+}
+
+static clib_error_t *
+test_buffer_cache_fn (vlib_main_t *vm, unformat_input_t *input,
+		      vlib_cli_command_t *cmd)
+{
+  if (!buffer_cache_test (vm))
+    return clib_error_return (0, "buffer cache test failed");
+
+  return 0;
+}
+
+VLIB_CLI_COMMAND (test_buffer_cache_command, static) = {
+  .path = "test buffer-cache",
+  .short_help = "test buffer-cache",
+  .function = test_buffer_cache_fn,
+};
+
+/* buffers allocated and never freed, for leak detectors to find */
+static u32 *test_buffer_leaked;
+
+static clib_error_t *
+test_buffer_leak_fn (vlib_main_t *vm, unformat_input_t *input,
+		     vlib_cli_command_t *cmd)
+{
+  u32 n = 1, n_alloc, len = vec_len (test_buffer_leaked);
+  int is_free = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "count %u", &n))
+	;
+      else if (unformat (input, "free"))
+	is_free = 1;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (is_free)
+    {
+      vlib_buffer_free (vm, test_buffer_leaked, len);
+      vec_reset_length (test_buffer_leaked);
+      vlib_cli_output (vm, "freed %u buffers", len);
+      return 0;
+    }
+
+  vec_validate (test_buffer_leaked, len + n - 1);
+  n_alloc = vlib_buffer_alloc (vm, test_buffer_leaked + len, n);
+  _vec_len (test_buffer_leaked) = len + n_alloc;
+  if (n_alloc != n)
+    return clib_error_return (0, "allocated %u of %u buffers", n_alloc, n);
+
+  vlib_cli_output (vm, "leaked %u buffers", n_alloc);
+  return 0;
+}
+
+VLIB_CLI_COMMAND (test_buffer_leak_command, static) = {
+  .path = "test buffer-leak",
+  .short_help = "test buffer-leak [count <n>] [free]",
+  .function = test_buffer_leak_fn,
+};
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
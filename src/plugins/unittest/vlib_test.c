@@ -224,9 +224,285 @@ VLIB_CLI_COMMAND (test_vlib2_command, static) =
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+test_handoff_congestion_command_fn (vlib_main_t *vm,
+				    unformat_input_t *input,
+				    vlib_cli_command_t *cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_node_runtime_t node = {};
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_t **fq;
+  vlib_frame_queue_ring_t *ring;
+  vlib_node_t *n;
+  static u32 fq_index = ~0;
+  u32 nelts = 16, ring_nelts, bi, n_enq = 0, i, threshold;
+  u64 n_congested, n_drops;
+  clib_error_t *error = 0;
+  u16 thread_index = vm->thread_index;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "nelts %u", &nelts))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (nelts < 2 || (nelts & (nelts - 1)))
+    return clib_error_return (0, "nelts must be a power of 2");
+
+  /*
+   * Frame queues can't be freed, all runs share one. It is created with the
+   * largest rings, which the main loop drains into error-drop between runs.
+   */
+  if (fq_index == ~0)
+    {
+      n = vlib_get_node_by_name (vm, (u8 *) "error-drop");
+      fq_index = vlib_frame_queue_main_init (
+	n->index, FRAME_QUEUE_MAX_NELTS * tm->n_vlib_mains);
+    }
+  fqm = vec_elt_at_index (tm->frame_queue_mains, fq_index);
+
+  /* the configured size is split between the senders, every ring is
+   * allocated up front */
+  ring_nelts = max_pow2 (
+    clib_max (FRAME_QUEUE_MIN_RING_NELTS, nelts / tm->n_vlib_mains));
+  if (ring_nelts > FRAME_QUEUE_MAX_NELTS)
+    return clib_error_return (0, "nelts too large, at most %u per thread",
+			      FRAME_QUEUE_MAX_NELTS);
+
+  vec_foreach (fq, fqm->vlib_frame_queues)
+    vec_foreach (ring, (*fq)->rings)
+      {
+	if (vec_len (ring->elts) != FRAME_QUEUE_MAX_NELTS)
+	  return clib_error_return (0, "queue %u ring %u not allocated",
+				    fq - fqm->vlib_frame_queues,
+				    ring - (*fq)->rings);
+	if (ring->head != ring->tail)
+	  return clib_error_return (0, "queue %u ring %u not drained",
+				    fq - fqm->vlib_frame_queues,
+				    ring - (*fq)->rings);
+      }
+
+  /* empty rings can be resized, their slots are all free */
+  vec_foreach (fq, fqm->vlib_frame_queues)
+    (*fq)->nelts = ring_nelts;
+  vlib_frame_queue_set_congestion_threshold (fq_index, 0);
+  vlib_clear_simple_counters (&fqm->congested);
+  vlib_clear_simple_counters (&fqm->drops);
+  nelts = ring_nelts;
+
+  /*
+   * This thread doesn't dequeue while the command runs, so handing off to
+   * itself congests its own ring: exactly nelts frames must be accepted
+   */
+  for (i = 0; i < 2 * nelts; i++)
+    {
+      if (vlib_buffer_alloc (vm, &bi, 1) != 1)
+	return clib_error_return (0, "buffer allocation failure");
+      n_enq +=
+	vlib_buffer_enqueue_to_thread (vm, &node, fq_index, &bi,
+				       &thread_index, 1, 1 /* drop */);
+    }
+
+  if (n_enq != nelts)
+    return clib_error_return (0, "%u of %u frames queued, expected %u",
+			      n_enq, 2 * nelts, nelts);
+  vlib_cli_output (vm, "%u of %u frames queued", n_enq, 2 * nelts);
+
+  /*
+   * Every attempt made with at least threshold frames in the ring, the
+   * accepted one included, counts as congested: the last nelts -
+   * threshold + 1 accepted frames and all the dropped ones
+   */
+  threshold = fqm->vlib_frame_queues[thread_index]->congestion_threshold;
+  n_congested = vlib_get_simple_counter (&fqm->congested, thread_index);
+  n_drops = vlib_get_simple_counter (&fqm->drops, thread_index);
+
+  if (n_congested != 2 * nelts - threshold + 1)
+    error = clib_error_return (0, "%lu congested enqueues, expected %u",
+			       n_congested, 2 * nelts - threshold + 1);
+  else if (n_drops != nelts)
+    error = clib_error_return (0, "%lu drops, expected %u", n_drops, nelts);
+  else
+    vlib_cli_output (vm, "%lu congested, %lu dropped", n_congested,
+		     n_drops);
+
+  return error;
+}
+
+VLIB_CLI_COMMAND (test_handoff_congestion_command, static) = {
+  .path = "test handoff-congestion",
+  .short_help = "test handoff-congestion [nelts <n>]",
+  .function = test_handoff_congestion_command_fn,
+};
 
+typedef struct
+{
+  u32 n_calls;
+  u32 n_vectors;
+  u32 n_traced;
+} test_coalesce_main_t;
+
+static test_coalesce_main_t test_coalesce_main;
+
+typedef struct
+{
+  u32 buffer_index;
+  u32 n_vectors;
+} test_coalesce_trace_t;
 
+static u8 *
+format_test_coalesce_trace (u8 *s, va_list *args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  test_coalesce_trace_t *t = va_arg (*args, test_coalesce_trace_t *);
+
+  return format (s, "buffer 0x%x in a frame of %u", t->buffer_index,
+		 t->n_vectors);
+}
+
+static uword
+test_coalesce_sink (vlib_main_t *vm, vlib_node_runtime_t *node,
+		    vlib_frame_t *frame)
+{
+  test_coalesce_main_t *tcm = &test_coalesce_main;
+  u32 *from = vlib_frame_vector_args (frame), i;
+  test_coalesce_trace_t *t;
+  vlib_buffer_t *b;
 
+  tcm->n_calls++;
+  tcm->n_vectors += frame->n_vectors;
+
+  if (node->flags & VLIB_NODE_FLAG_TRACE)
+    for (i = 0; i < frame->n_vectors; i++)
+      {
+	b = vlib_get_buffer (vm, from[i]);
+	if (!(b->flags & VLIB_BUFFER_IS_TRACED))
+	  continue;
+	t = vlib_add_trace (vm, node, b, sizeof (*t));
+	t->buffer_index = from[i];
+	t->n_vectors = frame->n_vectors;
+	tcm->n_traced++;
+      }
+
+  vlib_buffer_free (vm, from, frame->n_vectors);
+  return frame->n_vectors;
+}
+
+VLIB_REGISTER_NODE (test_coalesce_sink_node, static) = {
+  .function = test_coalesce_sink,
+  .name = "test-coalesce-sink",
+  .vector_size = sizeof (u32),
+  .format_trace = format_test_coalesce_trace,
+  .flags = VLIB_NODE_FLAG_TRACE_SUPPORTED,
+  /* vlib_trace_buffer flags the next frame of the node it is given */
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+};
+
+/*
+ * Hand many small frames to test-coalesce-sink in one main loop, the first
+ * <traced> of them with every buffer traced, then wait for all packets to
+ * be dispatched. Untraced frames must be merged, traced ones must keep
+ * their traces. Frame coalescing must be enabled for the node first, and
+ * tracing with "trace add test-coalesce-sink" when traced frames are sent.
+ */
+static clib_error_t *
+test_frame_coalescing_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				  vlib_cli_command_t *cmd)
+{
+  test_coalesce_main_t *tcm = &test_coalesce_main;
+  vlib_node_main_t *nm = &vm->node_main;
+  u32 n_frames = 32, n_vectors = 4, n_traced = 4, node_index, i, j;
+  u32 bi[VLIB_FRAME_SIZE], *to;
+  u64 n_merged;
+  vlib_node_runtime_t *rt;
+  vlib_frame_t *f;
+  f64 timeout;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "frames %u", &n_frames))
+	;
+      else if (unformat (input, "vectors %u", &n_vectors))
+	;
+      else if (unformat (input, "traced %u", &n_traced))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (n_frames == 0 || n_vectors == 0 || n_traced > n_frames ||
+      n_frames * n_vectors > VLIB_FRAME_SIZE)
+    return clib_error_return (0, "at most %u vectors in total",
+			      VLIB_FRAME_SIZE);
+
+  node_index = test_coalesce_sink_node.index;
+  rt = vlib_node_get_runtime (vm, node_index);
+  if (nm->coalesce_budget == 0 || !(rt->flags & VLIB_NODE_FLAG_COALESCE))
+    return clib_error_return (0, "frame coalescing is off for %U",
+			      format_vlib_node_name, vm, node_index);
+  if (n_traced && !vm->trace_main.trace_enable)
+    return clib_error_return (0, "tracing is off");
+
+  clib_memset (tcm, 0, sizeof (*tcm));
+  n_merged = nm->coalesce_merged_frames;
+
+  for (i = 0; i < n_frames; i++)
+    {
+      if (vlib_buffer_alloc (vm, bi, n_vectors) != n_vectors)
+	return clib_error_return (0, "buffer allocation failure");
+
+      f = vlib_get_frame_to_node (vm, node_index);
+      to = vlib_frame_vector_args (f);
+      for (j = 0; j < n_vectors; j++)
+	{
+	  to[j] = bi[j];
+	  if (i < n_traced &&
+	      !vlib_trace_buffer (vm, rt, 0, vlib_get_buffer (vm, bi[j]), 0))
+	    return clib_error_return (0, "failed to trace a buffer");
+	}
+      if (i < n_traced)
+	f->frame_flags |= VLIB_FRAME_TRACE;
+      f->n_vectors = n_vectors;
+      vlib_put_frame_to_node (vm, node_index, f);
+    }
+
+  /* Held frames are dispatched once the hold budget is spent */
+  timeout = vlib_time_now (vm) + 1;
+  while (tcm->n_vectors < n_frames * n_vectors && vlib_time_now (vm) < timeout)
+    vlib_process_suspend (vm, 1e-3);
+
+  if (tcm->n_vectors != n_frames * n_vectors)
+    return clib_error_return (0, "failed, %u of %u packets dispatched",
+			      tcm->n_vectors, n_frames * n_vectors);
+  if (tcm->n_traced != n_traced * n_vectors)
+    return clib_error_return (0, "failed, %u of %u packets traced",
+			      tcm->n_traced, n_traced * n_vectors);
+  /* Untraced frames all fit in one, traced ones are never merged */
+  if (tcm->n_calls + nm->coalesce_merged_frames - n_merged != n_frames ||
+      tcm->n_calls > n_traced + 1)
+    return clib_error_return (0, "failed, %u frames dispatched in %u calls",
+			      n_frames, tcm->n_calls);
+
+  vlib_cli_output (vm, "%u packets in %u calls, %u traced", tcm->n_vectors,
+		   tcm->n_calls, tcm->n_traced);
+  return 0;
+}
+
+VLIB_CLI_COMMAND (test_frame_coalescing_command, static) = {
+  .path = "test frame-coalescing",
+  .short_help = "test frame-coalescing [frames <n>] [vectors <n>] "
+		"[traced <n>]",
+  .function = test_frame_coalescing_command_fn,
+};
 
 /*
  * fd.io coding-style-patch-verification: ON
@@ -26,6 +26,8 @@ extern vlib_node_registration_t wg_output_tun_node;
 
 typedef struct wg_per_thread_data_t_
 {
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  vnet_crypto_op_t *crypto_ops;
   u8 data[WG_DEFAULT_DATA_SIZE];
 } wg_per_thread_data_t;
 typedef struct
@@ -51,6 +53,37 @@ extern wg_main_t wg_main;
 #define WG_START_EVENT	1
 void wg_feature_init (wg_main_t * wmp);
 
+/** Process a frame's worth of data path crypto ops in one go, buffers
+    whose op failed are sent to drop_next with the given error
+*/
+static_always_inline void
+wg_process_ops (vlib_main_t *vm, vlib_node_runtime_t *node,
+		vnet_crypto_op_t *ops, vlib_buffer_t *b[], u16 *nexts,
+		u16 drop_next, u32 error)
+{
+  u32 n_fail, n_ops = vec_len (ops);
+  vnet_crypto_op_t *op = ops;
+
+  if (n_ops == 0)
+    return;
+
+  n_fail = n_ops - vnet_crypto_process_ops (vm, op, n_ops);
+
+  while (n_fail)
+    {
+      ASSERT (op - ops < n_ops);
+
+      if (op->status != VNET_CRYPTO_OP_STATUS_COMPLETED)
+	{
+	  u32 bi = op->user_data;
+	  b[bi]->error = node->errors[error];
+	  nexts[bi] = drop_next;
+	  n_fail--;
+	}
+      op++;
+    }
+}
+
 #endif /* __included_wg_h__ */
 
 /*
@@ -32,6 +32,7 @@
   _ (HANDSHAKE_SEND, "Failed while sending Handshake")                        \
   _ (HANDSHAKE_RECEIVE, "Failed while receiving Handshake")                   \
   _ (TOO_BIG, "Packet too big")                                               \
+  _ (REPLAY, "Replayed or too old packet")                                    \
   _ (UNDEFINED, "Undefined error")
 
 typedef enum
@@ -272,6 +273,21 @@ fib_prefix_is_cover_addr_4 (const fib_prefix_t * p1,
   return (false);
 }
 
+static_always_inline void
+wg_input_trace (vlib_main_t *vm, vlib_node_runtime_t *node, vlib_buffer_t *b,
+		message_type_t type, bool is_keepalive, index_t peeri)
+{
+  if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE) &&
+		     (b->flags & VLIB_BUFFER_IS_TRACED)))
+    {
+      wg_input_trace_t *t = vlib_add_trace (vm, node, b, sizeof (*t));
+      t->type = type;
+      t->current_length = b->current_length;
+      t->is_keepalive = is_keepalive;
+      t->peer = peeri;
+    }
+}
+
 VLIB_NODE_FN (wg_input_node) (vlib_main_t * vm,
 			      vlib_node_runtime_t * node,
 			      vlib_frame_t * frame)
@@ -281,22 +297,35 @@ VLIB_NODE_FN (wg_input_node) (vlib_main_t * vm,
   u32 *from;
   vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b;
   u16 nexts[VLIB_FRAME_SIZE], *next;
+  /* keypair each data message is decrypted with, or NULL */
+  noise_keypair_t *kps[VLIB_FRAME_SIZE], **kp;
+  u32 peer_idxs[VLIB_FRAME_SIZE];
   u32 thread_index = vm->thread_index;
 
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
   b = bufs;
   next = nexts;
+  kp = kps;
 
   vlib_get_buffers (vm, from, bufs, n_left_from);
 
   wg_main_t *wmp = &wg_main;
+  wg_per_thread_data_t *ptd =
+    vec_elt_at_index (wmp->per_thread_data, thread_index);
   wg_peer_t *peer = NULL;
 
+  vec_reset_length (ptd->crypto_ops);
+
+  /*
+   * First pass: handshakes are processed right away while the data
+   * messages get a decrypt op, the ops of the whole frame are then
+   * processed at once and the data messages completed in a second pass
+   */
   while (n_left_from > 0)
     {
-      bool is_keepalive = false;
       next[0] = WG_INPUT_NEXT_PUNT;
+      kp[0] = NULL;
       header_type =
 	((message_header_t *) vlib_buffer_get_current (b[0]))->type;
       u32 *peer_idx;
@@ -342,72 +371,24 @@ VLIB_NODE_FN (wg_input_node) (vlib_main_t * vm,
 	      goto out;
 	    }
 
-	  u8 *decr_data = wmp->per_thread_data[thread_index].data;
-
-	  enum noise_state_crypt state_cr = noise_remote_decrypt (vm,
-								  &peer->remote,
-								  data->receiver_index,
-								  data->counter,
-								  data->encrypted_data,
-								  encr_len,
-								  decr_data);
-
-	  if (PREDICT_FALSE (state_cr == SC_CONN_RESET))
-	    {
-	      wg_timers_handshake_complete (peer);
-	    }
-	  else if (PREDICT_FALSE (state_cr == SC_KEEP_KEY_FRESH))
-	    {
-	      wg_send_handshake_from_mt (*peer_idx, false);
-	    }
-	  else if (PREDICT_FALSE (state_cr == SC_FAILED))
+	  kp[0] = noise_remote_decrypt_keypair (&peer->remote,
+						data->receiver_index);
+	  if (PREDICT_FALSE (kp[0] == NULL))
 	    {
 	      next[0] = WG_INPUT_NEXT_ERROR;
 	      b[0]->error = node->errors[WG_INPUT_ERROR_DECRYPTION];
 	      goto out;
 	    }
 
-	  clib_memcpy (vlib_buffer_get_current (b[0]), decr_data, decr_len);
-	  b[0]->current_length = decr_len;
-	  vnet_buffer_offload_flags_clear (b[0],
-					   VNET_BUFFER_OFFLOAD_F_UDP_CKSUM);
-
-	  wg_timers_any_authenticated_packet_received (peer);
-	  wg_timers_any_authenticated_packet_traversal (peer);
-
-	  /* Keepalive packet has zero length */
-	  if (decr_len == 0)
-	    {
-	      is_keepalive = true;
-	      goto out;
-	    }
-
-	  wg_timers_data_received (peer);
-
-	  ip4_header_t *iph = vlib_buffer_get_current (b[0]);
-
-	  const wg_peer_allowed_ip_t *allowed_ip;
-	  bool allowed = false;
-
-	  /*
-	   * we could make this into an ACL, but the expectation
-	   * is that there aren't many allowed IPs and thus a linear
-	   * walk is fater than an ACL
-	   */
-	  vec_foreach (allowed_ip, peer->allowed_ips)
-	  {
-	    if (fib_prefix_is_cover_addr_4 (&allowed_ip->prefix,
-					    &iph->src_address))
-	      {
-		allowed = true;
-		break;
-	      }
-	  }
-	  if (allowed)
-	    {
-	      vnet_buffer (b[0])->sw_if_index[VLIB_RX] = peer->wg_sw_if_index;
-	      next[0] = WG_INPUT_NEXT_IP4_INPUT;
-	    }
+	  /* Decrypted in place, the IV is kept in the pre-data */
+	  vnet_crypto_op_t *op;
+	  vec_add2 (ptd->crypto_ops, op, 1);
+	  noise_data_op_init (op, VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC,
+			      kp[0]->kp_recv_index, data->encrypted_data,
+			      data->encrypted_data, decr_len, b[0]->pre_data,
+			      data->counter, b - bufs);
+	  peer_idxs[b - bufs] = *peer_idx;
+	  goto next;
 	}
       else
 	{
@@ -429,20 +410,110 @@ VLIB_NODE_FN (wg_input_node) (vlib_main_t * vm,
 	}
 
     out:
-      if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)
-			 && (b[0]->flags & VLIB_BUFFER_IS_TRACED)))
+      wg_input_trace (vm, node, b[0], header_type, false,
+		      peer_idx ? *peer_idx : INDEX_INVALID);
+    next:
+      n_left_from -= 1;
+      next += 1;
+      b += 1;
+      kp += 1;
+    }
+
+  /* Decrypt the whole frame, failures are set to drop */
+  wg_process_ops (vm, node, ptd->crypto_ops, bufs, nexts, WG_INPUT_NEXT_ERROR,
+		  WG_INPUT_ERROR_DECRYPTION);
+
+  n_left_from = vec_len (ptd->crypto_ops) ? frame->n_vectors : 0;
+  b = bufs;
+  next = nexts;
+  kp = kps;
+
+  while (n_left_from > 0)
+    {
+      bool is_keepalive = false;
+
+      if (!kp[0])
+	goto next2;
+
+      u32 peeri = peer_idxs[b - bufs];
+
+      if (PREDICT_FALSE (next[0] == WG_INPUT_NEXT_ERROR))
+	goto out2;
+
+      message_data_t *data = vlib_buffer_get_current (b[0]);
+      u16 decr_len =
+	b[0]->current_length - sizeof (message_data_t) - NOISE_AUTHTAG_LEN;
+
+      peer = wg_peer_get (peeri);
+
+      enum noise_state_crypt state_cr = noise_remote_decrypt_finish (
+	vm, &peer->remote, kp[0], data->receiver_index, data->counter);
+
+      if (PREDICT_FALSE (state_cr == SC_CONN_RESET))
 	{
-	  wg_input_trace_t *t = vlib_add_trace (vm, node, b[0], sizeof (*t));
-	  t->type = header_type;
-	  t->current_length = b[0]->current_length;
-	  t->is_keepalive = is_keepalive;
-	  t->peer = peer_idx ? *peer_idx : INDEX_INVALID;
+	  wg_timers_handshake_complete (peer);
 	}
-    next:
+      else if (PREDICT_FALSE (state_cr == SC_KEEP_KEY_FRESH))
+	{
+	  wg_send_handshake_from_mt (peeri, false);
+	}
+      else if (PREDICT_FALSE (state_cr == SC_FAILED))
+	{
+	  next[0] = WG_INPUT_NEXT_ERROR;
+	  b[0]->error = node->errors[WG_INPUT_ERROR_REPLAY];
+	  goto out2;
+	}
+
+      vlib_buffer_advance (b[0], sizeof (message_data_t));
+      b[0]->current_length = decr_len;
+      vnet_buffer_offload_flags_clear (b[0], VNET_BUFFER_OFFLOAD_F_UDP_CKSUM);
+
+      wg_timers_any_authenticated_packet_received (peer);
+      wg_timers_any_authenticated_packet_traversal (peer);
+
+      /* Keepalive packet has zero length */
+      if (decr_len == 0)
+	{
+	  is_keepalive = true;
+	  goto out2;
+	}
+
+      wg_timers_data_received (peer);
+
+      ip4_header_t *iph = vlib_buffer_get_current (b[0]);
+
+      const wg_peer_allowed_ip_t *allowed_ip;
+      bool allowed = false;
+
+      /*
+       * we could make this into an ACL, but the expectation
+       * is that there aren't many allowed IPs and thus a linear
+       * walk is fater than an ACL
+       */
+      vec_foreach (allowed_ip, peer->allowed_ips)
+	{
+	  if (fib_prefix_is_cover_addr_4 (&allowed_ip->prefix,
+					  &iph->src_address))
+	    {
+	      allowed = true;
+	      break;
+	    }
+	}
+      if (allowed)
+	{
+	  vnet_buffer (b[0])->sw_if_index[VLIB_RX] = peer->wg_sw_if_index;
+	  next[0] = WG_INPUT_NEXT_IP4_INPUT;
+	}
+
+    out2:
+      wg_input_trace (vm, node, b[0], MESSAGE_DATA, is_keepalive, peeri);
+    next2:
       n_left_from -= 1;
       next += 1;
       b += 1;
+      kp += 1;
     }
+
   vlib_buffer_enqueue_to_next (vm, node, from, nexts, frame->n_vectors);
 
   return frame->n_vectors;
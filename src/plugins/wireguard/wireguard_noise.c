@@ -16,6 +16,7 @@
  */
 
 #include <openssl/hmac.h>
+#include <vlibmemory/api.h>
 #include <wireguard/wireguard.h>
 
 /* This implements Noise_IKpsk2:
@@ -93,7 +94,7 @@ noise_remote_init (noise_remote_t * r, uint32_t peer_pool_idx,
 {
   clib_memset (r, 0, sizeof (*r));
   clib_memcpy (r->r_public, public, NOISE_PUBLIC_KEY_LEN);
-  clib_rwlock_init (&r->r_keypair_lock);
+  clib_spinlock_init (&r->r_keypair_lock);
   r->r_peer_idx = peer_pool_idx;
   r->r_local_idx = noise_local_idx;
   r->r_handshake.hs_state = HS_ZEROED;
@@ -368,7 +369,7 @@ bool
 noise_remote_begin_session (vlib_main_t * vm, noise_remote_t * r)
 {
   noise_handshake_t *hs = &r->r_handshake;
-  noise_keypair_t kp, *next, *current, *previous;
+  noise_keypair_t kp, *new, *next, *current, *previous;
 
   uint8_t key_send[NOISE_SYMMETRIC_KEY_LEN];
   uint8_t key_recv[NOISE_SYMMETRIC_KEY_LEN];
@@ -406,39 +407,44 @@ noise_remote_begin_session (vlib_main_t * vm, noise_remote_t * r)
   clib_memset (&kp.kp_ctr, 0, sizeof (kp.kp_ctr));
 
   /* Now we need to add_new_keypair */
-  clib_rwlock_writer_lock (&r->r_keypair_lock);
+  clib_spinlock_lock (&r->r_keypair_lock);
   next = r->r_next;
   current = r->r_current;
   previous = r->r_previous;
 
+  /* Readers don't lock, so unlink first and free once unlocked */
   if (kp.kp_is_initiator)
     {
       if (next != NULL)
 	{
-	  r->r_next = NULL;
-	  r->r_previous = next;
-	  noise_remote_keypair_free (vm, r, &current);
+	  clib_atomic_store_rel_n (&r->r_next, NULL);
+	  clib_atomic_store_rel_n (&r->r_previous, next);
+	  next = NULL;
 	}
       else
 	{
-	  r->r_previous = current;
+	  clib_atomic_store_rel_n (&r->r_previous, current);
+	  current = NULL;
 	}
 
-      noise_remote_keypair_free (vm, r, &previous);
-
-      r->r_current = noise_remote_keypair_allocate (r);
-      *r->r_current = kp;
+      new = noise_remote_keypair_allocate (r);
+      *new = kp;
+      clib_atomic_store_rel_n (&r->r_current, new);
     }
   else
     {
-      noise_remote_keypair_free (vm, r, &next);
-      r->r_previous = NULL;
-      noise_remote_keypair_free (vm, r, &previous);
+      clib_atomic_store_rel_n (&r->r_previous, NULL);
+      current = NULL;
 
-      r->r_next = noise_remote_keypair_allocate (r);
-      *r->r_next = kp;
+      new = noise_remote_keypair_allocate (r);
+      *new = kp;
+      clib_atomic_store_rel_n (&r->r_next, new);
     }
-  clib_rwlock_writer_unlock (&r->r_keypair_lock);
+  clib_spinlock_unlock (&r->r_keypair_lock);
+
+  noise_remote_keypair_free (vm, r, &next);
+  noise_remote_keypair_free (vm, r, &current);
+  noise_remote_keypair_free (vm, r, &previous);
 
   secure_zero_memory (&r->r_handshake, sizeof (r->r_handshake));
 
@@ -449,28 +455,34 @@ noise_remote_begin_session (vlib_main_t * vm, noise_remote_t * r)
 void
 noise_remote_clear (vlib_main_t * vm, noise_remote_t * r)
 {
+  noise_keypair_t *next, *current, *previous;
+
   noise_remote_handshake_index_drop (r);
   secure_zero_memory (&r->r_handshake, sizeof (r->r_handshake));
 
-  clib_rwlock_writer_lock (&r->r_keypair_lock);
-  noise_remote_keypair_free (vm, r, &r->r_next);
-  noise_remote_keypair_free (vm, r, &r->r_current);
-  noise_remote_keypair_free (vm, r, &r->r_previous);
-  r->r_next = NULL;
-  r->r_current = NULL;
-  r->r_previous = NULL;
-  clib_rwlock_writer_unlock (&r->r_keypair_lock);
+  clib_spinlock_lock (&r->r_keypair_lock);
+  next = r->r_next;
+  current = r->r_current;
+  previous = r->r_previous;
+  clib_atomic_store_rel_n (&r->r_next, NULL);
+  clib_atomic_store_rel_n (&r->r_current, NULL);
+  clib_atomic_store_rel_n (&r->r_previous, NULL);
+  clib_spinlock_unlock (&r->r_keypair_lock);
+
+  noise_remote_keypair_free (vm, r, &next);
+  noise_remote_keypair_free (vm, r, &current);
+  noise_remote_keypair_free (vm, r, &previous);
 }
 
 void
 noise_remote_expire_current (noise_remote_t * r)
 {
-  clib_rwlock_writer_lock (&r->r_keypair_lock);
+  clib_spinlock_lock (&r->r_keypair_lock);
   if (r->r_next != NULL)
     r->r_next->kp_valid = 0;
   if (r->r_current != NULL)
     r->r_current->kp_valid = 0;
-  clib_rwlock_writer_unlock (&r->r_keypair_lock);
+  clib_spinlock_unlock (&r->r_keypair_lock);
 }
 
 bool
@@ -479,8 +491,7 @@ noise_remote_ready (noise_remote_t * r)
   noise_keypair_t *kp;
   int ret;
 
-  clib_rwlock_reader_lock (&r->r_keypair_lock);
-  if ((kp = r->r_current) == NULL ||
+  if ((kp = clib_atomic_load_acq_n (&r->r_current)) == NULL ||
       !kp->kp_valid ||
       wg_birthdate_has_expired (kp->kp_birthdate, REJECT_AFTER_TIME) ||
       kp->kp_ctr.c_recv >= REJECT_AFTER_MESSAGES ||
@@ -488,7 +499,6 @@ noise_remote_ready (noise_remote_t * r)
     ret = false;
   else
     ret = true;
-  clib_rwlock_reader_unlock (&r->r_keypair_lock);
   return ret;
 }
 
@@ -542,15 +552,14 @@ chacha20poly1305_calc (vlib_main_t * vm,
 }
 
 enum noise_state_crypt
-noise_remote_encrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t * r_idx,
-		      uint64_t * nonce, uint8_t * src, size_t srclen,
-		      uint8_t * dst)
+noise_remote_encrypt_prepare (noise_remote_t *r, uint32_t *r_idx,
+			      uint64_t *nonce,
+			      vnet_crypto_key_index_t *key_index)
 {
   noise_keypair_t *kp;
   enum noise_state_crypt ret = SC_FAILED;
 
-  clib_rwlock_reader_lock (&r->r_keypair_lock);
-  if ((kp = r->r_current) == NULL)
+  if ((kp = clib_atomic_load_acq_n (&r->r_current)) == NULL)
     goto error;
 
   /* We confirm that our values are within our tolerances. We want:
@@ -565,14 +574,10 @@ noise_remote_encrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t * r_idx,
       ((*nonce = noise_counter_send (&kp->kp_ctr)) > REJECT_AFTER_MESSAGES))
     goto error;
 
-  /* We encrypt into the same buffer, so the caller must ensure that buf
-   * has NOISE_AUTHTAG_LEN bytes to store the MAC. The nonce and index
-   * are passed back out to the caller through the provided data pointer. */
+  /* The nonce and index are passed back out to the caller, together with
+   * the key the caller encrypts with. */
   *r_idx = kp->kp_remote_index;
-
-  chacha20poly1305_calc (vm, src, srclen, dst, NULL, 0, *nonce,
-			 VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC,
-			 kp->kp_send_index);
+  *key_index = kp->kp_send_index;
 
   /* If our values are still within tolerances, but we are approaching
    * the tolerances, we notify the caller with ESTALE that they should
@@ -589,35 +594,45 @@ noise_remote_encrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t * r_idx,
 
   ret = SC_OK;
 error:
-  clib_rwlock_reader_unlock (&r->r_keypair_lock);
   return ret;
 }
 
 enum noise_state_crypt
-noise_remote_decrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t r_idx,
-		      uint64_t nonce, uint8_t * src, size_t srclen,
+noise_remote_encrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t * r_idx,
+		      uint64_t * nonce, uint8_t * src, size_t srclen,
 		      uint8_t * dst)
+{
+  vnet_crypto_key_index_t key_index;
+  enum noise_state_crypt ret;
+
+  ret = noise_remote_encrypt_prepare (r, r_idx, nonce, &key_index);
+  if (ret == SC_FAILED)
+    return ret;
+
+  /* We encrypt into the same buffer, so the caller must ensure that buf
+   * has NOISE_AUTHTAG_LEN bytes to store the MAC. */
+  chacha20poly1305_calc (vm, src, srclen, dst, NULL, 0, *nonce,
+			 VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC, key_index);
+
+  return ret;
+}
+
+noise_keypair_t *
+noise_remote_decrypt_keypair (noise_remote_t *r, uint32_t r_idx)
 {
   noise_keypair_t *kp;
-  enum noise_state_crypt ret = SC_FAILED;
-  clib_rwlock_reader_lock (&r->r_keypair_lock);
 
-  if (r->r_current != NULL && r->r_current->kp_local_index == r_idx)
-    {
-      kp = r->r_current;
-    }
-  else if (r->r_previous != NULL && r->r_previous->kp_local_index == r_idx)
-    {
-      kp = r->r_previous;
-    }
-  else if (r->r_next != NULL && r->r_next->kp_local_index == r_idx)
-    {
-      kp = r->r_next;
-    }
+  if ((kp = clib_atomic_load_acq_n (&r->r_current)) != NULL &&
+      kp->kp_local_index == r_idx)
+    ;
+  else if ((kp = clib_atomic_load_acq_n (&r->r_previous)) != NULL &&
+	   kp->kp_local_index == r_idx)
+    ;
+  else if ((kp = clib_atomic_load_acq_n (&r->r_next)) != NULL &&
+	   kp->kp_local_index == r_idx)
+    ;
   else
-    {
-      goto error;
-    }
+    return NULL;
 
   /* We confirm that our values are within our tolerances. These values
    * are the same as the encrypt routine.
@@ -625,16 +640,20 @@ noise_remote_decrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t r_idx,
    * kp_ctr isn't locked here, we're happy to accept a racy read. */
   if (wg_birthdate_has_expired (kp->kp_birthdate, REJECT_AFTER_TIME) ||
       kp->kp_ctr.c_recv >= REJECT_AFTER_MESSAGES)
-    goto error;
+    return NULL;
 
-  /* Decrypt, then validate the counter. We don't want to validate the
-   * counter before decrypting as we do not know the message is authentic
-   * prior to decryption. */
-  if (!chacha20poly1305_calc (vm, src, srclen, dst, NULL, 0, nonce,
-			      VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC,
-			      kp->kp_recv_index))
-    goto error;
+  return kp;
+}
 
+enum noise_state_crypt
+noise_remote_decrypt_finish (vlib_main_t *vm, noise_remote_t *r,
+			     noise_keypair_t *kp, uint32_t r_idx,
+			     uint64_t nonce)
+{
+  enum noise_state_crypt ret = SC_FAILED;
+
+  /* The message has been decrypted and is authentic, only now validate
+   * the counter. */
   if (!noise_counter_recv (&kp->kp_ctr, nonce))
     goto error;
 
@@ -642,24 +661,23 @@ noise_remote_decrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t r_idx,
    * next keypair into current. If we do slide the next keypair in, then
    * we skip the REKEY_AFTER_TIME_RECV check. This is safe to do as a
    * data packet can't confirm a session that we are an INITIATOR of. */
-  if (kp == r->r_next)
+  if (kp == clib_atomic_load_acq_n (&r->r_next))
     {
-      clib_rwlock_reader_unlock (&r->r_keypair_lock);
-      clib_rwlock_writer_lock (&r->r_keypair_lock);
+      noise_keypair_t *previous;
+
+      clib_spinlock_lock (&r->r_keypair_lock);
       if (kp == r->r_next && kp->kp_local_index == r_idx)
 	{
-	  noise_remote_keypair_free (vm, r, &r->r_previous);
-	  r->r_previous = r->r_current;
-	  r->r_current = r->r_next;
-	  r->r_next = NULL;
-
-	  ret = SC_CONN_RESET;
-	  clib_rwlock_writer_unlock (&r->r_keypair_lock);
-	  clib_rwlock_reader_lock (&r->r_keypair_lock);
-	  goto error;
+	  previous = r->r_previous;
+	  clib_atomic_store_rel_n (&r->r_previous, r->r_current);
+	  clib_atomic_store_rel_n (&r->r_current, kp);
+	  clib_atomic_store_rel_n (&r->r_next, NULL);
+	  clib_spinlock_unlock (&r->r_keypair_lock);
+
+	  noise_remote_keypair_free (vm, r, &previous);
+	  return SC_CONN_RESET;
 	}
-      clib_rwlock_writer_unlock (&r->r_keypair_lock);
-      clib_rwlock_reader_lock (&r->r_keypair_lock);
+      clib_spinlock_unlock (&r->r_keypair_lock);
     }
 
   /* Similar to when we encrypt, we want to notify the caller when we
@@ -667,7 +685,7 @@ noise_remote_decrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t r_idx,
    *  - we're the initiator and the current keypair is older than
    *    REKEY_AFTER_TIME_RECV seconds. */
   ret = SC_KEEP_KEY_FRESH;
-  kp = r->r_current;
+  kp = clib_atomic_load_acq_n (&r->r_current);
   if (kp != NULL &&
       kp->kp_valid &&
       kp->kp_is_initiator &&
@@ -676,7 +694,6 @@ noise_remote_decrypt (vlib_main_t * vm, noise_remote_t * r, uint32_t r_idx,
 
   ret = SC_OK;
 error:
-  clib_rwlock_reader_unlock (&r->r_keypair_lock);
   return ret;
 }
 
@@ -690,19 +707,52 @@ noise_remote_keypair_allocate (noise_remote_t * r)
   return kp;
 }
 
+typedef struct
+{
+  /* the local may be gone by the time the free runs */
+  void (*index_drop) (uint32_t);
+  noise_keypair_t *kp;
+} noise_keypair_free_args_t;
+
+static void
+noise_keypair_free_thread_fn (void *arg)
+{
+  noise_keypair_free_args_t *a = arg;
+  vlib_main_t *vm = vlib_get_main ();
+  noise_keypair_t *kp = a->kp;
+
+  a->index_drop (kp->kp_local_index);
+
+  /* The keypair is no longer reachable from the remote, wait for the
+   * workers which may still use it in a dispatch to let go */
+  vlib_worker_wait_one_loop ();
+
+  vnet_crypto_key_del (vm, kp->kp_send_index);
+  vnet_crypto_key_del (vm, kp->kp_recv_index);
+  secure_zero_memory (kp, sizeof (*kp));
+  clib_mem_free (kp);
+}
+
+/* The keypair must have been unlinked from the remote already. The free is
+ * always deferred to the main thread's process context, even when called
+ * on the main thread: wg-input looks keypairs up for a whole frame before
+ * running the batched crypto ops, so a handshake in the middle of a frame
+ * must not free a keypair still referenced by the frame's data packets. */
 static void
 noise_remote_keypair_free (vlib_main_t * vm, noise_remote_t * r,
 			   noise_keypair_t ** kp)
 {
-  noise_local_t *local = noise_local_get (r->r_local_idx);
-  struct noise_upcall *u = &local->l_upcall;
-  if (*kp)
-    {
-      u->u_index_drop ((*kp)->kp_local_index);
-      vnet_crypto_key_del (vm, (*kp)->kp_send_index);
-      vnet_crypto_key_del (vm, (*kp)->kp_recv_index);
-      clib_mem_free (*kp);
-    }
+  noise_keypair_free_args_t a;
+
+  if (*kp == NULL)
+    return;
+
+  a.index_drop = noise_local_get (r->r_local_idx)->l_upcall.u_index_drop;
+  a.kp = *kp;
+  *kp = NULL;
+
+  vl_api_force_rpc_call_main_thread (noise_keypair_free_thread_fn, (u8 *) &a,
+				     sizeof (a));
 }
 
 static uint32_t
@@ -28,6 +28,7 @@
 #define NOISE_TIMESTAMP_LEN	(sizeof(uint64_t) + sizeof(uint32_t))
 #define NOISE_AUTHTAG_LEN	16	//CHACHA20POLY1305_AUTHTAG_SIZE
 #define NOISE_HASH_LEN		BLAKE2S_HASH_SIZE
+#define NOISE_IV_LEN		12
 
 /* Protocol string constants */
 #define NOISE_HANDSHAKE_NAME	"Noise_IKpsk2_25519_ChaChaPoly_BLAKE2s"
@@ -108,7 +109,13 @@ typedef struct noise_remote
   uint8_t r_timestamp[NOISE_TIMESTAMP_LEN];
   f64 r_last_init;
 
-  clib_rwlock_t r_keypair_lock;
+  /* Serializes writers only, the data path reads the keypairs without
+   * locking. A replaced keypair is freed once every worker has been
+   * around the main loop, so a keypair fetched during a node dispatch
+   * remains valid until the dispatch returns. The send counter is only
+   * touched by the peer's output thread and the receive counter by its
+   * input thread. */
+  clib_spinlock_t r_keypair_lock;
   noise_keypair_t *r_next, *r_current, *r_previous;
 } noise_remote_t;
 
@@ -187,11 +194,49 @@ noise_remote_encrypt (vlib_main_t * vm, noise_remote_t *,
 		      uint32_t * r_idx,
 		      uint64_t * nonce,
 		      uint8_t * src, size_t srclen, uint8_t * dst);
-enum noise_state_crypt
-noise_remote_decrypt (vlib_main_t * vm, noise_remote_t *,
-		      uint32_t r_idx,
-		      uint64_t nonce,
-		      uint8_t * src, size_t srclen, uint8_t * dst);
+
+/* Data path, the crypto ops themselves are built and submitted in batches
+ * by the caller */
+enum noise_state_crypt noise_remote_encrypt_prepare (
+  noise_remote_t *r, uint32_t *r_idx, uint64_t *nonce,
+  vnet_crypto_key_index_t *key_index);
+noise_keypair_t *noise_remote_decrypt_keypair (noise_remote_t *r,
+					       uint32_t r_idx);
+enum noise_state_crypt noise_remote_decrypt_finish (vlib_main_t *vm,
+						    noise_remote_t *r,
+						    noise_keypair_t *kp,
+						    uint32_t r_idx,
+						    uint64_t nonce);
+
+/** Fill a ChaCha20-Poly1305 op for a data message. The tag follows the
+    data, both when encrypting and decrypting, and iv must hold
+    NOISE_IV_LEN bytes which stay valid until the op is processed.
+*/
+static_always_inline void
+noise_data_op_init (vnet_crypto_op_t *op, vnet_crypto_op_id_t op_id,
+		    vnet_crypto_key_index_t key_index, u8 *src, u8 *dst,
+		    u32 len, u8 *iv, u64 nonce, u32 user_data)
+{
+  vnet_crypto_op_init (op, op_id);
+  if (op_id == VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC)
+    {
+      op->flags |= VNET_CRYPTO_OP_FLAG_HMAC_CHECK;
+      op->tag = src + len;
+    }
+  else
+    op->tag = dst + len;
+
+  clib_memset (iv, 0, 4);
+  clib_memcpy (iv + 4, &nonce, sizeof (nonce));
+
+  op->key_index = key_index;
+  op->src = src;
+  op->dst = dst;
+  op->len = len;
+  op->tag_len = NOISE_AUTHTAG_LEN;
+  op->iv = iv;
+  op->user_data = user_data;
+}
 
 
 #endif /* __included_wg_noise_h__ */
@@ -26,6 +26,7 @@
  _(PEER, "Peer error")                                                  \
  _(KEYPAIR, "Keypair error")                                            \
  _(TOO_BIG, "packet too big")                                           \
+ _(CRYPTO_ENGINE_ERROR, "crypto engine error (packet dropped)")         \
 
 typedef enum
 {
@@ -98,8 +99,12 @@ VLIB_NODE_FN (wg_output_tun_node) (vlib_main_t * vm,
   vlib_get_buffers (vm, from, bufs, n_left_from);
 
   wg_main_t *wmp = &wg_main;
+  wg_per_thread_data_t *ptd =
+    vec_elt_at_index (wmp->per_thread_data, thread_index);
   wg_peer_t *peer = NULL;
 
+  vec_reset_length (ptd->crypto_ops);
+
   while (n_left_from > 0)
     {
       ip4_udp_header_t *hdr = vlib_buffer_get_current (b[0]);
@@ -144,28 +149,29 @@ VLIB_NODE_FN (wg_output_tun_node) (vlib_main_t * vm,
       size_t encrypted_packet_len = message_data_len (plain_data_len);
 
       /*
-       * Ensure there is enough space to write the encrypted data
-       * into the packet
+       * The data is encrypted in place, ensure there is headroom to
+       * insert the message header and to keep the IV in the pre-data, and
+       * enough space to write the tag after the data
        */
-      if (PREDICT_FALSE (encrypted_packet_len >= WG_DEFAULT_DATA_SIZE) ||
-	  PREDICT_FALSE ((b[0]->current_data + encrypted_packet_len) >=
+      if (PREDICT_FALSE (b[0]->current_data - (i16) sizeof (message_data_t) <
+			 NOISE_IV_LEN - VLIB_BUFFER_PRE_DATA_SIZE) ||
+	  PREDICT_FALSE ((b[0]->current_data + sizeof (ip4_udp_header_t) +
+			  noise_encrypted_len (plain_data_len)) >
 			 vlib_buffer_get_default_data_size (vm)))
 	{
 	  b[0]->error = node->errors[WG_OUTPUT_ERROR_TOO_BIG];
 	  goto out;
 	}
 
-      message_data_t *encrypted_packet =
-	(message_data_t *) wmp->per_thread_data[thread_index].data;
-
       enum noise_state_crypt state;
-      state =
-	noise_remote_encrypt (vm,
-			      &peer->remote,
-			      &encrypted_packet->receiver_index,
-			      &encrypted_packet->counter, plain_data,
-			      plain_data_len,
-			      encrypted_packet->encrypted_data);
+      vnet_crypto_key_index_t key_index;
+      message_data_t *encrypted_packet;
+      vnet_crypto_op_t *op;
+      u32 receiver_index;
+      u64 nonce;
+
+      state = noise_remote_encrypt_prepare (&peer->remote, &receiver_index,
+					    &nonce, &key_index);
 
       if (PREDICT_FALSE (state == SC_KEEP_KEY_FRESH))
 	{
@@ -178,11 +184,24 @@ VLIB_NODE_FN (wg_output_tun_node) (vlib_main_t * vm,
 	  goto out;
 	}
 
-      /* Here we are sure that can send packet to next node */
-      next[0] = WG_OUTPUT_NEXT_INTERFACE_OUTPUT;
+      /* Move the outer headers up to make room for the message header */
+      vlib_buffer_advance (b[0], -(word) sizeof (message_data_t));
+      memmove (vlib_buffer_get_current (b[0]), hdr, sizeof (*hdr));
+      hdr = vlib_buffer_get_current (b[0]);
+
+      encrypted_packet = (message_data_t *) (hdr + 1);
       encrypted_packet->header.type = MESSAGE_DATA;
+      encrypted_packet->receiver_index = receiver_index;
+      encrypted_packet->counter = nonce;
+
+      vec_add2 (ptd->crypto_ops, op, 1);
+      noise_data_op_init (op, VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC, key_index,
+			  encrypted_packet->encrypted_data,
+			  encrypted_packet->encrypted_data, plain_data_len,
+			  b[0]->pre_data, nonce, b - bufs);
 
-      clib_memcpy (plain_data, (u8 *) encrypted_packet, encrypted_packet_len);
+      /* The crypto ops are processed once the whole frame is walked */
+      next[0] = WG_OUTPUT_NEXT_INTERFACE_OUTPUT;
 
       hdr->udp.length = clib_host_to_net_u16 (encrypted_packet_len +
 					      sizeof (udp_header_t));
@@ -210,6 +229,9 @@ VLIB_NODE_FN (wg_output_tun_node) (vlib_main_t * vm,
       b += 1;
     }
 
+  wg_process_ops (vm, node, ptd->crypto_ops, bufs, nexts,
+		  WG_OUTPUT_NEXT_ERROR, WG_OUTPUT_ERROR_CRYPTO_ENGINE_ERROR);
+
   vlib_buffer_enqueue_to_next (vm, node, from, nexts, frame->n_vectors);
   return frame->n_vectors;
 }
@@ -51,6 +51,7 @@ typedef struct
   u32 prev;	/**< Previous linked-list element pool index */
   u32 start;	/**< Start of segment, normalized*/
   u32 length;	/**< Length of segment */
+  rb_node_index_t rb_index; /**< Node index in ooo segment lookup rbtree */
 } ooo_segment_t;
 
 typedef struct
@@ -96,6 +97,7 @@ typedef struct _svm_fifo
   svm_fifo_chunk_t *ooo_deq;	 /**< last chunk used for ooo dequeue */
   svm_fifo_chunk_t *ooo_enq;	 /**< last chunk used for ooo enqueue */
   ooo_segment_t *ooo_segments;	 /**< Pool of ooo segments */
+  rb_tree_t ooo_seg_lookup;	 /**< rbtree of ooo segments by start */
   u32 ooos_list_head;		 /**< Head of out-of-order linked-list */
   u32 ooos_newest;		 /**< Last segment to have been updated */
 
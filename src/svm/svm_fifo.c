@@ -105,6 +105,44 @@ svm_fifo_copy_from_chunk (svm_fifo_t *f, svm_fifo_chunk_t *c, u32 head_idx,
 						   last);
 }
 
+static rb_node_t *
+f_find_node_rbtree (rb_tree_t * rt, u32 pos)
+{
+  rb_node_t *cur, *prev;
+
+  cur = rb_node (rt, rt->root);
+  if (PREDICT_FALSE (rb_node_is_tnil (rt, cur)))
+    return 0;
+
+  while (pos != cur->key)
+    {
+      prev = cur;
+      if (f_pos_lt (pos, cur->key))
+	{
+	  cur = rb_node_left (rt, cur);
+	  if (rb_node_is_tnil (rt, cur))
+	    {
+	      cur = rb_tree_predecessor (rt, prev);
+	      break;
+	    }
+	}
+      else
+	{
+	  cur = rb_node_right (rt, cur);
+	  if (rb_node_is_tnil (rt, cur))
+	    {
+	      cur = prev;
+	      break;
+	    }
+	}
+    }
+
+  if (rb_node_is_tnil (rt, cur))
+    return 0;
+
+  return cur;
+}
+
 static inline u32
 ooo_segment_end_pos (ooo_segment_t * s)
 {
@@ -115,14 +153,7 @@ void
 svm_fifo_free_ooo_data (svm_fifo_t * f)
 {
   pool_free (f->ooo_segments);
-}
-
-static inline ooo_segment_t *
-ooo_segment_prev (svm_fifo_t * f, ooo_segment_t * s)
-{
-  if (s->prev == OOO_SEGMENT_INVALID_INDEX)
-    return 0;
-  return pool_elt_at_index (f->ooo_segments, s->prev);
+  rb_tree_free_nodes (&f->ooo_seg_lookup);
 }
 
 static inline ooo_segment_t *
@@ -144,6 +175,11 @@ ooo_segment_alloc (svm_fifo_t * f, u32 start, u32 length)
   s->length = length;
   s->prev = s->next = OOO_SEGMENT_INVALID_INDEX;
 
+  if (PREDICT_FALSE (!rb_tree_is_init (&f->ooo_seg_lookup)))
+    rb_tree_init (&f->ooo_seg_lookup);
+  s->rb_index = rb_tree_add_custom (&f->ooo_seg_lookup, start,
+				    s - f->ooo_segments, f_pos_lt);
+
   return s;
 }
 
@@ -169,9 +205,40 @@ ooo_segment_free (svm_fifo_t * f, u32 index)
       f->ooos_list_head = cur->next;
     }
 
+  rb_tree_del_node (&f->ooo_seg_lookup,
+		    rb_node (&f->ooo_seg_lookup, cur->rb_index));
   pool_put (f->ooo_segments, cur);
 }
 
+/**
+ * Find last segment that starts at or before position
+ *
+ * Segments are tracked in an rbtree keyed by their start position, so
+ * lookups are logarithmic in the number of ooo segments.
+ */
+static inline ooo_segment_t *
+ooo_segment_lookup (svm_fifo_t *f, u32 pos)
+{
+  rb_node_t *n;
+
+  n = f_find_node_rbtree (&f->ooo_seg_lookup, pos);
+  if (!n)
+    return 0;
+  return pool_elt_at_index (f->ooo_segments, n->opaque);
+}
+
+/**
+ * Move start of segment to a lower position. Caller guarantees the new start
+ * does not overlap the previous segment, so ordering in the rbtree is not
+ * changed and the node's key can be updated in place.
+ */
+static inline void
+ooo_segment_update_start (svm_fifo_t *f, ooo_segment_t *s, u32 start)
+{
+  rb_node (&f->ooo_seg_lookup, s->rb_index)->key = start;
+  s->start = start;
+}
+
 /**
  * Add segment to fifo's out-of-order segment list. Takes care of merging
  * adjacent segments and removing overlapping ones.
@@ -180,7 +247,7 @@ static void
 ooo_segment_add (svm_fifo_t * f, u32 offset, u32 head, u32 tail, u32 length)
 {
   ooo_segment_t *s, *new_s, *prev, *next, *it;
-  u32 new_index, s_end_pos, s_index;
+  u32 new_index, s_end_pos, s_index, prev_index;
   u32 offset_pos, offset_end_pos;
 
   ASSERT (offset + length <= f_free_count (f, head, tail));
@@ -198,40 +265,35 @@ ooo_segment_add (svm_fifo_t * f, u32 offset, u32 head, u32 tail, u32 length)
       return;
     }
 
-  /* Find first segment that starts after new segment */
-  s = pool_elt_at_index (f->ooo_segments, f->ooos_list_head);
-  while (s->next != OOO_SEGMENT_INVALID_INDEX
-	 && f_pos_lt (s->start, offset_pos))
-    s = pool_elt_at_index (f->ooo_segments, s->next);
-
-  /* If we have a previous and we overlap it, use it as starting point */
-  prev = ooo_segment_prev (f, s);
-  if (prev && f_pos_leq (offset_pos, ooo_segment_end_pos (prev)))
+  /* Find last segment that starts at or before new segment. If we overlap
+   * it, use it as starting point */
+  s = ooo_segment_lookup (f, offset_pos);
+  if (s && f_pos_leq (offset_pos, ooo_segment_end_pos (s)))
     {
-      s = prev;
       s_end_pos = ooo_segment_end_pos (s);
-
-      /* Since we have previous, offset start position cannot be smaller
-       * than prev->start. Check tail */
-      ASSERT (f_pos_lt (s->start, offset_pos));
       goto check_tail;
     }
 
-  s_index = s - f->ooo_segments;
-  s_end_pos = ooo_segment_end_pos (s);
+  /* Segment that follows new segment, if any */
+  prev = s;
+  s = prev ? ooo_segment_next (f, prev) : svm_fifo_first_ooo_segment (f);
 
-  /* No overlap, add before current segment */
-  if (f_pos_lt (offset_end_pos, s->start))
+  /* No overlap, add between previous and next segments */
+  if (!s || f_pos_lt (offset_end_pos, s->start))
     {
+      prev_index = prev ? prev - f->ooo_segments : OOO_SEGMENT_INVALID_INDEX;
+      s_index = s ? s - f->ooo_segments : OOO_SEGMENT_INVALID_INDEX;
+
       new_s = ooo_segment_alloc (f, offset_pos, length);
       new_index = new_s - f->ooo_segments;
 
-      /* Pool might've moved, get segment again */
-      s = pool_elt_at_index (f->ooo_segments, s_index);
-      if (s->prev != OOO_SEGMENT_INVALID_INDEX)
+      /* Pool might've moved, get segments again */
+      new_s->prev = prev_index;
+      new_s->next = s_index;
+
+      if (prev_index != OOO_SEGMENT_INVALID_INDEX)
 	{
-	  new_s->prev = s->prev;
-	  prev = pool_elt_at_index (f->ooo_segments, new_s->prev);
+	  prev = pool_elt_at_index (f->ooo_segments, prev_index);
 	  prev->next = new_index;
 	}
       else
@@ -240,27 +302,13 @@ ooo_segment_add (svm_fifo_t * f, u32 offset, u32 head, u32 tail, u32 length)
 	  f->ooos_list_head = new_index;
 	}
 
-      new_s->next = s_index;
-      s->prev = new_index;
-      f->ooos_newest = new_index;
-      return;
-    }
-  /* No overlap, add after current segment */
-  else if (f_pos_gt (offset_pos, s_end_pos))
-    {
-      new_s = ooo_segment_alloc (f, offset_pos, length);
-      new_index = new_s - f->ooo_segments;
-
-      /* Pool might've moved, get segment again */
-      s = pool_elt_at_index (f->ooo_segments, s_index);
-
-      /* Needs to be last */
-      ASSERT (s->next == OOO_SEGMENT_INVALID_INDEX);
+      if (s_index != OOO_SEGMENT_INVALID_INDEX)
+	{
+	  s = pool_elt_at_index (f->ooo_segments, s_index);
+	  s->prev = new_index;
+	}
 
-      new_s->prev = s_index;
-      s->next = new_index;
       f->ooos_newest = new_index;
-
       return;
     }
 
@@ -268,13 +316,12 @@ ooo_segment_add (svm_fifo_t * f, u32 offset, u32 head, u32 tail, u32 length)
    * Merge needed
    */
 
-  /* Merge at head */
-  if (f_pos_lt (offset_pos, s->start))
-    {
-      s->start = offset_pos;
-      s->length = s_end_pos - s->start;
-      f->ooos_newest = s - f->ooo_segments;
-    }
+  /* Merge at head. Next segment starts after new segment by construction */
+  ASSERT (f_pos_lt (offset_pos, s->start));
+  s_end_pos = ooo_segment_end_pos (s);
+  ooo_segment_update_start (f, s, offset_pos);
+  s->length = s_end_pos - s->start;
+  f->ooos_newest = s - f->ooo_segments;
 
 check_tail:
 
@@ -544,44 +591,6 @@ svm_fifo_max_write_chunk (svm_fifo_t * f)
   return tail_chunk ? f_chunk_end (tail_chunk) - tail : 0;
 }
 
-static rb_node_t *
-f_find_node_rbtree (rb_tree_t * rt, u32 pos)
-{
-  rb_node_t *cur, *prev;
-
-  cur = rb_node (rt, rt->root);
-  if (PREDICT_FALSE (rb_node_is_tnil (rt, cur)))
-    return 0;
-
-  while (pos != cur->key)
-    {
-      prev = cur;
-      if (f_pos_lt (pos, cur->key))
-	{
-	  cur = rb_node_left (rt, cur);
-	  if (rb_node_is_tnil (rt, cur))
-	    {
-	      cur = rb_tree_predecessor (rt, prev);
-	      break;
-	    }
-	}
-      else
-	{
-	  cur = rb_node_right (rt, cur);
-	  if (rb_node_is_tnil (rt, cur))
-	    {
-	      cur = prev;
-	      break;
-	    }
-	}
-    }
-
-  if (rb_node_is_tnil (rt, cur))
-    return 0;
-
-  return cur;
-}
-
 static svm_fifo_chunk_t *
 f_find_chunk_rbtree (rb_tree_t * rt, u32 pos)
 {
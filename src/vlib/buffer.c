@@ -494,6 +494,29 @@ vlib_buffer_alloc_size (uword ext_hdr_size, uword data_size)
   return alloc_size;
 }
 
+static void
+vlib_buffer_pool_validate_threads (vlib_buffer_pool_t *bp)
+{
+  vlib_buffer_pool_thread_t *bpt;
+
+  u32 n_threads = vlib_get_n_threads ();
+  u32 max_size;
+
+  vec_validate_aligned (bp->threads, n_threads - 1, CLIB_CACHE_LINE_BYTES);
+
+  max_size = bp->n_buffers / (n_threads * VLIB_BUFFER_POOL_CACHE_SHARE);
+  max_size = clib_min (max_size, VLIB_BUFFER_POOL_PER_THREAD_CACHE_MAX_SZ);
+  bp->cache_max_size =
+    clib_max (max_size, VLIB_BUFFER_POOL_PER_THREAD_CACHE_MIN_SZ);
+
+  vec_foreach (bpt, bp->threads)
+    if (bpt->cache_size == 0)
+      bpt->cache_size = clib_min (VLIB_BUFFER_POOL_PER_THREAD_CACHE_SZ,
+				  bp->cache_max_size);
+    else
+      bpt->cache_size = clib_min (bpt->cache_size, bp->cache_max_size);
+}
+
 u8
 vlib_buffer_pool_create (vlib_main_t * vm, char *name, u32 data_size,
 			 u32 physmem_map_index)
@@ -546,9 +569,6 @@ vlib_buffer_pool_create (vlib_main_t * vm, char *name, u32 data_size,
   bp->data_size = data_size;
   bp->numa_node = m->numa_node;
 
-  vec_validate_aligned (bp->threads, vlib_get_n_threads () - 1,
-			CLIB_CACHE_LINE_BYTES);
-
   alloc_size = vlib_buffer_alloc_size (bm->ext_hdr_size, data_size);
   n_alloc_per_page = (1ULL << m->log2_page_size) / alloc_size;
 
@@ -557,6 +577,9 @@ vlib_buffer_pool_create (vlib_main_t * vm, char *name, u32 data_size,
   bp->buffers = clib_mem_alloc_aligned (bp->n_buffers * sizeof (u32),
 					CLIB_CACHE_LINE_BYTES);
 
+  /* cache sizes depend on the pool size */
+  vlib_buffer_pool_validate_threads (bp);
+
   clib_spinlock_init (&bp->lock);
 
   for (j = 0; j < m->n_pages; j++)
@@ -630,18 +653,48 @@ format_vlib_buffer_pool_all (u8 *s, va_list *va)
   return s;
 }
 
+static u8 *
+format_vlib_buffer_pool_threads (u8 *s, va_list *va)
+{
+  vlib_buffer_pool_t *bp = va_arg (*va, vlib_buffer_pool_t *);
+  vlib_buffer_pool_thread_t *bpt;
+
+  s = format (s,
+	      "%s (cache size limit %u):\n"
+	      "  %=8s%=8s%=8s%=14s%=14s%=12s%=12s%=12s",
+	      bp->name, bp->cache_max_size, "Thread", "Size", "Cached",
+	      "Alloc", "Free", "Pool Get", "Pool Put", "Contended");
+
+  vec_foreach (bpt, bp->threads)
+    s = format (s, "\n  %=8u%=8u%=8u%=14lu%=14lu%=12lu%=12lu%=12lu",
+		bpt - bp->threads, bpt->cache_size, bpt->n_cached,
+		bpt->n_alloc, bpt->n_free, bpt->n_pool_get, bpt->n_pool_put,
+		bpt->n_contended);
+
+  return s;
+}
+
 static clib_error_t *
 show_buffers (vlib_main_t *vm, unformat_input_t *input,
 	      vlib_cli_command_t *cmd)
 {
+  vlib_buffer_main_t *bm = vm->buffer_main;
+  vlib_buffer_pool_t *bp;
+
   vlib_cli_output (vm, "%U", format_vlib_buffer_pool_all, vm);
+
+  if (unformat (input, "verbose"))
+    vec_foreach (bp, bm->buffer_pools)
+      if (bp->n_buffers)
+	vlib_cli_output (vm, "%U", format_vlib_buffer_pool_threads, bp);
+
   return 0;
 }
 
 /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (show_buffers_command, static) = {
   .path = "show buffers",
-  .short_help = "Show packet buffer allocation",
+  .short_help = "show buffers [verbose]",
   .function = show_buffers,
 };
 /* *INDENT-ON* */
@@ -656,8 +709,7 @@ vlib_buffer_worker_init (vlib_main_t * vm)
   vec_foreach (bp, bm->buffer_pools)
     {
       clib_spinlock_lock (&bp->lock);
-      vec_validate_aligned (bp->threads, vlib_get_n_threads () - 1,
-			    CLIB_CACHE_LINE_BYTES);
+      vlib_buffer_pool_validate_threads (bp);
       clib_spinlock_unlock (&bp->lock);
     }
   /* *INDENT-ON* */
@@ -831,6 +883,28 @@ buffer_gauges_update_cached_fn (stat_segment_directory_entry_t * e, u32 index)
   e->value = buffer_get_cached (bp);
 }
 
+#define foreach_buffer_pool_thread_stat                                       \
+  _ (n_alloc, alloc)                                                          \
+  _ (n_free, free)                                                            \
+  _ (n_contended, contended)
+
+#define _(field, name)                                                        \
+  static void buffer_gauges_update_##name##_fn (                              \
+    stat_segment_directory_entry_t *e, u32 index)                             \
+  {                                                                           \
+    vlib_main_t *vm = vlib_get_main ();                                       \
+    vlib_buffer_pool_t *bp = buffer_get_by_index (vm->buffer_main, index);    \
+    vlib_buffer_pool_thread_t *bpt;                                           \
+    u64 sum = 0;                                                              \
+    if (!bp)                                                                  \
+      return;                                                                 \
+    vec_foreach (bpt, bp->threads)                                            \
+      sum += bpt->field;                                                      \
+    e->value = sum;                                                           \
+  }
+foreach_buffer_pool_thread_stat
+#undef _
+
 clib_error_t *
 vlib_buffer_main_init (struct vlib_main_t * vm)
 {
@@ -919,6 +993,14 @@ vlib_buffer_main_init (struct vlib_main_t * vm)
     name = format (name, "/buffer-pools/%s/available%c", bp->name, 0);
     stat_segment_register_gauge (name, buffer_gauges_update_available_fn,
 				 bp - bm->buffer_pools);
+
+#define _(field, n)                                                           \
+  vec_reset_length (name);                                                    \
+  name = format (name, "/buffer-pools/%s/" #n "%c", bp->name, 0);             \
+  stat_segment_register_gauge (name, buffer_gauges_update_##n##_fn,           \
+			       bp - bm->buffer_pools);
+    foreach_buffer_pool_thread_stat
+#undef _
   }
 
 done:
@@ -991,6 +1073,40 @@ vlib_buffer_set_alloc_free_callback (
   return 0;
 }
 
+/*
+ * Append the indices of all buffers of a pool, allocated or not, in memory
+ * order. Pools never grow, so the result stays valid.
+ */
+__clib_export u32 *
+vlib_buffer_pool_get_all_buffers (vlib_main_t *vm, u8 buffer_pool_index,
+				  u32 *buffers)
+{
+  vlib_buffer_main_t *bm = vm->buffer_main;
+  vlib_buffer_pool_t *bp = vlib_get_buffer_pool (vm, buffer_pool_index);
+  vlib_physmem_map_t *m = vlib_physmem_get_map (vm, bp->physmem_map_index);
+  u32 alloc_size, n_alloc_per_page;
+  uword i, j;
+
+  alloc_size = vlib_buffer_alloc_size (bm->ext_hdr_size, bp->data_size);
+  n_alloc_per_page = (1ULL << m->log2_page_size) / alloc_size;
+
+  for (j = 0; j < m->n_pages; j++)
+    for (i = 0; i < n_alloc_per_page; i++)
+      {
+	u8 *p = m->base + (j << m->log2_page_size) + i * alloc_size;
+
+	p += bm->ext_hdr_size;
+
+	/* see vlib_buffer_pool_create () */
+	if (p == m->base)
+	  continue;
+
+	vec_add1 (buffers, vlib_get_buffer_index (vm, (vlib_buffer_t *) p));
+      }
+
+  return buffers;
+}
+
 /** @endcond */
 /*
  * fd.io coding-style-patch-verification: ON
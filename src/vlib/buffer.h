@@ -438,13 +438,38 @@ vlib_buffer_pull (vlib_buffer_t * b, u8 size)
 /* Forward declaration. */
 struct vlib_main_t;
 
-#define VLIB_BUFFER_POOL_PER_THREAD_CACHE_SZ 512
+/*
+ * Per-thread cache capacity starts at the default size and adapts: it
+ * grows while a thread alternates between refilling from and spilling to
+ * the pool, and shrinks when the pool runs low. Caches of pools on a
+ * remote NUMA node only collect buffers to be returned home, so they run
+ * at maximum size and are flushed in one go. The maximum size is further
+ * limited so that the caches of all threads together hold at most
+ * 1/VLIB_BUFFER_POOL_CACHE_SHARE of the pool.
+ */
+#define VLIB_BUFFER_POOL_PER_THREAD_CACHE_SZ	 512
+#define VLIB_BUFFER_POOL_PER_THREAD_CACHE_MIN_SZ 128
+#define VLIB_BUFFER_POOL_PER_THREAD_CACHE_MAX_SZ 2048
+#define VLIB_BUFFER_POOL_CACHE_SHARE		 4
 
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
-  u32 cached_buffers[VLIB_BUFFER_POOL_PER_THREAD_CACHE_SZ];
   u32 n_cached;
+  u32 cache_size;
+  /* last trip to the pool returned buffers */
+  u8 last_pool_op_was_put;
+
+  /* buffers allocated and freed by this thread */
+  u64 n_alloc;
+  u64 n_free;
+  /* trips to the pool, and how many found the pool lock taken */
+  u64 n_pool_get;
+  u64 n_pool_put;
+  u64 n_contended;
+
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  u32 cached_buffers[VLIB_BUFFER_POOL_PER_THREAD_CACHE_MAX_SZ];
 } vlib_buffer_pool_thread_t;
 
 typedef struct
@@ -460,6 +485,8 @@ typedef struct
   u32 n_buffers;
   u32 n_avail;
   u32 *buffers;
+  /* per-thread cache size limit for the current number of threads */
+  u32 cache_max_size;
   u8 *name;
   clib_spinlock_t lock;
 
@@ -515,6 +542,9 @@ int vlib_buffer_set_alloc_free_callback (
   struct vlib_main_t *vm, vlib_buffer_alloc_free_callback_t *alloc_callback_fn,
   vlib_buffer_alloc_free_callback_t *free_callback_fn);
 
+u32 *vlib_buffer_pool_get_all_buffers (struct vlib_main_t *vm,
+				       u8 buffer_pool_index, u32 *buffers);
+
 extern u16 __vlib_buffer_external_hdr_size;
 #define VLIB_BUFFER_SET_EXT_HDR_SIZE(x) \
 static void __clib_constructor \
@@ -169,35 +169,65 @@ next:
 CLIB_MARCH_FN_REGISTRATION (vlib_buffer_enqueue_to_single_next_fn);
 
 static inline vlib_frame_queue_elt_t *
-vlib_get_frame_queue_elt (vlib_frame_queue_main_t *fqm, u32 index,
-			  int dont_wait)
+vlib_get_frame_queue_elt (vlib_main_t *vm, vlib_frame_queue_main_t *fqm,
+			  u32 index, int dont_wait)
 {
   vlib_frame_queue_t *fq;
-  u64 nelts, tail, new_tail;
+  vlib_frame_queue_ring_t *ring;
+  u64 nelts, tail;
 
   fq = fqm->vlib_frame_queues[index];
   ASSERT (fq);
+  ring = vec_elt_at_index (fq->rings, vm->thread_index);
   nelts = fq->nelts;
 
-retry:
-  tail = __atomic_load_n (&fq->tail, __ATOMIC_ACQUIRE);
-  new_tail = tail + 1;
+  /* Only the sending thread moves the tail */
+  tail = ring->tail;
 
-  if (new_tail >= fq->head + nelts)
+  /*
+   * The cached head can only lag behind, so the receiver's cache line is
+   * read only when the ring looks congested or full
+   */
+  if (PREDICT_FALSE (tail + 1 - ring->head_cache >=
+		     clib_min (fq->congestion_threshold, nelts)))
     {
-      if (dont_wait)
-	return 0;
+      ring->head_cache = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+
+      if (tail + 1 - ring->head_cache >= fq->congestion_threshold)
+	vlib_increment_simple_counter (&fqm->congested, vm->thread_index,
+				       index, 1);
 
-      /* Wait until a ring slot is available */
-      while (new_tail >= fq->head + nelts)
-	vlib_worker_thread_barrier_check ();
+      if (tail - ring->head_cache >= nelts)
+	{
+	  if (dont_wait)
+	    return 0;
+
+	  /* Wait until a ring slot is available */
+	  do
+	    {
+	      vlib_worker_thread_barrier_check ();
+	      ring->head_cache =
+		__atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+	    }
+	  while (tail - ring->head_cache >= nelts);
+	}
     }
 
-  if (!__atomic_compare_exchange_n (&fq->tail, &tail, new_tail, 0 /* weak */,
-				    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
-    goto retry;
+  return ring->elts + (tail & (nelts - 1));
+}
+
+static_always_inline void
+vlib_put_frame_queue_elt (vlib_main_t *vm, vlib_frame_queue_main_t *fqm,
+			  u32 index)
+{
+  vlib_frame_queue_t *fq = fqm->vlib_frame_queues[index];
+  vlib_frame_queue_ring_t *ring;
+
+  ring = vec_elt_at_index (fq->rings, vm->thread_index);
 
-  return fq->elts + (new_tail & (nelts - 1));
+  /* Publish the element, the receiver acquires the tail before reading it */
+  __atomic_store_n (&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+  vlib_get_main_by_index (index)->check_frame_queues = 1;
 }
 
 static_always_inline u32
@@ -218,21 +248,28 @@ vlib_buffer_enqueue_to_thread_inline (vlib_main_t *vm,
 
 more:
   clib_mask_compare_u16 (thread_index, thread_indices, mask, n_packets);
-  hf = vlib_get_frame_queue_elt (fqm, thread_index, drop_on_congestion);
+  hf = vlib_get_frame_queue_elt (vm, fqm, thread_index, drop_on_congestion);
 
   n_comp = clib_compress_u32 (hf ? hf->buffer_index : drop_list + n_drop,
 			      buffer_indices, mask, n_packets);
 
   if (hf)
     {
-      if (node->flags & VLIB_NODE_FLAG_TRACE)
-	hf->maybe_trace = 1;
+      hf->maybe_trace = (node->flags & VLIB_NODE_FLAG_TRACE) != 0;
       hf->n_vectors = n_comp;
-      __atomic_store_n (&hf->valid, 1, __ATOMIC_RELEASE);
-      vlib_get_main_by_index (thread_index)->check_frame_queues = 1;
+      hf->offset = 0;
+      vlib_put_frame_queue_elt (vm, fqm, thread_index);
     }
   else
-    n_drop += n_comp;
+    {
+      vlib_increment_simple_counter (&fqm->drops, vm->thread_index,
+				     thread_index, n_comp);
+      n_drop += n_comp;
+    }
+
+  /* Let the main loop hold back input until the receiver catches up */
+  if (vlib_frame_queue_is_congested (fqm, thread_index))
+    vm->handoff_congested = 1;
 
   n_left -= n_comp;
 
@@ -299,8 +336,12 @@ CLIB_MULTIARCH_FN (vlib_frame_queue_dequeue_fn)
   u32 thread_id = vm->thread_index;
   vlib_frame_queue_t *fq = fqm->vlib_frame_queues[thread_id];
   u32 mask = fq->nelts - 1;
+  u32 n_rings = vec_len (fq->rings);
+  vlib_frame_queue_ring_t *ring;
   vlib_frame_queue_elt_t *elt;
   u32 n_free, n_copy, *from, *to = 0, processed = 0, vectors = 0;
+  u32 i, ring_index, next_ring = ~0;
+  u64 head, depth = 0;
   vlib_frame_t *f = 0;
 
   ASSERT (fq);
@@ -315,14 +356,28 @@ CLIB_MULTIARCH_FN (vlib_frame_queue_dequeue_fn)
     {
       frame_queue_trace_t *fqt;
       frame_queue_nelt_counter_t *fqh;
-      u32 elix;
+      u32 elix = 0;
 
       fqt = &fqm->frame_queue_traces[thread_id];
 
-      fqt->nelts = fq->nelts;
-      fqt->head = fq->head;
-      fqt->tail = fq->tail;
+      /* Report the rings towards this thread as a single queue */
+      fqt->nelts = clib_min (fq->nelts * n_rings, FRAME_QUEUE_MAX_NELTS);
+      fqt->head = fqt->tail = 0;
       fqt->threshold = fq->vector_threshold;
+      clib_memset (fqt->n_vectors, 0, sizeof (fqt->n_vectors));
+
+      vec_foreach (ring, fq->rings)
+	{
+	  u64 tail = __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE);
+
+	  fqt->head += ring->head;
+	  fqt->tail += tail;
+
+	  /* Record a snapshot of the elements in use */
+	  for (head = ring->head; head != tail && elix < fqt->nelts; head++)
+	    fqt->n_vectors[elix++] = ring->elts[head & mask].n_vectors;
+	}
+
       fqt->n_in_use = fqt->tail - fqt->head;
       if (fqt->n_in_use >= fqt->nelts)
 	{
@@ -334,76 +389,91 @@ CLIB_MULTIARCH_FN (vlib_frame_queue_dequeue_fn)
       fqh = &fqm->frame_queue_histogram[thread_id];
       fqh->count[fqt->n_in_use]++;
 
-      /* Record a snapshot of the elements in use */
-      for (elix = 0; elix < fqt->nelts; elix++)
-	{
-	  elt = fq->elts + ((fq->head + 1 + elix) & (mask));
-	  if (1 || elt->valid)
-	    {
-	      fqt->n_vectors[elix] = elt->n_vectors;
-	    }
-	}
       fqt->written = 1;
     }
 
-  while (1)
+  /*
+   * Visit every sender's ring once, starting where the previous call ran
+   * out of budget. The remote tail is only re-read once the cached copy is
+   * used up, and the head is published once per ring.
+   */
+  for (i = 0; i < n_rings; i++)
     {
-      if (fq->head == fq->tail)
-	break;
+      ring_index = fq->next_ring + i;
+      if (ring_index >= n_rings)
+	ring_index -= n_rings;
+      ring = fq->rings + ring_index;
+      head = ring->head;
 
-      elt = fq->elts + ((fq->head + 1) & mask);
+      if (head == ring->tail_cache)
+	ring->tail_cache = __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE);
 
-      if (!__atomic_load_n (&elt->valid, __ATOMIC_ACQUIRE))
-	break;
+      depth += ring->tail_cache - head;
 
-      from = elt->buffer_index + elt->offset;
+      while (head != ring->tail_cache)
+	{
+	  /* Limit the number of packets pushed into the graph */
+	  if (vectors >= fq->vector_threshold)
+	    {
+	      if (next_ring == ~0)
+		next_ring = ring_index;
+	      break;
+	    }
 
-      ASSERT (elt->offset + elt->n_vectors <= VLIB_FRAME_SIZE);
+	  elt = ring->elts + (head & mask);
+	  from = elt->buffer_index + elt->offset;
 
-      if (f == 0)
-	{
-	  f = vlib_get_frame_to_node (vm, fqm->node_index);
-	  to = vlib_frame_vector_args (f);
-	  n_free = VLIB_FRAME_SIZE;
-	}
+	  ASSERT (elt->offset + elt->n_vectors <= VLIB_FRAME_SIZE);
 
-      if (elt->maybe_trace)
-	f->frame_flags |= VLIB_NODE_FLAG_TRACE;
+	  if (f == 0)
+	    {
+	      f = vlib_get_frame_to_node (vm, fqm->node_index);
+	      f->frame_flags |= fqm->frame_flags;
+	      to = vlib_frame_vector_args (f);
+	      n_free = VLIB_FRAME_SIZE;
+	    }
 
-      n_copy = clib_min (n_free, elt->n_vectors);
+	  if (elt->maybe_trace)
+	    f->frame_flags |= VLIB_NODE_FLAG_TRACE;
 
-      vlib_buffer_copy_indices (to, from, n_copy);
-      to += n_copy;
-      n_free -= n_copy;
-      vectors += n_copy;
+	  n_copy = clib_min (n_free, elt->n_vectors);
 
-      if (n_free == 0)
-	{
-	  f->n_vectors = VLIB_FRAME_SIZE;
-	  vlib_put_frame_to_node (vm, fqm->node_index, f);
-	  f = 0;
-	}
+	  vlib_buffer_copy_indices (to, from, n_copy);
+	  to += n_copy;
+	  n_free -= n_copy;
+	  vectors += n_copy;
 
-      if (n_copy < elt->n_vectors)
-	{
-	  /* not empty - leave it on the ring */
-	  elt->n_vectors -= n_copy;
-	  elt->offset += n_copy;
-	}
-      else
-	{
-	  /* empty - reset and bump head */
-	  u32 sz = STRUCT_OFFSET_OF (vlib_frame_queue_elt_t, end_of_reset);
-	  clib_memset (elt, 0, sz);
-	  __atomic_store_n (&fq->head, fq->head + 1, __ATOMIC_RELEASE);
-	  processed++;
+	  if (n_free == 0)
+	    {
+	      f->n_vectors = VLIB_FRAME_SIZE;
+	      vlib_put_frame_to_node (vm, fqm->node_index, f);
+	      f = 0;
+	    }
+
+	  if (n_copy < elt->n_vectors)
+	    {
+	      /* not empty - leave it on the ring */
+	      elt->n_vectors -= n_copy;
+	      elt->offset += n_copy;
+	    }
+	  else
+	    {
+	      head++;
+	      processed++;
+	    }
 	}
 
-      /* Limit the number of packets pushed into the graph */
-      if (vectors >= fq->vector_threshold)
-	break;
+      if (head != ring->head)
+	__atomic_store_n (&ring->head, head, __ATOMIC_RELEASE);
     }
 
+  /* Start with the first ring left unserved next time, for fairness */
+  if (next_ring != ~0)
+    fq->next_ring = next_ring;
+
+  if (vectors)
+    vlib_increment_histogram (&fqm->depth, thread_id, 0, depth);
+
   if (f)
     {
       f->n_vectors = VLIB_FRAME_SIZE - n_free;
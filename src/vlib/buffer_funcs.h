@@ -555,16 +555,48 @@ vlib_get_buffer_pool (vlib_main_t * vm, u8 buffer_pool_index)
   return vec_elt_at_index (bm->buffer_pools, buffer_pool_index);
 }
 
+static_always_inline void
+vlib_buffer_pool_lock (vlib_buffer_pool_t *bp, vlib_buffer_pool_thread_t *bpt)
+{
+  if (PREDICT_FALSE (!clib_spinlock_trylock (&bp->lock)))
+    {
+      bpt->n_contended++;
+      clib_spinlock_lock (&bp->lock);
+    }
+}
+
+/* Resize a thread's cache on a trip to the pool, called with the lock held */
+static_always_inline void
+vlib_buffer_pool_thread_adapt (vlib_main_t *vm, vlib_buffer_pool_t *bp,
+			       vlib_buffer_pool_thread_t *bpt, int is_put)
+{
+  u32 size = bpt->cache_size;
+
+  if (bp->n_avail < bp->n_buffers / 8)
+    size = clib_max (size / 2, VLIB_BUFFER_POOL_PER_THREAD_CACHE_MIN_SZ);
+  else if (bp->numa_node != vm->numa_node)
+    size = bp->cache_max_size;
+  else if (is_put != bpt->last_pool_op_was_put)
+    size = clib_min (size * 2, bp->cache_max_size);
+
+  bpt->cache_size = size;
+  bpt->last_pool_op_was_put = is_put;
+}
+
 static_always_inline __clib_warn_unused_result uword
 vlib_buffer_pool_get (vlib_main_t * vm, u8 buffer_pool_index, u32 * buffers,
 		      u32 n_buffers)
 {
   vlib_buffer_pool_t *bp = vlib_get_buffer_pool (vm, buffer_pool_index);
+  vlib_buffer_pool_thread_t *bpt =
+    vec_elt_at_index (bp->threads, vm->thread_index);
   u32 len;
 
   ASSERT (bp->buffers);
 
-  clib_spinlock_lock (&bp->lock);
+  bpt->n_pool_get++;
+  vlib_buffer_pool_lock (bp, bpt);
+  vlib_buffer_pool_thread_adapt (vm, bp, bpt, 0 /* is_put */);
   len = bp->n_avail;
   if (PREDICT_TRUE (n_buffers < len))
     {
@@ -630,7 +662,7 @@ vlib_buffer_alloc_from_pool (vlib_main_t * vm, u32 * buffers, u32 n_buffers,
     }
 
   /* alloc bigger than cache - take buffers directly from main pool */
-  if (n_buffers >= VLIB_BUFFER_POOL_PER_THREAD_CACHE_SZ)
+  if (n_buffers >= bpt->cache_size)
     {
       n_buffers = vlib_buffer_pool_get (vm, buffer_pool_index, buffers,
 					n_buffers);
@@ -646,7 +678,8 @@ vlib_buffer_alloc_from_pool (vlib_main_t * vm, u32 * buffers, u32 n_buffers,
       n_left -= len;
     }
 
-  len = round_pow2 (n_left, 32);
+  /* refill half the cache, so the next allocations stay local */
+  len = clib_max (round_pow2 (n_left, 32), bpt->cache_size / 2);
   len = vlib_buffer_pool_get (vm, buffer_pool_index, bpt->cached_buffers,
 			      len);
   bpt->n_cached = len;
@@ -663,6 +696,8 @@ vlib_buffer_alloc_from_pool (vlib_main_t * vm, u32 * buffers, u32 n_buffers,
   n_buffers -= n_left;
 
 done:
+  bpt->n_alloc += n_buffers;
+
   /* Verify that buffers are known free. */
   if (CLIB_DEBUG > 0)
     vlib_buffer_validate_alloc_free (vm, buffers, n_buffers,
@@ -774,7 +809,7 @@ vlib_buffer_pool_put (vlib_main_t * vm, u8 buffer_pool_index,
   vlib_buffer_pool_t *bp = vlib_get_buffer_pool (vm, buffer_pool_index);
   vlib_buffer_pool_thread_t *bpt = vec_elt_at_index (bp->threads,
 						     vm->thread_index);
-  u32 n_cached, n_empty;
+  u32 n_cached, n_empty, n_keep, n_keep_new, n_keep_old;
 
   if (CLIB_DEBUG > 0)
     vlib_buffer_validate_alloc_free (vm, buffers, n_buffers,
@@ -782,8 +817,9 @@ vlib_buffer_pool_put (vlib_main_t * vm, u8 buffer_pool_index,
   if (PREDICT_FALSE (bm->free_callback_fn != 0))
     bm->free_callback_fn (vm, buffer_pool_index, buffers, n_buffers);
 
+  bpt->n_free += n_buffers;
   n_cached = bpt->n_cached;
-  n_empty = VLIB_BUFFER_POOL_PER_THREAD_CACHE_SZ - n_cached;
+  n_empty = n_cached < bpt->cache_size ? bpt->cache_size - n_cached : 0;
   if (n_buffers <= n_empty)
     {
       vlib_buffer_copy_indices (bpt->cached_buffers + n_cached,
@@ -792,15 +828,34 @@ vlib_buffer_pool_put (vlib_main_t * vm, u8 buffer_pool_index,
       return;
     }
 
-  vlib_buffer_copy_indices (bpt->cached_buffers + n_cached,
-			    buffers + n_buffers - n_empty, n_empty);
-  bpt->n_cached = VLIB_BUFFER_POOL_PER_THREAD_CACHE_SZ;
-
-  clib_spinlock_lock (&bp->lock);
+  /*
+   * Cache is full: return it to the pool in one batch, except for half a
+   * cache of the most recently freed buffers. Buffers of a remote NUMA
+   * node are all sent home.
+   */
+  bpt->n_pool_put++;
+  vlib_buffer_pool_lock (bp, bpt);
+  vlib_buffer_pool_thread_adapt (vm, bp, bpt, 1 /* is_put */);
+
+  n_keep = bp->numa_node == vm->numa_node ? bpt->cache_size / 2 : 0;
+  n_keep_new = clib_min (n_keep, n_buffers);
+  n_keep_old = clib_min (n_keep - n_keep_new, n_cached);
+
+  vlib_buffer_copy_indices (bp->buffers + bp->n_avail, bpt->cached_buffers,
+			    n_cached - n_keep_old);
+  bp->n_avail += n_cached - n_keep_old;
   vlib_buffer_copy_indices (bp->buffers + bp->n_avail, buffers,
-			    n_buffers - n_empty);
-  bp->n_avail += n_buffers - n_empty;
+			    n_buffers - n_keep_new);
+  bp->n_avail += n_buffers - n_keep_new;
   clib_spinlock_unlock (&bp->lock);
+
+  if (n_keep_old)
+    memmove (bpt->cached_buffers,
+	     bpt->cached_buffers + n_cached - n_keep_old,
+	     n_keep_old * sizeof (u32));
+  vlib_buffer_copy_indices (bpt->cached_buffers + n_keep_old,
+			    buffers + n_buffers - n_keep_new, n_keep_new);
+  bpt->n_cached = n_keep_old + n_keep_new;
 }
 
 static_always_inline void
@@ -39,6 +39,7 @@
 
 #include <vlib/vlib.h>
 #include <vlib/stat_weak_inlines.h>
+#include <vpp/stats/stat_segment_shared.h>
 
 void
 vlib_clear_simple_counters (vlib_simple_counter_main_t * cm)
@@ -187,6 +188,124 @@ vlib_free_combined_counter (vlib_combined_counter_main_t * cm)
   clib_mem_set_heap (oldheap);
 }
 
+void
+vlib_validate_histogram (vlib_histogram_main_t *hm, u32 index)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u32 max_bucket = (index + 1) * hm->n_buckets - 1;
+  int i, resized = 0;
+  void *oldheap;
+
+  ASSERT (hm->n_buckets);
+
+  oldheap = vlib_stats_push_heap (hm->counters);
+
+  vec_validate (hm->counters, tm->n_vlib_mains - 1);
+  for (i = 0; i < tm->n_vlib_mains; i++)
+    if (max_bucket >= vec_len (hm->counters[i]))
+      {
+	if (vec_resize_will_expand (hm->counters[i],
+				    max_bucket - vec_len (hm->counters[i]) +
+				      1 /* length_increment */))
+	  resized++;
+	vec_validate_aligned (hm->counters[i], max_bucket,
+			      CLIB_CACHE_LINE_BYTES);
+      }
+
+  /* Avoid the epoch increase when there was no counter vector resize. */
+  if (resized)
+    vlib_stats_pop_heap (hm, oldheap, index, 8 /* STAT_DIR_TYPE_HISTOGRAM */);
+  else
+    clib_mem_set_heap (oldheap);
+}
+
+void
+vlib_clear_histograms (vlib_histogram_main_t *hm)
+{
+  uword i;
+
+  for (i = 0; i < vec_len (hm->counters); i++)
+    clib_memset (hm->counters[i], 0,
+		 vec_len (hm->counters[i]) * sizeof (hm->counters[i][0]));
+}
+
+void
+vlib_free_histogram (vlib_histogram_main_t *hm)
+{
+  int i;
+
+  vlib_stats_delete_cm (hm);
+
+  void *oldheap = vlib_stats_push_heap (hm->counters);
+  for (i = 0; i < vec_len (hm->counters); i++)
+    vec_free (hm->counters[i]);
+  vec_free (hm->counters);
+  clib_mem_set_heap (oldheap);
+}
+
+u32
+vlib_histogram_n_histograms (const vlib_histogram_main_t *hm)
+{
+  ASSERT (hm->counters);
+  return (vec_len (hm->counters[0]) / hm->n_buckets);
+}
+
+u64
+vlib_histogram_bucket_min (const vlib_histogram_main_t *hm, u32 bucket)
+{
+  /* Same bounds as stat segment clients see */
+  return stat_segment_histogram_bucket_min (hm->log2_sub_buckets, bucket);
+}
+
+static_always_inline u64
+vlib_histogram_bucket_count (const vlib_histogram_main_t *hm,
+			     u32 thread_index, u32 index, u32 bucket)
+{
+  u32 offset = index * hm->n_buckets + bucket;
+  u64 count = 0;
+  uword i;
+
+  if (thread_index != VLIB_HISTOGRAM_ALL_THREADS)
+    return hm->counters[thread_index][offset];
+
+  for (i = 0; i < vec_len (hm->counters); i++)
+    count += hm->counters[i][offset];
+  return count;
+}
+
+u64
+vlib_histogram_count (const vlib_histogram_main_t *hm, u32 thread_index,
+		      u32 index)
+{
+  u64 count = 0;
+  u32 b;
+
+  for (b = 0; b < hm->n_buckets; b++)
+    count += vlib_histogram_bucket_count (hm, thread_index, index, b);
+  return count;
+}
+
+u64
+vlib_histogram_percentile (const vlib_histogram_main_t *hm, u32 thread_index,
+			   u32 index, u32 percent)
+{
+  u64 total, sum = 0;
+  u32 b;
+
+  total = vlib_histogram_count (hm, thread_index, index);
+  if (total == 0)
+    return 0;
+
+  for (b = 0; b < hm->n_buckets - 1; b++)
+    {
+      sum += vlib_histogram_bucket_count (hm, thread_index, index, b);
+      if (sum && sum * 100 >= total * percent)
+	break;
+    }
+
+  return vlib_histogram_bucket_min (hm, b);
+}
+
 u32
 vlib_combined_counter_n_counters (const vlib_combined_counter_main_t * cm)
 {
@@ -346,6 +346,100 @@ int vlib_validate_combined_counter_will_expand
 
 void vlib_free_combined_counter (vlib_combined_counter_main_t * cm);
 
+/** A collection of log-linear histograms
+
+    Each histogram has n_buckets per-thread u64 buckets. Values below
+    2^log2_sub_buckets are counted exactly, larger values in one of
+    2^log2_sub_buckets linear sub-buckets of their power of two range.
+    Both parameters must be set before the first validate call.
+*/
+typedef struct
+{
+  counter_t **counters;	   /**< Per-thread buckets, n_buckets per histogram */
+  char *name;		   /**< The histogram collection's name. */
+  char *stat_segment_name; /**< Name in stat segment directory */
+  u32 log2_sub_buckets;	   /**< Linear sub-buckets per power of two */
+  u32 n_buckets;	   /**< Buckets per histogram */
+} vlib_histogram_main_t;
+
+/** Map a value to its histogram bucket
+    @param hm - (vlib_histogram_main_t *) histogram main pointer
+    @param value - (u64) value to map
+    @returns bucket index, values beyond the last bucket map to it
+*/
+always_inline u32
+vlib_histogram_bucket (const vlib_histogram_main_t *hm, u64 value)
+{
+  u32 log2_sub = hm->log2_sub_buckets, shift, bucket;
+
+  if (value < (1ULL << log2_sub))
+    bucket = value;
+  else
+    {
+      shift = min_log2_u64 (value) - log2_sub;
+      bucket = ((shift + 1) << log2_sub) + (value >> shift) - (1 << log2_sub);
+    }
+
+  return clib_min (bucket, hm->n_buckets - 1);
+}
+
+/** Add a sample to a histogram
+    @param hm - (vlib_histogram_main_t *) histogram main pointer
+    @param thread_index - (u32) the current cpu index
+    @param index - (u32) index of the histogram
+    @param value - (u64) sample value
+*/
+always_inline void
+vlib_increment_histogram (vlib_histogram_main_t *hm, u32 thread_index,
+			  u32 index, u64 value)
+{
+  counter_t *my_counters;
+
+  my_counters = hm->counters[thread_index];
+  my_counters[index * hm->n_buckets + vlib_histogram_bucket (hm, value)]++;
+}
+
+/** Smallest value counted in a histogram bucket
+    @param hm - (vlib_histogram_main_t *) histogram main pointer
+    @param bucket - (u32) bucket index
+    @returns the bucket's lower bound, the inverse of vlib_histogram_bucket
+*/
+u64 vlib_histogram_bucket_min (const vlib_histogram_main_t *hm, u32 bucket);
+
+/** Pass as thread_index to sum a histogram over all threads */
+#define VLIB_HISTOGRAM_ALL_THREADS (~0)
+
+/** Number of samples in a histogram
+    @param hm - (vlib_histogram_main_t *) histogram main pointer
+    @param thread_index - (u32) thread, or VLIB_HISTOGRAM_ALL_THREADS
+    @param index - (u32) index of the histogram
+*/
+u64 vlib_histogram_count (const vlib_histogram_main_t *hm, u32 thread_index,
+			  u32 index);
+
+/** Percentile of a histogram
+    @param hm - (vlib_histogram_main_t *) histogram main pointer
+    @param thread_index - (u32) thread, or VLIB_HISTOGRAM_ALL_THREADS
+    @param index - (u32) index of the histogram
+    @param percent - (u32) 0 to 100, 0 and 100 give the smallest and
+    largest sample's bucket
+    @returns lower bound of the first bucket at which percent of the
+    samples have been counted, 0 for an empty histogram
+*/
+u64 vlib_histogram_percentile (const vlib_histogram_main_t *hm,
+			       u32 thread_index, u32 index, u32 percent);
+
+/** validate a histogram
+    @param hm - (vlib_histogram_main_t *) pointer to the histogram collection
+    @param index - (u32) index of the histogram to validate
+*/
+void vlib_validate_histogram (vlib_histogram_main_t *hm, u32 index);
+void vlib_clear_histograms (vlib_histogram_main_t *hm);
+void vlib_free_histogram (vlib_histogram_main_t *hm);
+
+/** The number of histograms (not the number of per-thread histograms) */
+u32 vlib_histogram_n_histograms (const vlib_histogram_main_t *hm);
+
 /** Obtain the number of simple or combined counters allocated.
     A macro which reduces to to vec_len(cm->maxi), the answer in either
     case.
@@ -41,6 +41,7 @@
 #include <vppinfra/format.h>
 #include <vlib/vlib.h>
 #include <vlib/threads.h>
+#include <vlib/steal.h>
 #include <vppinfra/tw_timer_1t_3w_1024sl_ov.h>
 
 #include <vlib/unix/unix.h>
@@ -296,6 +297,180 @@ VLIB_CLI_COMMAND (show_frame_stats_cli, static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+set_frame_coalescing_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				 vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vlib_node_main_t *nm = &vm->node_main;
+  clib_error_t *error = 0;
+  int is_enable = nm->coalesce_budget != 0;
+  u32 budget_us = nm->coalesce_budget ?
+		    nm->coalesce_budget * 1e6 / vm->clib_time.clocks_per_second :
+		    VLIB_FRAME_COALESCE_DEFAULT_BUDGET_US;
+  u32 min_vectors = nm->coalesce_min_vectors ?
+		      nm->coalesce_min_vectors :
+		      VLIB_FRAME_COALESCE_DEFAULT_MIN_VECTORS;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "on"))
+	is_enable = 1;
+      else if (unformat (line_input, "off"))
+	is_enable = 0;
+      else if (unformat (line_input, "budget-us %u", &budget_us))
+	;
+      else if (unformat (line_input, "min-vectors %u", &min_vectors))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (budget_us == 0)
+    {
+      error = clib_error_return (0, "budget-us must be non-zero");
+      goto done;
+    }
+
+  if (min_vectors < 2 || min_vectors > VLIB_FRAME_SIZE)
+    {
+      error = clib_error_return (0, "min-vectors must be between 2 and %u",
+				 VLIB_FRAME_SIZE);
+      goto done;
+    }
+
+  /* Held frames are dispatched by the next main loop once disabled */
+  vlib_worker_thread_barrier_sync (vm);
+  foreach_vlib_main ()
+    {
+      nm = &this_vlib_main->node_main;
+      nm->coalesce_budget =
+	is_enable ? budget_us * 1e-6 * vm->clib_time.clocks_per_second : 0;
+      nm->coalesce_min_vectors = min_vectors;
+    }
+  vlib_worker_thread_barrier_release (vm);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Hold frames with fewer than min-vectors vectors to nodes enabled with
+ * "set node coalescing" back to the next main loop, for at most
+ * budget-us microseconds, so that more vectors accumulate. Pending frames
+ * to the same node are merged before dispatch.
+ *
+ * @cliexpar
+ * @cliexcmd{set frame-coalescing on budget-us 20 min-vectors 32}
+?*/
+VLIB_CLI_COMMAND (set_frame_coalescing_command, static) = {
+  .path = "set frame-coalescing",
+  .short_help = "set frame-coalescing [on|off] [budget-us <n>] "
+		"[min-vectors <n>]",
+  .function = set_frame_coalescing_command_fn,
+};
+
+static clib_error_t *
+set_node_coalescing_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				vlib_cli_command_t *cmd)
+{
+  vlib_node_runtime_t *rt;
+  vlib_node_t *n;
+  u32 node_index;
+  int is_enable = 1;
+
+  if (!unformat (input, "%U", unformat_vlib_node, vm, &node_index))
+    return clib_error_return (0, "please specify a node");
+
+  if (unformat (input, "off"))
+    is_enable = 0;
+  else if (!unformat (input, "on") &&
+	   unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    return clib_error_return (0, "unknown input '%U'", format_unformat_error,
+			      input);
+
+  n = vlib_get_node (vm, node_index);
+  if (n->type != VLIB_NODE_TYPE_INTERNAL ||
+      (n->flags & VLIB_NODE_FLAG_FRAME_NO_FREE_AFTER_DISPATCH))
+    return clib_error_return (0, "frames to node '%v' cannot be coalesced",
+			      n->name);
+
+  vlib_worker_thread_barrier_sync (vm);
+  foreach_vlib_main ()
+    {
+      n = vlib_get_node (this_vlib_main, node_index);
+      rt = vlib_node_get_runtime (this_vlib_main, node_index);
+      if (is_enable)
+	{
+	  n->flags |= VLIB_NODE_FLAG_COALESCE;
+	  rt->flags |= VLIB_NODE_FLAG_COALESCE;
+	}
+      else
+	{
+	  n->flags &= ~VLIB_NODE_FLAG_COALESCE;
+	  rt->flags &= ~VLIB_NODE_FLAG_COALESCE;
+	}
+    }
+  vlib_worker_thread_barrier_release (vm);
+
+  return 0;
+}
+
+VLIB_CLI_COMMAND (set_node_coalescing_command, static) = {
+  .path = "set node coalescing",
+  .short_help = "set node coalescing <node-name> [on|off]",
+  .function = set_node_coalescing_command_fn,
+};
+
+static clib_error_t *
+show_frame_coalescing_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				  vlib_cli_command_t *cmd)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  vlib_node_t *n;
+  u32 i;
+
+  if (nm->coalesce_budget == 0)
+    vlib_cli_output (vm, "frame coalescing off");
+  else
+    vlib_cli_output (vm, "frame coalescing on, budget %.1fus, min-vectors %u",
+		     nm->coalesce_budget * 1e6 /
+		       vm->clib_time.clocks_per_second,
+		     nm->coalesce_min_vectors);
+
+  for (i = 0; i < vec_len (nm->nodes); i++)
+    {
+      n = nm->nodes[i];
+      if (n->flags & VLIB_NODE_FLAG_COALESCE)
+	vlib_cli_output (vm, "  node %v", n->name);
+    }
+
+  vlib_cli_output (vm, "%=8s%=16s%=16s", "Thread", "Merged", "Deferred");
+  foreach_vlib_main ()
+    {
+      nm = &this_vlib_main->node_main;
+      vlib_cli_output (vm, "%=8u%=16lu%=16lu", this_vlib_main->thread_index,
+		       nm->coalesce_merged_frames,
+		       nm->coalesce_deferred_frames);
+    }
+
+  return 0;
+}
+
+VLIB_CLI_COMMAND (show_frame_coalescing_command, static) = {
+  .path = "show frame-coalescing",
+  .short_help = "show frame-coalescing",
+  .function = show_frame_coalescing_command_fn,
+};
+
 /* Change ownership of enqueue rights to given next node. */
 static void
 vlib_next_frame_change_ownership (vlib_main_t * vm,
@@ -352,6 +527,9 @@ vlib_next_frame_change_ownership (vlib_main_t * vm,
 		      next_frame - vm->node_main.next_frames;
 		  }
 	      }
+	      vec_foreach (p, nm->deferred_frames)
+		if (p->frame == next_frame->frame)
+		  p->next_frame_index = next_frame - vm->node_main.next_frames;
 	    }
 	}
     }
@@ -1180,18 +1358,23 @@ dispatch_pending_node (vlib_main_t * vm, uword pending_frame_index,
   n->flags |= (nf->flags & VLIB_FRAME_TRACE) ? VLIB_NODE_FLAG_TRACE : 0;
   nf->flags &= ~VLIB_FRAME_TRACE;
 
-  last_time_stamp = dispatch_node (vm, n,
-				   VLIB_NODE_TYPE_INTERNAL,
-				   VLIB_NODE_STATE_POLLING,
-				   f, last_time_stamp);
-  /* Internal node vector-rate accounting, for summary stats */
-  vm->internal_node_vectors += f->n_vectors;
-  vm->internal_node_calls++;
-  vm->internal_node_last_vectors_per_main_loop =
-    (f->n_vectors > vm->internal_node_last_vectors_per_main_loop) ?
-    f->n_vectors : vm->internal_node_last_vectors_per_main_loop;
+  /* Busy workers may hand full frames to an idle worker instead */
+  if (PREDICT_TRUE (!vlib_steal_frame (vm, n, f)))
+    {
+      last_time_stamp = dispatch_node (vm, n, VLIB_NODE_TYPE_INTERNAL,
+				       VLIB_NODE_STATE_POLLING, f,
+				       last_time_stamp);
+      /* Internal node vector-rate accounting, for summary stats */
+      vm->internal_node_vectors += f->n_vectors;
+      vm->internal_node_calls++;
+      vm->internal_node_last_vectors_per_main_loop =
+	(f->n_vectors > vm->internal_node_last_vectors_per_main_loop) ?
+	  f->n_vectors :
+	  vm->internal_node_last_vectors_per_main_loop;
+    }
 
-  f->frame_flags &= ~(VLIB_FRAME_PENDING | VLIB_FRAME_NO_APPEND);
+  f->frame_flags &=
+    ~(VLIB_FRAME_PENDING | VLIB_FRAME_NO_APPEND | VLIB_FRAME_NO_STEAL);
 
   /* Frame is ready to be used again, so restore it. */
   if (restore_frame != NULL)
@@ -1248,6 +1431,89 @@ dispatch_pending_node (vlib_main_t * vm, uword pending_frame_index,
   return last_time_stamp;
 }
 
+/*
+ * Frame coalescing. Merge later pending frames to the same node into the
+ * frame about to be dispatched, then hold it back to the next main loop
+ * if it is still small and the hold budget is not spent. A held frame
+ * stays pending, so its producer keeps appending to it in the meantime.
+ * Returns non-zero if the frame was held back.
+ */
+static_always_inline int
+vlib_frame_coalesce (vlib_main_t *vm, uword pending_frame_index,
+		     u64 cpu_time_now)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  vlib_pending_frame_t *p, *q;
+  vlib_node_runtime_t *n;
+  vlib_frame_t *f, *g;
+  uword i;
+  u32 trace;
+
+  p = nm->pending_frames + pending_frame_index;
+  n = vec_elt_at_index (nm->nodes_by_type[VLIB_NODE_TYPE_INTERNAL],
+			p->node_runtime_index);
+
+  if (!(n->flags & VLIB_NODE_FLAG_COALESCE))
+    return 0;
+
+  f = p->frame;
+
+  /* Frames with scalar arguments or no-append frames describe their
+     vectors as a whole, so they are never merged */
+  for (i = pending_frame_index + 1;
+       i < vec_len (nm->pending_frames) && f->n_vectors < VLIB_FRAME_SIZE &&
+       f->scalar_size == 0 && !(f->frame_flags & VLIB_FRAME_NO_APPEND);
+       i++)
+    {
+      q = nm->pending_frames + i;
+      g = q->frame;
+
+      if (q->node_runtime_index != p->node_runtime_index ||
+	  g->flags != f->flags || (g->frame_flags & VLIB_FRAME_NO_APPEND) ||
+	  f->n_vectors + g->n_vectors > VLIB_FRAME_SIZE)
+	continue;
+
+      /* Keep traced frames apart, the trace flag lives in the next frame */
+      if (q->next_frame_index == VLIB_PENDING_FRAME_NO_NEXT_FRAME)
+	trace = g->frame_flags & VLIB_FRAME_TRACE;
+      else
+	trace = nm->next_frames[q->next_frame_index].flags & VLIB_FRAME_TRACE;
+      if (trace)
+	continue;
+
+      clib_memcpy_fast ((u8 *) vlib_frame_vector_args (f) +
+			  f->n_vectors * f->vector_size,
+			vlib_frame_vector_args (g),
+			g->n_vectors * g->vector_size);
+      f->n_vectors += g->n_vectors;
+      /* Stolen vectors must not be handed over again */
+      f->frame_flags |= g->frame_flags & VLIB_FRAME_NO_STEAL;
+
+      /* As if g had been dispatched */
+      g->frame_flags &=
+	~(VLIB_FRAME_PENDING | VLIB_FRAME_NO_APPEND | VLIB_FRAME_NO_STEAL);
+      if (g->frame_flags & VLIB_FRAME_FREE_AFTER_DISPATCH)
+	vlib_frame_free (vm, n, g);
+
+      vec_delete (nm->pending_frames, 1, i);
+      i--;
+      nm->coalesce_merged_frames++;
+    }
+
+  if (f->n_vectors >= nm->coalesce_min_vectors)
+    return 0;
+
+  if (nm->coalesce_hold_start == 0)
+    nm->coalesce_hold_start = cpu_time_now;
+  else if (cpu_time_now - nm->coalesce_hold_start >= nm->coalesce_budget)
+    return 0;
+
+  vec_add1 (nm->deferred_frames, p[0]);
+  nm->coalesce_deferred_frames++;
+
+  return 1;
+}
+
 always_inline uword
 vlib_process_stack_is_valid (vlib_process_t * p)
 {
@@ -1590,8 +1856,20 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 	      vm->check_frame_queues = 0;
 	    }
 
-	  vec_foreach (fqm, tm->frame_queue_mains)
-	    processed += (fn) (vm, fqm);
+	  if (PREDICT_TRUE (vec_len (vm->handoff_perf_callbacks) == 0))
+	    vec_foreach (fqm, tm->frame_queue_mains)
+	      processed += (fn) (vm, fqm);
+	  else
+	    vec_foreach (fqm, tm->frame_queue_mains)
+	      {
+		u64 t = clib_cpu_time_now ();
+		u32 n = (fn) (vm, fqm);
+
+		if (n)
+		  clib_call_callbacks (vm->handoff_perf_callbacks, vm,
+				       fqm - tm->frame_queue_mains, n, t);
+		processed += n;
+	      }
 
 	  /* No handoff queue work found? */
 	  if (processed)
@@ -1613,13 +1891,18 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 				      /* frame */ 0,
 				      cpu_time_now);
 
-      /* Next process input nodes. */
-      vec_foreach (n, nm->nodes_by_type[VLIB_NODE_TYPE_INPUT])
-	cpu_time_now = dispatch_node (vm, n,
-				      VLIB_NODE_TYPE_INPUT,
-				      VLIB_NODE_STATE_POLLING,
-				      /* frame */ 0,
-				      cpu_time_now);
+      /* Next process input nodes. If this thread congested a handoff
+         queue, skip a round and leave the packets with the devices until
+         the receiving thread catches up. */
+      if (PREDICT_FALSE (vm->handoff_congested))
+	vm->handoff_congested = 0;
+      else
+	vec_foreach (n, nm->nodes_by_type[VLIB_NODE_TYPE_INPUT])
+	  cpu_time_now = dispatch_node (vm, n,
+					VLIB_NODE_TYPE_INPUT,
+					VLIB_NODE_STATE_POLLING,
+					/* frame */ 0,
+					cpu_time_now);
 
       if (PREDICT_TRUE (is_main && vm->queue_signal_pending == 0))
 	vm->queue_signal_callback (vm);
@@ -1629,6 +1912,18 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 	  int int_num = -1;
 	  *nm->pending_interrupts = 0;
 
+	  /* A signal racing with the reset above is not recorded */
+	  if (PREDICT_FALSE (nm->interrupt_signal_time != 0))
+	    {
+	      /* Signalled on another cpu, whose clock may be slightly ahead */
+	      i64 dt = clib_cpu_time_now () - nm->interrupt_signal_time;
+	      vlib_increment_histogram (&vlib_global_main.wakeup_latency,
+					vm->thread_index, 0,
+					clib_max (dt, 0) *
+					  vm->clib_time.seconds_per_clock * 1e9);
+	      nm->interrupt_signal_time = 0;
+	    }
+
 	  while ((int_num =
 		    clib_interrupt_get_next (nm->interrupts, int_num)) != -1)
 	    {
@@ -1646,10 +1941,25 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
          Process pending vector until there is nothing left.
          All pending vectors will be processed from input -> output. */
       for (i = 0; i < _vec_len (nm->pending_frames); i++)
-	cpu_time_now = dispatch_pending_node (vm, i, cpu_time_now);
+	if (PREDICT_TRUE (nm->coalesce_budget == 0) ||
+	    !vlib_frame_coalesce (vm, i, cpu_time_now))
+	  cpu_time_now = dispatch_pending_node (vm, i, cpu_time_now);
+
+      if (PREDICT_FALSE (vlib_steal_main.is_enabled) && !is_main)
+	vlib_steal_update_idle (vm, _vec_len (nm->pending_frames) == 0);
+
       /* Reset pending vector for next iteration. */
       _vec_len (nm->pending_frames) = 0;
 
+      /* Frames held back by coalescing go first in the next iteration */
+      if (PREDICT_FALSE (vec_len (nm->deferred_frames) > 0))
+	{
+	  vec_append (nm->pending_frames, nm->deferred_frames);
+	  vec_reset_length (nm->deferred_frames);
+	}
+      else
+	nm->coalesce_hold_start = 0;
+
       if (is_main)
 	{
           /* *INDENT-OFF* */
@@ -255,9 +255,19 @@ typedef struct vlib_main_t
   void (**volatile barrier_perf_callbacks_tmp)
     (struct vlib_main_t *, u64 t, int leave);
 
+  /* Frame queue dequeue callback, t is the cpu time before the dequeue */
+  void (**volatile handoff_perf_callbacks) (struct vlib_main_t *,
+					    u32 fq_index, u32 n_vectors, u64 t);
+  void (**volatile handoff_perf_callbacks_tmp) (struct vlib_main_t *,
+						u32 fq_index, u32 n_vectors,
+						u64 t);
+
   /* Need to check the frame queues */
   volatile uword check_frame_queues;
 
+  /* A handoff queue towards another thread was found congested */
+  u8 handoff_congested;
+
   /* RPC requests, main thread only */
   uword *pending_rpc_requests;
   uword *processing_rpc_requests;
@@ -305,6 +315,9 @@ typedef struct vlib_global_main_t
   /* Packet trace capture filter */
   vlib_trace_filter_t trace_filter;
 
+  /* Interrupt signal to dispatch latency in ns, see "set worker-sleep" */
+  vlib_histogram_main_t wakeup_latency;
+
   /* List of init functions to call, setup by constructors */
   _vlib_init_function_list_elt_t *init_function_registrations;
   _vlib_init_function_list_elt_t *main_loop_enter_function_registrations;
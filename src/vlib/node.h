@@ -296,6 +296,14 @@ typedef struct vlib_node_t
 #define VLIB_NODE_FLAG_TRACE_SUPPORTED (1 << 8)
 #define VLIB_NODE_FLAG_ADAPTIVE_MODE			     (1 << 9)
 
+  /* Node keeps no per-thread state between frames, so its frames may be
+     handed to an idle worker (see vlib/steal.h). */
+#define VLIB_NODE_FLAG_STEAL_SAFE (1 << 10)
+
+  /* Small frames to this node may be held back and merged, see
+     "set frame-coalescing". */
+#define VLIB_NODE_FLAG_COALESCE (1 << 11)
+
   /* State for input nodes. */
   u8 state;
 
@@ -406,6 +414,9 @@ typedef struct
 #define VLIB_FRAME_NO_FREE_AFTER_DISPATCH \
   VLIB_NODE_FLAG_FRAME_NO_FREE_AFTER_DISPATCH
 
+  /* Frame was handed over by a busy worker, don't steal it again */
+#define VLIB_FRAME_NO_STEAL (1 << 13)
+
   /* Don't append this frame */
 #define VLIB_FRAME_NO_APPEND (1 << 14)
 
@@ -682,6 +693,13 @@ typedef struct
   void *interrupts;
   volatile u32 *pending_interrupts;
 
+  /* Clock at which the first interrupt since the last interrupt dispatch
+     was signalled by another thread, or at which the epoll sleep ended
+     for interrupts signalled by fd events, kept while wakeup latency is
+     recorded. */
+  u64 interrupt_signal_time;
+  u8 record_wakeup_latency;
+
   /* Input nodes are switched from/to interrupt to/from polling mode
      when average vector length goes above/below polling/interrupt
      thresholds. */
@@ -694,6 +712,16 @@ typedef struct
   /* Vector of internal node's frames waiting to be called. */
   vlib_pending_frame_t *pending_frames;
 
+  /* Frame coalescing: frames to VLIB_NODE_FLAG_COALESCE nodes with fewer
+     than coalesce_min_vectors are held back to the next main loop, for
+     at most coalesce_budget clocks. Disabled when coalesce_budget is 0. */
+  vlib_pending_frame_t *deferred_frames;
+  u64 coalesce_budget;
+  u64 coalesce_hold_start;
+  u32 coalesce_min_vectors;
+  u64 coalesce_merged_frames;
+  u64 coalesce_deferred_frames;
+
   /* Timing wheel for scheduling time-based node dispatch. */
   void *timing_wheel;
 
@@ -743,6 +771,9 @@ typedef struct
   uword *node_fn_march_variant_by_suffix;
 } vlib_node_main_t;
 
+#define VLIB_FRAME_COALESCE_DEFAULT_BUDGET_US	20
+#define VLIB_FRAME_COALESCE_DEFAULT_MIN_VECTORS 32
+
 typedef u16 vlib_error_t;
 
 always_inline u32
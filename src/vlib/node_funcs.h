@@ -254,7 +254,15 @@ vlib_node_set_interrupt_pending (vlib_main_t *vm, u32 node_index)
   ASSERT (n->type == VLIB_NODE_TYPE_INPUT);
 
   if (vm != vlib_get_main ())
-    clib_interrupt_set_atomic (nm->interrupts, n->runtime_index);
+    {
+      clib_interrupt_set_atomic (nm->interrupts, n->runtime_index);
+
+      /* Signalled by another thread, which may be waking this one up. The
+	 thread's own interrupts are stamped when its epoll sleep ends. */
+      if (PREDICT_FALSE (nm->record_wakeup_latency) &&
+	  nm->interrupt_signal_time == 0)
+	nm->interrupt_signal_time = clib_cpu_time_now ();
+    }
   else
     clib_interrupt_set (nm->interrupts, n->runtime_index);
 
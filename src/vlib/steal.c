@@ -0,0 +1,275 @@
+/*
+ * steal.c - work stealing between worker threads
+ *
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vlib/vlib.h>
+#include <vlib/steal.h>
+#include <vlib/buffer_node.h>
+
+vlib_steal_main_t vlib_steal_main = {
+  .idle_loops_threshold = VLIB_STEAL_DEFAULT_IDLE_LOOPS,
+  .min_vectors = VLIB_STEAL_DEFAULT_MIN_VECTORS,
+};
+
+/* Claim one advertised idle worker, other than the calling one */
+static u32
+vlib_steal_claim_idle_thread (vlib_main_t *vm)
+{
+  vlib_steal_main_t *sm = &vlib_steal_main;
+  uword i, w, mask;
+
+  for (i = 0; i < vec_len (sm->idle_threads); i++)
+    {
+      w = __atomic_load_n (sm->idle_threads + i, __ATOMIC_RELAXED);
+      if (i == vm->thread_index / uword_bits)
+	w &= ~((uword) 1 << (vm->thread_index % uword_bits));
+
+      while (w)
+	{
+	  mask = w & -w;
+	  if (__atomic_fetch_and (sm->idle_threads + i, ~mask,
+				  __ATOMIC_ACQ_REL) &
+	      mask)
+	    return i * uword_bits + count_trailing_zeros (mask);
+	  w &= ~mask;
+	}
+    }
+
+  return ~0;
+}
+
+int
+vlib_steal_frame_i (vlib_main_t *vm, vlib_node_runtime_t *node,
+		    vlib_frame_t *f)
+{
+  vlib_steal_main_t *sm = &vlib_steal_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_steal_per_thread_t *ptd;
+  vlib_frame_queue_main_t *fqm;
+  u16 thread_indices[VLIB_FRAME_SIZE];
+  u32 fq_index, thread_index;
+
+  if (node->node_index >= vec_len (sm->frame_queue_index_by_node))
+    return 0;
+
+  fq_index = sm->frame_queue_index_by_node[node->node_index];
+  if (fq_index == ~0)
+    return 0;
+
+  thread_index = vlib_steal_claim_idle_thread (vm);
+  if (thread_index == ~0)
+    return 0;
+
+  ptd = vec_elt_at_index (sm->per_thread, vm->thread_index);
+  fqm = vec_elt_at_index (tm->frame_queue_mains, fq_index);
+
+  /* Never wait on an idle worker, give the claim back instead */
+  if (vlib_frame_queue_is_congested (fqm, thread_index))
+    {
+      __atomic_fetch_or (sm->idle_threads + thread_index / uword_bits,
+			 (uword) 1 << (thread_index % uword_bits),
+			 __ATOMIC_RELEASE);
+      ptd->claims_returned++;
+      return 0;
+    }
+
+  clib_memset_u16 (thread_indices, thread_index, f->n_vectors);
+  vlib_buffer_enqueue_to_thread (vm, node, fq_index,
+				 vlib_frame_vector_args (f), thread_indices,
+				 f->n_vectors, 0 /* drop on congestion */);
+
+  ptd->frames_given++;
+  ptd->vectors_given += f->n_vectors;
+
+  return 1;
+}
+
+clib_error_t *
+vlib_steal_enable_disable (vlib_main_t *vm, int is_enable)
+{
+  vlib_steal_main_t *sm = &vlib_steal_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_node_main_t *nm = &vm->node_main;
+  vlib_frame_queue_main_t *fqm;
+  vlib_node_t *n;
+  u32 i, fq_index;
+
+  if (is_enable && tm->n_vlib_mains < 3)
+    return clib_error_return (0, "work stealing needs at least 2 workers");
+
+  if (is_enable == sm->is_enabled)
+    return 0;
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  if (is_enable)
+    {
+      vec_validate_aligned (sm->per_thread, tm->n_vlib_mains - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      /* Pad the bitmap to whole cache lines */
+      i = clib_max ((tm->n_vlib_mains - 1) / uword_bits,
+		    CLIB_CACHE_LINE_BYTES / sizeof (uword) - 1);
+      vec_validate_aligned (sm->idle_threads, i, CLIB_CACHE_LINE_BYTES);
+      vec_validate_init_empty (sm->frame_queue_index_by_node,
+			       vec_len (nm->nodes) - 1, ~0);
+
+      /*
+       * Frames reach the idle worker without scalar arguments, and the
+       * node must hand the frame back once dispatched
+       */
+      for (i = 0; i < vec_len (nm->nodes); i++)
+	{
+	  n = nm->nodes[i];
+	  if (!(n->flags & VLIB_NODE_FLAG_STEAL_SAFE) ||
+	      n->type != VLIB_NODE_TYPE_INTERNAL || n->scalar_size ||
+	      (n->flags & VLIB_NODE_FLAG_FRAME_NO_FREE_AFTER_DISPATCH) ||
+	      sm->frame_queue_index_by_node[i] != ~0)
+	    continue;
+
+	  fq_index = vlib_frame_queue_main_init (n->index, 0);
+	  fqm = vec_elt_at_index (tm->frame_queue_mains, fq_index);
+	  fqm->frame_flags = VLIB_FRAME_NO_STEAL;
+	  sm->frame_queue_index_by_node[i] = fq_index;
+	}
+    }
+  else
+    {
+      vlib_steal_per_thread_t *ptd;
+
+      vec_zero (sm->idle_threads);
+      vec_foreach (ptd, sm->per_thread)
+	{
+	  ptd->idle_loops = 0;
+	  ptd->is_advertised = 0;
+	}
+    }
+
+  sm->is_enabled = is_enable;
+
+  vlib_worker_thread_barrier_release (vm);
+
+  return 0;
+}
+
+static clib_error_t *
+set_work_stealing_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			      vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vlib_steal_main_t *sm = &vlib_steal_main;
+  clib_error_t *error = 0;
+  int is_enable = sm->is_enabled;
+  u32 idle_loops = sm->idle_loops_threshold;
+  u32 min_vectors = sm->min_vectors;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "on"))
+	is_enable = 1;
+      else if (unformat (line_input, "off"))
+	is_enable = 0;
+      else if (unformat (line_input, "idle-loops %u", &idle_loops))
+	;
+      else if (unformat (line_input, "min-vectors %u", &min_vectors))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (idle_loops == 0)
+    {
+      error = clib_error_return (0, "idle-loops must be non-zero");
+      goto done;
+    }
+
+  if (min_vectors == 0 || min_vectors > VLIB_FRAME_SIZE)
+    {
+      error = clib_error_return (0, "min-vectors must be between 1 and %u",
+				 VLIB_FRAME_SIZE);
+      goto done;
+    }
+
+  sm->idle_loops_threshold = idle_loops;
+  sm->min_vectors = min_vectors;
+  error = vlib_steal_enable_disable (vm, is_enable);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Let idle workers take full frames destined to steal-safe nodes from
+ * busy workers. Stolen packets may be reordered with respect to packets
+ * processed by the busy worker.
+ *
+ * @cliexpar
+ * @cliexcmd{set work-stealing on idle-loops 16 min-vectors 256}
+?*/
+VLIB_CLI_COMMAND (set_work_stealing_command, static) = {
+  .path = "set work-stealing",
+  .short_help = "set work-stealing [on|off] [idle-loops <n>] "
+		"[min-vectors <n>]",
+  .function = set_work_stealing_command_fn,
+};
+
+static clib_error_t *
+show_work_stealing_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			       vlib_cli_command_t *cmd)
+{
+  vlib_steal_main_t *sm = &vlib_steal_main;
+  vlib_steal_per_thread_t *ptd;
+  u32 i;
+
+  vlib_cli_output (vm, "work stealing %s, idle-loops %u, min-vectors %u",
+		   sm->is_enabled ? "on" : "off", sm->idle_loops_threshold,
+		   sm->min_vectors);
+
+  for (i = 0; i < vec_len (sm->frame_queue_index_by_node); i++)
+    if (sm->frame_queue_index_by_node[i] != ~0)
+      vlib_cli_output (vm, "  node %U, frame queue %u", format_vlib_node_name,
+		       vm, i, sm->frame_queue_index_by_node[i]);
+
+  vlib_cli_output (vm, "%=8s%=8s%=16s%=16s%=16s", "Thread", "Idle", "Frames",
+		   "Vectors", "Returned");
+  vec_foreach (ptd, sm->per_thread)
+    vlib_cli_output (vm, "%=8u%=8s%=16lu%=16lu%=16lu", ptd - sm->per_thread,
+		     ptd->is_advertised ? "yes" : "no", ptd->frames_given,
+		     ptd->vectors_given, ptd->claims_returned);
+
+  return 0;
+}
+
+VLIB_CLI_COMMAND (show_work_stealing_command, static) = {
+  .path = "show work-stealing",
+  .short_help = "show work-stealing",
+  .function = show_work_stealing_command_fn,
+};
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
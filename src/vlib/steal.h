@@ -0,0 +1,143 @@
+/*
+ * steal.h - work stealing between worker threads
+ *
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef included_vlib_steal_h
+#define included_vlib_steal_h
+
+#include <vlib/vlib.h>
+
+/*
+ * Workers which have been idle for a number of main loops advertise
+ * themselves in a shared bitmap. A busy worker about to dispatch a full
+ * frame to a node marked VLIB_NODE_FLAG_STEAL_SAFE claims one idle worker
+ * and hands the frame over through a frame queue, so the frame is run by
+ * the idle worker's own node runtime. A claim buys exactly one frame; the
+ * idle worker re-advertises itself once the stolen frame is processed.
+ * Frames arriving through the steal frame queues are flagged
+ * VLIB_FRAME_NO_STEAL, so a frame is handed over at most once and can't
+ * bounce between idle workers.
+ */
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* consecutive main loops without work */
+  u32 idle_loops;
+  /* set in the idle bitmap */
+  u8 is_advertised;
+
+  /* frames and vectors handed to idle workers */
+  u64 frames_given;
+  u64 vectors_given;
+  /* claims given back since the idle worker's queue was congested */
+  u64 claims_returned;
+} vlib_steal_per_thread_t;
+
+typedef struct
+{
+  /* one bit per thread, on cache lines of their own */
+  uword *idle_threads;
+
+  /* frame queue used to hand frames to each steal-safe node, or ~0 */
+  u32 *frame_queue_index_by_node;
+
+  vlib_steal_per_thread_t *per_thread;
+
+  /* idle main loops before a worker advertises itself */
+  u32 idle_loops_threshold;
+
+  /* smallest frame worth handing over */
+  u32 min_vectors;
+
+  u8 is_enabled;
+} vlib_steal_main_t;
+
+#define VLIB_STEAL_DEFAULT_IDLE_LOOPS  16
+#define VLIB_STEAL_DEFAULT_MIN_VECTORS VLIB_FRAME_SIZE
+
+extern vlib_steal_main_t vlib_steal_main;
+
+int vlib_steal_frame_i (vlib_main_t *vm, vlib_node_runtime_t *node,
+			vlib_frame_t *f);
+clib_error_t *vlib_steal_enable_disable (vlib_main_t *vm, int is_enable);
+
+/** Hand a frame about to be dispatched to an idle worker, if there is one
+    Returns non-zero if the buffers were handed over, in which case the
+    caller must not dispatch the frame.
+*/
+static_always_inline int
+vlib_steal_frame (vlib_main_t *vm, vlib_node_runtime_t *node,
+		  vlib_frame_t *f)
+{
+  vlib_steal_main_t *sm = &vlib_steal_main;
+
+  if (PREDICT_TRUE (!sm->is_enabled))
+    return 0;
+
+  if (!(node->flags & VLIB_NODE_FLAG_STEAL_SAFE) || vm->thread_index == 0 ||
+      f->n_vectors < sm->min_vectors ||
+      (f->frame_flags & VLIB_FRAME_NO_STEAL))
+    return 0;
+
+  return vlib_steal_frame_i (vm, node, f);
+}
+
+/** Track whether a worker has spare cycles, called once per main loop */
+static_always_inline void
+vlib_steal_update_idle (vlib_main_t *vm, int is_idle)
+{
+  vlib_steal_main_t *sm = &vlib_steal_main;
+  vlib_steal_per_thread_t *ptd;
+  uword *word, mask;
+
+  ptd = vec_elt_at_index (sm->per_thread, vm->thread_index);
+  word = sm->idle_threads + vm->thread_index / uword_bits;
+  mask = (uword) 1 << (vm->thread_index % uword_bits);
+
+  if (is_idle)
+    {
+      if (ptd->is_advertised || ++ptd->idle_loops < sm->idle_loops_threshold)
+	return;
+      __atomic_fetch_or (word, mask, __ATOMIC_RELEASE);
+      ptd->is_advertised = 1;
+      return;
+    }
+
+  ptd->idle_loops = 0;
+  if (PREDICT_TRUE (!ptd->is_advertised))
+    return;
+
+  if (__atomic_load_n (word, __ATOMIC_RELAXED) & mask)
+    {
+      /* Own work showed up while advertised, withdraw */
+      __atomic_fetch_and (word, ~mask, __ATOMIC_RELEASE);
+      ptd->is_advertised = 0;
+    }
+  else
+    /* Claimed by a busy worker, so this was stolen work: stay available */
+    __atomic_fetch_or (word, mask, __ATOMIC_RELEASE);
+}
+
+#endif /* included_vlib_steal_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -339,15 +339,18 @@ vlib_thread_init (vlib_main_t * vm)
 }
 
 vlib_frame_queue_t *
-vlib_frame_queue_alloc (int nelts)
+vlib_frame_queue_alloc (int nelts, int n_rings)
 {
   vlib_frame_queue_t *fq;
+  vlib_frame_queue_ring_t *ring;
 
   fq = clib_mem_alloc_aligned (sizeof (*fq), CLIB_CACHE_LINE_BYTES);
   clib_memset (fq, 0, sizeof (*fq));
   fq->nelts = nelts;
+  fq->ring_size = nelts;
   fq->vector_threshold = 2 * VLIB_FRAME_SIZE;
-  vec_validate_aligned (fq->elts, nelts - 1, CLIB_CACHE_LINE_BYTES);
+  fq->congestion_threshold = VLIB_FRAME_QUEUE_CONGESTION_THRESHOLD (nelts);
+  vec_validate_aligned (fq->rings, n_rings - 1, CLIB_CACHE_LINE_BYTES);
 
   if (nelts & (nelts - 1))
     {
@@ -355,6 +358,10 @@ vlib_frame_queue_alloc (int nelts)
       abort ();
     }
 
+  /* Allocate every ring up front, senders never allocate on the data path */
+  vec_foreach (ring, fq->rings)
+    vec_validate_aligned (ring->elts, nelts - 1, CLIB_CACHE_LINE_BYTES);
+
   return (fq);
 }
 
@@ -887,6 +894,7 @@ vlib_worker_thread_node_refork (void)
   vlib_node_main_t *nm, *nm_clone;
   vlib_node_t **old_nodes_clone;
   vlib_node_runtime_t *rt, *old_rt;
+  vlib_pending_frame_t *pf;
 
   vlib_node_t *new_n_clone;
 
@@ -916,6 +924,15 @@ vlib_worker_thread_node_refork (void)
   vm_clone->error_main.counters_last_clear = old_counters_all_clear;
 
   nm_clone = &vm_clone->node_main;
+
+  /* Frames held back by frame coalescing are still pending, and no next
+     frame will point to them once the next frames are reset */
+  vec_foreach (pf, nm_clone->pending_frames)
+    {
+      pf->frame->frame_flags |= VLIB_FRAME_FREE_AFTER_DISPATCH;
+      pf->next_frame_index = VLIB_PENDING_FRAME_NO_NEXT_FRAME;
+    }
+
   vec_free (nm_clone->next_frames);
   nm_clone->next_frames = vec_dup_aligned (nm->next_frames,
 					   CLIB_CACHE_LINE_BYTES);
@@ -1561,16 +1578,23 @@ u32
 vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts)
 {
   vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_main_t *vm = vlib_get_main ();
   vlib_frame_queue_main_t *fqm;
   vlib_frame_queue_t *fq;
+  u8 *name;
   int i;
-  u32 num_threads;
+  u32 ring_size;
 
   if (frame_queue_nelts == 0)
     frame_queue_nelts = FRAME_QUEUE_MAX_NELTS;
 
-  num_threads = 1 /* main thread */  + tm->n_threads;
-  ASSERT (frame_queue_nelts >= 8 + num_threads);
+  /*
+   * Every sender gets its own ring towards each receiver, so split the
+   * configured queue size between them. Memory then grows with the number
+   * of threads rather than with its square.
+   */
+  ring_size = max_pow2 (clib_max (FRAME_QUEUE_MIN_RING_NELTS,
+				  frame_queue_nelts / tm->n_vlib_mains));
 
   vec_add2 (tm->frame_queue_mains, fqm, 1);
 
@@ -1581,13 +1605,52 @@ vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts)
   _vec_len (fqm->vlib_frame_queues) = 0;
   for (i = 0; i < tm->n_vlib_mains; i++)
     {
-      fq = vlib_frame_queue_alloc (frame_queue_nelts);
+      fq = vlib_frame_queue_alloc (ring_size, tm->n_vlib_mains);
       vec_add1 (fqm->vlib_frame_queues, fq);
     }
 
+  /* Congestion and depth statistics, named after the receiving node */
+  if (node_index != ~0)
+    name = format (0, "/sys/frame-queue/%v",
+		   vlib_get_node (vm, node_index)->name);
+  else
+    name = format (0, "/sys/frame-queue/%u", fqm - tm->frame_queue_mains);
+
+  fqm->congested.name = (char *) format (0, "%v/congested%c", name, 0);
+  fqm->congested.stat_segment_name = fqm->congested.name;
+  vlib_validate_simple_counter (&fqm->congested, tm->n_vlib_mains - 1);
+
+  fqm->drops.name = (char *) format (0, "%v/drops%c", name, 0);
+  fqm->drops.stat_segment_name = fqm->drops.name;
+  vlib_validate_simple_counter (&fqm->drops, tm->n_vlib_mains - 1);
+
+  /* Exact below 8, 8 sub-buckets per power of two up to 128 */
+  fqm->depth.name = (char *) format (0, "%v/depth%c", name, 0);
+  fqm->depth.stat_segment_name = fqm->depth.name;
+  fqm->depth.log2_sub_buckets = 3;
+  fqm->depth.n_buckets = 40;
+  vlib_validate_histogram (&fqm->depth, 0);
+
+  vec_free (name);
+
   return (fqm - tm->frame_queue_mains);
 }
 
+void
+vlib_frame_queue_set_congestion_threshold (u32 frame_queue_index,
+					   u32 threshold)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_t **fq;
+
+  fqm = vec_elt_at_index (tm->frame_queue_mains, frame_queue_index);
+  vec_foreach (fq, fqm->vlib_frame_queues)
+    (*fq)->congestion_threshold =
+      threshold ? clib_min (threshold, (*fq)->nelts) :
+		  VLIB_FRAME_QUEUE_CONGESTION_THRESHOLD ((*fq)->nelts);
+}
+
 int
 vlib_thread_cb_register (struct vlib_main_t *vm, vlib_thread_callbacks_t * cb)
 {
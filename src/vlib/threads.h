@@ -67,11 +67,9 @@ typedef struct vlib_thread_registration_
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
-  volatile u32 valid;
   u32 maybe_trace : 1;
   u32 n_vectors;
   u32 offset;
-  STRUCT_MARK (end_of_reset);
 
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
   u32 buffer_index[VLIB_FRAME_SIZE];
@@ -111,22 +109,45 @@ typedef struct
 
 extern vlib_worker_thread_t *vlib_worker_threads;
 
+/*
+ * Single producer, single consumer ring carrying frames from one sending
+ * thread to one receiving thread. Producer and consumer state live on
+ * separate cache lines, and each side keeps a private copy of the other
+ * side's index, so the remote line is only touched when the copy runs out.
+ */
 typedef struct
 {
-  /* static data */
+  /* modified by enqueue side */
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  volatile u64 tail;
+  u64 head_cache;
+
+  /* modified by dequeue side */
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  volatile u64 head;
+  u64 tail_cache;
+
+  /* allocated with the frame queue */
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline2);
   vlib_frame_queue_elt_t *elts;
+} vlib_frame_queue_ring_t;
+
+typedef struct
+{
+  /* static data */
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* one ring per sending thread */
+  vlib_frame_queue_ring_t *rings;
   u64 vector_threshold;
   u64 trace;
+  /* ring size in use, and allocated */
   u32 nelts;
+  u32 ring_size;
+  u32 congestion_threshold;
 
-  /* modified by enqueue side  */
+  /* modified by dequeue side */
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
-  volatile u64 tail;
-
-  /* modified by dequeue side  */
-  CLIB_CACHE_LINE_ALIGN_MARK (cacheline2);
-  volatile u64 head;
+  u32 next_ring;
 }
 vlib_frame_queue_t;
 
@@ -137,11 +158,30 @@ typedef struct
 
   vlib_frame_queue_t **vlib_frame_queues;
 
+  /* frame flags set on the frames handed to the node */
+  u16 frame_flags;
+
   /* for frame queue tracing */
   frame_queue_trace_t *frame_queue_traces;
   frame_queue_nelt_counter_t *frame_queue_histogram;
+
+  /* enqueues above the congestion threshold, [sender][receiver] */
+  vlib_simple_counter_main_t congested;
+  /* packets dropped on congestion, [sender][receiver] */
+  vlib_simple_counter_main_t drops;
+  /* queue depth seen by the receiver on dequeue, [receiver] */
+  vlib_histogram_main_t depth;
 } vlib_frame_queue_main_t;
 
+/*
+ * Ring occupancy at or above which a frame queue is considered congested,
+ * by default 3/4 of the ring
+ */
+#define VLIB_FRAME_QUEUE_CONGESTION_THRESHOLD(nelts) ((nelts) - ((nelts) >> 2))
+
+/* Smallest per-sender ring, whatever the number of senders */
+#define FRAME_QUEUE_MIN_RING_NELTS 8
+
 typedef struct
 {
   uword node_index;
@@ -159,6 +199,8 @@ void vlib_create_worker_threads (vlib_main_t * vm, int n,
 
 void vlib_worker_thread_init (vlib_worker_thread_t * w);
 u32 vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts);
+void vlib_frame_queue_set_congestion_threshold (u32 frame_queue_index,
+					       u32 threshold);
 
 /* Check for a barrier sync request every 30ms */
 #define BARRIER_SYNC_DELAY (0.030000)
@@ -189,6 +231,24 @@ vlib_get_thread_index (void)
   return __os_thread_index;
 }
 
+/** Check if the handoff queue towards a thread is congested
+    Handoff nodes can use this as early feedback, before enqueues start
+    failing or spinning. Only the sending thread may call it.
+*/
+static_always_inline int
+vlib_frame_queue_is_congested (vlib_frame_queue_main_t *fqm, u32 thread_index)
+{
+  vlib_frame_queue_t *fq = fqm->vlib_frame_queues[thread_index];
+  vlib_frame_queue_ring_t *ring = fq->rings + vlib_get_thread_index ();
+
+  /* The cached head can only lag behind, refresh it before saying yes */
+  if (PREDICT_TRUE (ring->tail - ring->head_cache < fq->congestion_threshold))
+    return 0;
+
+  ring->head_cache = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+  return ring->tail - ring->head_cache >= fq->congestion_threshold;
+}
+
 always_inline void
 vlib_smp_unsafe_warning (void)
 {
@@ -434,9 +434,13 @@ test_frame_queue_nelts (vlib_main_t * vm, unformat_input_t * input,
       goto done;
     }
 
+  /* Rings are allocated at their full size, they can only shrink */
   for (fqix = 0; fqix < num_fq; fqix++)
     {
-      fqm->vlib_frame_queues[fqix]->nelts = nelts;
+      vlib_frame_queue_t *fq = fqm->vlib_frame_queues[fqix];
+      fq->nelts = clib_min (nelts, fq->ring_size);
+      fq->congestion_threshold =
+	clib_min (fq->congestion_threshold, fq->nelts);
     }
 
 done:
@@ -532,6 +536,64 @@ VLIB_CLI_COMMAND (cmd_test_frame_queue_threshold,static) = {
 };
 /* *INDENT-ON* */
 
+/*
+ * Modify the occupancy at which frame queues report congestion
+ */
+static clib_error_t *
+set_frame_queue_congestion_threshold (vlib_main_t *vm,
+				      unformat_input_t *input,
+				      vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  clib_error_t *error = NULL;
+  u32 threshold = ~0, index = ~0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "%u", &threshold))
+	;
+      else if (unformat (line_input, "index %u", &index))
+	;
+      else
+	{
+	  error = clib_error_return (0, "parse error: '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (index >= vec_len (tm->frame_queue_mains))
+    {
+      error = clib_error_return (0,
+				 "expecting valid worker handoff queue index");
+      goto done;
+    }
+
+  if (threshold == ~0)
+    {
+      error = clib_error_return (0, "expecting threshold value");
+      goto done;
+    }
+
+  vlib_frame_queue_set_congestion_threshold (index, threshold);
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+VLIB_CLI_COMMAND (cmd_set_frame_queue_congestion_threshold, static) = {
+  .path = "set frame-queue congestion-threshold",
+  .short_help =
+    "set frame-queue congestion-threshold N index I (0=default 3/4 full)",
+  .function = set_frame_queue_congestion_threshold,
+};
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -60,10 +60,29 @@ typedef struct
   /* Statistics. */
   u64 epoll_files_ready;
   u64 epoll_waits;
+
+  /* Worker sleep policy, see "set worker-sleep" */
+  u8 sleep_policy;
+  u32 empty_polls_threshold;
+  f64 max_busy_poll;
+  u32 n_empty_polls;
+  u32 last_main_loop_count;
+  u32 last_vectors_processed;
+  f64 last_busy_time;
+  /* moving average of the gaps between bursts, in seconds */
+  f64 idle_gap;
+  f64 policy_enable_time;
+  u64 n_sleeps;
+  f64 time_asleep;
 } linux_epoll_main_t;
 
 static linux_epoll_main_t *linux_epoll_mains = 0;
 
+#define LINUX_EPOLL_DEFAULT_EMPTY_POLLS	     256
+#define LINUX_EPOLL_DEFAULT_MAX_BUSY_POLL_US 100
+/* main loops between sleep policy checks once no vectors are seen */
+#define LINUX_EPOLL_IDLE_LOOPS_PER_CALL 16
+
 static void
 linux_epoll_file_update (clib_file_t * f, clib_file_update_type_t update_type)
 {
@@ -130,6 +149,45 @@ linux_epoll_file_update (clib_file_t * f, clib_file_update_type_t update_type)
     }
 }
 
+/*
+ * Worker sleep policy: sleep once no vectors were processed for
+ * empty_polls_threshold main loops and for the busy-poll window. The
+ * window is twice the average gap between bursts, if that is short enough
+ * for busy polling to catch the next burst, and zero otherwise. Bursty
+ * traffic keeps being polled, sparse traffic lets the worker sleep early.
+ */
+static_always_inline int
+linux_epoll_worker_may_sleep (vlib_main_t *vm, linux_epoll_main_t *em,
+			      f64 now)
+{
+  u32 n_loops = vm->main_loop_count - em->last_main_loop_count;
+  u32 n_vectors =
+    vm->main_loop_vectors_processed - em->last_vectors_processed;
+  f64 window;
+
+  em->last_main_loop_count = vm->main_loop_count;
+  em->last_vectors_processed = vm->main_loop_vectors_processed;
+
+  if (n_vectors)
+    {
+      if (em->n_empty_polls)
+	em->idle_gap += (now - em->last_busy_time - em->idle_gap) / 8;
+      em->last_busy_time = now;
+      em->n_empty_polls = 0;
+      return 0;
+    }
+
+  em->n_empty_polls += n_loops;
+  if (em->n_empty_polls < em->empty_polls_threshold)
+    return 0;
+
+  window = em->idle_gap < em->max_busy_poll ?
+	     clib_min (2 * em->idle_gap, em->max_busy_poll) :
+	     0;
+
+  return now - em->last_busy_time >= window;
+}
+
 static_always_inline uword
 linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 			  vlib_frame_t * frame, u32 thread_index)
@@ -140,6 +198,8 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   struct epoll_event *e;
   int n_fds_ready;
   int is_main = (thread_index == 0);
+  f64 sleep_start = 0;
+  u64 wake_time = 0;
 
   {
     vlib_node_main_t *nm = &vm->node_main;
@@ -172,7 +232,8 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
       }
     /* If we're not working very hard, decide how long to sleep */
     else if (is_main && vector_rate < 2 && vm->api_queue_nonempty == 0
-	     && nm->input_node_counts_by_state[VLIB_NODE_STATE_POLLING] == 0)
+	     && nm->input_node_counts_by_state[VLIB_NODE_STATE_POLLING] == 0
+	     && nm->coalesce_hold_start == 0)
       {
 	ticks_until_expiration = TW (tw_timer_first_expires_in_ticks)
 	  ((TWT (tw_timer_wheel) *) nm->timing_wheel);
@@ -198,13 +259,31 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 	  }
 	node->input_main_loops_per_call = 0;
       }
+    else if (is_main == 0 && em->sleep_policy)
+      {
+	if (linux_epoll_worker_may_sleep (vm, em, now) &&
+	    (vlib_get_first_main ()->time_last_barrier_release + 0.5 < now) &&
+	    nm->input_node_counts_by_state[VLIB_NODE_STATE_POLLING] == 0 &&
+	    nm->coalesce_hold_start == 0)
+	  {
+	    timeout = 10e-3;
+	    timeout_ms = max_timeout_ms;
+	    node->input_main_loops_per_call = 0;
+	    sleep_start = now;
+	  }
+	else
+	  node->input_main_loops_per_call =
+	    em->n_empty_polls ? LINUX_EPOLL_IDLE_LOOPS_PER_CALL : 1024;
+      }
     else if (is_main == 0 && vector_rate < 2 &&
 	     (vlib_get_first_main ()->time_last_barrier_release + 0.5 < now) &&
-	     nm->input_node_counts_by_state[VLIB_NODE_STATE_POLLING] == 0)
+	     nm->input_node_counts_by_state[VLIB_NODE_STATE_POLLING] == 0 &&
+	     nm->coalesce_hold_start == 0)
       {
 	timeout = 10e-3;
 	timeout_ms = max_timeout_ms;
 	node->input_main_loops_per_call = 0;
+	sleep_start = now;
       }
     else			/* busy */
       {
@@ -229,6 +308,10 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 				      vec_len (em->epoll_events), timeout_ms);
 	  }
 
+	/* fd events ended the sleep, as far as we can tell they arrived now */
+	if (PREDICT_FALSE (nm->record_wakeup_latency) && timeout_ms &&
+	    n_fds_ready > 0)
+	  wake_time = clib_cpu_time_now ();
       }
     else
       {
@@ -345,7 +428,21 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 	}
     }
 
+  /*
+   * Interrupts the read functions signalled, e.g. by rx queue fds, are
+   * dispatched after this node: their latency counts from the wakeup
+   */
+  if (wake_time && *vm->node_main.pending_interrupts &&
+      vm->node_main.interrupt_signal_time == 0)
+    vm->node_main.interrupt_signal_time = wake_time;
+
 done:
+  if (sleep_start != 0)
+    {
+      em->n_sleeps++;
+      em->time_asleep += vlib_time_now (vm) - sleep_start;
+    }
+
   if (PREDICT_FALSE (vm->cpu_id != clib_get_current_cpu_id ()))
     {
       vm->cpu_id = clib_get_current_cpu_id ();
@@ -408,6 +505,169 @@ linux_epoll_input_init (vlib_main_t * vm)
 
 VLIB_INIT_FUNCTION (linux_epoll_input_init);
 
+static clib_error_t *
+set_worker_sleep_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			     vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vlib_global_main_t *vgm = vlib_get_global_main ();
+  vlib_histogram_main_t *hm = &vgm->wakeup_latency;
+  u32 n_threads = vlib_get_n_threads ();
+  u32 empty_polls = LINUX_EPOLL_DEFAULT_EMPTY_POLLS;
+  u32 max_busy_poll_us = LINUX_EPOLL_DEFAULT_MAX_BUSY_POLL_US;
+  clib_error_t *error = 0;
+  uword *workers = 0;
+  linux_epoll_main_t *em;
+  int is_enable = 1, any_enabled = 0;
+  u32 i;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "on"))
+	is_enable = 1;
+      else if (unformat (line_input, "off"))
+	is_enable = 0;
+      else if (unformat (line_input, "workers %U", unformat_bitmap_list,
+			 &workers))
+	;
+      else if (unformat (line_input, "empty-polls %u", &empty_polls))
+	;
+      else if (unformat (line_input, "max-busy-poll-us %u",
+			 &max_busy_poll_us))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (n_threads < 2)
+    {
+      error = clib_error_return (0, "no worker threads");
+      goto done;
+    }
+
+  if (workers && clib_bitmap_last_set (workers) >= n_threads - 1)
+    {
+      error = clib_error_return (0, "worker index out of range");
+      goto done;
+    }
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  if (hm->counters == 0)
+    {
+      /* ns, exact below 2, then 2 sub-buckets per power of two, ~2s */
+      hm->name = "wakeup-latency";
+      hm->stat_segment_name = "/sys/wakeup-latency";
+      hm->log2_sub_buckets = 1;
+      hm->n_buckets = 62;
+      vlib_validate_histogram (hm, 0);
+    }
+
+  for (i = 1; i < n_threads; i++)
+    {
+      em = vec_elt_at_index (linux_epoll_mains, i);
+      if (workers == 0 || clib_bitmap_get (workers, i - 1))
+	{
+	  if (is_enable && !em->sleep_policy)
+	    {
+	      em->n_empty_polls = 0;
+	      em->idle_gap = 0;
+	      em->n_sleeps = 0;
+	      em->time_asleep = 0;
+	      em->policy_enable_time = vlib_time_now (vm);
+	    }
+	  em->sleep_policy = is_enable;
+	  em->empty_polls_threshold = empty_polls;
+	  em->max_busy_poll = max_busy_poll_us * 1e-6;
+	}
+      any_enabled |= em->sleep_policy;
+    }
+
+  foreach_vlib_main ()
+    this_vlib_main->node_main.record_wakeup_latency = any_enabled;
+
+  vlib_worker_thread_barrier_release (vm);
+
+done:
+  clib_bitmap_free (workers);
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Let workers sleep in epoll once they have seen no vectors for
+ * empty-polls main loops, and for a busy-poll window derived from the
+ * observed gaps between bursts, capped at max-busy-poll-us. Rx queues
+ * must be in interrupt or adaptive mode for a worker to sleep. While any
+ * worker uses the policy, the latency from the end of an epoll sleep on
+ * an fd event, or from an interrupt signalled by another thread, to the
+ * interrupt dispatch is recorded in the /sys/wakeup-latency histogram.
+ *
+ * @cliexpar
+ * @cliexcmd{set worker-sleep workers 0-3 on empty-polls 256
+ * max-busy-poll-us 100}
+?*/
+VLIB_CLI_COMMAND (set_worker_sleep_command, static) = {
+  .path = "set worker-sleep",
+  .short_help = "set worker-sleep [workers <list>] [on|off] "
+		"[empty-polls <n>] [max-busy-poll-us <n>]",
+  .function = set_worker_sleep_command_fn,
+};
+
+static clib_error_t *
+show_worker_sleep_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			      vlib_cli_command_t *cmd)
+{
+  vlib_histogram_main_t *hm = &vlib_get_global_main ()->wakeup_latency;
+  linux_epoll_main_t *em;
+  f64 now = vlib_time_now (vm), window;
+  u64 n_wakeups;
+  u32 i;
+
+  vlib_cli_output (vm, "%=8s%=8s%=12s%=12s%=12s%=12s%=10s%=12s%=12s",
+		   "Thread", "Policy", "Empty-polls", "Gap(us)", "Window(us)",
+		   "Sleeps", "Asleep", "p50(us)", "p99(us)");
+
+  for (i = 1; i < vlib_get_n_threads (); i++)
+    {
+      em = vec_elt_at_index (linux_epoll_mains, i);
+      if (!em->sleep_policy)
+	{
+	  vlib_cli_output (vm, "%=8u%=8s", i, "off");
+	  continue;
+	}
+
+      window = em->idle_gap < em->max_busy_poll ?
+		 clib_min (2 * em->idle_gap, em->max_busy_poll) :
+		 0;
+
+      n_wakeups = hm->counters ? vlib_histogram_count (hm, i, 0) : 0;
+
+      vlib_cli_output (
+	vm, "%=8u%=8s%=12u%=12.1f%=12.1f%=12lu%=9.1f%%%=12.1f%=12.1f", i,
+	"on", em->empty_polls_threshold, em->idle_gap * 1e6, window * 1e6,
+	em->n_sleeps,
+	100 * em->time_asleep / clib_max (now - em->policy_enable_time, 1e-3),
+	n_wakeups ? vlib_histogram_percentile (hm, i, 0, 50) * 1e-3 : 0,
+	n_wakeups ? vlib_histogram_percentile (hm, i, 0, 99) * 1e-3 : 0);
+    }
+
+  return 0;
+}
+
+VLIB_CLI_COMMAND (show_worker_sleep_command, static) = {
+  .path = "show worker-sleep",
+  .short_help = "show worker-sleep",
+  .function = show_worker_sleep_command_fn,
+};
+
 #endif /* HAVE_LINUX_EPOLL */
 
 static clib_error_t *
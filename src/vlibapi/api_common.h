@@ -137,6 +137,7 @@ typedef struct
   int replay;			/**< is this message to be replayed?  */
   int message_bounce;		/**< do not free message after processing */
   int is_mp_safe;		/**< worker thread barrier required?  */
+  int is_read_only;		/**< handler only reads main thread state */
   int is_autoendian;		/**< endian conversion required?  */
 } vl_msg_api_msg_config_t;
 
@@ -265,6 +266,12 @@ typedef struct api_main_t
   /** Message is mp safe vector */
   u8 *is_mp_safe;
 
+  /** Message handler is read-only vector, see vl_msg_api_barrier_needed */
+  u8 *is_read_only;
+
+  /** Take the barrier for read-only handlers too */
+  u8 read_only_use_barrier;
+
   /** Message requires us to do endian conversion */
   u8 *is_autoendian;
 
@@ -396,11 +403,17 @@ typedef struct api_main_t
   void (**perf_counter_cbs_tmp)
     (struct api_main_t *, u32 id, int before_or_after);
 
+  /** called once the barrier taken for a message is released */
+  void (*barrier_hold_cb) (struct api_main_t *, u32 id, u64 n_clocks);
+
 } api_main_t;
 
 extern __thread api_main_t *my_api_main;
 extern api_main_t api_global_main;
 
+void vl_api_set_msg_thread_safe (api_main_t *am, u32 msg_id, int value);
+void vl_api_set_msg_read_only (api_main_t *am, u32 msg_id, int value);
+
 always_inline api_main_t *
 vlibapi_get_main (void)
 {
@@ -413,6 +426,18 @@ vlibapi_set_main (api_main_t * am)
   my_api_main = am;
 }
 
+/** Does the handler for msg id need the worker thread barrier?
+    Read-only handlers run on the main thread, which owns the control
+    plane state they read, so they only need it if told so.
+*/
+always_inline int
+vl_msg_api_barrier_needed (api_main_t *am, u32 id)
+{
+  if (am->is_mp_safe[id])
+    return 0;
+  return !am->is_read_only[id] || am->read_only_use_barrier;
+}
+
 #endif /* included_api_common_h */
 
 /*
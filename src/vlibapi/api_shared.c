@@ -505,6 +505,8 @@ msg_handler_internal (api_main_t * am,
 {
   u16 id = clib_net_to_host_u16 (*((u16 *) the_msg));
   u8 *(*print_fp) (void *, void *);
+  int needs_barrier = 0;
+  u64 t_sync = 0;
 
   if (PREDICT_FALSE (am->elog_trace_api_messages))
     {
@@ -547,9 +549,12 @@ msg_handler_internal (api_main_t * am,
 
       if (do_it)
 	{
-	  if (!am->is_mp_safe[id])
+	  needs_barrier = vl_msg_api_barrier_needed (am, id);
+	  if (needs_barrier)
 	    {
 	      vl_msg_api_barrier_trace_context (am->msg_names[id]);
+	      if (am->barrier_hold_cb)
+		t_sync = clib_cpu_time_now ();
 	      vl_msg_api_barrier_sync ();
 	    }
 
@@ -569,8 +574,12 @@ msg_handler_internal (api_main_t * am,
 	  if (PREDICT_FALSE (vec_len (am->perf_counter_cbs) != 0))
 	    clib_call_callbacks (am->perf_counter_cbs, am, id,
 				 1 /* after */ );
-	  if (!am->is_mp_safe[id])
-	    vl_msg_api_barrier_release ();
+	  if (needs_barrier)
+	    {
+	      vl_msg_api_barrier_release ();
+	      if (am->barrier_hold_cb)
+		am->barrier_hold_cb (am, id, clib_cpu_time_now () - t_sync);
+	    }
 	}
     }
   else
@@ -606,7 +615,7 @@ msg_handler_internal (api_main_t * am,
       if (id < vec_len (am->msg_names) && am->msg_names[id])
 	{
 	  ed->c = elog_string (am->elog_main, (char *) am->msg_names[id]);
-	  ed->barrier = !am->is_mp_safe[id];
+	  ed->barrier = !needs_barrier;
 	}
       else
 	{
@@ -629,7 +638,8 @@ vl_msg_api_handler_with_vm_node (api_main_t * am, svm_region_t * vlib_rp,
   u8 *(*print_fp) (void *, void *);
   svm_region_t *old_vlib_rp;
   void *save_shmem_hdr;
-  int is_mp_safe = 1;
+  int needs_barrier = 0;
+  u64 t_sync = 0;
 
   if (PREDICT_FALSE (am->elog_trace_api_messages))
     {
@@ -671,11 +681,13 @@ vl_msg_api_handler_with_vm_node (api_main_t * am, svm_region_t * vlib_rp,
 	      (*print_fp) (the_msg, vm);
 	    }
 	}
-      is_mp_safe = am->is_mp_safe[id];
+      needs_barrier = vl_msg_api_barrier_needed (am, id);
 
-      if (!is_mp_safe)
+      if (needs_barrier)
 	{
 	  vl_msg_api_barrier_trace_context (am->msg_names[id]);
+	  if (am->barrier_hold_cb)
+	    t_sync = clib_cpu_time_now ();
 	  vl_msg_api_barrier_sync ();
 	}
       if (is_private)
@@ -707,8 +719,12 @@ vl_msg_api_handler_with_vm_node (api_main_t * am, svm_region_t * vlib_rp,
 	  am->vlib_rp = old_vlib_rp;
 	  am->shmem_hdr = save_shmem_hdr;
 	}
-      if (!is_mp_safe)
-	vl_msg_api_barrier_release ();
+      if (needs_barrier)
+	{
+	  vl_msg_api_barrier_release ();
+	  if (am->barrier_hold_cb)
+	    am->barrier_hold_cb (am, id, clib_cpu_time_now () - t_sync);
+	}
     }
   else
     {
@@ -762,7 +778,7 @@ vl_msg_api_handler_with_vm_node (api_main_t * am, svm_region_t * vlib_rp,
 	ed->c = elog_string (am->elog_main, (char *) am->msg_names[id]);
       else
 	ed->c = elog_string (am->elog_main, "BOGUS");
-      ed->barrier = is_mp_safe;
+      ed->barrier = !needs_barrier;
     }
 }
 
@@ -885,6 +901,7 @@ vl_msg_api_socket_handler (void *the_msg)
   _ (api_trace_cfg)                                                           \
   _ (message_bounce)                                                          \
   _ (is_mp_safe)                                                              \
+  _ (is_read_only)                                                            \
   _ (is_autoendian)
 
 void
@@ -929,6 +946,7 @@ vl_msg_api_config (vl_msg_api_msg_config_t * c)
   am->msg_fromjson_handlers[c->id] = c->fromjson;
   am->message_bounce[c->id] = c->message_bounce;
   am->is_mp_safe[c->id] = c->is_mp_safe;
+  am->is_read_only[c->id] = c->is_read_only;
   am->is_autoendian[c->id] = c->is_autoendian;
 
   am->api_trace_cfg[c->id].size = c->size;
@@ -965,6 +983,7 @@ vl_msg_api_set_handlers (int id, char *name, void *handler, void *cleanup,
   c->replay = 1;
   c->message_bounce = 0;
   c->is_mp_safe = 0;
+  c->is_read_only = 0;
   c->is_autoendian = 0;
   c->tojson = tojson;
   c->fromjson = fromjson;
@@ -994,6 +1013,33 @@ vl_msg_api_set_cleanup_handler (int msg_id, void *fp)
   am->msg_cleanup_handlers[msg_id] = fp;
 }
 
+/*
+ * Mark a message as not needing the worker thread barrier. Call after
+ * setup_message_id_table, with the message id base added.
+ */
+void
+vl_api_set_msg_thread_safe (api_main_t *am, u32 msg_id, int value)
+{
+  ASSERT (msg_id > 0);
+
+  vec_validate (am->is_mp_safe, msg_id);
+  am->is_mp_safe[msg_id] = value;
+}
+
+/*
+ * Mark a message handler as only reading state owned by the main thread,
+ * e.g. a dump. Such handlers run without the barrier, unless
+ * am->read_only_use_barrier is set.
+ */
+void
+vl_api_set_msg_read_only (api_main_t *am, u32 msg_id, int value)
+{
+  ASSERT (msg_id > 0);
+
+  vec_validate (am->is_read_only, msg_id);
+  am->is_read_only[msg_id] = value;
+}
+
 void
 vl_msg_api_queue_handler (svm_queue_t * q)
 {
@@ -350,9 +350,13 @@ vlib_apis_hookup (vlib_main_t *vm)
    */
   msg_id_base = setup_message_id_table ();
 
-  am->is_mp_safe[VL_API_GET_NODE_GRAPH] = 1;
-  am->is_mp_safe[VL_API_CONTROL_PING] = 1;
-  am->is_mp_safe[VL_API_CONTROL_PING_REPLY] = 1;
+  vl_api_set_msg_thread_safe (am, msg_id_base + VL_API_GET_NODE_GRAPH, 1);
+  vl_api_set_msg_thread_safe (am, msg_id_base + VL_API_CONTROL_PING, 1);
+  vl_api_set_msg_thread_safe (am, msg_id_base + VL_API_CONTROL_PING_REPLY, 1);
+
+  vl_api_set_msg_read_only (am, msg_id_base + VL_API_SHOW_THREADS, 1);
+  vl_api_set_msg_read_only (am, msg_id_base + VL_API_GET_NODE_INDEX, 1);
+  vl_api_set_msg_read_only (am, msg_id_base + VL_API_GET_NEXT_INDEX, 1);
 
   return 0;
 }
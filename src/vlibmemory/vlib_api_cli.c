@@ -94,6 +94,162 @@ VLIB_CLI_COMMAND (cli_clear_api_histogram_command, static) =
 };
 /* *INDENT-ON* */
 
+/* Barrier hold time per message id, in microseconds, up to ~2s */
+static vlib_histogram_main_t vl_api_barrier_hold_histograms = {
+  .name = "api-barrier-hold",
+  .stat_segment_name = "/sys/api/barrier-hold",
+  .log2_sub_buckets = 2,
+  .n_buckets = 80,
+};
+
+static void
+vl_api_barrier_hold_record (api_main_t *am, u32 id, u64 n_clocks)
+{
+  vlib_histogram_main_t *hm = &vl_api_barrier_hold_histograms;
+  vlib_main_t *vm = vlib_get_main ();
+
+  /* Nested in a barrier held by someone else, e.g. a batch of RPCs */
+  if (vlib_worker_threads[0].recursion_level)
+    return;
+
+  if (hm->counters == 0 || id >= vlib_histogram_n_histograms (hm))
+    vlib_validate_histogram (hm, clib_max (id, vec_len (am->msg_names) - 1));
+
+  vlib_increment_histogram (hm, vm->thread_index, id,
+			    n_clocks * vm->clib_time.seconds_per_clock * 1e6);
+}
+
+static clib_error_t *
+vl_api_barrier_hold_init (vlib_main_t *vm)
+{
+  api_main_t *am = vlibapi_get_main ();
+
+  am->barrier_hold_cb = vl_api_barrier_hold_record;
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (vl_api_barrier_hold_init);
+
+typedef struct
+{
+  u32 id;
+  u64 count;
+  u64 p50, p99, max;
+} vl_api_barrier_hold_summary_t;
+
+static int
+vl_api_barrier_hold_summary_cmp (void *a1, void *a2)
+{
+  vl_api_barrier_hold_summary_t *s1 = a1, *s2 = a2;
+
+  if (s1->p99 != s2->p99)
+    return s1->p99 < s2->p99 ? 1 : -1;
+  return s1->max < s2->max ? 1 : (s1->max > s2->max ? -1 : 0);
+}
+
+static clib_error_t *
+vl_api_show_barrier_command (vlib_main_t *vm, unformat_input_t *input,
+			     vlib_cli_command_t *cli_cmd)
+{
+  vlib_histogram_main_t *hm = &vl_api_barrier_hold_histograms;
+  api_main_t *am = vlibapi_get_main ();
+  vl_api_barrier_hold_summary_t *summaries = 0, *sp;
+  u32 id;
+
+  vlib_cli_output (vm, "read-only handlers %s the barrier",
+		   am->read_only_use_barrier ? "take" : "do not take");
+  vlib_cli_output (vm, "barrier syncs: %lu",
+		   vlib_worker_threads[0].barrier_sync_count);
+
+  if (hm->counters == 0)
+    return 0;
+
+  for (id = 0; id < vlib_histogram_n_histograms (hm); id++)
+    {
+      vl_api_barrier_hold_summary_t s = { .id = id };
+
+      s.count = vlib_histogram_count (hm, VLIB_HISTOGRAM_ALL_THREADS, id);
+      if (s.count == 0)
+	continue;
+
+      s.p50 = vlib_histogram_percentile (hm, VLIB_HISTOGRAM_ALL_THREADS, id,
+					 50);
+      s.p99 = vlib_histogram_percentile (hm, VLIB_HISTOGRAM_ALL_THREADS, id,
+					 99);
+      s.max = vlib_histogram_percentile (hm, VLIB_HISTOGRAM_ALL_THREADS, id,
+					 100);
+      vec_add1 (summaries, s);
+    }
+
+  vec_sort_with_function (summaries, vl_api_barrier_hold_summary_cmp);
+
+  vlib_cli_output (vm, "%-6s%-50s%12s%10s%10s%10s", "ID", "Name", "Count",
+		   "p50(us)", "p99(us)", "Max(us)");
+  vec_foreach (sp, summaries)
+    vlib_cli_output (
+      vm, "%-6u%-50s%12lu%10lu%10lu%10lu", sp->id,
+      sp->id < vec_len (am->msg_names) && am->msg_names[sp->id] ?
+	am->msg_names[sp->id] :
+	"[unknown]",
+      sp->count, sp->p50, sp->p99, sp->max);
+
+  vec_free (summaries);
+  return 0;
+}
+
+/*?
+ * Display how long the worker thread barrier was held for each binary
+ * API message which took it, worst p99 first. Times are bucket lower
+ * bounds. The same histograms are in the stats segment, under
+ * /sys/api/barrier-hold, indexed by message id.
+?*/
+VLIB_CLI_COMMAND (cli_show_api_barrier_command, static) = {
+  .path = "show api barrier",
+  .short_help = "show api barrier",
+  .function = vl_api_show_barrier_command,
+};
+
+static clib_error_t *
+vl_api_clear_barrier_command (vlib_main_t *vm, unformat_input_t *input,
+			      vlib_cli_command_t *cli_cmd)
+{
+  vlib_clear_histograms (&vl_api_barrier_hold_histograms);
+  return 0;
+}
+
+VLIB_CLI_COMMAND (cli_clear_api_barrier_command, static) = {
+  .path = "clear api barrier",
+  .short_help = "clear api barrier",
+  .function = vl_api_clear_barrier_command,
+};
+
+static clib_error_t *
+vl_api_set_barrier_command (vlib_main_t *vm, unformat_input_t *input,
+			    vlib_cli_command_t *cli_cmd)
+{
+  api_main_t *am = vlibapi_get_main ();
+
+  if (unformat (input, "read-only on"))
+    am->read_only_use_barrier = 1;
+  else if (unformat (input, "read-only off"))
+    am->read_only_use_barrier = 0;
+  else
+    return clib_error_return (0, "unknown input `%U'",
+			      format_unformat_error, input);
+  return 0;
+}
+
+/*?
+ * Handlers of read-only messages, such as most dumps, normally run
+ * without the worker thread barrier. "read-only on" makes them take it
+ * again, e.g. to rule them out while chasing a crash.
+?*/
+VLIB_CLI_COMMAND (cli_set_api_barrier_command, static) = {
+  .path = "set api barrier",
+  .short_help = "set api barrier read-only <on|off>",
+  .function = vl_api_set_barrier_command,
+};
+
 static clib_error_t *
 vl_api_client_command (vlib_main_t * vm,
 		       unformat_input_t * input, vlib_cli_command_t * cli_cmd)
@@ -239,8 +395,8 @@ vl_api_message_table_command (vlib_main_t * vm,
   if (verbose == 0)
     vlib_cli_output (vm, "%-4s %s", "ID", "Name");
   else
-    vlib_cli_output (vm, "%-4s %-40s %6s %7s", "ID", "Name", "Bounce",
-		     "MP-safe");
+    vlib_cli_output (vm, "%-4s %-40s %6s %7s %9s", "ID", "Name", "Bounce",
+		     "MP-safe", "Read-only");
 
   for (i = 1; i < vec_len (am->msg_names); i++)
     {
@@ -252,10 +408,10 @@ vl_api_message_table_command (vlib_main_t * vm,
 	}
       else
 	{
-	  vlib_cli_output (vm, "%-4d %-40s %6d %7d", i,
+	  vlib_cli_output (vm, "%-4d %-40s %6d %7d %9d", i,
 			   am->msg_names[i] ? am->msg_names[i] :
 			   "  [no handler]", am->message_bounce[i],
-			   am->is_mp_safe[i]);
+			   am->is_mp_safe[i], am->is_read_only[i]);
 	}
     }
 
@@ -656,12 +812,14 @@ vl_msg_api_process_file (vlib_main_t * vm, u8 * filename,
 	    {
 	      void (*handler) (void *, vlib_main_t *);
 
+	      int needs_barrier = vl_msg_api_barrier_needed (am, msg_id);
+
 	      handler = (void *) am->msg_handlers[msg_id];
 
-	      if (!am->is_mp_safe[msg_id])
+	      if (needs_barrier)
 		vl_msg_api_barrier_sync ();
 	      (*handler) (tmpbuf + sizeof (uword), vm);
-	      if (!am->is_mp_safe[msg_id])
+	      if (needs_barrier)
 		vl_msg_api_barrier_release ();
 	    }
 	  else
@@ -903,11 +1061,14 @@ vl_msg_exec_json_command (vlib_main_t *vm, cJSON *o)
 	  goto end;
 	}
 
-      if (!am->is_mp_safe[msg_id])
-	vl_msg_api_barrier_sync ();
-      (*handler) (msg, vm);
-      if (!am->is_mp_safe[msg_id])
-	vl_msg_api_barrier_release ();
+      if (vl_msg_api_barrier_needed (am, msg_id))
+	{
+	  vl_msg_api_barrier_sync ();
+	  (*handler) (msg, vm);
+	  vl_msg_api_barrier_release ();
+	}
+      else
+	(*handler) (msg, vm);
     }
 
   rv = 0;
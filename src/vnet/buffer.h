@@ -65,15 +65,15 @@
   _ (16, IS_DVR, "dvr", 1)                                                    \
   _ (17, QOS_DATA_VALID, "qos-data-valid", 0)                                 \
   _ (18, GSO, "gso", 0)                                                       \
-  _ (19, AVAIL1, "avail1", 1)                                                 \
-  _ (20, AVAIL2, "avail2", 1)                                                 \
-  _ (21, AVAIL3, "avail3", 1)                                                 \
-  _ (22, AVAIL4, "avail4", 1)                                                 \
-  _ (23, AVAIL5, "avail5", 1)                                                 \
-  _ (24, AVAIL6, "avail6", 1)                                                 \
-  _ (25, AVAIL7, "avail7", 1)                                                 \
-  _ (26, AVAIL8, "avail8", 1)                                                 \
-  _ (27, AVAIL9, "avail9", 1)
+  _ (19, IPSEC_INLINE, "ipsec-inline", 1)                                     \
+  _ (20, AVAIL1, "avail1", 1)                                                 \
+  _ (21, AVAIL2, "avail2", 1)                                                 \
+  _ (22, AVAIL3, "avail3", 1)                                                 \
+  _ (23, AVAIL4, "avail4", 1)                                                 \
+  _ (24, AVAIL5, "avail5", 1)                                                 \
+  _ (25, AVAIL6, "avail6", 1)                                                 \
+  _ (26, AVAIL7, "avail7", 1)                                                 \
+  _ (27, AVAIL8, "avail8", 1)
 
 /*
  * Please allocate the FIRST available bit, redefine
@@ -84,7 +84,7 @@
 #define VNET_BUFFER_FLAGS_ALL_AVAIL                                           \
   (VNET_BUFFER_F_AVAIL1 | VNET_BUFFER_F_AVAIL2 | VNET_BUFFER_F_AVAIL3 |       \
    VNET_BUFFER_F_AVAIL4 | VNET_BUFFER_F_AVAIL5 | VNET_BUFFER_F_AVAIL6 |       \
-   VNET_BUFFER_F_AVAIL7 | VNET_BUFFER_F_AVAIL8 | VNET_BUFFER_F_AVAIL9)
+   VNET_BUFFER_F_AVAIL7 | VNET_BUFFER_F_AVAIL8)
 
 #define VNET_BUFFER_FLAGS_VLAN_BITS \
   (VNET_BUFFER_F_VLAN_1_DEEP | VNET_BUFFER_F_VLAN_2_DEEP)
@@ -497,6 +497,19 @@ typedef struct
     {
       u64 pad[1];
       u64 pg_replay_timestamp;
+
+      /**
+       * Sampled buffer lifetime, maintained by the bufmon plugin.
+       * Only meaningful while cookie matches the plugin's cookie for
+       * the buffer index.
+       */
+      struct
+      {
+	u32 cookie;
+	u32 last_node;
+	u32 last_tick;
+	u32 alloc_time;
+      } lifetime;
     };
     u32 unused[8];
   };
@@ -107,6 +107,17 @@ typedef int (vnet_flow_dev_ops_function_t) (struct vnet_main_t * vnm,
 					    u32 hw_if_index, u32 index,
 					    uword * private_data);
 
+typedef enum
+{
+  VNET_IPSEC_OFFLOAD_DEV_OP_ADD_SA,
+  VNET_IPSEC_OFFLOAD_DEV_OP_DEL_SA,
+} vnet_ipsec_offload_dev_op_t;
+
+/* Interface inline IPsec offload operations callback. */
+typedef int (vnet_ipsec_offload_dev_ops_function_t) (
+  struct vnet_main_t *vnm, vnet_ipsec_offload_dev_op_t op, u32 dev_instance,
+  u32 sa_index, uword *private_data);
+
 typedef enum vnet_interface_function_priority_t_
 {
   VNET_ITF_FUNC_PRIORITY_LOW,
@@ -241,6 +252,9 @@ typedef struct _vnet_device_class
   /* Interface flow offload operations */
   vnet_flow_dev_ops_function_t *flow_ops_function;
 
+  /* Interface inline IPsec offload operations */
+  vnet_ipsec_offload_dev_ops_function_t *ipsec_offload_ops_function;
+
   /* Format device instance as name. */
   format_function_t *format_device_name;
 
@@ -1042,6 +1056,10 @@ typedef struct
   /* feature_arc_index */
   u8 output_feature_arc_index;
 
+  /* set once an ESP SA is offloaded to a device, from then on output
+     checks for packets left to a device which can't encrypt them */
+  u8 ipsec_inline_offload_used;
+
   /* fast lookup tables */
   u32 *hw_if_index_by_sw_if_index;
   u16 *if_out_arc_end_next_index_by_sw_if_index;
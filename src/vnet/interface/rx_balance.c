@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Automatic rx queue rebalancing. A process samples the vectors per call
+ * of each worker, and the packet rate of each rx queue. The rate of a
+ * queue is estimated from the rx counters its interface accumulates on
+ * the polling thread, split evenly between the interface's queues on that
+ * thread. When the busiest worker stays above the high watermark while
+ * the least busy one stays below the low watermark for a number of
+ * consecutive samples, one queue is moved from the former to the latter,
+ * and no further move is made for a hold-down period.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/devices/devices.h>
+#include <vnet/interface/rx_queue_funcs.h>
+
+VLIB_REGISTER_LOG_CLASS (if_rx_balance_log, static) = {
+  .class_name = "interface",
+  .subclass_name = "rx-balance",
+};
+
+#define log_notice(fmt, ...)                                                  \
+  vlib_log_notice (if_rx_balance_log.class, fmt, __VA_ARGS__)
+
+typedef struct
+{
+  /* counters at the previous sample */
+  u64 last_vectors;
+  u64 last_calls;
+  u64 *last_rx_packets_by_sw_if_index;
+
+  /* vectors per call over the last interval */
+  f64 vectors_per_call;
+
+  /* estimated packets per second of the rx queues polled by the thread */
+  f64 rx_rate;
+} rx_balance_thread_t;
+
+typedef struct
+{
+  rx_balance_thread_t *threads;
+
+  /* estimated packets per second, by rx queue index */
+  f64 *rx_rate_by_queue;
+
+  /* consecutive samples spent over the watermarks */
+  u32 n_imbalanced;
+
+  f64 last_move;
+  u64 n_moves;
+
+  /* config */
+  f64 interval;
+  f64 holddown;
+  f64 high_vectors_per_call;
+  f64 low_vectors_per_call;
+  u32 n_samples;
+  u8 is_enabled;
+} rx_balance_main_t;
+
+static rx_balance_main_t rx_balance_main = {
+  .interval = 1.0,
+  .holddown = 10.0,
+  .high_vectors_per_call = 128,
+  .low_vectors_per_call = 32,
+  .n_samples = 3,
+};
+
+typedef enum
+{
+  RX_BALANCE_EVENT_CONFIG,
+} rx_balance_event_t;
+
+static void
+rx_balance_sample (vlib_main_t *vm, f64 dt)
+{
+  rx_balance_main_t *rbm = &rx_balance_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_interface_main_t *im = &vnm->interface_main;
+  vlib_combined_counter_main_t *cm =
+    im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_RX;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vnet_hw_if_rx_queue_t *rxq;
+  rx_balance_thread_t *rt;
+  vnet_hw_interface_t *hi;
+  u32 **n_queues_by_sw_if_index = 0;
+  u32 *n_queues, i;
+
+  vec_validate (rbm->threads, tm->n_vlib_mains - 1);
+  vec_validate (n_queues_by_sw_if_index, tm->n_vlib_mains - 1);
+
+  for (i = 0; i < vec_len (rbm->threads); i++)
+    {
+      vlib_main_t *ovm = vlib_get_main_by_index (i);
+      u64 vectors, calls;
+
+      rt = rbm->threads + i;
+      vectors = ovm->internal_node_vectors;
+      calls = ovm->internal_node_calls;
+      rt->vectors_per_call = calls > rt->last_calls ?
+			       (f64) (vectors - rt->last_vectors) /
+				 (f64) (calls - rt->last_calls) :
+			       0;
+      rt->last_vectors = vectors;
+      rt->last_calls = calls;
+      rt->rx_rate = 0;
+    }
+
+  /* Number of queues each interface has on each thread */
+  pool_foreach (rxq, im->hw_if_rx_queues)
+    {
+      hi = vnet_get_hw_interface (vnm, rxq->hw_if_index);
+      vec_validate (n_queues_by_sw_if_index[rxq->thread_index],
+		    hi->sw_if_index);
+      n_queues_by_sw_if_index[rxq->thread_index][hi->sw_if_index]++;
+    }
+
+  /* Rate of an interface on a thread, split between its queues there */
+  vec_validate (rbm->rx_rate_by_queue, pool_len (im->hw_if_rx_queues));
+  pool_foreach (rxq, im->hw_if_rx_queues)
+    {
+      u32 ti = rxq->thread_index, sw_if_index;
+      u64 packets = 0, *last;
+
+      hi = vnet_get_hw_interface (vnm, rxq->hw_if_index);
+      sw_if_index = hi->sw_if_index;
+      rt = rbm->threads + ti;
+      n_queues = n_queues_by_sw_if_index[ti];
+
+      if (sw_if_index < vec_len (cm->counters[ti]))
+	packets = cm->counters[ti][sw_if_index].packets;
+
+      vec_validate (rt->last_rx_packets_by_sw_if_index, sw_if_index);
+      last = rt->last_rx_packets_by_sw_if_index + sw_if_index;
+
+      rbm->rx_rate_by_queue[rxq - im->hw_if_rx_queues] =
+	packets > last[0] ?
+	  (f64) (packets - last[0]) / dt / n_queues[sw_if_index] :
+	  0;
+      rt->rx_rate += rbm->rx_rate_by_queue[rxq - im->hw_if_rx_queues];
+    }
+
+  /*
+   * Snapshot the counters on every thread, not just the polling one, so a
+   * queue moving to another thread does not show up as a burst
+   */
+  pool_foreach (rxq, im->hw_if_rx_queues)
+    {
+      u32 sw_if_index;
+
+      hi = vnet_get_hw_interface (vnm, rxq->hw_if_index);
+      sw_if_index = hi->sw_if_index;
+      vec_foreach (rt, rbm->threads)
+	{
+	  i = rt - rbm->threads;
+	  vec_validate (rt->last_rx_packets_by_sw_if_index, sw_if_index);
+	  rt->last_rx_packets_by_sw_if_index[sw_if_index] =
+	    sw_if_index < vec_len (cm->counters[i]) ?
+	      cm->counters[i][sw_if_index].packets :
+	      0;
+	}
+    }
+
+  for (i = 0; i < vec_len (n_queues_by_sw_if_index); i++)
+    vec_free (n_queues_by_sw_if_index[i]);
+  vec_free (n_queues_by_sw_if_index);
+}
+
+static int
+rx_balance_move_one (vlib_main_t *vm, u32 from, u32 to)
+{
+  rx_balance_main_t *rbm = &rx_balance_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_interface_main_t *im = &vnm->interface_main;
+  vnet_hw_if_rx_queue_t *rxq, *best = 0;
+  f64 gap, target, rate, dist, best_dist = 0;
+  u32 n_queues = 0;
+  u32 to_numa = vlib_get_main_by_index (to)->numa_node;
+
+  pool_foreach (rxq, im->hw_if_rx_queues)
+    if (rxq->thread_index == from)
+      n_queues++;
+
+  /* Moving the only queue of a worker just moves the hot spot */
+  if (n_queues < 2)
+    return 0;
+
+  /*
+   * Pick the queue whose rate is closest to half the gap between the two
+   * workers. Anything below the full gap narrows it.
+   */
+  gap = rbm->threads[from].rx_rate - rbm->threads[to].rx_rate;
+  target = gap / 2;
+
+  pool_foreach (rxq, im->hw_if_rx_queues)
+    {
+      if (rxq->thread_index != from)
+	continue;
+
+      if (vnet_hw_if_get_rx_queue_numa_node (
+	    vnm, rxq - im->hw_if_rx_queues) != to_numa)
+	continue;
+
+      rate = rbm->rx_rate_by_queue[rxq - im->hw_if_rx_queues];
+      if (rate <= 0 || rate >= gap)
+	continue;
+
+      dist = rate > target ? rate - target : target - rate;
+      if (!best || dist < best_dist)
+	{
+	  best = rxq;
+	  best_dist = dist;
+	}
+    }
+
+  if (!best)
+    return 0;
+
+  /* *INDENT-OFF* */
+  ELOG_TYPE_DECLARE (e) = {
+    .format = "rx-balance: hw_if_index %d queue %d thread %d -> %d",
+    .format_args = "i4i4i4i4",
+  };
+  /* *INDENT-ON* */
+  struct
+  {
+    u32 hw_if_index, queue_id, from, to;
+  } *ed;
+
+  ed = ELOG_DATA (&vlib_global_main.elog_main, e);
+  ed->hw_if_index = best->hw_if_index;
+  ed->queue_id = best->queue_id;
+  ed->from = from;
+  ed->to = to;
+
+  log_notice ("moving %v queue %u from thread %u to thread %u (%.0f pps, "
+	      "vectors/call %.2f -> %.2f)",
+	      vnet_get_hw_interface (vnm, best->hw_if_index)->name,
+	      best->queue_id, from, to,
+	      rbm->rx_rate_by_queue[best - im->hw_if_rx_queues],
+	      rbm->threads[from].vectors_per_call,
+	      rbm->threads[to].vectors_per_call);
+
+  vnet_hw_if_set_rx_queue_thread_index (vnm, best - im->hw_if_rx_queues, to);
+  vnet_hw_if_update_runtime_data (vnm, best->hw_if_index);
+
+  return 1;
+}
+
+static void
+rx_balance_run (vlib_main_t *vm, f64 now)
+{
+  rx_balance_main_t *rbm = &rx_balance_main;
+  vnet_device_main_t *vdm = &vnet_device_main;
+  u32 i, busiest = ~0, idlest = ~0;
+  f64 vpc;
+
+  for (i = vdm->first_worker_thread_index; i <= vdm->last_worker_thread_index;
+       i++)
+    {
+      vpc = rbm->threads[i].vectors_per_call;
+      if (busiest == ~0 || vpc > rbm->threads[busiest].vectors_per_call)
+	busiest = i;
+      if (idlest == ~0 || vpc < rbm->threads[idlest].vectors_per_call)
+	idlest = i;
+    }
+
+  if (busiest == idlest ||
+      rbm->threads[busiest].vectors_per_call < rbm->high_vectors_per_call ||
+      rbm->threads[idlest].vectors_per_call > rbm->low_vectors_per_call)
+    {
+      rbm->n_imbalanced = 0;
+      return;
+    }
+
+  if (++rbm->n_imbalanced < rbm->n_samples ||
+      now - rbm->last_move < rbm->holddown)
+    return;
+
+  if (rx_balance_move_one (vm, busiest, idlest))
+    {
+      rbm->last_move = now;
+      rbm->n_moves++;
+    }
+  rbm->n_imbalanced = 0;
+}
+
+static uword
+rx_balance_process (vlib_main_t *vm, vlib_node_runtime_t *rt, vlib_frame_t *f)
+{
+  rx_balance_main_t *rbm = &rx_balance_main;
+  f64 last_sample = 0, now;
+
+  while (1)
+    {
+      if (rbm->is_enabled)
+	vlib_process_wait_for_event_or_clock (vm, rbm->interval);
+      else
+	vlib_process_wait_for_event (vm);
+
+      /* Configuration changed, start sampling afresh */
+      if (vlib_process_get_events (vm, 0) != ~0)
+	{
+	  rbm->n_imbalanced = 0;
+	  last_sample = 0;
+	}
+
+      if (!rbm->is_enabled)
+	continue;
+
+      now = vlib_time_now (vm);
+      rx_balance_sample (vm, last_sample ? now - last_sample : rbm->interval);
+
+      /* The first sample only sets the baseline */
+      if (last_sample)
+	rx_balance_run (vm, now);
+      last_sample = now;
+    }
+
+  return 0;
+}
+
+VLIB_REGISTER_NODE (rx_balance_process_node) = {
+  .function = rx_balance_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "rx-balance-process",
+};
+
+static clib_error_t *
+set_interface_rx_balance_fn (vlib_main_t *vm, unformat_input_t *input,
+			     vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  rx_balance_main_t *rbm = &rx_balance_main;
+  vnet_device_main_t *vdm = &vnet_device_main;
+  clib_error_t *error = 0;
+  rx_balance_main_t cfg = *rbm;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "on"))
+	cfg.is_enabled = 1;
+      else if (unformat (line_input, "off"))
+	cfg.is_enabled = 0;
+      else if (unformat (line_input, "interval %f", &cfg.interval))
+	;
+      else if (unformat (line_input, "holddown %f", &cfg.holddown))
+	;
+      else if (unformat (line_input, "high %f", &cfg.high_vectors_per_call))
+	;
+      else if (unformat (line_input, "low %f", &cfg.low_vectors_per_call))
+	;
+      else if (unformat (line_input, "samples %u", &cfg.n_samples))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (cfg.is_enabled &&
+      vdm->last_worker_thread_index <= vdm->first_worker_thread_index)
+    {
+      error = clib_error_return (0, "rx balancing needs at least 2 workers");
+      goto done;
+    }
+
+  if (cfg.interval <= 0 || cfg.holddown < 0 || cfg.n_samples == 0 ||
+      cfg.low_vectors_per_call >= cfg.high_vectors_per_call)
+    {
+      error = clib_error_return (0, "invalid parameters");
+      goto done;
+    }
+
+  rbm->interval = cfg.interval;
+  rbm->holddown = cfg.holddown;
+  rbm->high_vectors_per_call = cfg.high_vectors_per_call;
+  rbm->low_vectors_per_call = cfg.low_vectors_per_call;
+  rbm->n_samples = cfg.n_samples;
+  rbm->is_enabled = cfg.is_enabled;
+
+  vlib_process_signal_event (vm, rx_balance_process_node.index,
+			     RX_BALANCE_EVENT_CONFIG, 0);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Automatically move rx queues from busy to idle workers. A queue is moved
+ * when the busiest worker stays at or above '<em>high</em>' vectors per
+ * call while the least busy one stays at or below '<em>low</em>' for
+ * '<em>samples</em>' consecutive samples, taken every '<em>interval</em>'
+ * seconds. At most one queue is moved per '<em>holddown</em>' seconds.
+ * Decisions are logged and recorded in the event log.
+ *
+ * @cliexpar
+ * @cliexcmd{set interface rx-balance on interval 1 high 128 low 32}
+?*/
+VLIB_CLI_COMMAND (set_interface_rx_balance, static) = {
+  .path = "set interface rx-balance",
+  .short_help = "set interface rx-balance [on|off] [interval <sec>] "
+		"[holddown <sec>] [high <vectors/call>] [low <vectors/call>] "
+		"[samples <n>]",
+  .function = set_interface_rx_balance_fn,
+};
+
+static clib_error_t *
+show_interface_rx_balance_fn (vlib_main_t *vm, unformat_input_t *input,
+			      vlib_cli_command_t *cmd)
+{
+  rx_balance_main_t *rbm = &rx_balance_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_interface_main_t *im = &vnm->interface_main;
+  vnet_hw_if_rx_queue_t *rxq;
+  rx_balance_thread_t *rt;
+
+  vlib_cli_output (vm,
+		   "rx balancing %s, interval %.2fs, holddown %.2fs, "
+		   "high %.2f, low %.2f, samples %u, moves %lu",
+		   rbm->is_enabled ? "on" : "off", rbm->interval,
+		   rbm->holddown, rbm->high_vectors_per_call,
+		   rbm->low_vectors_per_call, rbm->n_samples, rbm->n_moves);
+
+  vec_foreach (rt, rbm->threads)
+    {
+      vlib_cli_output (vm, "Thread %u: vectors/call %.2f, rx %.0f pps",
+		       rt - rbm->threads, rt->vectors_per_call, rt->rx_rate);
+      pool_foreach (rxq, im->hw_if_rx_queues)
+	if (rxq->thread_index == rt - rbm->threads &&
+	    rxq - im->hw_if_rx_queues < vec_len (rbm->rx_rate_by_queue))
+	  vlib_cli_output (
+	    vm, "  %v queue %u: %.0f pps",
+	    vnet_get_hw_interface (vnm, rxq->hw_if_index)->name,
+	    rxq->queue_id, rbm->rx_rate_by_queue[rxq - im->hw_if_rx_queues]);
+    }
+
+  return 0;
+}
+
+VLIB_CLI_COMMAND (show_interface_rx_balance, static) = {
+  .path = "show interface rx-balance",
+  .short_help = "show interface rx-balance",
+  .function = show_interface_rx_balance_fn,
+};
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
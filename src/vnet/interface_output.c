@@ -171,6 +171,37 @@ vnet_interface_output_handle_offload (vlib_main_t *vm, vlib_buffer_t *b)
 			      b->flags & VNET_BUFFER_F_IS_IP6);
 }
 
+/*
+ * A packet left to the device to encrypt must never leave through one
+ * which can't, it would go out with its payload in clear. The buffers
+ * kept are moved to the front, their number is returned.
+ */
+static_always_inline u32
+vnet_interface_output_drop_ipsec_inline (vlib_main_t *vm,
+					 vlib_node_runtime_t *node, u32 *from,
+					 vlib_buffer_t **b, u32 n_buffers)
+{
+  u32 drop[VLIB_FRAME_SIZE], n_drop = 0, n_keep = 0, i;
+
+  for (i = 0; i < n_buffers; i++)
+    {
+      if (PREDICT_FALSE (b[i]->flags & VNET_BUFFER_F_IPSEC_INLINE))
+	drop[n_drop++] = from[i];
+      else
+	{
+	  from[n_keep] = from[i];
+	  b[n_keep++] = b[i];
+	}
+    }
+
+  if (n_drop)
+    vlib_error_drop_buffers (vm, node, drop,
+			     /* buffer stride */ 1, n_drop,
+			     VNET_INTERFACE_OUTPUT_NEXT_DROP, node->node_index,
+			     VNET_INTERFACE_OUTPUT_ERROR_IPSEC_INLINE);
+  return n_keep;
+}
+
 static_always_inline uword
 vnet_interface_output_node_inline (vlib_main_t *vm, u32 sw_if_index,
 				   vlib_combined_counter_main_t *ccm,
@@ -461,6 +492,16 @@ VLIB_NODE_FN (vnet_interface_output_node)
 	node->node_index, VNET_INTERFACE_OUTPUT_ERROR_INTERFACE_DOWN);
     }
 
+  if (PREDICT_FALSE (im->ipsec_inline_offload_used) &&
+      !vnet_get_device_class (vnm, hi->dev_class_index)
+	 ->ipsec_offload_ops_function)
+    {
+      n_buffers = vnet_interface_output_drop_ipsec_inline (vm, node, from,
+							   bufs, n_buffers);
+      if (n_buffers == 0)
+	return frame->n_vectors;
+    }
+
   /* interface-output feature arc handling */
   if (PREDICT_FALSE (vnet_have_features (arc, sw_if_index)))
     {
@@ -494,17 +535,17 @@ VLIB_NODE_FN (vnet_interface_output_node)
   from = vlib_frame_vector_args (frame);
   if (PREDICT_TRUE (next_index == VNET_INTERFACE_OUTPUT_NEXT_TX))
     {
-      enqueu_to_tx_node (vm, node, hi, from, frame->n_vectors);
+      enqueu_to_tx_node (vm, node, hi, from, n_buffers);
     }
   else
     {
       vlib_buffer_enqueue_to_single_next (vm, node, from, next_index,
-					  frame->n_vectors);
+					  n_buffers);
     }
 
   /* Update main interface stats. */
   vlib_increment_combined_counter (ccm, ti, sw_if_index, n_buffers, n_bytes);
-  return n_buffers;
+  return frame->n_vectors;
 }
 
 VLIB_REGISTER_NODE (vnet_interface_output_node) = {
@@ -2098,17 +2098,34 @@ ip_api_hookup (vlib_main_t * vm)
   api_main_t *am = vlibapi_get_main ();
 
   /*
-   * Mark the route add/del API as MP safe
+   * Set up the (msg_name, crc, message-id) table
    */
-  am->is_mp_safe[VL_API_IP_ROUTE_ADD_DEL] = 1;
-  am->is_mp_safe[VL_API_IP_ROUTE_ADD_DEL_REPLY] = 1;
-  am->is_mp_safe[VL_API_IP_ROUTE_ADD_DEL_V2] = 1;
-  am->is_mp_safe[VL_API_IP_ROUTE_ADD_DEL_V2_REPLY] = 1;
+  REPLY_MSG_ID_BASE = setup_message_id_table ();
 
   /*
-   * Set up the (msg_name, crc, message-id) table
+   * Mark the route add/del API as MP safe
    */
-  REPLY_MSG_ID_BASE = setup_message_id_table ();
+  vl_api_set_msg_thread_safe (am, REPLY_MSG_ID_BASE + VL_API_IP_ROUTE_ADD_DEL,
+			      1);
+  vl_api_set_msg_thread_safe (
+    am, REPLY_MSG_ID_BASE + VL_API_IP_ROUTE_ADD_DEL_REPLY, 1);
+  vl_api_set_msg_thread_safe (
+    am, REPLY_MSG_ID_BASE + VL_API_IP_ROUTE_ADD_DEL_V2, 1);
+  vl_api_set_msg_thread_safe (
+    am, REPLY_MSG_ID_BASE + VL_API_IP_ROUTE_ADD_DEL_V2_REPLY, 1);
+
+  /* FIB and interface address state is only written by the main thread */
+  vl_api_set_msg_read_only (am, REPLY_MSG_ID_BASE + VL_API_IP_TABLE_DUMP, 1);
+  vl_api_set_msg_read_only (am, REPLY_MSG_ID_BASE + VL_API_IP_ROUTE_DUMP, 1);
+  vl_api_set_msg_read_only (am, REPLY_MSG_ID_BASE + VL_API_IP_ROUTE_V2_DUMP,
+			    1);
+  vl_api_set_msg_read_only (am, REPLY_MSG_ID_BASE + VL_API_IP_MTABLE_DUMP, 1);
+  vl_api_set_msg_read_only (am, REPLY_MSG_ID_BASE + VL_API_IP_MROUTE_DUMP, 1);
+  vl_api_set_msg_read_only (am, REPLY_MSG_ID_BASE + VL_API_IP_ADDRESS_DUMP,
+			    1);
+  vl_api_set_msg_read_only (am, REPLY_MSG_ID_BASE + VL_API_IP_UNNUMBERED_DUMP,
+			    1);
+  vl_api_set_msg_read_only (am, REPLY_MSG_ID_BASE + VL_API_IP_DUMP, 1);
 
   return 0;
 }
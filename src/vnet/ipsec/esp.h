@@ -91,7 +91,6 @@ typedef struct esp_aead_t_
 
 u8 *format_esp_header (u8 * s, va_list * args);
 
-/* TODO seq increment should be atomic to be accessed by multiple workers */
 always_inline int
 esp_seq_advance (ipsec_sa_t * sa)
 {
@@ -117,6 +116,34 @@ esp_seq_advance (ipsec_sa_t * sa)
   return 0;
 }
 
+/*
+ * Upper bound of the sequence numbers a worker reserves at once on a
+ * multi-worker SA. The workers send their reservations concurrently, so
+ * this bounds how far out of order the peer sees them, which must stay
+ * within its anti-replay window.
+ */
+#define ESP_MW_SEQ_RESERVE_MAX 32
+
+/*
+ * Reserve n sequence numbers of a multi-worker SA with a single atomic
+ * add, returns the first of them as seq_hi:seq
+ */
+always_inline u64
+esp_seq_reserve (ipsec_sa_t *sa, u32 n)
+{
+  return clib_atomic_fetch_add_relax (&sa->seq64, n) + 1;
+}
+
+always_inline int
+esp_seq_is_cycled (const ipsec_sa_t *sa, u64 seq)
+{
+  if (!ipsec_sa_is_set_USE_ANTI_REPLAY (sa))
+    return 0;
+  if (ipsec_sa_is_set_USE_ESN (sa))
+    return (seq == 0);
+  return (seq > ESP_SEQ_MAX);
+}
+
 always_inline u16
 esp_aad_fill (u8 *data, const esp_header_t *esp, const ipsec_sa_t *sa,
 	      u32 seq_hi)
@@ -62,6 +62,7 @@ typedef enum
   _ (RX_PKTS, "ESP pkts received")                                            \
   _ (RX_POST_PKTS, "ESP-POST pkts received")                                  \
   _ (HANDOFF, "hand-off")                                                     \
+  _ (INLINE_PKTS, "ESP pkts decrypted by the device")                         \
   _ (DECRYPTION_FAILED, "ESP decryption failed")                              \
   _ (INTEG_ERROR, "Integrity check failed")                                   \
   _ (CRYPTO_ENGINE_ERROR, "crypto engine error (packet dropped)")             \
@@ -782,17 +783,35 @@ esp_decrypt_post_crypto (vlib_main_t *vm, const vlib_node_runtime_t *node,
    * sequence number in the window) which is non-trivial, it can generate
    * a sequence s, s+1, s+2, s+3, ... s+n and nothing will prevent any
    * implementation, sequential or batching, from decrypting these.
+   *
+   * The window of a multi-worker SA is shared with the other workers,
+   * so there the check and the advance are one atomic step.
    */
-  if (ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, pd->seq_hi, true,
-					   NULL))
+  u64 n_lost;
+
+  if (ipsec_sa_is_set_IS_MULTI_WORKER (sa0))
     {
-      b->error = node->errors[ESP_DECRYPT_ERROR_REPLAY];
-      next[0] = ESP_DECRYPT_NEXT_DROP;
-      return;
+      if (ipsec_sa_anti_replay_mw_advance (sa0, pd->seq, pd->seq_hi,
+					   &n_lost))
+	{
+	  b->error = node->errors[ESP_DECRYPT_ERROR_REPLAY];
+	  next[0] = ESP_DECRYPT_NEXT_DROP;
+	  return;
+	}
     }
+  else
+    {
+      if (ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, pd->seq_hi,
+					       true, NULL))
+	{
+	  b->error = node->errors[ESP_DECRYPT_ERROR_REPLAY];
+	  next[0] = ESP_DECRYPT_NEXT_DROP;
+	  return;
+	}
 
-  u64 n_lost =
-    ipsec_sa_anti_replay_advance (sa0, vm->thread_index, pd->seq, pd->seq_hi);
+      n_lost = ipsec_sa_anti_replay_advance (sa0, vm->thread_index, pd->seq,
+					     pd->seq_hi);
+    }
 
   vlib_prefetch_simple_counter (&ipsec_sa_lost_counters, vm->thread_index,
 				pd->sa_index);
@@ -1044,6 +1063,7 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
   esp_decrypt_packet_data2_t pkt_data2[VLIB_FRAME_SIZE], *pd2 = pkt_data2;
   esp_decrypt_packet_data_t cpd = { };
   u32 current_sa_index = ~0, current_sa_bytes = 0, current_sa_pkts = 0;
+  u32 n_inline = 0;
   const u8 esp_sz = sizeof (esp_header_t);
   ipsec_sa_t *sa0 = 0;
   vnet_crypto_op_t _op, *op = &_op;
@@ -1055,13 +1075,11 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
   esp_decrypt_error_t err;
 
   vlib_get_buffers (vm, from, b, n_left);
-  if (!is_async)
-    {
-      vec_reset_length (ptd->crypto_ops);
-      vec_reset_length (ptd->integ_ops);
-      vec_reset_length (ptd->chained_crypto_ops);
-      vec_reset_length (ptd->chained_integ_ops);
-    }
+  /* inline offloaded packets take the sync path in async mode too */
+  vec_reset_length (ptd->crypto_ops);
+  vec_reset_length (ptd->integ_ops);
+  vec_reset_length (ptd->chained_crypto_ops);
+  vec_reset_length (ptd->chained_integ_ops);
   vec_reset_length (ptd->async_frames);
   vec_reset_length (ptd->chunks);
   clib_memset (sync_nexts, -1, sizeof (sync_nexts));
@@ -1069,7 +1087,7 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 
   while (n_left > 0)
     {
-      u8 *payload;
+      u8 *payload, is_inline = 0;
 
       err = ESP_DECRYPT_ERROR_RX_PKTS;
       if (n_left > 2)
@@ -1112,7 +1130,9 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	  is_async = im->async_mode | ipsec_sa_is_set_IS_ASYNC (sa0);
 	}
 
-      if (PREDICT_FALSE (~0 == sa0->thread_index))
+      /* a multi-worker SA is never claimed by, nor handed off to, a thread */
+      if (PREDICT_FALSE (~0 == sa0->thread_index) &&
+	  !(cpd.flags & IPSEC_SA_FLAG_IS_MULTI_WORKER))
 	{
 	  /* this is the first packet to use this SA, claim the SA
 	   * for this thread. this could happen simultaneously on
@@ -1121,7 +1141,8 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 				    ipsec_sa_assign_thread (thread_index));
 	}
 
-      if (PREDICT_FALSE (thread_index != sa0->thread_index))
+      if (PREDICT_FALSE (thread_index != sa0->thread_index) &&
+	  !(cpd.flags & IPSEC_SA_FLAG_IS_MULTI_WORKER))
 	{
 	  vnet_buffer (b[0])->ipsec.thread_index = sa0->thread_index;
 	  err = ESP_DECRYPT_ERROR_HANDOFF;
@@ -1160,8 +1181,10 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
       pd->current_length = b[0]->current_length;
 
       /* anti-reply check */
-      if (ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, ~0, false,
-					       &pd->seq_hi))
+      if (PREDICT_FALSE (cpd.flags & IPSEC_SA_FLAG_IS_MULTI_WORKER) ?
+	    ipsec_sa_anti_replay_mw_check (sa0, pd->seq, &pd->seq_hi) :
+	    ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, ~0, false,
+						 &pd->seq_hi))
 	{
 	  err = ESP_DECRYPT_ERROR_REPLAY;
 	  esp_set_next_index (b[0], node, err, n_noop, noop_nexts,
@@ -1181,6 +1204,20 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
       current_sa_pkts += 1;
       current_sa_bytes += vlib_buffer_length_in_chain (vm, b[0]);
 
+      /* the device has decrypted and authenticated the packet already,
+       * trust it only while the SA is offloaded, otherwise the software
+       * transform fails it */
+      if (PREDICT_FALSE (b[0]->flags & VNET_BUFFER_F_IPSEC_INLINE))
+	{
+	  b[0]->flags &= ~VNET_BUFFER_F_IPSEC_INLINE;
+	  is_inline = !!(cpd.flags & IPSEC_SA_FLAG_IS_INLINE_OFFLOAD);
+	  if (is_inline)
+	    {
+	      n_inline++;
+	      goto next;
+	    }
+	}
+
       if (is_async)
 	{
 	  async_op = sa0->crypto_async_dec_op_id;
@@ -1218,7 +1255,7 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	  n_noop++;
 	  noop_next++;
 	}
-      else if (!is_async)
+      else if (!is_async || is_inline)
 	{
 	  sync_bi[n_sync] = from[b - bufs];
 	  sync_bufs[n_sync] = b[0];
@@ -1334,6 +1371,9 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 
   vlib_node_increment_counter (vm, node->node_index, ESP_DECRYPT_ERROR_RX_PKTS,
 			       from_frame->n_vectors);
+  if (n_inline)
+    vlib_node_increment_counter (vm, node->node_index,
+				 ESP_DECRYPT_ERROR_INLINE_PKTS, n_inline);
 
   if (n_sync)
     vlib_buffer_enqueue_to_next (vm, node, sync_bi, sync_nexts, n_sync);
@@ -24,6 +24,7 @@
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/ipsec_tun.h>
 #include <vnet/ipsec/esp.h>
+#include <vnet/ipsec/ipsec_offload.h>
 #include <vnet/tunnel/tunnel_dp.h>
 
 #define foreach_esp_encrypt_next                                              \
@@ -47,6 +48,7 @@ typedef enum
   _ (RX_PKTS, "ESP pkts received")                                            \
   _ (POST_RX_PKTS, "ESP-post pkts received")                                  \
   _ (HANDOFF, "Hand-off")                                                     \
+  _ (INLINE_PKTS, "ESP pkts offloaded to the device")                         \
   _ (SEQ_CYCLED, "sequence number cycled (packet dropped)")                   \
   _ (CRYPTO_ENGINE_ERROR, "crypto engine error (packet dropped)")             \
   _ (CRYPTO_QUEUE_FULL, "crypto queue full (packet dropped)")                 \
@@ -293,6 +295,43 @@ esp_process_ops (vlib_main_t * vm, vlib_node_runtime_t * node,
     }
 }
 
+/*
+ * a CTR/GCM IV only has to be unique for the key. The per SA counter may
+ * only be incremented by the SA's thread, so a multi-worker SA uses its
+ * sequence number instead, which is reserved atomically
+ */
+static_always_inline u64
+esp_ctr_iv (ipsec_sa_t *sa, u64 seq)
+{
+  if (ipsec_sa_is_set_IS_MULTI_WORKER (sa))
+    return seq;
+  return sa->ctr_iv_counter++;
+}
+
+/*
+ * the device does the transform on transmit, leave it what it needs to find
+ * and complete the ESP packet, see ipsec_offload.h
+ */
+static_always_inline void
+esp_prepare_inline_offload (ipsec_sa_t *sa0, u64 seq, vlib_buffer_t *b,
+			    esp_header_t *esp, u8 *payload, u16 payload_len,
+			    u8 iv_sz, u8 icv_sz)
+{
+  if (ipsec_sa_is_set_IS_CTR (sa0))
+    {
+      ASSERT (sizeof (u64) == iv_sz);
+      clib_mem_unaligned (payload - iv_sz, u64) =
+	clib_host_to_net_u64 (esp_ctr_iv (sa0, seq));
+    }
+
+  if (ipsec_sa_is_set_USE_ESN (sa0) && icv_sz >= sizeof (u32))
+    clib_mem_unaligned (payload + payload_len - icv_sz, u32) =
+      clib_host_to_net_u32 (seq >> 32);
+
+  vnet_buffer (b)->l4_hdr_offset = (u8 *) esp - b->data;
+  b->flags |= VNET_BUFFER_F_IPSEC_INLINE;
+}
+
 static_always_inline u32
 esp_encrypt_chain_crypto (vlib_main_t * vm, ipsec_per_thread_data_t * ptd,
 			  ipsec_sa_t * sa0, vlib_buffer_t * b,
@@ -332,7 +371,7 @@ esp_encrypt_chain_crypto (vlib_main_t * vm, ipsec_per_thread_data_t * ptd,
 
 static_always_inline u32
 esp_encrypt_chain_integ (vlib_main_t * vm, ipsec_per_thread_data_t * ptd,
-			 ipsec_sa_t * sa0, vlib_buffer_t * b,
+			 ipsec_sa_t * sa0, u32 seq_hi, vlib_buffer_t * b,
 			 vlib_buffer_t * lb, u8 icv_sz, u8 * start,
 			 u32 start_len, u8 * digest, u16 * n_ch)
 {
@@ -354,8 +393,8 @@ esp_encrypt_chain_integ (vlib_main_t * vm, ipsec_per_thread_data_t * ptd,
 	  total_len += ch->len = cb->current_length - icv_sz;
 	  if (ipsec_sa_is_set_USE_ESN (sa0))
 	    {
-	      u32 seq_hi = clib_net_to_host_u32 (sa0->seq_hi);
-	      clib_memcpy_fast (digest, &seq_hi, sizeof (seq_hi));
+	      u32 tmp = clib_net_to_host_u32 (seq_hi);
+	      clib_memcpy_fast (digest, &tmp, sizeof (seq_hi));
 	      ch->len += sizeof (seq_hi);
 	      total_len += sizeof (seq_hi);
 	    }
@@ -379,11 +418,13 @@ esp_encrypt_chain_integ (vlib_main_t * vm, ipsec_per_thread_data_t * ptd,
 always_inline void
 esp_prepare_sync_op (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 		     vnet_crypto_op_t **crypto_ops,
-		     vnet_crypto_op_t **integ_ops, ipsec_sa_t *sa0, u32 seq_hi,
+		     vnet_crypto_op_t **integ_ops, ipsec_sa_t *sa0, u64 seq,
 		     u8 *payload, u16 payload_len, u8 iv_sz, u8 icv_sz, u32 bi,
 		     vlib_buffer_t **b, vlib_buffer_t *lb, u32 hdr_len,
 		     esp_header_t *esp)
 {
+  u32 seq_hi = seq >> 32;
+
   if (sa0->crypto_enc_op_id)
     {
       vnet_crypto_op_t *op;
@@ -418,7 +459,7 @@ esp_prepare_sync_op (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 	    }
 
 	  nonce->salt = sa0->salt;
-	  nonce->iv = *pkt_iv = clib_host_to_net_u64 (sa0->ctr_iv_counter++);
+	  nonce->iv = *pkt_iv = clib_host_to_net_u64 (esp_ctr_iv (sa0, seq));
 	  op->iv = (u8 *) nonce;
 	}
       else
@@ -457,7 +498,7 @@ esp_prepare_sync_op (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 	  op->chunk_index = vec_len (ptd->chunks);
 	  op->digest = vlib_buffer_get_tail (lb) - icv_sz;
 
-	  esp_encrypt_chain_integ (vm, ptd, sa0, b[0], lb, icv_sz,
+	  esp_encrypt_chain_integ (vm, ptd, sa0, seq_hi, b[0], lb, icv_sz,
 				   payload - iv_sz - sizeof (esp_header_t),
 				   payload_len + iv_sz +
 				   sizeof (esp_header_t), op->digest,
@@ -475,10 +516,10 @@ esp_prepare_sync_op (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 static_always_inline void
 esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 			 vnet_crypto_async_frame_t *async_frame,
-			 ipsec_sa_t *sa, vlib_buffer_t *b, esp_header_t *esp,
-			 u8 *payload, u32 payload_len, u8 iv_sz, u8 icv_sz,
-			 u32 bi, u16 next, u32 hdr_len, u16 async_next,
-			 vlib_buffer_t *lb)
+			 ipsec_sa_t *sa, u64 seq, vlib_buffer_t *b,
+			 esp_header_t *esp, u8 *payload, u32 payload_len,
+			 u8 iv_sz, u8 icv_sz, u32 bi, u16 next, u32 hdr_len,
+			 u16 async_next, vlib_buffer_t *lb)
 {
   esp_post_data_t *post = esp_post_data (b);
   u8 *tag, *iv, *aad = 0;
@@ -486,6 +527,7 @@ esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
   u32 key_index;
   i16 crypto_start_offset, integ_start_offset = 0;
   u16 crypto_total_len, integ_total_len;
+  u32 seq_hi = seq >> 32;
 
   post->next_index = next;
 
@@ -508,7 +550,7 @@ esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 	{
 	  /* constuct aad in a scratch space in front of the nonce */
 	  aad = (u8 *) nonce - sizeof (esp_aead_t);
-	  esp_aad_fill (aad, esp, sa, sa->seq_hi);
+	  esp_aad_fill (aad, esp, sa, seq_hi);
 	  key_index = sa->crypto_key_index;
 	}
       else
@@ -517,7 +559,7 @@ esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 	}
 
       nonce->salt = sa->salt;
-      nonce->iv = *pkt_iv = clib_host_to_net_u64 (sa->ctr_iv_counter++);
+      nonce->iv = *pkt_iv = clib_host_to_net_u64 (esp_ctr_iv (sa, seq));
       iv = (u8 *) nonce;
     }
   else
@@ -543,14 +585,14 @@ esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
       if (b != lb)
 	{
 	  integ_total_len = esp_encrypt_chain_integ (
-	    vm, ptd, sa, b, lb, icv_sz,
+	    vm, ptd, sa, seq_hi, b, lb, icv_sz,
 	    payload - iv_sz - sizeof (esp_header_t),
 	    payload_len + iv_sz + sizeof (esp_header_t), tag, 0);
 	}
       else if (ipsec_sa_is_set_USE_ESN (sa))
 	{
-	  u32 seq_hi = clib_net_to_host_u32 (sa->seq_hi);
-	  clib_memcpy_fast (tag, &seq_hi, sizeof (seq_hi));
+	  u32 tmp = clib_net_to_host_u32 (seq_hi);
+	  clib_memcpy_fast (tag, &tmp, sizeof (seq_hi));
 	  integ_total_len += sizeof (seq_hi);
 	}
     }
@@ -562,12 +604,35 @@ esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 				  async_next, iv, tag, aad, flag);
 }
 
+/* number of packets from b[0] on using sa_index, at most
+ * ESP_MW_SEQ_RESERVE_MAX */
+static_always_inline u32
+esp_encrypt_mw_run_length (vlib_buffer_t **b, u32 n_left, u32 sa_index,
+			   int is_tun)
+{
+  u32 n, sai;
+
+  n_left = clib_min (n_left, ESP_MW_SEQ_RESERVE_MAX);
+  for (n = 1; n < n_left; n++)
+    {
+      if (is_tun)
+	sai = ipsec_tun_protect_get_sa_out (
+	  vnet_buffer (b[n])->ip.adj_index[VLIB_TX]);
+      else
+	sai = vnet_buffer (b[n])->ipsec.sad_index;
+      if (sai != sa_index)
+	break;
+    }
+  return n;
+}
+
 always_inline uword
 esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 		    vlib_frame_t *frame, vnet_link_t lt, int is_tun,
 		    u16 async_next_node)
 {
   ipsec_main_t *im = &ipsec_main;
+  vnet_main_t *vnm = vnet_get_main ();
   ipsec_per_thread_data_t *ptd = vec_elt_at_index (im->ptd, vm->thread_index);
   u32 *from = vlib_frame_vector_args (frame);
   u32 n_left = frame->n_vectors;
@@ -575,8 +640,9 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
   u32 thread_index = vm->thread_index;
   u16 buffer_data_size = vlib_buffer_get_default_data_size (vm);
   u32 current_sa_index = ~0, current_sa_packets = 0;
-  u32 current_sa_bytes = 0, spi = 0;
-  u8 esp_align = 4, iv_sz = 0, icv_sz = 0;
+  u32 current_sa_bytes = 0, spi = 0, n_inline = 0;
+  u64 seq = 0, mw_seq = 0, mw_seq_end = 0;
+  u8 esp_align = 4, iv_sz = 0, icv_sz = 0, is_mw = 0, is_inline = 0;
   ipsec_sa_t *sa0 = 0;
   vlib_buffer_t *lb;
   vnet_crypto_op_t **crypto_ops = &ptd->crypto_ops;
@@ -664,9 +730,12 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	  icv_sz = sa0->integ_icv_size;
 	  iv_sz = sa0->crypto_iv_size;
 	  is_async = im->async_mode | ipsec_sa_is_set_IS_ASYNC (sa0);
+	  is_mw = ipsec_sa_is_set_IS_MULTI_WORKER (sa0);
+	  mw_seq = mw_seq_end = 0;
 	}
 
-      if (PREDICT_FALSE (~0 == sa0->thread_index))
+      /* a multi-worker SA is never claimed by, nor handed off to, a thread */
+      if (PREDICT_FALSE (~0 == sa0->thread_index) && !is_mw)
 	{
 	  /* this is the first packet to use this SA, claim the SA
 	   * for this thread. this could happen simultaneously on
@@ -675,7 +744,7 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 				    ipsec_sa_assign_thread (thread_index));
 	}
 
-      if (PREDICT_FALSE (thread_index != sa0->thread_index))
+      if (PREDICT_FALSE (thread_index != sa0->thread_index) && !is_mw)
 	{
 	  vnet_buffer (b[0])->ipsec.thread_index = sa0->thread_index;
 	  err = ESP_ENCRYPT_ERROR_HANDOFF;
@@ -700,11 +769,37 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	    lb = vlib_get_buffer (vm, lb->next_buffer);
 	}
 
-      if (PREDICT_FALSE (esp_seq_advance (sa0)))
+      if (is_mw)
 	{
-	  err = ESP_ENCRYPT_ERROR_SEQ_CYCLED;
-	  esp_set_next_index (b[0], node, err, n_noop, noop_nexts, drop_next);
-	  goto trace;
+	  /* reserve sequence numbers for the run of packets using this SA
+	   * at once, a number left unused by a dropped packet is skipped */
+	  if (mw_seq == mw_seq_end)
+	    {
+	      u32 n_run =
+		esp_encrypt_mw_run_length (b, n_left, sa_index0, is_tun);
+	      mw_seq = esp_seq_reserve (sa0, n_run);
+	      mw_seq_end = mw_seq + n_run;
+	    }
+	  seq = mw_seq++;
+
+	  if (PREDICT_FALSE (esp_seq_is_cycled (sa0, seq)))
+	    {
+	      err = ESP_ENCRYPT_ERROR_SEQ_CYCLED;
+	      esp_set_next_index (b[0], node, err, n_noop, noop_nexts,
+				  drop_next);
+	      goto trace;
+	    }
+	}
+      else
+	{
+	  if (PREDICT_FALSE (esp_seq_advance (sa0)))
+	    {
+	      err = ESP_ENCRYPT_ERROR_SEQ_CYCLED;
+	      esp_set_next_index (b[0], node, err, n_noop, noop_nexts,
+				  drop_next);
+	      goto trace;
+	    }
+	  seq = sa0->seq64;
 	}
 
       /* space for IV */
@@ -933,9 +1028,24 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	}
 
       esp->spi = spi;
-      esp->seq = clib_net_to_host_u32 (sa0->seq);
-
-      if (is_async)
+      esp->seq = clib_net_to_host_u32 ((u32) seq);
+
+      /* the device only encrypts what it sends, anything forwarded
+       * elsewhere is encrypted here */
+      is_inline =
+	ipsec_sa_is_set_IS_INLINE_OFFLOAD (sa0) && lb == b[0] &&
+	(ipsec_sa_is_set_IS_TUNNEL (sa0) && !is_tun ?
+	   ipsec_offload_dpo_is_tx (vnm, &sa0->dpo, sa0->offload_hw_if_index) :
+	   ipsec_offload_adj_is_tx (
+	     vnm, vnet_buffer (b[0])->ip.adj_index[VLIB_TX],
+	     sa0->offload_hw_if_index));
+      if (PREDICT_FALSE (is_inline))
+	{
+	  esp_prepare_inline_offload (sa0, seq, b[0], esp, payload,
+				      payload_len, iv_sz, icv_sz);
+	  n_inline++;
+	}
+      else if (is_async)
 	{
 	  async_op = sa0->crypto_async_enc_op_id;
 
@@ -950,15 +1060,15 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	      vec_add1 (ptd->async_frames, async_frames[async_op]);
 	    }
 
-	  esp_prepare_async_frame (vm, ptd, async_frames[async_op], sa0, b[0],
-				   esp, payload, payload_len, iv_sz, icv_sz,
-				   from[b - bufs], sync_next[0], hdr_len,
-				   async_next_node, lb);
+	  esp_prepare_async_frame (vm, ptd, async_frames[async_op], sa0, seq,
+				   b[0], esp, payload, payload_len, iv_sz,
+				   icv_sz, from[b - bufs], sync_next[0],
+				   hdr_len, async_next_node, lb);
 	}
       else
-	esp_prepare_sync_op (vm, ptd, crypto_ops, integ_ops, sa0, sa0->seq_hi,
-			     payload, payload_len, iv_sz, icv_sz, n_sync, b,
-			     lb, hdr_len, esp);
+	esp_prepare_sync_op (vm, ptd, crypto_ops, integ_ops, sa0, seq, payload,
+			     payload_len, iv_sz, icv_sz, n_sync, b, lb,
+			     hdr_len, esp);
 
       vlib_buffer_advance (b[0], 0LL - hdr_len);
 
@@ -972,8 +1082,10 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 						    sizeof (*tr));
 	  tr->sa_index = sa_index0;
 	  tr->spi = sa0->spi;
-	  tr->seq = sa0->seq;
-	  tr->sa_seq_hi = sa0->seq_hi;
+	  if (!is_mw)
+	    seq = sa0->seq64;
+	  tr->seq = (u32) seq;
+	  tr->sa_seq_hi = seq >> 32;
 	  tr->udp_encap = ipsec_sa_is_set_UDP_ENCAP (sa0);
 	  tr->crypto_alg = sa0->crypto_alg;
 	  tr->integ_alg = sa0->integ_alg;
@@ -986,7 +1098,7 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	  n_noop++;
 	  noop_next++;
 	}
-      else if (!is_async)
+      else if (!is_async || is_inline)
 	{
 	  sync_bi[n_sync] = from[b - bufs];
 	  sync_bufs[n_sync] = b[0];
@@ -1041,6 +1153,9 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 
   vlib_node_increment_counter (vm, node->node_index, ESP_ENCRYPT_ERROR_RX_PKTS,
 			       frame->n_vectors);
+  if (n_inline)
+    vlib_node_increment_counter (vm, node->node_index,
+				 ESP_ENCRYPT_ERROR_INLINE_PKTS, n_inline);
 
   return frame->n_vectors;
 }
@@ -32,6 +32,7 @@
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/ipsec_tun.h>
 #include <vnet/ipsec/ipsec_itf.h>
+#include <vnet/ipsec/ipsec_offload.h>
 
 #include <vnet/format_fns.h>
 #include <vnet/ipsec/ipsec.api_enum.h>
@@ -1116,6 +1117,39 @@ vl_api_ipsec_set_async_mode_t_handler (vl_api_ipsec_set_async_mode_t * mp)
   REPLY_MACRO (VL_API_IPSEC_SET_ASYNC_MODE_REPLY);
 }
 
+static void
+vl_api_ipsec_sa_offload_enable_disable_t_handler (
+  vl_api_ipsec_sa_offload_enable_disable_t *mp)
+{
+  vl_api_ipsec_sa_offload_enable_disable_reply_t *rmp;
+  vnet_main_t *vnm = vnet_get_main ();
+  ipsec_main_t *im = &ipsec_main;
+  u32 sw_if_index;
+  int rv = 0;
+  uword *p;
+
+  p = hash_get (im->sa_index_by_sa_id, ntohl (mp->sa_id));
+  if (!p)
+    {
+      rv = VNET_API_ERROR_NO_SUCH_ENTRY;
+      goto out;
+    }
+
+  if (mp->enable)
+    {
+      VALIDATE_SW_IF_INDEX (mp);
+      sw_if_index = ntohl (mp->sw_if_index);
+      rv = ipsec_sa_offload_enable (
+	vnm, p[0], vnet_get_sup_hw_interface (vnm, sw_if_index)->hw_if_index);
+      BAD_SW_IF_INDEX_LABEL;
+    }
+  else
+    rv = ipsec_sa_offload_disable (vnm, p[0]);
+
+out:
+  REPLY_MACRO (VL_API_IPSEC_SA_OFFLOAD_ENABLE_DISABLE_REPLY);
+}
+
 #include <vnet/ipsec/ipsec.api.c>
 static clib_error_t *
 ipsec_api_hookup (vlib_main_t * vm)
@@ -24,6 +24,7 @@
 
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/ipsec_tun.h>
+#include <vnet/ipsec/ipsec_offload.h>
 
 static clib_error_t *
 set_interface_spd_command_fn (vlib_main_t * vm,
@@ -163,6 +164,8 @@ ipsec_sa_add_del_command_fn (vlib_main_t * vm,
 	flags |= IPSEC_SA_FLAG_UDP_ENCAP;
       else if (unformat (line_input, "async"))
 	flags |= IPSEC_SA_FLAG_IS_ASYNC;
+      else if (unformat (line_input, "multi-worker"))
+	flags |= IPSEC_SA_FLAG_IS_MULTI_WORKER;
       else
 	{
 	  error = clib_error_return (0, "parse error: '%U'",
@@ -951,6 +954,76 @@ VLIB_CLI_COMMAND (set_async_mode_command, static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+ipsec_offload_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			  vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  ipsec_main_t *im = &ipsec_main;
+  u32 id = ~0, sw_if_index = ~0;
+  clib_error_t *error = NULL;
+  int is_enable = 1, rv;
+  uword *p;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "sa %u", &id))
+	;
+      else if (unformat (line_input, "disable"))
+	is_enable = 0;
+      else if (unformat (line_input, "%U", unformat_vnet_sw_interface, vnm,
+			 &sw_if_index))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  p = hash_get (im->sa_index_by_sa_id, id);
+  if (!p)
+    {
+      error = clib_error_return (0, "no such SA %u", id);
+      goto done;
+    }
+
+  if (is_enable)
+    {
+      if (~0 == sw_if_index)
+	{
+	  error = clib_error_return (0, "interface required");
+	  goto done;
+	}
+      rv = ipsec_sa_offload_enable (
+	vnm, p[0], vnet_get_sup_hw_interface (vnm, sw_if_index)->hw_if_index);
+    }
+  else
+    rv = ipsec_sa_offload_disable (vnm, p[0]);
+
+  if (rv)
+    error = clib_error_return (0, "offload %s failed: %U",
+			       is_enable ? "enable" : "disable",
+			       format_vnet_api_errno, rv);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (ipsec_offload_command, static) = {
+    .path = "ipsec offload",
+    .short_help = "ipsec offload sa <id> [<interface>] [disable]",
+    .function = ipsec_offload_command_fn,
+};
+/* *INDENT-ON* */
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -294,8 +294,15 @@ format_ipsec_sa (u8 * s, va_list * args)
   s = format (s, "\n   salt 0x%x", clib_net_to_host_u32 (sa->salt));
   s = format (s, "\n   thread-index:%d", sa->thread_index);
   s = format (s, "\n   seq %u seq-hi %u", sa->seq, sa->seq_hi);
-  s = format (s, "\n   window %U", format_ipsec_replay_window,
-	      sa->replay_window);
+  if (ipsec_sa_is_set_IS_MULTI_WORKER (sa))
+    s = format (s, "\n   window-ring %U", format_hex_bytes, sa->replay_ring,
+		sizeof (sa->replay_ring));
+  else
+    s = format (s, "\n   window %U", format_ipsec_replay_window,
+		sa->replay_window);
+  if (ipsec_sa_is_set_IS_INLINE_OFFLOAD (sa))
+    s = format (s, "\n   offloaded to %U", format_vnet_hw_if_index_name,
+		vnet_get_main (), sa->offload_hw_if_index);
   s = format (s, "\n   crypto alg %U",
 	      format_ipsec_crypto_alg, sa->crypto_alg);
   if (sa->crypto_alg && (flags & IPSEC_FORMAT_INSECURE))
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/ipsec/ipsec.h>
+#include <vnet/ipsec/ipsec_offload.h>
+
+int
+ipsec_sa_offload_enable (vnet_main_t *vnm, u32 sa_index, u32 hw_if_index)
+{
+  vnet_hw_interface_t *hi;
+  vnet_device_class_t *dev_class;
+  uword private_data = 0;
+  ipsec_sa_t *sa;
+  int rv;
+
+  if (pool_is_free_index (ipsec_sa_pool, sa_index))
+    return VNET_API_ERROR_NO_SUCH_ENTRY;
+
+  if (!vnet_hw_interface_is_valid (vnm, hw_if_index))
+    return VNET_API_ERROR_INVALID_INTERFACE;
+
+  sa = ipsec_sa_get (sa_index);
+
+  /* an SA is offloaded to one device at most */
+  if (ipsec_sa_is_set_IS_INLINE_OFFLOAD (sa))
+    return VNET_API_ERROR_ENTRY_ALREADY_EXISTS;
+
+  if (sa->protocol != IPSEC_PROTOCOL_ESP)
+    return VNET_API_ERROR_UNSUPPORTED;
+
+  hi = vnet_get_hw_interface (vnm, hw_if_index);
+  dev_class = vnet_get_device_class (vnm, hi->dev_class_index);
+
+  if (dev_class->ipsec_offload_ops_function == 0)
+    return VNET_API_ERROR_UNSUPPORTED;
+
+  rv = dev_class->ipsec_offload_ops_function (
+    vnm, VNET_IPSEC_OFFLOAD_DEV_OP_ADD_SA, hi->dev_instance, sa_index,
+    &private_data);
+
+  if (rv)
+    return rv;
+
+  sa->offload_hw_if_index = hw_if_index;
+  sa->offload_private_data = private_data;
+  vnm->interface_main.ipsec_inline_offload_used = 1;
+  sa->flags |= IPSEC_SA_FLAG_IS_INLINE_OFFLOAD;
+  return 0;
+}
+
+int
+ipsec_sa_offload_disable (vnet_main_t *vnm, u32 sa_index)
+{
+  vnet_hw_interface_t *hi;
+  vnet_device_class_t *dev_class;
+  ipsec_sa_t *sa;
+  int rv = 0;
+
+  if (pool_is_free_index (ipsec_sa_pool, sa_index))
+    return VNET_API_ERROR_NO_SUCH_ENTRY;
+
+  sa = ipsec_sa_get (sa_index);
+
+  if (!ipsec_sa_is_set_IS_INLINE_OFFLOAD (sa))
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  /* stop the data-plane from relying on the device first */
+  sa->flags &= ~IPSEC_SA_FLAG_IS_INLINE_OFFLOAD;
+
+  if (vnet_hw_interface_is_valid (vnm, sa->offload_hw_if_index))
+    {
+      hi = vnet_get_hw_interface (vnm, sa->offload_hw_if_index);
+      dev_class = vnet_get_device_class (vnm, hi->dev_class_index);
+      rv = dev_class->ipsec_offload_ops_function (
+	vnm, VNET_IPSEC_OFFLOAD_DEV_OP_DEL_SA, hi->dev_instance, sa_index,
+	&sa->offload_private_data);
+    }
+
+  sa->offload_hw_if_index = ~0;
+  sa->offload_private_data = 0;
+  return rv;
+}
+
+static_always_inline int
+ipsec_offload_sw_op_failed (vnet_crypto_op_t *op)
+{
+  return op->status != VNET_CRYPTO_OP_STATUS_COMPLETED;
+}
+
+int
+ipsec_offload_sw_encrypt (vlib_main_t *vm, u32 sa_index, esp_header_t *esp,
+			  u32 len)
+{
+  ipsec_sa_t *sa = ipsec_sa_get (sa_index);
+  u8 iv_sz = sa->crypto_iv_size, icv_sz = sa->integ_icv_size;
+  u8 *iv = (u8 *) (esp + 1), *payload = iv + iv_sz;
+  u8 *icv = (u8 *) esp + len - icv_sz;
+  esp_ctr_nonce_t nonce;
+  esp_aead_t aad;
+  vnet_crypto_op_t op;
+  u32 seq_hi = 0;
+
+  if (len < sizeof (*esp) + iv_sz + icv_sz)
+    return -1;
+
+  /* the high sequence bits are passed in the ICV space */
+  if (icv_sz >= sizeof (seq_hi))
+    seq_hi = clib_net_to_host_u32 (clib_mem_unaligned (icv, u32));
+
+  if (sa->crypto_enc_op_id)
+    {
+      vnet_crypto_op_init (&op, sa->crypto_enc_op_id);
+      op.key_index = sa->crypto_key_index;
+      op.src = op.dst = payload;
+      op.len = icv - payload;
+
+      if (ipsec_sa_is_set_IS_CTR (sa))
+	{
+	  if (ipsec_sa_is_set_IS_AEAD (sa))
+	    {
+	      op.aad = (u8 *) &aad;
+	      op.aad_len = esp_aad_fill (op.aad, esp, sa, seq_hi);
+	      op.tag = icv;
+	      op.tag_len = 16;
+	    }
+	  else
+	    nonce.ctr = clib_host_to_net_u32 (1);
+	  nonce.salt = sa->salt;
+	  nonce.iv = clib_mem_unaligned (iv, u64);
+	  op.iv = (u8 *) &nonce;
+	}
+      else
+	{
+	  op.iv = iv;
+	  op.flags = VNET_CRYPTO_OP_FLAG_INIT_IV;
+	}
+
+      vnet_crypto_process_ops (vm, &op, 1);
+      if (ipsec_offload_sw_op_failed (&op))
+	return -1;
+    }
+
+  if (sa->integ_op_id)
+    {
+      vnet_crypto_op_init (&op, sa->integ_op_id);
+      op.key_index = sa->integ_key_index;
+      op.src = (u8 *) esp;
+      op.len = icv - (u8 *) esp;
+      op.digest = icv;
+      op.digest_len = icv_sz;
+
+      /* the high sequence bits already follow the data */
+      if (ipsec_sa_is_set_USE_ESN (sa))
+	op.len += sizeof (seq_hi);
+
+      vnet_crypto_process_ops (vm, &op, 1);
+      if (ipsec_offload_sw_op_failed (&op))
+	return -1;
+    }
+
+  return 0;
+}
+
+int
+ipsec_offload_sw_decrypt (vlib_main_t *vm, u32 sa_index, esp_header_t *esp,
+			  u32 len)
+{
+  ipsec_sa_t *sa = ipsec_sa_get (sa_index);
+  u8 iv_sz = sa->crypto_iv_size, icv_sz = sa->integ_icv_size;
+  u8 *iv = (u8 *) (esp + 1), *payload = iv + iv_sz;
+  u8 *icv = (u8 *) esp + len - icv_sz;
+  u8 digest[64];
+  esp_ctr_nonce_t nonce;
+  esp_aead_t aad;
+  vnet_crypto_op_t op;
+  u32 seq, seq_hi;
+
+  if (len < sizeof (*esp) + iv_sz + icv_sz || icv_sz > sizeof (digest))
+    return -1;
+
+  /* the device keeps no replay state, it only needs the sequence number's
+   * high bits; a packet failing the check is left to the software path */
+  seq = clib_net_to_host_u32 (esp->seq);
+  if (ipsec_sa_is_set_IS_MULTI_WORKER (sa) ?
+	ipsec_sa_anti_replay_mw_check (sa, seq, &seq_hi) :
+	ipsec_sa_anti_replay_and_sn_advance (sa, seq, ~0, false, &seq_hi))
+    return -1;
+
+  if (sa->integ_op_id)
+    {
+      vnet_crypto_op_init (&op, sa->integ_op_id);
+      op.key_index = sa->integ_key_index;
+      op.flags = VNET_CRYPTO_OP_FLAG_HMAC_CHECK;
+      op.src = (u8 *) esp;
+      op.len = icv - (u8 *) esp;
+      op.digest = icv;
+      op.digest_len = icv_sz;
+
+      /* the high sequence bits go where the ICV is, which is put back
+       * once checked, the ICV is left in the packet */
+      if (ipsec_sa_is_set_USE_ESN (sa))
+	{
+	  clib_memcpy_fast (digest, icv, icv_sz);
+	  clib_mem_unaligned (icv, u32) = clib_host_to_net_u32 (seq_hi);
+	  op.digest = digest;
+	  op.len += sizeof (seq_hi);
+	}
+
+      vnet_crypto_process_ops (vm, &op, 1);
+
+      if (ipsec_sa_is_set_USE_ESN (sa))
+	clib_memcpy_fast (icv, digest, icv_sz);
+      if (ipsec_offload_sw_op_failed (&op))
+	return -1;
+    }
+
+  if (sa->crypto_dec_op_id)
+    {
+      vnet_crypto_op_init (&op, sa->crypto_dec_op_id);
+      op.key_index = sa->crypto_key_index;
+      op.src = op.dst = payload;
+      op.len = icv - payload;
+      op.iv = iv;
+
+      if (ipsec_sa_is_set_IS_CTR (sa))
+	{
+	  if (ipsec_sa_is_set_IS_AEAD (sa))
+	    {
+	      op.aad = (u8 *) &aad;
+	      op.aad_len = esp_aad_fill (op.aad, esp, sa, seq_hi);
+	      op.tag = icv;
+	      op.tag_len = 16;
+	    }
+	  else
+	    nonce.ctr = clib_host_to_net_u32 (1);
+	  nonce.salt = sa->salt;
+	  nonce.iv = clib_mem_unaligned (iv, u64);
+	  op.iv = (u8 *) &nonce;
+	}
+
+      vnet_crypto_process_ops (vm, &op, 1);
+      if (ipsec_offload_sw_op_failed (&op))
+	return -1;
+    }
+
+  return 0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __IPSEC_OFFLOAD_H__
+#define __IPSEC_OFFLOAD_H__
+
+#include <vnet/ipsec/esp.h>
+#include <vnet/adj/adj.h>
+#include <vnet/dpo/load_balance.h>
+
+/*
+ * Inline IPsec protocol offload.
+ *
+ * An ESP SA can be installed on the network device it is received on, or
+ * sent from, through the device class' ipsec_offload_ops_function.
+ *
+ * Receive: the device looks up the SA by SPI, decrypts and authenticates
+ * the packet and marks the buffer with VNET_BUFFER_F_IPSEC_INLINE. The
+ * ESP header, IV, trailer and ICV are left in place so esp-decrypt only
+ * does the anti-replay check and strips the headers. Packets the device
+ * could not process are left unmarked and take the software path.
+ *
+ * Transmit: esp-encrypt builds the packet but does no crypto. It marks
+ * the buffer with VNET_BUFFER_F_IPSEC_INLINE, leaves the offset of the
+ * ESP header in l4_hdr_offset and, for ESN SAs, the high sequence bits
+ * (in network order) in the ICV space. CTR/GCM IVs are filled in, a CBC
+ * IV is generated by the device. Packets are only left to the device when
+ * they are forwarded through it unchanged, anything else is encrypted in
+ * software. A marked packet reaching another device is dropped by the
+ * interface output node.
+ */
+
+extern int ipsec_sa_offload_enable (vnet_main_t *vnm, u32 sa_index,
+				    u32 hw_if_index);
+extern int ipsec_sa_offload_disable (vnet_main_t *vnm, u32 sa_index);
+
+/*
+ * ESP transforms done in software, for devices standing in for one that
+ * offloads. Both work on a single contiguous ESP packet of len bytes,
+ * starting at the ESP header, and return 0 on success.
+ */
+extern int ipsec_offload_sw_encrypt (vlib_main_t *vm, u32 sa_index,
+				     esp_header_t *esp, u32 len);
+extern int ipsec_offload_sw_decrypt (vlib_main_t *vm, u32 sa_index,
+				     esp_header_t *esp, u32 len);
+
+/* a complete adjacency on the device, not a tunnel on top of it */
+static_always_inline int
+ipsec_offload_rewrite_is_tx (vnet_main_t *vnm, u32 adj_index, u32 hw_if_index)
+{
+  ip_adjacency_t *adj = adj_get (adj_index);
+
+  return (adj->lookup_next_index == IP_LOOKUP_NEXT_REWRITE &&
+	  vnet_get_sup_hw_interface (vnm, adj->rewrite_header.sw_if_index)
+	      ->hw_if_index == hw_if_index);
+}
+
+/* an adjacency, or every bucket of a load-balance, sends through the device */
+static_always_inline int
+ipsec_offload_dpo_is_tx (vnet_main_t *vnm, const dpo_id_t *dpo,
+			 u32 hw_if_index)
+{
+  const load_balance_t *lb;
+  const dpo_id_t *bucket;
+  u32 i;
+
+  if (dpo->dpoi_type == DPO_ADJACENCY)
+    return ipsec_offload_rewrite_is_tx (vnm, dpo->dpoi_index, hw_if_index);
+
+  if (dpo->dpoi_type != DPO_LOAD_BALANCE)
+    return 0;
+
+  lb = load_balance_get (dpo->dpoi_index);
+  for (i = 0; i < lb->lb_n_buckets; i++)
+    {
+      bucket = load_balance_get_bucket_i (lb, i);
+      if (bucket->dpoi_type != DPO_ADJACENCY ||
+	  !ipsec_offload_rewrite_is_tx (vnm, bucket->dpoi_index, hw_if_index))
+	return 0;
+    }
+
+  return 1;
+}
+
+/* the adjacency the packet is sent on, or the one an ipsec tunnel
+ * interface's midchain is stacked on, sends through the device */
+static_always_inline int
+ipsec_offload_adj_is_tx (vnet_main_t *vnm, u32 adj_index, u32 hw_if_index)
+{
+  ip_adjacency_t *adj = adj_get (adj_index);
+
+  if (adj->lookup_next_index == IP_LOOKUP_NEXT_MIDCHAIN)
+    return ipsec_offload_dpo_is_tx (vnm, &adj->sub_type.midchain.next_dpo,
+				    hw_if_index);
+
+  return ipsec_offload_rewrite_is_tx (vnm, adj_index, hw_if_index);
+}
+
+#endif /* __IPSEC_OFFLOAD_H__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -19,6 +19,7 @@
 #include <vnet/fib/fib_table.h>
 #include <vnet/fib/fib_entry_track.h>
 #include <vnet/ipsec/ipsec_tun.h>
+#include <vnet/ipsec/ipsec_offload.h>
 
 /**
  * @brief
@@ -170,6 +171,19 @@ ipsec_sa_set_async_op_ids (ipsec_sa_t * sa)
   /* *INDENT-ON* */
 }
 
+static void
+ipsec_sa_init_replay_ring (ipsec_sa_t *sa)
+{
+  u32 i;
+
+  /* the ring starts out holding the blocks before block 0, all seen, so
+   * none of them is counted as lost; sequence number 0 is never sent */
+  sa->replay_ring[0] = 1;
+  for (i = 1; i < IPSEC_SA_MW_REPLAY_RING_SIZE; i++)
+    sa->replay_ring[i] = (u64) (u32) (i - IPSEC_SA_MW_REPLAY_RING_SIZE) << 32 |
+			 0xffffffff;
+}
+
 int
 ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
 		       ipsec_crypto_alg_t crypto_alg, const ipsec_key_t *ck,
@@ -208,6 +222,9 @@ ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
   sa->flags = flags;
   sa->salt = salt;
   sa->thread_index = (vlib_num_workers ()) ? ~0 : 0;
+  sa->offload_hw_if_index = ~0;
+  if (ipsec_sa_is_set_IS_MULTI_WORKER (sa))
+    ipsec_sa_init_replay_ring (sa);
   if (integ_alg != IPSEC_INTEG_ALG_NONE)
     {
       ipsec_sa_set_integ_alg (sa, integ_alg);
@@ -350,6 +367,9 @@ ipsec_sa_del (ipsec_sa_t * sa)
   /* no recovery possible when deleting an SA */
   (void) ipsec_call_add_del_callbacks (im, sa, sa_index, 0);
 
+  if (ipsec_sa_is_set_IS_INLINE_OFFLOAD (sa))
+    ipsec_sa_offload_disable (vnet_get_main (), sa_index);
+
   if (ipsec_sa_is_set_IS_ASYNC (sa))
     vnet_crypto_request_async_mode (0);
   if (ipsec_sa_is_set_UDP_ENCAP (sa) && ipsec_sa_is_set_IS_INBOUND (sa))
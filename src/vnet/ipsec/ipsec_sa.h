@@ -90,6 +90,8 @@ typedef struct ipsec_key_t_
  * IPsec tunnel mode is IPv6 if non-zero,
  * else IPv4 tunnel only valid if is_tunnel is non-zero
  * enable UDP encapsulation for NAT traversal
+ * SA is used by all workers at once, without handoff to one of them
+ * SA's ESP transform is done inline by the network device
  */
 #define foreach_ipsec_sa_flags                                                \
   _ (0, NONE, "none")                                                         \
@@ -102,7 +104,9 @@ typedef struct ipsec_key_t_
   _ (64, IS_INBOUND, "inbound")                                               \
   _ (128, IS_AEAD, "aead")                                                    \
   _ (256, IS_CTR, "ctr")                                                      \
-  _ (512, IS_ASYNC, "async")
+  _ (512, IS_ASYNC, "async")                                                  \
+  _ (1024, IS_MULTI_WORKER, "multi-worker")                                   \
+  _ (2048, IS_INLINE_OFFLOAD, "inline-offload")
 
 typedef enum ipsec_sad_flags_t_
 {
@@ -113,6 +117,15 @@ typedef enum ipsec_sad_flags_t_
 
 STATIC_ASSERT (sizeof (ipsec_sa_flags_t) == 2, "IPSEC SA flags != 2 byte");
 
+/*
+ * Multi-worker anti-replay window: a ring of words, each holding the
+ * seen bits of one block of 32 sequence numbers in its lower half and
+ * the (truncated) number of that block in its upper half.
+ */
+#define IPSEC_SA_MW_REPLAY_BLOCK_LOG2 5
+#define IPSEC_SA_MW_REPLAY_BLOCK_SIZE (1 << IPSEC_SA_MW_REPLAY_BLOCK_LOG2)
+#define IPSEC_SA_MW_REPLAY_RING_SIZE  4
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -129,8 +142,16 @@ typedef struct
   u32 thread_index;
 
   u32 spi;
-  u32 seq;
-  u32 seq_hi;
+  union
+  {
+    struct
+    {
+      u32 seq;
+      u32 seq_hi;
+    };
+    /* both of the above, updated atomically in multi-worker mode */
+    u64 seq64;
+  };
   u64 replay_window;
   u64 ctr_iv_counter;
   dpo_id_t dpo;
@@ -217,10 +238,20 @@ typedef struct
 
   ipsec_key_t integ_key;
   ipsec_key_t crypto_key;
+
+  /* inline offload: the device doing the transform and its SA state */
+  u32 offload_hw_if_index;
+  uword offload_private_data;
+
+  /* anti-replay window of a multi-worker SA, written by all workers */
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline3);
+  u64 replay_ring[IPSEC_SA_MW_REPLAY_RING_SIZE];
 } ipsec_sa_t;
 
 STATIC_ASSERT_OFFSET_OF (ipsec_sa_t, cacheline1, CLIB_CACHE_LINE_BYTES);
 STATIC_ASSERT_OFFSET_OF (ipsec_sa_t, cacheline2, 2 * CLIB_CACHE_LINE_BYTES);
+STATIC_ASSERT (CLIB_ARCH_IS_LITTLE_ENDIAN,
+	       "seq64 assumes seq is the low half of the 64 bit number");
 
 /**
  * Pool of IPSec SAs
@@ -627,6 +658,124 @@ ipsec_sa_anti_replay_advance (ipsec_sa_t *sa, u32 thread_index, u32 seq,
   return n_lost;
 }
 
+/*
+ * Multi-worker anti-replay
+ *  An SA with the multi-worker flag is processed by any worker, so
+ *  seq/seq_hi and the window can not be single-writer. seq64 holds the
+ *  highest sequence number received and is only ever raised with a CAS.
+ *  The window is kept in replay_ring; a packet's bit is set, and if need
+ *  be its ring word is claimed for a newer block, with a single CAS.
+ *  A word holding a newer block than the packet's means the packet is
+ *  older than the window, so a duplicate can never be accepted twice.
+ *  Lost packets are counted when a block leaves the ring.
+ */
+STATIC_ASSERT (IPSEC_SA_MW_REPLAY_BLOCK_SIZE * IPSEC_SA_MW_REPLAY_RING_SIZE >=
+		 IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE +
+		   IPSEC_SA_MW_REPLAY_BLOCK_SIZE,
+	       "multi-worker replay ring smaller than the window");
+
+always_inline u32
+ipsec_sa_anti_replay_mw_seq_hi (const ipsec_sa_t *sa, u64 top, u32 seq)
+{
+  u32 tl = (u32) top, th = top >> 32;
+
+  if (!ipsec_sa_is_set_USE_ESN (sa))
+    return 0;
+
+  /* RFC4303 Appendix A, as in ipsec_sa_anti_replay_and_sn_advance */
+  if (tl >= IPSEC_SA_ANTI_REPLAY_WINDOW_MAX_INDEX)
+    return (seq >= IPSEC_SA_ANTI_REPLAY_WINDOW_LOWER_BOUND (tl)) ? th :
+								     th + 1;
+  return (seq >= IPSEC_SA_ANTI_REPLAY_WINDOW_LOWER_BOUND (tl)) ? th - 1 : th;
+}
+
+/*
+ * Pre-decrypt check of a multi-worker SA, returns the hi-seq number
+ * that should be used to decrypt. Returns non-zero if the packet is a
+ * replay or falls behind the window.
+ */
+always_inline int
+ipsec_sa_anti_replay_mw_check (const ipsec_sa_t *sa, u32 seq, u32 *hi_seq_req)
+{
+  u64 top = clib_atomic_load_relax_n (&sa->seq64);
+  u64 seq64, w;
+  u32 blk;
+
+  *hi_seq_req = ipsec_sa_anti_replay_mw_seq_hi (sa, top, seq);
+
+  if (!ipsec_sa_is_set_USE_ANTI_REPLAY (sa))
+    return 0;
+
+  seq64 = (u64) *hi_seq_req << 32 | seq;
+  if (seq64 > top)
+    return 0;
+  if (top - seq64 >= IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE)
+    return 1;
+
+  blk = seq64 >> IPSEC_SA_MW_REPLAY_BLOCK_LOG2;
+  w = clib_atomic_load_relax_n (
+    &sa->replay_ring[blk & (IPSEC_SA_MW_REPLAY_RING_SIZE - 1)]);
+
+  if ((u32) (w >> 32) != blk)
+    return ((i32) (blk - (u32) (w >> 32)) < 0);
+
+  return (w >> (seq64 & (IPSEC_SA_MW_REPLAY_BLOCK_SIZE - 1))) & 1;
+}
+
+/*
+ * Post-decrypt test-and-set of the packet in the window of a multi-worker
+ * SA and advance of its sequence number. Returns non-zero if the packet
+ * is a replay, i.e. another worker accepted the same sequence number.
+ */
+always_inline int
+ipsec_sa_anti_replay_mw_advance (ipsec_sa_t *sa, u32 seq, u32 hi_seq,
+				 u64 *n_lost)
+{
+  u64 seq64 = (u64) hi_seq << 32 | seq;
+  u64 top = clib_atomic_load_relax_n (&sa->seq64);
+  u64 *wp, w, nw, bit;
+  u32 blk, wblk;
+
+  *n_lost = 0;
+
+  if (ipsec_sa_is_set_USE_ANTI_REPLAY (sa))
+    {
+      if (seq64 < top && top - seq64 >= IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE)
+	return 1;
+
+      blk = seq64 >> IPSEC_SA_MW_REPLAY_BLOCK_LOG2;
+      bit = 1ULL << (seq64 & (IPSEC_SA_MW_REPLAY_BLOCK_SIZE - 1));
+      wp = &sa->replay_ring[blk & (IPSEC_SA_MW_REPLAY_RING_SIZE - 1)];
+      w = clib_atomic_load_relax_n (wp);
+
+      do
+	{
+	  wblk = w >> 32;
+	  if (wblk == blk)
+	    {
+	      if (w & bit)
+		return 1;
+	      nw = w | bit;
+	    }
+	  else if ((i32) (blk - wblk) < 0)
+	    return 1;
+	  else
+	    nw = (u64) blk << 32 | bit;
+	}
+      while (!clib_atomic_cmp_and_swap_acq_relax_n (wp, &w, nw, 1));
+
+      /* holes in a block leaving the ring are lost packets */
+      if (wblk != blk)
+	*n_lost =
+	  IPSEC_SA_MW_REPLAY_BLOCK_SIZE - count_set_bits ((u32) w);
+    }
+
+  while (seq64 > top &&
+	 !clib_atomic_cmp_and_swap_acq_relax_n (&sa->seq64, &top, seq64, 1))
+    ;
+
+  return 0;
+}
 
 /*
  * Makes choice for thread_id should be assigned.
@@ -53,8 +53,10 @@
 #include <vnet/ip/ip4_packet.h>
 #include <vnet/ip/ip6_packet.h>
 #include <vnet/udp/udp_packet.h>
+#include <vnet/udp/udp_local.h>
 #include <vnet/devices/devices.h>
 #include <vnet/gso/gro_func.h>
+#include <vnet/ipsec/ipsec_offload.h>
 
 static int
 validate_buffer_data2 (vlib_buffer_t * b, pg_stream_t * s,
@@ -1536,6 +1538,84 @@ pg_input_trace (pg_main_t * pg,
   return n_trace - n_trace0 - n_trace1;
 }
 
+/*
+ * Inline IPsec on receive: decrypt the ESP packets of the SAs installed on
+ * the interface and mark them, the others are left to the software path
+ */
+static_always_inline void
+pg_input_ipsec_inline (vlib_main_t *vm, pg_interface_t *pi, u32 *buffers,
+		       u32 n_buffers)
+{
+  for (int i = 0; i < n_buffers; i++)
+    {
+      vlib_buffer_t *b0 = vlib_get_buffer (vm, buffers[i]);
+      u8 *data = vlib_buffer_get_current (b0), *end;
+      esp_header_t *esp = 0;
+      u16 ethertype;
+      u8 protocol;
+      u32 len = 0;
+      uword *p;
+
+      if (b0->flags & VLIB_BUFFER_NEXT_PRESENT)
+	continue;
+
+      end = vlib_buffer_get_tail (b0);
+
+      if (pi->mode == PG_MODE_ETHERNET)
+	{
+	  ethernet_header_t *eh = (ethernet_header_t *) data;
+	  if (data + sizeof (*eh) > end)
+	    continue;
+	  ethertype = clib_net_to_host_u16 (eh->type);
+	  data += sizeof (*eh);
+	}
+      else
+	ethertype = pi->mode == PG_MODE_IP4 ? ETHERNET_TYPE_IP4 :
+						ETHERNET_TYPE_IP6;
+
+      if (ethertype == ETHERNET_TYPE_IP4)
+	{
+	  ip4_header_t *ip4 = (ip4_header_t *) data;
+	  /* the device does not reassemble */
+	  if (data + sizeof (*ip4) > end || ip4_is_fragment (ip4))
+	    continue;
+	  protocol = ip4->protocol;
+	  len = clib_net_to_host_u16 (ip4->length) - ip4_header_bytes (ip4);
+	  data += ip4_header_bytes (ip4);
+	}
+      else if (ethertype == ETHERNET_TYPE_IP6)
+	{
+	  ip6_header_t *ip6 = (ip6_header_t *) data;
+	  if (data + sizeof (*ip6) > end)
+	    continue;
+	  protocol = ip6->protocol;
+	  len = clib_net_to_host_u16 (ip6->payload_length);
+	  data += sizeof (*ip6);
+	}
+      else
+	continue;
+
+      if (protocol == IP_PROTOCOL_IPSEC_ESP)
+	esp = (esp_header_t *) data;
+      else if (protocol == IP_PROTOCOL_UDP)
+	{
+	  udp_header_t *udp = (udp_header_t *) data;
+	  if (data + sizeof (*udp) > end ||
+	      udp->dst_port != clib_host_to_net_u16 (UDP_DST_PORT_ipsec))
+	    continue;
+	  len = clib_net_to_host_u16 (udp->length) - sizeof (*udp);
+	  esp = (esp_header_t *) (udp + 1);
+	}
+
+      if (!esp || len < sizeof (*esp) || (u8 *) esp + len > end)
+	continue;
+
+      p = hash_get (pi->ipsec_rx_sa_by_spi, clib_net_to_host_u32 (esp->spi));
+      if (p && !ipsec_offload_sw_decrypt (vm, p[0], esp, len))
+	b0->flags |= VNET_BUFFER_F_IPSEC_INLINE;
+    }
+}
+
 static_always_inline void
 fill_buffer_offload_flags (vlib_main_t *vm, u32 *buffers, u32 n_buffers,
 			   u32 buffer_oflags, int gso_enabled, u32 gso_size)
@@ -1724,6 +1804,9 @@ pg_generate_packets (vlib_node_runtime_t * node,
 				     pi->gso_size);
 	}
 
+      if (PREDICT_FALSE (hash_elts (pi->ipsec_rx_sa_by_spi)))
+	pg_input_ipsec_inline (vm, pi, to_next, n_this_frame);
+
       n_trace = vlib_get_trace_count (vm, node);
       if (PREDICT_FALSE (n_trace > 0))
 	{
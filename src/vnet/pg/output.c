@@ -43,6 +43,32 @@
 #include <vnet/pg/pg.h>
 #include <vnet/ethernet/ethernet.h>
 #include <vnet/gso/gro_func.h>
+#include <vnet/ipsec/ipsec_offload.h>
+
+/* do the ESP transform the device was asked for, 0 if it can't be done */
+static_always_inline int
+pg_output_ipsec_inline (vlib_main_t *vm, pg_interface_t *pif, vlib_buffer_t *b)
+{
+  esp_header_t *esp;
+  uword *p;
+
+  b->flags &= ~VNET_BUFFER_F_IPSEC_INLINE;
+
+  if (b->flags & VLIB_BUFFER_NEXT_PRESENT)
+    return 0;
+
+  esp = (esp_header_t *) (b->data + vnet_buffer (b)->l4_hdr_offset);
+  if ((u8 *) esp < (u8 *) vlib_buffer_get_current (b) ||
+      (u8 *) (esp + 1) > vlib_buffer_get_tail (b))
+    return 0;
+
+  p = hash_get (pif->ipsec_tx_sa_by_spi, clib_net_to_host_u32 (esp->spi));
+  if (!p)
+    return 0;
+
+  return !ipsec_offload_sw_encrypt (vm, p[0], esp,
+				    vlib_buffer_get_tail (b) - (u8 *) esp);
+}
 
 uword
 pg_output (vlib_main_t * vm, vlib_node_runtime_t * node, vlib_frame_t * frame)
@@ -74,6 +100,15 @@ pg_output (vlib_main_t * vm, vlib_node_runtime_t * node, vlib_frame_t * frame)
       vlib_buffer_t *b = vlib_get_buffer (vm, bi0);
       buffers++;
 
+      /* never let a packet the device could not encrypt on the wire */
+      if (PREDICT_FALSE (b->flags & VNET_BUFFER_F_IPSEC_INLINE) &&
+	  !pg_output_ipsec_inline (vm, pif, b))
+	{
+	  vlib_error_count (vm, node->node_index,
+			    PG_OUTPUT_ERROR_IPSEC_INLINE, 1);
+	  continue;
+	}
+
       if (b->flags & VLIB_BUFFER_IS_TRACED)
 	{
 	  pg_output_trace_t *t = vlib_add_trace (vm, node, b, sizeof (*t));
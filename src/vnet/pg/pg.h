@@ -326,6 +326,10 @@ typedef struct
   pg_interface_mode_t mode;
 
   mac_address_t *allowed_mcast_macs;
+
+  /* inline IPsec offload, SAs installed on the interface by SPI */
+  uword *ipsec_rx_sa_by_spi;
+  uword *ipsec_tx_sa_by_spi;
 } pg_interface_t;
 
 /* Per VLIB node data. */
@@ -369,6 +373,18 @@ extern vlib_node_registration_t pg_input_node;
 /* Buffer generator input, output node functions. */
 vlib_node_function_t pg_input, pg_output;
 
+#define foreach_pg_output_error                                               \
+  _ (NONE, "no error")                                                        \
+  _ (IPSEC_INLINE, "inline IPsec encryption failed")
+
+typedef enum
+{
+#define _(n, s) PG_OUTPUT_ERROR_##n,
+  foreach_pg_output_error
+#undef _
+    PG_OUTPUT_N_ERROR,
+} pg_output_error_t;
+
 /* Stream add/delete. */
 void pg_stream_del (pg_main_t * pg, uword index);
 void pg_stream_add (pg_main_t * pg, pg_stream_t * s_init);
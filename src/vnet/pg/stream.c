@@ -43,6 +43,7 @@
 #include <vnet/ip/ip.h>
 #include <vnet/mpls/mpls.h>
 #include <vnet/devices/devices.h>
+#include <vnet/ipsec/ipsec_sa.h>
 
 /* Mark stream active or inactive. */
 void
@@ -171,14 +172,62 @@ pg_add_del_mac_address (vnet_hw_interface_t * hi,
   return (NULL);
 }
 
+/*
+ * The pg device stands in for a NIC doing inline IPsec, the transforms are
+ * done in software by its rx and tx nodes. An SA not known to be inbound
+ * is installed for both directions
+ */
+static int
+pg_ipsec_offload_ops (vnet_main_t *vnm, vnet_ipsec_offload_dev_op_t op,
+		      u32 dev_instance, u32 sa_index, uword *private_data)
+{
+  pg_main_t *pg = &pg_main;
+  pg_interface_t *pi = pool_elt_at_index (pg->interfaces, dev_instance);
+  ipsec_sa_t *sa = ipsec_sa_get (sa_index);
+  u8 is_tx = !ipsec_sa_is_set_IS_INBOUND (sa);
+  uword *p;
+
+  switch (op)
+    {
+    case VNET_IPSEC_OFFLOAD_DEV_OP_ADD_SA:
+      if (hash_get (pi->ipsec_rx_sa_by_spi, sa->spi) ||
+	  (is_tx && hash_get (pi->ipsec_tx_sa_by_spi, sa->spi)))
+	return VNET_API_ERROR_ENTRY_ALREADY_EXISTS;
+      hash_set (pi->ipsec_rx_sa_by_spi, sa->spi, sa_index);
+      if (is_tx)
+	hash_set (pi->ipsec_tx_sa_by_spi, sa->spi, sa_index);
+      *private_data = sa->spi;
+      break;
+    case VNET_IPSEC_OFFLOAD_DEV_OP_DEL_SA:
+      p = hash_get (pi->ipsec_rx_sa_by_spi, *private_data);
+      if (p && p[0] == sa_index)
+	hash_unset (pi->ipsec_rx_sa_by_spi, *private_data);
+      p = hash_get (pi->ipsec_tx_sa_by_spi, *private_data);
+      if (p && p[0] == sa_index)
+	hash_unset (pi->ipsec_tx_sa_by_spi, *private_data);
+      break;
+    }
+
+  return 0;
+}
+
+static char *pg_output_error_strings[] = {
+#define _(n, s) s,
+  foreach_pg_output_error
+#undef _
+};
+
 /* *INDENT-OFF* */
 VNET_DEVICE_CLASS (pg_dev_class) = {
   .name = "pg",
   .tx_function = pg_output,
+  .tx_function_n_errors = PG_OUTPUT_N_ERROR,
+  .tx_function_error_strings = pg_output_error_strings,
   .format_device_name = format_pg_interface_name,
   .format_tx_trace = format_pg_output_trace,
   .admin_up_down_function = pg_interface_admin_up_down,
   .mac_addr_add_del_function = pg_add_del_mac_address,
+  .ipsec_offload_ops_function = pg_ipsec_offload_ops,
 };
 /* *INDENT-ON* */
 
@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/session/session_hh.h>
+#include <vnet/session/session.h>
+#include <vpp/stats/stat_segment.h>
+#include <vppinfra/xxhash.h>
+
+session_hh_main_t session_hh_main = {
+  .estimates = {
+#define _(sym, str)                                                           \
+  [SESSION_HH_##sym] = {                                                      \
+    .name = "session-hh-" #str,                                               \
+    .stat_segment_name = "/sys/session/hh/" #str,                             \
+  },
+    foreach_session_hh_metric
+#undef _
+  },
+};
+
+static const char *session_hh_metric_names[] = {
+#define _(sym, str) [SESSION_HH_##sym] = #str,
+  foreach_session_hh_metric
+#undef _
+};
+
+static const u64 session_hh_cms_seeds[SESSION_HH_CMS_DEPTH] = {
+  0x9e3779b97f4a7c15ULL,
+  0xc2b2ae3d27d4eb4fULL,
+  0x165667b19e3779f9ULL,
+  0x27d4eb2f165667c5ULL,
+};
+
+static u64
+session_hh_cms_update (session_hh_tracker_t *t, session_handle_t sh,
+		       u64 value)
+{
+  u64 estimate = ~0ULL, *counter;
+  int i;
+
+  for (i = 0; i < SESSION_HH_CMS_DEPTH; i++)
+    {
+      counter = &t->cms[i][clib_xxhash (sh ^ session_hh_cms_seeds[i]) &
+			   (SESSION_HH_CMS_WIDTH - 1)];
+      *counter += value;
+      estimate = clib_min (estimate, *counter);
+    }
+
+  return estimate;
+}
+
+static void
+session_hh_heap_sift_down (session_hh_tracker_t *t, u32 i)
+{
+  session_hh_entry_t *heap = t->heap, tmp;
+  u32 l, r, min;
+
+  while (1)
+    {
+      l = 2 * i + 1;
+      r = l + 1;
+      min = i;
+      if (l < t->n_entries && heap[l].estimate < heap[min].estimate)
+	min = l;
+      if (r < t->n_entries && heap[r].estimate < heap[min].estimate)
+	min = r;
+      if (min == i)
+	return;
+      tmp = heap[i];
+      heap[i] = heap[min];
+      heap[min] = tmp;
+      i = min;
+    }
+}
+
+static void
+session_hh_heap_sift_up (session_hh_tracker_t *t, u32 i)
+{
+  session_hh_entry_t *heap = t->heap, tmp;
+  u32 parent;
+
+  while (i)
+    {
+      parent = (i - 1) / 2;
+      if (heap[parent].estimate <= heap[i].estimate)
+	return;
+      tmp = heap[i];
+      heap[i] = heap[parent];
+      heap[parent] = tmp;
+      i = parent;
+    }
+}
+
+static void
+session_hh_tracker_update (session_hh_tracker_t *t, session_handle_t sh,
+			   u64 value, u32 topk)
+{
+  u64 estimate;
+  u32 i;
+
+  estimate = session_hh_cms_update (t, sh, value);
+
+  /* Heap is small, linear search is cheaper than maintaining an index */
+  for (i = 0; i < t->n_entries; i++)
+    {
+      if (t->heap[i].handle != sh)
+	continue;
+      /* Estimates only grow between decays, so only sift down */
+      t->heap[i].estimate = estimate;
+      session_hh_heap_sift_down (t, i);
+      return;
+    }
+
+  if (t->n_entries < topk)
+    {
+      t->heap[t->n_entries].handle = sh;
+      t->heap[t->n_entries].estimate = estimate;
+      session_hh_heap_sift_up (t, t->n_entries++);
+      return;
+    }
+
+  if (estimate <= t->heap[0].estimate)
+    return;
+
+  t->heap[0].handle = sh;
+  t->heap[0].estimate = estimate;
+  session_hh_heap_sift_down (t, 0);
+}
+
+static void
+session_hh_tracker_decay (session_hh_tracker_t *t)
+{
+  u64 *counter = &t->cms[0][0];
+  int i;
+
+  for (i = 0; i < SESSION_HH_CMS_DEPTH * SESSION_HH_CMS_WIDTH; i++)
+    counter[i] >>= 1;
+
+  /* Halving preserves heap order */
+  for (i = 0; i < t->n_entries; i++)
+    t->heap[i].estimate >>= 1;
+}
+
+static int
+session_hh_entry_cmp (const void *a1, const void *a2)
+{
+  const session_hh_entry_t *e1 = a1, *e2 = a2;
+
+  if (e1->estimate == e2->estimate)
+    return 0;
+  return e1->estimate < e2->estimate ? 1 : -1;
+}
+
+/**
+ * Copy heavy hitters of a tracker sorted by decreasing estimate. Called
+ * from workers, so avoid heap allocations.
+ */
+static u32
+session_hh_tracker_sorted (session_hh_tracker_t *t,
+			   session_hh_entry_t entries[SESSION_HH_MAX_TOPK])
+{
+  clib_memcpy_fast (entries, t->heap, t->n_entries * sizeof (t->heap[0]));
+  qsort (entries, t->n_entries, sizeof (entries[0]), session_hh_entry_cmp);
+  return t->n_entries;
+}
+
+static void
+session_hh_export (session_hh_wrk_t *hw, u32 thread_index)
+{
+  session_hh_main_t *hm = &session_hh_main;
+  session_hh_entry_t entries[SESSION_HH_MAX_TOPK];
+  u32 i, n_entries, metric, gauge;
+
+  for (metric = 0; metric < SESSION_HH_N_METRICS; metric++)
+    {
+      n_entries = session_hh_tracker_sorted (&hw->trackers[metric], entries);
+      for (i = 0; i < hm->topk; i++)
+	{
+	  vlib_set_simple_counter (&hm->estimates[metric], thread_index, i,
+				   i < n_entries ? entries[i].estimate : 0);
+	  gauge = hm->handle_gauges[metric][thread_index * SESSION_HH_MAX_TOPK +
+					     i];
+	  if (gauge != ~0)
+	    stat_segment_set_state_counter (
+	      gauge, i < n_entries ? entries[i].handle : SESSION_INVALID_HANDLE);
+	}
+    }
+}
+
+void
+session_hh_update_i (session_hh_wrk_t *hw, session_hh_metric_t metric,
+		     session_handle_t sh, u64 value, f64 now)
+{
+  session_hh_main_t *hm = &session_hh_main;
+  u32 i;
+
+  session_hh_tracker_update (&hw->trackers[metric], sh, value, hm->topk);
+
+  if (PREDICT_FALSE (now - hw->last_decay > hm->decay_interval))
+    {
+      for (i = 0; i < SESSION_HH_N_METRICS; i++)
+	session_hh_tracker_decay (&hw->trackers[i]);
+      hw->last_decay = now;
+    }
+
+  if (PREDICT_FALSE (now - hw->last_export > SESSION_HH_EXPORT_INTERVAL))
+    {
+      session_hh_export (hw, hw - hm->wrk);
+      hw->last_export = now;
+    }
+}
+
+/**
+ * Register the handle gauges of the ranks tracked by each thread, named
+ * /sys/session/hh/<metric>/handles/<thread>/<rank>, and reset all of them.
+ * Gauges are kept when tracking is disabled, so they are only registered
+ * once.
+ */
+static void
+session_hh_register_handle_gauges (session_hh_metric_t metric,
+				   u32 num_threads)
+{
+  session_hh_main_t *hm = &session_hh_main;
+  u32 thread_index, rank, *gauge;
+  clib_error_t *error;
+  u8 *name;
+
+  vec_validate_init_empty (hm->handle_gauges[metric],
+			   num_threads * SESSION_HH_MAX_TOPK - 1, ~0);
+
+  for (thread_index = 0; thread_index < num_threads; thread_index++)
+    for (rank = 0; rank < SESSION_HH_MAX_TOPK; rank++)
+      {
+	gauge = vec_elt_at_index (hm->handle_gauges[metric],
+				  thread_index * SESSION_HH_MAX_TOPK + rank);
+	/* gauges of ranks no longer tracked are reset, not removed */
+	if (*gauge == ~0 && rank >= hm->topk)
+	  continue;
+	if (*gauge == ~0)
+	  {
+	    name = format (0, "/sys/session/hh/%s/handles/%u/%u%c",
+			   session_hh_metric_names[metric], thread_index, rank,
+			   0);
+	    error = stat_segment_register_state_counter (name, gauge);
+	    vec_free (name);
+	    if (error)
+	      {
+		clib_error_report (error);
+		*gauge = ~0;
+		continue;
+	      }
+	  }
+	stat_segment_set_state_counter (*gauge, SESSION_INVALID_HANDLE);
+      }
+}
+
+void
+session_hh_enable_disable (u8 is_en, u32 topk, f64 decay_interval)
+{
+  session_hh_main_t *hm = &session_hh_main;
+  vlib_thread_main_t *vtm = vlib_get_thread_main ();
+  u32 num_threads, i;
+  f64 now;
+
+  if (!is_en)
+    {
+      hm->is_enabled = 0;
+      return;
+    }
+
+  num_threads = 1 /* main thread */ + vtm->n_threads;
+  now = vlib_time_now (vlib_get_main ());
+
+  vec_validate_aligned (hm->wrk, num_threads - 1, CLIB_CACHE_LINE_BYTES);
+  clib_memset (hm->wrk, 0, vec_len (hm->wrk) * sizeof (hm->wrk[0]));
+  vec_foreach_index (i, hm->wrk)
+    {
+      hm->wrk[i].last_decay = now;
+      hm->wrk[i].last_export = now;
+    }
+
+  hm->topk = clib_min (clib_max (topk, 1), SESSION_HH_MAX_TOPK);
+  hm->decay_interval = decay_interval;
+
+  for (i = 0; i < SESSION_HH_N_METRICS; i++)
+    {
+      vlib_validate_simple_counter (&hm->estimates[i], hm->topk - 1);
+      vlib_clear_simple_counters (&hm->estimates[i]);
+      session_hh_register_handle_gauges (i, num_threads);
+    }
+
+  hm->is_enabled = 1;
+}
+
+static clib_error_t *
+session_hh_enable_disable_fn (vlib_main_t *vm, unformat_input_t *input,
+			      vlib_cli_command_t *cmd)
+{
+  session_hh_main_t *hm = &session_hh_main;
+  u32 topk = hm->topk ? hm->topk : SESSION_HH_DEFAULT_TOPK;
+  f64 decay = hm->decay_interval ? hm->decay_interval :
+					 SESSION_HH_DEFAULT_DECAY;
+  u8 is_en = 1;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "enable"))
+	is_en = 1;
+      else if (unformat (input, "disable"))
+	is_en = 0;
+      else if (unformat (input, "topk %u", &topk))
+	;
+      else if (unformat (input, "decay-interval %f", &decay))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (!topk || topk > SESSION_HH_MAX_TOPK)
+    return clib_error_return (0, "topk must be between 1 and %u",
+			      SESSION_HH_MAX_TOPK);
+  if (decay <= 0)
+    return clib_error_return (0, "decay-interval must be positive");
+
+  session_hh_enable_disable (is_en, topk, decay);
+
+  return 0;
+}
+
+VLIB_CLI_COMMAND (session_hh_enable_disable_command, static) = {
+  .path = "session heavy-hitters",
+  .short_help = "session heavy-hitters [enable|disable] [topk <n>] "
+		"[decay-interval <secs>]",
+  .function = session_hh_enable_disable_fn,
+};
+
+static u8 *
+format_session_hh_metric (u8 *s, va_list *args)
+{
+  session_hh_metric_t metric = va_arg (*args, session_hh_metric_t);
+  char *strings[] = {
+#define _(sym, str) [SESSION_HH_##sym] = #str,
+    foreach_session_hh_metric
+#undef _
+  };
+
+  if (metric < SESSION_HH_N_METRICS)
+    return format (s, "%s", strings[metric]);
+  return format (s, "unknown %u", metric);
+}
+
+static clib_error_t *
+show_session_hh_fn (vlib_main_t *vm, unformat_input_t *input,
+		    vlib_cli_command_t *cmd)
+{
+  session_hh_main_t *hm = &session_hh_main;
+  u32 metric = ~0, first, last, thread, i, n_entries;
+  session_hh_entry_t entries[SESSION_HH_MAX_TOPK];
+  session_t *s;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (0)
+	;
+#define _(sym, str)                                                           \
+  else if (unformat (input, #str)) metric = SESSION_HH_##sym;
+      foreach_session_hh_metric
+#undef _
+	else return clib_error_return (0, "unknown input `%U'",
+				       format_unformat_error, input);
+    }
+
+  if (!hm->is_enabled)
+    {
+      vlib_cli_output (vm, "session heavy-hitters not enabled");
+      return 0;
+    }
+
+  first = metric == ~0 ? 0 : metric;
+  last = metric == ~0 ? SESSION_HH_N_METRICS - 1 : metric;
+
+  for (thread = 0; thread < vec_len (hm->wrk); thread++)
+    {
+      vlib_cli_output (vm, "Thread %u:", thread);
+      for (metric = first; metric <= last; metric++)
+	{
+	  vlib_cli_output (vm, "  %U:", format_session_hh_metric, metric);
+	  n_entries = session_hh_tracker_sorted (
+	    &hm->wrk[thread].trackers[metric], entries);
+	  for (i = 0; i < n_entries; i++)
+	    {
+	      s = session_get_from_handle_if_valid (entries[i].handle);
+	      if (s)
+		vlib_cli_output (vm, "    %-3u %-20lu %U", i, entries[i].estimate,
+				 format_session, s, 0);
+	      else
+		vlib_cli_output (vm, "    %-3u %-20lu [closed 0x%lx]", i,
+				 entries[i].estimate, entries[i].handle);
+	    }
+	}
+    }
+
+  return 0;
+}
+
+VLIB_CLI_COMMAND (show_session_hh_command, static) = {
+  .path = "show session heavy-hitters",
+  .short_help = "show session heavy-hitters [bytes|events]",
+  .function = show_session_hh_fn,
+};
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VNET_SESSION_SESSION_HH_H_
+#define SRC_VNET_SESSION_SESSION_HH_H_
+
+#include <vnet/session/session_types.h>
+#include <vlib/counter.h>
+
+/*
+ * Per worker heavy hitter (top-k) session tracking. Session load is
+ * accounted in a count-min sketch and the k sessions with the largest
+ * estimates are kept in a min-heap. All state is owned by the worker, so
+ * updates need no locks.
+ */
+
+#define SESSION_HH_CMS_DEPTH	   4
+#define SESSION_HH_CMS_WIDTH	   1024
+#define SESSION_HH_MAX_TOPK	   32
+#define SESSION_HH_DEFAULT_TOPK	   10
+#define SESSION_HH_DEFAULT_DECAY   10.0
+#define SESSION_HH_EXPORT_INTERVAL 1.0
+
+#define foreach_session_hh_metric                                             \
+  _ (BYTES, bytes)                                                            \
+  _ (EVENTS, events)
+
+typedef enum session_hh_metric_
+{
+#define _(sym, str) SESSION_HH_##sym,
+  foreach_session_hh_metric
+#undef _
+    SESSION_HH_N_METRICS
+} session_hh_metric_t;
+
+typedef struct session_hh_entry_
+{
+  session_handle_t handle;
+  u64 estimate;
+} session_hh_entry_t;
+
+typedef struct session_hh_tracker_
+{
+  /** Count-min sketch counters */
+  u64 cms[SESSION_HH_CMS_DEPTH][SESSION_HH_CMS_WIDTH];
+
+  /** Min-heap of heavy hitters, ordered by estimate */
+  session_hh_entry_t heap[SESSION_HH_MAX_TOPK];
+
+  /** Number of heavy hitters in heap */
+  u32 n_entries;
+} session_hh_tracker_t;
+
+typedef struct session_hh_wrk_
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /** Per metric trackers */
+  session_hh_tracker_t trackers[SESSION_HH_N_METRICS];
+
+  /** Last time estimates were halved */
+  f64 last_decay;
+
+  /** Last time heavy hitters were exported to stats segment */
+  f64 last_export;
+} session_hh_wrk_t;
+
+typedef struct session_hh_main_
+{
+  /** Per worker trackers */
+  session_hh_wrk_t *wrk;
+
+  /** Heavy hitter estimates exported to stats segment, by rank */
+  vlib_simple_counter_main_t estimates[SESSION_HH_N_METRICS];
+
+  /** Stats segment gauges of the heavy hitter session handles, by thread
+      (SESSION_HH_MAX_TOPK apart) and rank. Unlike counters, readers never
+      sum them over threads. */
+  u32 *handle_gauges[SESSION_HH_N_METRICS];
+
+  /** Interval after which estimates are halved */
+  f64 decay_interval;
+
+  /** Number of heavy hitters tracked per worker and metric */
+  u32 topk;
+
+  /** Tracking is enabled */
+  u8 is_enabled;
+} session_hh_main_t;
+
+extern session_hh_main_t session_hh_main;
+
+void session_hh_enable_disable (u8 is_en, u32 topk, f64 decay_interval);
+void session_hh_update_i (session_hh_wrk_t *hw, session_hh_metric_t metric,
+			  session_handle_t sh, u64 value, f64 now);
+
+static inline void
+session_hh_update (u32 thread_index, session_handle_t sh,
+		   session_hh_metric_t metric, u64 value, f64 now)
+{
+  session_hh_main_t *hm = &session_hh_main;
+
+  if (PREDICT_TRUE (!hm->is_enabled))
+    return;
+
+  session_hh_update_i (vec_elt_at_index (hm->wrk, thread_index), metric, sh,
+		       value, now);
+}
+
+#endif /* SRC_VNET_SESSION_SESSION_HH_H_ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -23,6 +23,7 @@
 #include <vnet/session/application_interface.h>
 #include <vnet/session/application_local.h>
 #include <vnet/session/session_debug.h>
+#include <vnet/session/session_hh.h>
 #include <svm/queue.h>
 #include <sys/timerfd.h>
 
@@ -1376,6 +1377,8 @@ session_tx_fifo_read_and_snd_i (session_worker_t * wrk,
 
   SESSION_EVT (SESSION_EVT_DEQ, ctx->s, ctx->max_len_to_snd, ctx->max_dequeue,
 	       ctx->s->tx_fifo->has_event, wrk->last_vlib_time);
+  session_hh_update (ctx->s->thread_index, session_handle (ctx->s),
+		     SESSION_HH_BYTES, ctx->max_len_to_snd, wrk->last_vlib_time);
 
   ASSERT (ctx->left_to_snd == 0);
 
@@ -1581,6 +1584,8 @@ session_event_dispatch_io (session_worker_t * wrk, vlib_node_runtime_t * node,
       if (PREDICT_FALSE (!s))
 	break;
       CLIB_PREFETCH (s->tx_fifo, sizeof (*(s->tx_fifo)), LOAD);
+      session_hh_update (s->thread_index, session_handle (s),
+			 SESSION_HH_EVENTS, 1, wrk->last_vlib_time);
       wrk->ctx.s = s;
       /* Spray packets in per session type frames, since they go to
        * different nodes */
@@ -1590,6 +1595,8 @@ session_event_dispatch_io (session_worker_t * wrk, vlib_node_runtime_t * node,
       s = session_event_get_session (wrk, e);
       if (!s)
 	break;
+      session_hh_update (s->thread_index, session_handle (s),
+			 SESSION_HH_EVENTS, 1, wrk->last_vlib_time);
       transport_app_rx_evt (session_get_transport_proto (s),
 			    s->connection_index, s->thread_index);
       break;
@@ -1597,6 +1604,8 @@ session_event_dispatch_io (session_worker_t * wrk, vlib_node_runtime_t * node,
       s = session_event_get_session (wrk, e);
       if (PREDICT_FALSE (!s || s->session_state >= SESSION_STATE_CLOSING))
 	break;
+      session_hh_update (s->thread_index, session_handle (s),
+			 SESSION_HH_EVENTS, 1, wrk->last_vlib_time);
       svm_fifo_unset_event (s->rx_fifo);
       app_wrk = app_worker_get (s->app_wrk_index);
       app_worker_builtin_rx (app_wrk, s);
@@ -270,6 +270,32 @@ copy_data (stat_segment_directory_entry_t *ep, u32 index2, char *name,
 	}
       break;
 
+    case STAT_DIR_TYPE_HISTOGRAM:
+      {
+	stat_segment_histogram_t *h = stat_segment_adjust (sm, ep->data);
+	counter_t **counts;
+	if (!h)
+	  break;
+	counts = stat_segment_adjust (sm, h->counts);
+	result.log2_sub_buckets = h->log2_sub_buckets;
+	result.n_buckets = h->n_buckets;
+	result.histogram_vec = stat_vec_dup (sm, counts);
+	for (i = 0; i < vec_len (counts); i++)
+	  {
+	    counter_t *cb = stat_segment_adjust (sm, counts[i]);
+	    if (index2 != ~0)
+	      {
+		/* Copy out a single histogram */
+		result.histogram_vec[i] = 0;
+		vec_add (result.histogram_vec[i], cb + index2 * h->n_buckets,
+			 h->n_buckets);
+	      }
+	    else
+	      result.histogram_vec[i] = stat_vec_dup (sm, cb);
+	  }
+      }
+      break;
+
     case STAT_DIR_TYPE_ERROR_INDEX:
       /* Gather errors from all threads into a vector */
       error_vector =
@@ -329,6 +355,11 @@ stat_segment_data_free (stat_segment_data_t * res)
 	    vec_free (res[i].combined_counter_vec[j]);
 	  vec_free (res[i].combined_counter_vec);
 	  break;
+	case STAT_DIR_TYPE_HISTOGRAM:
+	  for (j = 0; j < vec_len (res[i].histogram_vec); j++)
+	    vec_free (res[i].histogram_vec[j]);
+	  vec_free (res[i].histogram_vec);
+	  break;
 	case STAT_DIR_TYPE_NAME_VECTOR:
 	  for (j = 0; j < vec_len (res[i].name_vector); j++)
 	    vec_free (res[i].name_vector[j]);
@@ -18,7 +18,7 @@
 #define included_stat_client_h
 
 #define STAT_VERSION_MAJOR     1
-#define STAT_VERSION_MINOR     2
+#define STAT_VERSION_MINOR     3
 
 #include <stdint.h>
 #include <unistd.h>
@@ -43,6 +43,12 @@ typedef struct
     counter_t **simple_counter_vec;
     vlib_counter_t **combined_counter_vec;
     uint8_t **name_vector;
+    struct
+    {
+      uint32_t log2_sub_buckets;
+      uint32_t n_buckets;
+      counter_t **histogram_vec; /* [thread][histogram * n_buckets + bucket] */
+    };
   };
 } stat_segment_data_t;
 
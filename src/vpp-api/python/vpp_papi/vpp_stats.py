@@ -392,6 +392,22 @@ class SimpleList(list):
         '''Sum the vector'''
         return sum(self)
 
+class StatsHistogramList(list):
+    '''Histograms 2-dimensional by thread by index of bucket lists'''
+
+    def __getitem__(self, item):
+        '''Supports partial numpy style 2d support. Slice by column [:,1]'''
+        if isinstance(item, int):
+            return list.__getitem__(self, item)
+        return HistogramList([row[item[1]] for row in self])
+
+class HistogramList(list):
+    '''Histogram across threads'''
+
+    def sum(self):
+        '''Sum the buckets of all threads'''
+        return [sum(buckets) for buckets in zip(*self)]
+
 class StatsEntry():
     '''An individual stats entry'''
     # pylint: disable=unused-argument,no-self-use
@@ -412,6 +428,8 @@ class StatsEntry():
             self.function = self.name
         elif stattype == 7:
             self.function = self.symlink
+        elif stattype == 8:
+            self.function = self.histogram
         else:
             self.function = self.illegal
 
@@ -463,6 +481,18 @@ class StatsEntry():
         name = stats.directory_by_idx[index1]
         return stats[name][:,index2]
 
+    HISTOGRAM_FMT = Struct('IIP')
+    def histogram(self, stats):
+        '''Histogram counter'''
+        _, n_buckets, counts = self.HISTOGRAM_FMT.unpack_from(
+            stats.statseg, self.value - stats.base)
+        counter = StatsHistogramList()
+        for threads in StatsVector(stats, counts, 'P'):
+            clist = [v[0] for v in StatsVector(stats, threads[0], 'Q')]
+            counter.append([clist[i:i + n_buckets]
+                            for i in range(0, len(clist), n_buckets)])
+        return counter
+
     def get_counter(self, stats):
         '''Return a list of counters'''
         if stats:
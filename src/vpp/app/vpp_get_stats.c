@@ -20,6 +20,32 @@
 #include <vpp-api/client/stat_client.h>
 #include <vlib/vlib.h>
 
+/*
+ * Print the non-empty buckets of a histogram collection, one line per
+ * bucket, labelled with the bucket's lower bound.
+ */
+static void
+stat_print_histogram (stat_segment_data_t *r)
+{
+  int j, k, b;
+  counter_t *counts;
+
+  if (r->histogram_vec == 0 || r->n_buckets == 0)
+    return;
+
+  for (k = 0; k < vec_len (r->histogram_vec); k++)
+    {
+      counts = r->histogram_vec[k];
+      for (j = 0; j < vec_len (counts) / r->n_buckets; j++)
+	for (b = 0; b < r->n_buckets; b++)
+	  if (counts[j * r->n_buckets + b])
+	    fformat (stdout, "[%d @ %d]: >= %llu: %llu %s\n", j, k,
+		     stat_segment_histogram_bucket_min (r->log2_sub_buckets,
+							b),
+		     counts[j * r->n_buckets + b], r->name);
+    }
+}
+
 static int
 stat_poll_loop (u8 ** patterns)
 {
@@ -89,6 +115,10 @@ stat_poll_loop (u8 ** patterns)
 	      fformat (stdout, "%.2f %s\n", res[i].scalar_value, res[i].name);
 	      break;
 
+	    case STAT_DIR_TYPE_HISTOGRAM:
+	      stat_print_histogram (&res[i]);
+	      break;
+
 	    case STAT_DIR_TYPE_EMPTY:
 	      break;
 
@@ -227,6 +257,10 @@ reconnect:
 	      fformat (stdout, "%.2f %s\n", res[i].scalar_value, res[i].name);
 	      break;
 
+	    case STAT_DIR_TYPE_HISTOGRAM:
+	      stat_print_histogram (&res[i]);
+	      break;
+
 	    case STAT_DIR_TYPE_NAME_VECTOR:
 	      if (res[i].name_vector == 0)
 		continue;
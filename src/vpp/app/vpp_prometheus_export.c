@@ -48,6 +48,51 @@ prom_string (char *s)
   return s;
 }
 
+/*
+ * Histograms track bucket counts only, there is no running sum of the
+ * samples, so they cannot be exposed as a Prometheus histogram (which
+ * requires _sum). Export them as a gauge family instead: one cumulative
+ * count per bucket labelled with its inclusive upper bound, the open ended
+ * last bucket is le="+Inf" and carries the total number of samples.
+ * Empty buckets are left out, the cumulative count of a bucket that is
+ * not listed is the one of the bucket before it.
+ */
+static void
+dump_histogram (FILE *stream, stat_segment_data_t *r)
+{
+  counter_t *counts;
+  u64 total;
+  int j, k, b;
+
+  if (r->n_buckets == 0)
+    return;
+
+  fformat (stream, "# TYPE %s gauge\n", prom_string (r->name));
+  for (k = 0; k < vec_len (r->histogram_vec); k++)
+    {
+      counts = r->histogram_vec[k];
+      for (j = 0; j < vec_len (counts) / r->n_buckets; j++)
+	{
+	  total = 0;
+	  for (b = 0; b < r->n_buckets - 1; b++)
+	    {
+	      if (counts[j * r->n_buckets + b] == 0)
+		continue;
+	      total += counts[j * r->n_buckets + b];
+	      fformat (stream,
+		       "%s{thread=\"%d\",index=\"%d\",le=\"%llu\"} %llu\n",
+		       r->name, k, j,
+		       stat_segment_histogram_bucket_min (r->log2_sub_buckets,
+							  b + 1) - 1,
+		       total);
+	    }
+	  total += counts[j * r->n_buckets + b];
+	  fformat (stream, "%s{thread=\"%d\",index=\"%d\",le=\"+Inf\"} %llu\n",
+		   r->name, k, j, total);
+	}
+    }
+}
+
 static void
 dump_metrics (FILE * stream, u8 ** patterns)
 {
@@ -121,6 +166,10 @@ retry:
 		       prom_string (res[i].name), k, res[i].name_vector[k]);
 	  break;
 
+	case STAT_DIR_TYPE_HISTOGRAM:
+	  dump_histogram (stream, &res[i]);
+	  break;
+
 	case STAT_DIR_TYPE_EMPTY:
 	  break;
 
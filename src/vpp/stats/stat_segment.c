@@ -171,6 +171,8 @@ vlib_stats_delete_cm (void *cm_arg)
   hash_unset (sm->directory_vector_by_name, &e->name);
 
   void *oldheap = clib_mem_set_heap (sm->heap);	/* Enter stats segment */
+  if (e->type == STAT_DIR_TYPE_HISTOGRAM)
+    clib_mem_free (e->data);
   clib_mem_set_heap (oldheap);	/* Exit stats segment */
 
   memset (e, 0, sizeof (*e));
@@ -219,7 +221,23 @@ vlib_stats_pop_heap (void *cm_arg, void *oldheap, u32 cindex,
     }
 
   stat_segment_directory_entry_t *ep = &sm->directory_vector[vector_index];
-  ep->data = cm->counters;
+  if (type == STAT_DIR_TYPE_HISTOGRAM)
+    {
+      /* Clients need the bucket layout, publish it next to the counts */
+      vlib_histogram_main_t *hm = cm_arg;
+      stat_segment_histogram_t *h = ep->data;
+
+      if (!h)
+	{
+	  h = clib_mem_alloc (sizeof (*h));
+	  ep->data = h;
+	}
+      h->log2_sub_buckets = hm->log2_sub_buckets;
+      h->n_buckets = hm->n_buckets;
+      h->counts = (uint64_t **) hm->counters;
+    }
+  else
+    ep->data = cm->counters;
 
   /* Reset the client hash table pointer, since it WILL change! */
   shared_header->directory_vector = sm->directory_vector;
@@ -541,6 +559,10 @@ format_stat_dir_entry (u8 * s, va_list * args)
       type_name = "Symlink";
       break;
 
+    case STAT_DIR_TYPE_HISTOGRAM:
+      type_name = "Histogram";
+      break;
+
     default:
       type_name = "illegal!";
       break;
@@ -739,6 +761,138 @@ update_node_counters (stat_segment_main_t * sm)
   vec_free (stat_vms);
 }
 
+/*
+ * Per-node dispatch histograms:
+ * clocks per call and vectors per call [threads][node-index * n_buckets]
+ * Recorded from the dispatch wrapper, so at most one rdtsc per call is
+ * added on top of the regular node runtime accounting.
+ */
+
+static uword
+stat_segment_node_histograms_dispatch (vlib_main_t *vm,
+				       vlib_node_runtime_t *node,
+				       vlib_frame_t *frame)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  uword n;
+
+  n = node->function (vm, node, frame);
+
+  /* Nodes created since the last validation are not recorded yet */
+  if (PREDICT_TRUE (node->node_index < sm->node_histograms_n_nodes))
+    {
+      vlib_increment_histogram (
+	&sm->node_clock_histograms, vm->thread_index, node->node_index,
+	clib_cpu_time_now () - vm->cpu_time_last_node_dispatch);
+      vlib_increment_histogram (&sm->node_vector_histograms,
+				vm->thread_index, node->node_index, n);
+    }
+
+  return n;
+}
+
+/*
+ * Must be called with the barrier held
+ */
+static void
+stat_segment_node_histograms_validate (vlib_main_t *vm)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  u32 n_nodes = vec_len (vm->node_main.nodes);
+
+  vlib_validate_histogram (&sm->node_clock_histograms, n_nodes - 1);
+  vlib_validate_histogram (&sm->node_vector_histograms, n_nodes - 1);
+  sm->node_histograms_n_nodes = n_nodes;
+}
+
+clib_error_t *
+stat_segment_node_histograms_enable_disable (vlib_main_t *vm, int is_enable)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  vlib_node_function_t *fn = stat_segment_node_histograms_dispatch;
+  clib_error_t *error = 0;
+  int i;
+
+  if (is_enable == sm->node_histograms_enabled)
+    return 0;
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  if (is_enable)
+    {
+      /* Clocks: exact below 2, then 2 sub-buckets per power of two, so up
+       * to ~12M clocks. Vectors: exact below 8, 4 sub-buckets above */
+      sm->node_clock_histograms.name = "node-clock-histograms";
+      sm->node_clock_histograms.stat_segment_name = "/sys/node/clock-histogram";
+      sm->node_clock_histograms.log2_sub_buckets = 1;
+      sm->node_clock_histograms.n_buckets = 48;
+      sm->node_vector_histograms.name = "node-vector-histograms";
+      sm->node_vector_histograms.stat_segment_name =
+	"/sys/node/vector-histogram";
+      sm->node_vector_histograms.log2_sub_buckets = 2;
+      sm->node_vector_histograms.n_buckets = 32;
+
+      for (i = 0; i < vlib_get_n_threads (); i++)
+	if (vlib_node_set_dispatch_wrapper (vlib_get_main_by_index (i), fn))
+	  {
+	    while (--i >= 0)
+	      vlib_node_set_dispatch_wrapper (vlib_get_main_by_index (i), 0);
+	    error = clib_error_return (0, "another dispatch wrapper is "
+					  "already registered");
+	    goto done;
+	  }
+
+      stat_segment_node_histograms_validate (vm);
+      vlib_clear_histograms (&sm->node_clock_histograms);
+      vlib_clear_histograms (&sm->node_vector_histograms);
+    }
+  else
+    {
+      for (i = 0; i < vlib_get_n_threads (); i++)
+	{
+	  vlib_main_t *ovm = vlib_get_main_by_index (i);
+	  if (ovm->dispatch_wrapper_fn == fn)
+	    vlib_node_set_dispatch_wrapper (ovm, 0);
+	}
+    }
+
+  sm->node_histograms_enabled = is_enable;
+
+done:
+  vlib_worker_thread_barrier_release (vm);
+  return error;
+}
+
+static clib_error_t *
+set_stat_segment_node_histograms_command_fn (vlib_main_t *vm,
+					     unformat_input_t *input,
+					     vlib_cli_command_t *cmd)
+{
+  int is_enable = -1;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "on") || unformat (input, "enable"))
+	is_enable = 1;
+      else if (unformat (input, "off") || unformat (input, "disable"))
+	is_enable = 0;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (is_enable == -1)
+    return clib_error_return (0, "expected on or off");
+
+  return stat_segment_node_histograms_enable_disable (vm, is_enable);
+}
+
+VLIB_CLI_COMMAND (set_stat_segment_node_histograms_command, static) = {
+  .path = "set statistics node-histograms",
+  .short_help = "set statistics node-histograms [on|off]",
+  .function = set_stat_segment_node_histograms_command_fn,
+};
+
 static void
 do_stat_segment_updates (vlib_main_t *vm, stat_segment_main_t *sm)
 {
@@ -759,6 +913,14 @@ do_stat_segment_updates (vlib_main_t *vm, stat_segment_main_t *sm)
       sm->directory_vector[STAT_COUNTER_NUM_WORKER_THREADS].value =
 	tm->n_vlib_mains - 1;
       num_worker_threads_set = 1;
+
+      if (sm->node_histograms_config)
+	{
+	  clib_error_t *error;
+	  error = stat_segment_node_histograms_enable_disable (vm, 1);
+	  if (error)
+	    clib_error_report (error);
+	}
     }
 
   /*
@@ -777,6 +939,14 @@ do_stat_segment_updates (vlib_main_t *vm, stat_segment_main_t *sm)
   if (sm->node_counters_enabled)
     update_node_counters (sm);
 
+  if (sm->node_histograms_enabled &&
+      vec_len (vm->node_main.nodes) > sm->node_histograms_n_nodes)
+    {
+      vlib_worker_thread_barrier_sync (vm);
+      stat_segment_node_histograms_validate (vm);
+      vlib_worker_thread_barrier_release (vm);
+    }
+
   /* *INDENT-OFF* */
   stat_segment_gauges_pool_t *g;
   pool_foreach (g, sm->gauges)
@@ -990,6 +1160,10 @@ statseg_config (vlib_main_t * vm, unformat_input_t * input)
 	sm->node_counters_enabled = 1;
       else if (unformat (input, "per-node-counters off"))
 	sm->node_counters_enabled = 0;
+      else if (unformat (input, "node-histograms on"))
+	sm->node_histograms_config = 1;
+      else if (unformat (input, "node-histograms off"))
+	sm->node_histograms_config = 0;
       else if (unformat (input, "update-interval %f", &sm->update_interval))
 	;
       else
@@ -91,6 +91,13 @@ typedef struct
   ssize_t memory_size;
   clib_mem_page_sz_t log2_page_sz;
   u8 node_counters_enabled;
+
+  /* Per-node dispatch histograms, indexed by node index */
+  vlib_histogram_main_t node_clock_histograms;
+  vlib_histogram_main_t node_vector_histograms;
+  u32 node_histograms_n_nodes;
+  u8 node_histograms_enabled;
+  u8 node_histograms_config;
   void *last;
   void *heap;
   stat_segment_shared_header_t *shared_header;	/* pointer to shared memory segment */
@@ -119,5 +126,7 @@ void vlib_stats_register_symlink (void *oldheap, u8 *name, u32 index1,
 				  u32 index2, u8 lock);
 
 void stat_provider_register_vector_rate (u32 num_workers);
+clib_error_t *stat_segment_node_histograms_enable_disable (vlib_main_t *vm,
+							  int is_enable);
 
 #endif
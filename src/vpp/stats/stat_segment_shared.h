@@ -26,8 +26,22 @@ typedef enum
   STAT_DIR_TYPE_NAME_VECTOR,
   STAT_DIR_TYPE_EMPTY,
   STAT_DIR_TYPE_SYMLINK,
+  STAT_DIR_TYPE_HISTOGRAM,
 } stat_directory_type_t;
 
+/*
+ * Per-thread log-linear histograms. Values below 2^log2_sub_buckets get a
+ * bucket each, larger values fall in one of 2^log2_sub_buckets linear
+ * sub-buckets of their power of two range. The last bucket also counts all
+ * values above its lower bound.
+ */
+typedef struct
+{
+  uint32_t log2_sub_buckets;
+  uint32_t n_buckets;
+  uint64_t **counts; /* [thread][histogram index * n_buckets + bucket] */
+} stat_segment_histogram_t;
+
 typedef struct
 {
   stat_directory_type_t type;
@@ -63,4 +77,18 @@ stat_segment_pointer (void *start, uint64_t offset)
   return ((char *) start + offset);
 }
 
+/*
+ * Smallest value counted in a histogram bucket
+ */
+static inline uint64_t
+stat_segment_histogram_bucket_min (uint32_t log2_sub_buckets, uint32_t bucket)
+{
+  uint64_t n_sub = 1ULL << log2_sub_buckets;
+
+  if (bucket < n_sub)
+    return bucket;
+  return (n_sub + (bucket & (n_sub - 1)))
+	 << ((bucket >> log2_sub_buckets) - 1);
+}
+
 #endif /* included_stat_segment_shared_h */
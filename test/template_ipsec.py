@@ -1566,6 +1566,61 @@ class IpsecTun4HandoffTests(IpsecTun4):
         self.verify_counters4(p, 4*N_PKTS, worker=0)
 
 
+class IpsecTun4MultiWorkerTests(IpsecTun4):
+    """ UT test methods for Tunnel v4 with multi-worker SAs """
+    vpp_worker_count = 2
+
+    def test_tun_multi_worker_44(self):
+        """ ipsec 4o4 tunnel multi-worker SA test """
+        self.vapi.cli("clear errors")
+        self.vapi.cli("clear ipsec sa")
+
+        N_PKTS = 15
+        p = self.params[socket.AF_INET]
+
+        # inject alternately on worker 0 and 1. there is no hand-off
+        # so each worker processes its own packets
+        for worker in [0, 1, 0, 1]:
+            send_pkts = self.gen_encrypt_pkts(p, p.scapy_tun_sa, self.tun_if,
+                                              src=p.remote_tun_if_host,
+                                              dst=self.pg1.remote_ip4,
+                                              count=N_PKTS)
+            recv_pkts = self.send_and_expect(self.tun_if, send_pkts,
+                                             self.pg1, worker=worker)
+            self.verify_decrypted(p, recv_pkts)
+
+            send_pkts = self.gen_pkts(self.pg1, src=self.pg1.remote_ip4,
+                                      dst=p.remote_tun_if_host,
+                                      count=N_PKTS)
+            recv_pkts = self.send_and_expect(self.pg1, send_pkts,
+                                             self.tun_if, worker=worker)
+            self.verify_encrypted(p, p.vpp_tun_sa, recv_pkts)
+
+        # the SA counts are split between the workers
+        for worker in [0, 1]:
+            self.assertEqual(p.tun_sa_in.get_stats(worker)['packets'],
+                             2*N_PKTS)
+            self.assertEqual(p.tun_sa_out.get_stats(worker)['packets'],
+                             2*N_PKTS)
+
+        # a packet replayed on the other worker is caught by the shared
+        # replay window, there is no hand-off to the worker which saw it
+        for worker, replay_worker in [(0, 1), (1, 0)]:
+            send_pkts = self.gen_encrypt_pkts(p, p.scapy_tun_sa, self.tun_if,
+                                              src=p.remote_tun_if_host,
+                                              dst=self.pg1.remote_ip4,
+                                              count=1)
+            self.send_and_expect(self.tun_if, send_pkts, self.pg1,
+                                 worker=worker)
+            self.pg_send(self.tun_if, send_pkts * 3, worker=replay_worker)
+            self.pg1.get_capture(0, timeout=1)
+            self.pg1.assert_nothing_captured(remark="replayed packet")
+        self.assertEqual(
+            self.statistics.get_err_counter(
+                '/err/%s/SA replayed packet' % self.tun4_decrypt_node_name[0]),
+            6)
+
+
 class IpsecTun46Tests(IpsecTun4Tests, IpsecTun6Tests):
     """ UT test methods for Tunnel v6 & v4 """
     pass
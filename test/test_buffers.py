@@ -27,3 +27,11 @@ class TestBuffers(VppTestCase):
         if error:
             self.logger.critical(error)
             self.assertNotIn('failed', error)
+
+    def test_cache(self):
+        """ Per-thread Buffer Cache Growth and Shrink """
+        error = self.vapi.cli("test buffer-cache")
+
+        if error:
+            self.logger.critical(error)
+            self.assertNotIn('failed', error)
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+
+import re
+import unittest
+
+from scapy.layers.inet import IP, UDP
+from scapy.layers.l2 import Ether
+from scapy.packet import Raw
+
+from framework import VppTestCase, VppTestRunner
+from framework import tag_fixme_vpp_workers
+
+
+@tag_fixme_vpp_workers
+class TestBufmonLifetime(VppTestCase):
+    """ Buffer lifetime tracing """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestBufmonLifetime, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        for i in cls.pg_interfaces:
+            i.unconfig_ip4()
+            i.admin_down()
+        super(TestBufmonLifetime, cls).tearDownClass()
+
+    def tearDown(self):
+        self.vapi.cli("test buffer-leak free")
+        self.vapi.cli("set buffer lifetime off")
+        super(TestBufmonLifetime, self).tearDown()
+
+    def suspected_leaks(self):
+        reply = self.vapi.cli("show buffer lifetime")
+        self.logger.info(reply)
+        return int(re.search(r"suspected leaks: (\d+)", reply).group(1))
+
+    def test_lifetime(self):
+        """ Buffer residence times and leaks """
+        # every buffer is sampled
+        self.vapi.cli("set buffer lifetime on sample 1 leak-timeout 1")
+
+        n_pkts = 17
+        p = (Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+             IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+             UDP(sport=1234, dport=1234) /
+             Raw(b'\xa5' * 100))
+        self.send_and_expect(self.pg0, p * n_pkts, self.pg1)
+
+        # each packet left a residence time in the nodes it went through
+        node = self.statistics.get_counter("/sys/node/names").index(
+            "ip4-input")
+        residence = self.statistics.get_counter(
+            "/bufmon/residence")[:, node].sum()
+        self.logger.info("ip4-input residence %s" % residence)
+        self.assertGreaterEqual(sum(residence), n_pkts)
+
+        # buffers held on purpose are reported once the timeout expires
+        self.sleep(2)
+        n_leaks = self.suspected_leaks()
+        reply = self.vapi.cli("test buffer-leak count 8")
+        self.assertIn("leaked 8 buffers", reply)
+        self.sleep(2)
+        n_leaks_held = self.suspected_leaks()
+        self.assertGreaterEqual(n_leaks_held, n_leaks + 8)
+
+        # and no longer once they are freed
+        self.vapi.cli("test buffer-leak free")
+        self.assertLessEqual(self.suspected_leaks(), n_leaks_held - 8)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
@@ -1,7 +1,12 @@
 #!/usr/bin/env python3
 
+from scapy.layers.inet import IP, UDP
+from scapy.layers.l2 import Ether
+from scapy.packet import Raw
+
 from framework import VppTestCase
 from framework import tag_fixme_vpp_workers
+from vpp_papi_provider import CliFailedCommandError
 
 
 @tag_fixme_vpp_workers
@@ -37,3 +42,86 @@ class TestCounters(VppTestCase):
         if error:
             self.logger.critical(error)
             self.assertNotIn('failed', error)
+
+    def test_counter_histogram_buckets(self):
+        """ Histogram Buckets """
+        error = self.vapi.cli("test counter histogram buckets")
+
+        if error:
+            self.logger.critical(error)
+            self.assertNotIn('failed', error)
+
+
+@tag_fixme_vpp_workers
+class TestNodeHistograms(VppTestCase):
+    """ Node Dispatch Histograms """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestNodeHistograms, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        for i in cls.pg_interfaces:
+            i.unconfig_ip4()
+            i.admin_down()
+        super(TestNodeHistograms, cls).tearDownClass()
+
+    def setUp(self):
+        super(TestNodeHistograms, self).setUp()
+        self.vapi.cli("set statistics node-histograms on")
+
+    def tearDown(self):
+        self.vapi.cli("set statistics node-histograms off")
+        super(TestNodeHistograms, self).tearDown()
+
+    def test_node_histograms(self):
+        """ Node Dispatch Histograms """
+        n_pkts = 5
+        p = (Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+             IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+             UDP(sport=1234, dport=1234) /
+             Raw(b'\xa5' * 100))
+        self.send_and_expect(self.pg0, p * n_pkts, self.pg1)
+
+        node = self.statistics.get_counter("/sys/node/names").index(
+            "ip4-input")
+        clocks = self.statistics.get_counter(
+            "/sys/node/clock-histogram")[:, node].sum()
+        vectors = self.statistics.get_counter(
+            "/sys/node/vector-histogram")[:, node].sum()
+        self.logger.info("ip4-input clocks %s vectors %s" %
+                         (clocks, vectors))
+
+        # one sample per call in each histogram
+        self.assertEqual(len(clocks), 48)
+        self.assertEqual(len(vectors), 32)
+        self.assertGreater(sum(vectors), 0)
+        self.assertEqual(sum(clocks), sum(vectors))
+
+        # vector counts below 8 have exact buckets
+        self.assertEqual(sum(vectors[8:]), 0)
+        self.assertEqual(sum(i * n for i, n in enumerate(vectors)), n_pkts)
+
+    def test_node_histograms_wrapper_in_use(self):
+        """ Node Dispatch Histograms and another dispatch wrapper """
+        # the dispatch wrapper slot is taken by the histograms
+        with self.assertRaises(CliFailedCommandError):
+            self.vapi.cli("set buffer traces on")
+        self.assertIn("buffers tracing is off",
+                      self.vapi.cli("show buffer traces status"))
+        self.vapi.cli("set statistics node-histograms off")
+
+        # and the other way round
+        self.vapi.cli("set buffer traces on")
+        try:
+            with self.assertRaises(CliFailedCommandError):
+                self.vapi.cli("set statistics node-histograms on")
+        finally:
+            self.vapi.cli("set buffer traces off")
+        self.vapi.cli("set statistics node-histograms on")
@@ -24,5 +24,33 @@ class TestCrypto(VppTestCase):
             self.logger.critical(error)
         self.assertNotIn("FAIL", error)
 
+
+class TestCryptoNativeMultiBuffer(VppTestCase):
+    """ Crypto Native Multi-buffer AES-GCM Test Case """
+    extra_vpp_punt_config = ["crypto-native", "{",
+                             "aes-gcm-multi-buffer-max-bytes", "1024", "}"]
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestCryptoNativeMultiBuffer, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestCryptoNativeMultiBuffer, cls).tearDownClass()
+
+    def test_crypto(self):
+        """ Crypto Unit Tests with multi-buffer AES-GCM """
+        # the incremental vectors run several AES-GCM ops of up to 1024
+        # bytes in one call, which goes through the multi-buffer kernels
+        reply = self.vapi.cli("set crypto handler aes-128-gcm aes-192-gcm "
+                              "aes-256-gcm native")
+        self.assertNotIn("failed", reply)
+
+        error = self.vapi.cli("test crypto")
+
+        if error:
+            self.logger.critical(error)
+        self.assertNotIn("FAIL", error)
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
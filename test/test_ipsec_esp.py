@@ -13,7 +13,7 @@ from template_ipsec import IpsecTra46Tests, IpsecTun46Tests, TemplateIpsec, \
     config_tun_params, IPsecIPv4Params, IPsecIPv6Params, \
     IpsecTra4, IpsecTun4, IpsecTra6, IpsecTun6, \
     IpsecTun6HandoffTests, IpsecTun4HandoffTests, \
-    IpsecTra6ExtTests
+    IpsecTun4MultiWorkerTests, IpsecTra6ExtTests
 from vpp_ipsec import VppIpsecSpd, VppIpsecSpdEntry, VppIpsecSA,\
     VppIpsecSpdItfBinding
 from vpp_ip_route import VppIpRoute, VppRoutePath
@@ -677,6 +677,55 @@ class TestIpsecEspAsync(TemplateIpsecEsp):
         # screen scrape.
         self.assertTrue("DISABLED" in self.vapi.cli("sh crypto async status"))
 
+    def sw_scheduler_stats(self):
+        """ Frames split and elements processed by all workers """
+        reply = self.vapi.cli("show sw_scheduler workers")
+        self.logger.info(reply)
+        n_split = n_elts = 0
+        for line in reply.splitlines()[1:]:
+            cols = line.split()
+            n_split += int(cols[5])
+            n_elts += int(cols[6]) + int(cols[7])
+        return n_split, n_elts
+
+    def test_async_sw_scheduler_order(self):
+        """ Async SA on the sw scheduler completes in order """
+        self.vapi.cli("set crypto async handler all sw_scheduler")
+        for worker in range(self.vpp_worker_count):
+            self.vapi.cli("set sw_scheduler worker %d crypto on" % worker)
+        n_split, n_elts = self.sw_scheduler_stats()
+
+        # full frames are split in two jobs, which both workers may take
+        n_pkts = 2048
+        pkts = [(Ether(src=self.pg1.remote_mac, dst=self.pg1.local_mac) /
+                 IP(src=self.pg1.remote_ip4,
+                    dst=self.p_async.remote_tun_if_host) /
+                 UDP(sport=1024 + i % 1024, dport=4444 + i // 1024) /
+                 Raw(b'0x0' * 200)) for i in range(n_pkts)]
+
+        rxs = self.send_and_expect(self.pg1, pkts, self.pg0, worker=1)
+
+        # frames are returned in the order they were queued, whichever
+        # worker processed them
+        seq = None
+        for i, rx in enumerate(rxs):
+            self.assertEqual(rx[ESP].spi, self.p_async.vpp_tun_spi)
+            if seq is not None:
+                self.assertEqual(rx[ESP].seq, seq + 1)
+            seq = rx[ESP].seq
+            decrypted = self.p_async.scapy_tun_sa.decrypt(rx[IP])
+            self.assertEqual(decrypted[UDP].sport, 1024 + i % 1024)
+            self.assertEqual(decrypted[UDP].dport, 4444 + i // 1024)
+
+        n_split_after, n_elts_after = self.sw_scheduler_stats()
+        self.assertGreater(n_split_after, n_split)
+        self.assertEqual(n_elts_after - n_elts, n_pkts)
+
+        self.p_sync.spd.remove_vpp_config()
+        self.p_sync.sa.remove_vpp_config()
+        self.p_async.spd.remove_vpp_config()
+        self.p_async.sa.remove_vpp_config()
+
 
 class TestIpsecEspHandoff(TemplateIpsecEsp,
                           IpsecTun6HandoffTests,
@@ -685,6 +734,80 @@ class TestIpsecEspHandoff(TemplateIpsecEsp,
     pass
 
 
+class TestIpsecEspMultiWorker(TemplateIpsecEsp,
+                              IpsecTun4MultiWorkerTests):
+    """ Ipsec ESP - multi-worker SA tests """
+
+    def config_anti_replay(self, params):
+        super(TestIpsecEspMultiWorker, self).config_anti_replay(params)
+        saf = VppEnum.vl_api_ipsec_sad_flags_t
+        for p in params:
+            p.flags |= saf.IPSEC_API_SAD_FLAG_MULTI_WORKER
+
+
+class TestIpsecEspInlineOffload(TemplateIpsecEsp, IpsecTun4Tests):
+    """ Ipsec ESP - inline offload tests """
+
+    def setUp(self):
+        super(TestIpsecEspInlineOffload, self).setUp()
+        # the pg interface stands in for a device doing the ESP transform
+        p = self.params[socket.AF_INET]
+        for sa in [p.tun_sa_in, p.tun_sa_out]:
+            self.vapi.ipsec_sa_offload_enable_disable(
+                sa_id=sa.id, sw_if_index=self.tun_if.sw_if_index)
+
+    def get_inline_counters(self):
+        n_enc = self.statistics.get_err_counter(
+            '/err/%s/ESP pkts offloaded to the device' %
+            self.tun4_encrypt_node_name)
+        n_dec = self.statistics.get_err_counter(
+            '/err/%s/ESP pkts decrypted by the device' %
+            self.tun4_decrypt_node_name[0])
+        return n_enc, n_dec
+
+    def test_tun_inline_offload44(self):
+        """ ipsec 4o4 tunnel inline offload test """
+        p = self.params[socket.AF_INET]
+        self.verify_tun_44(p, count=17)
+        self.assertIn("offloaded to %s" % self.tun_if.name,
+                      self.vapi.cli("show ipsec sa %d" %
+                                    p.tun_sa_in.stat_index))
+        # the device did the transform of every packet, both ways
+        self.assertEqual(self.get_inline_counters(), (17, 17))
+
+        # once no longer offloaded the SAs are processed in software
+        for sa in [p.tun_sa_in, p.tun_sa_out]:
+            self.vapi.ipsec_sa_offload_enable_disable(sa_id=sa.id,
+                                                      enable=False)
+        self.vapi.cli("clear errors")
+        self.vapi.cli("clear ipsec sa")
+        self.verify_tun_44(p, count=17)
+        self.assertEqual(self.get_inline_counters(), (0, 0))
+
+        # a device can hold an SPI once
+        self.vapi.ipsec_sa_offload_enable_disable(
+            sa_id=p.tun_sa_in.id, sw_if_index=self.tun_if.sw_if_index)
+        with self.vapi.assert_negative_api_retval():
+            self.vapi.ipsec_sa_offload_enable_disable(
+                sa_id=p.tun_sa_in.id, sw_if_index=self.tun_if.sw_if_index)
+
+    def test_tun_inline_offload_other_device44(self):
+        """ ipsec 4o4 tunnel not sent through the offload device """
+        p = self.params[socket.AF_INET]
+
+        # the tunnel is routed out of tun_if, the outbound SA is offloaded
+        # to pg1, so its packets must be encrypted in software
+        self.vapi.ipsec_sa_offload_enable_disable(sa_id=p.tun_sa_out.id,
+                                                  enable=False)
+        self.vapi.ipsec_sa_offload_enable_disable(
+            sa_id=p.tun_sa_out.id, sw_if_index=self.pg1.sw_if_index)
+        self.verify_tun_44(p, count=17)
+        self.assertEqual(self.get_inline_counters(), (0, 17))
+        self.assertEqual(self.statistics.get_err_counter(
+            '/err/%s-output/inline IPsec not offloaded to the interface' %
+            self.tun_if.name), 0)
+
+
 class TemplateIpsecEspUdp(ConfigIpsecESP):
     """
     UDP encapped ESP
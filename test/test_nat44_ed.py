@@ -1,16 +1,19 @@
 #!/usr/bin/env python3
 
+import socket
+import struct
 import unittest
 from io import BytesIO
 from random import randint, shuffle, choice
 
 import scapy.compat
 from framework import VppTestCase, VppTestRunner
+from ipfix import IPFIX, Set, Template, Data, IPFIXDecoder
 from scapy.data import IP_PROTOS
 from scapy.layers.inet import IP, TCP, UDP, ICMP, GRE
 from scapy.layers.inet import IPerror, TCPerror
 from scapy.layers.l2 import Ether
-from scapy.packet import Raw
+from scapy.packet import Raw, bind_layers
 from syslog_rfc5424_parser import SyslogMessage, ParseError
 from syslog_rfc5424_parser.constants import SyslogSeverity
 from util import ppp, ip4_range
@@ -993,6 +996,147 @@ class TestNAT44ED(NAT44EDTestCase):
 
         self.pg0.get_capture(1)
 
+    def test_port_block_allocation(self):
+        """ NAT44ED port block allocation """
+
+        port_block_size = 64
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+
+        self.vapi.nat44_ed_set_port_block_size(
+            port_block_size=port_block_size)
+        r = self.vapi.nat44_ed_show_port_block_size()
+        self.assertEqual(r.port_block_size, port_block_size)
+
+        blocks = []
+        for host in self.pg0.remote_hosts[:2]:
+            pkts = []
+            for i in range(0, 5):
+                p = (Ether(dst=self.pg0.local_mac, src=host.mac) /
+                     IP(src=host.ip4, dst=self.pg1.remote_ip4) /
+                     UDP(sport=5000 + i, dport=53))
+                pkts.append(p)
+            self.pg0.add_stream(pkts)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            capture = self.pg1.get_capture(len(pkts))
+
+            # all sessions of the host use ports of a single block
+            host_blocks = set()
+            for p in capture:
+                self.assertEqual(p[IP].src, self.nat_addr)
+                host_blocks.add((p[UDP].sport - 1024) // port_block_size)
+            self.assertEqual(len(host_blocks), 1)
+            blocks.append(host_blocks.pop())
+
+        # each host owns a different block
+        self.assertNotEqual(blocks[0], blocks[1])
+        self.logger.info(self.vapi.cli("show nat44 addresses"))
+
+    def test_port_block_logging(self):
+        """ NAT44ED port block allocation IPFIX and syslog logging """
+
+        port_block_size = 64
+        ipfix_domain_id = 10
+        ipfix_src_port = 20202
+        collector_port = 30303
+        bind_layers(UDP, IPFIX, dport=collector_port)
+
+        self.vapi.syslog_set_filter(
+            self.syslog_severity.SYSLOG_API_SEVERITY_INFO)
+        self.vapi.syslog_set_sender(self.pg3.local_ip4, self.pg3.remote_ip4)
+        self.vapi.set_ipfix_exporter(collector_address=self.pg3.remote_ip4,
+                                     src_address=self.pg3.local_ip4,
+                                     path_mtu=512,
+                                     template_interval=10,
+                                     collector_port=collector_port)
+        self.vapi.nat_ipfix_enable_disable(domain_id=ipfix_domain_id,
+                                           src_port=ipfix_src_port,
+                                           enable=1)
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+        self.vapi.nat44_ed_set_port_block_size(
+            port_block_size=port_block_size)
+
+        pkts = []
+        for i in range(0, 5):
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=5000 + i, dport=53))
+            pkts.append(p)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        start_port = 1024 + ((capture[0][UDP].sport - 1024) //
+                             port_block_size) * port_block_size
+        end_port = start_port + port_block_size - 1
+
+        # 7 templates, the block allocation record and its syslog message,
+        # the sessions of the block are not logged one by one
+        self.sleep(1)
+        self.vapi.ipfix_flush()
+        capture = self.pg3.get_capture(9)
+        syslog = [p for p in capture if not p.haslayer(IPFIX)]
+        self.assertEqual(len(syslog), 1)
+        message = SyslogMessage.parse(syslog[0][Raw].load.decode('utf-8'))
+        self.assertEqual(message.msgid, 'APMADD')
+        sd_params = message.sd.get('napmap')
+        self.assertTrue(sd_params is not None)
+        self.assertEqual(sd_params.get('ISADDR'), self.pg0.remote_ip4)
+        self.assertEqual(sd_params.get('XSADDR'), self.nat_addr)
+        self.assertEqual(sd_params.get('XSPORT'),
+                         "%d-%d" % (start_port, end_port))
+
+        ipfix = IPFIXDecoder()
+        # first load template
+        for p in capture:
+            if p.haslayer(IPFIX):
+                self.assertEqual(p[UDP].sport, ipfix_src_port)
+                self.assertEqual(p[IPFIX].observationDomainID,
+                                 ipfix_domain_id)
+                if p.haslayer(Template):
+                    ipfix.add_template(p.getlayer(Template))
+        # verify events in data set
+        records = []
+        for p in capture:
+            if p.haslayer(Data):
+                records += ipfix.decode_data_set(p.getlayer(Set))
+        self.assertEqual(len(records), 1)
+        record = records[0]
+        # natEvent NAT44 port block allocation
+        self.assertEqual(scapy.compat.orb(record[230]), 16)
+        # sourceIPv4Address
+        self.assertEqual(socket.inet_pton(socket.AF_INET,
+                                          self.pg0.remote_ip4), record[8])
+        # postNATSourceIPv4Address
+        self.assertEqual(socket.inet_pton(socket.AF_INET, self.nat_addr),
+                         record[225])
+        # portRangeStart/portRangeEnd
+        self.assertEqual(struct.pack("!H", start_port), record[361])
+        self.assertEqual(struct.pack("!H", end_port), record[362])
+
+        # the sessions are cleared along with the block size, the block
+        # still in use is logged as released
+        self.pg_enable_capture(self.pg_interfaces)
+        self.vapi.nat44_ed_set_port_block_size(port_block_size=0)
+        syslog = self.pg3.get_capture(
+            1, filter_out_fn=lambda p: p.haslayer(IPFIX))
+        message = SyslogMessage.parse(syslog[0][Raw].load.decode('utf-8'))
+        self.assertEqual(message.msgid, 'APMDEL')
+        sd_params = message.sd.get('napmap')
+        self.assertTrue(sd_params is not None)
+        self.assertEqual(sd_params.get('XSPORT'),
+                         "%d-%d" % (start_port, end_port))
+
+        self.vapi.nat_ipfix_enable_disable(domain_id=ipfix_domain_id,
+                                           src_port=ipfix_src_port,
+                                           enable=0)
+
     def test_users_dump(self):
         """ NAT44ED API test - nat44_user_dump """
 
@@ -2558,8 +2702,8 @@ class TestNAT44EDMW(TestNAT44ED):
         self.assertEqual(self.max_sessions,
                          nat_config.max_translations_per_thread)
 
-    def test_lru_cleanup(self):
-        """ NAT44ED LRU cleanup algorithm """
+    def test_expired_session_cleanup(self):
+        """ NAT44ED expired sessions cleanup """
 
         self.nat_add_address(self.nat_addr)
         self.nat_add_inside_interface(self.pg0)
@@ -2582,6 +2726,10 @@ class TestNAT44EDMW(TestNAT44ED):
         self.pg1.get_capture(len(pkts))
         self.sleep(1.5, "wait for timeouts")
 
+        # expired sessions are reclaimed without any traffic
+        sessions = self.statistics['/nat44-ed/total-sessions']
+        self.assertEqual(sessions[:, 0].sum(), 1)
+
         pkts = []
         for i in range(0, self.max_sessions - 1):
             p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
@@ -3898,5 +4046,64 @@ class TestNAT44EDMW(TestNAT44ED):
         self.logger.info(ppp("capture packet:", capture))
 
 
+class TestNAT44EDPerWorkerFlows(NAT44EDTestCase):
+    """ NAT44ED per worker flow tables Test Case """
+    vpp_worker_count = 2
+    max_sessions = 5000
+
+    def plugin_enable(self):
+        self.vapi.nat44_ed_plugin_enable_disable(
+            sessions=self.max_sessions,
+            flags=self.nat44_config_flags.NAT44_IS_PER_WORKER_FLOWS,
+            enable=1)
+
+    def test_dynamic(self):
+        """ NAT44ED per worker flows dynamic translation test """
+        pkt_count = 100
+        port_per_thread = (0xffff - 1024) // self.vpp_worker_count
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+
+        for worker in range(self.vpp_worker_count):
+            sport_offset = 1000 * (worker + 1)
+
+            # in2out, sessions are created by the receiving worker
+            pkts = [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                     IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                     UDP(sport=sport_offset + i, dport=20))
+                    for i in range(pkt_count)]
+            self.pg0.add_stream(pkts, worker=worker)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            capture = self.pg1.get_capture(pkt_count)
+
+            # outside ports are allocated from the worker's port range,
+            # replies received by another worker are handed off by port
+            pkts = []
+            for p in capture:
+                self.assertEqual(p[IP].src, self.nat_addr)
+                self.assertEqual(
+                    (p[UDP].sport - 1024) // port_per_thread, worker)
+                pkts.append(
+                    Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                    IP(src=self.pg1.remote_ip4, dst=self.nat_addr) /
+                    UDP(sport=20, dport=p[UDP].sport))
+            self.pg1.add_stream(
+                pkts, worker=(worker + 1) % self.vpp_worker_count)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            capture = self.pg0.get_capture(pkt_count)
+            for p in capture:
+                self.assertEqual(p[IP].dst, self.pg0.remote_ip4)
+                self.assert_in_range(p[UDP].dport, sport_offset,
+                                     sport_offset + pkt_count - 1,
+                                     "dst UDP port")
+
+        sc = self.statistics['/nat44-ed/total-sessions']
+        self.assertEqual(sc[:, 0].sum(), pkt_count * self.vpp_worker_count)
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -170,6 +170,35 @@ class QUICEchoIntMStreamTestCase(QUICEchoIntTestCase):
         self.client("nclients", "10", "mbytes", "1", "no-output")
 
 
+@tag_fixme_vpp_workers
+class QUICEchoIntVppCryptoTestCase(QUICEchoIntTestCase):
+    """QUIC Echo Internal VPP Crypto Engine Test Case"""
+
+    def setUp(self):
+        super(QUICEchoIntVppCryptoTestCase, self).setUp()
+        # packets from each quicly_send burst are protected in one batch
+        # of vnet crypto ops, only with the vpp crypto engine
+        self.vapi.cli("quic set crypto api vpp")
+
+    def test_quic_int_vpp_crypto_transfer(self):
+        """QUIC internal multi-stream transfer with batched vpp crypto"""
+        self.server()
+        self.client("nclients", "10", "mbytes", "1", "no-output")
+
+        contexts = self.vapi.cli("show quic crypto context")
+        self.logger.info(contexts)
+        self.assertIn("[vpp]", contexts)
+        self.assertNotIn("[picotls]", contexts)
+
+        # 10 streams of 1MB went through the batched encrypt and decrypt
+        tx = self.statistics.get_err_counter(
+            "/err/quic-input/quic TX packets")
+        rx = self.statistics.get_err_counter(
+            "/err/quic-input/quic RX packets")
+        self.assertGreater(tx, 10 * 1024 * 1024 // 1500)
+        self.assertGreater(rx, 10 * 1024 * 1024 // 1500)
+
+
 class QUICEchoExtTestCase(QUICTestCase):
     quic_setup = "default"
     test_bytes = "test-bytes:assert"
@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestRxBalance(VppTestCase):
+    """ Rx Queue Rebalancing Test Case """
+    vpp_worker_count = 2
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestRxBalance, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestRxBalance, cls).tearDownClass()
+
+    def tearDown(self):
+        self.vapi.cli("set interface rx-balance off")
+        super(TestRxBalance, self).tearDown()
+
+    def test_rx_balance(self):
+        """ Rx queue moved from a busy to an idle worker """
+        self.vapi.cli("set interface rx-balance on interval 0.1 "
+                      "holddown 0 samples 2")
+
+        reply = self.vapi.cli("test interface rx-balance interval 0.1")
+        self.logger.info(reply)
+        self.assertNotIn("failed", reply)
+        self.assertIn("moved 1 of 2 queues", reply)
+
+        reply = self.vapi.cli("show interface rx-balance")
+        self.logger.info(reply)
+        self.assertIn("moves 1", reply)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+
+import json
+import os
+import unittest
+
+from scapy.layers.inet import IP, UDP
+from scapy.layers.l2 import Ether
+from scapy.packet import Raw
+
+from framework import VppTestCase, VppTestRunner
+from framework import tag_fixme_vpp_workers
+from vpp_papi_provider import CliFailedCommandError
+
+
+@tag_fixme_vpp_workers
+class TestTimeline(VppTestCase):
+    """ Timeline plugin """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestTimeline, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        for i in cls.pg_interfaces:
+            i.unconfig_ip4()
+            i.admin_down()
+        super(TestTimeline, cls).tearDownClass()
+
+    def tearDown(self):
+        self.vapi.cli("set timeline off")
+        super(TestTimeline, self).tearDown()
+
+    def recorded(self):
+        """ Spans recorded by the main thread """
+        reply = self.vapi.cli("show timeline")
+        self.logger.info(reply)
+        return int(reply.splitlines()[2].split()[1])
+
+    def send_traffic(self, n_pkts):
+        pkts = [(Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1234, dport=1234) /
+                 Raw(b'\xa5' * 100)) for i in range(n_pkts)]
+        self.send_and_expect(self.pg0, pkts, self.pg1)
+
+    def test_timeline_cli(self):
+        """ Timeline enable, save and disable """
+
+        with self.assertRaises(CliFailedCommandError):
+            self.vapi.cli("set timeline on events-per-thread 1000")
+
+        self.vapi.cli("set timeline on events-per-thread 65536 node api")
+        reply = self.vapi.cli("show timeline")
+        self.assertIn("timeline on: node api, 65536 events per thread",
+                      reply)
+
+        self.send_traffic(17)
+        self.assertGreater(self.recorded(), 0)
+
+        with self.assertRaises(CliFailedCommandError):
+            self.vapi.cli("timeline save ../timeline.json")
+
+        name = "vpp-test-timeline-%d.json" % os.getpid()
+        reply = self.vapi.cli("timeline save %s" % name)
+        self.assertIn("Saved timeline to /tmp/%s" % name, reply)
+        with open("/tmp/%s" % name) as f:
+            events = json.load(f)["traceEvents"]
+        os.remove("/tmp/%s" % name)
+
+        # one thread name, then complete spans
+        self.assertEqual(events[0]["ph"], "M")
+        self.assertEqual(events[0]["args"]["name"], "vpp_main")
+        spans = events[1:]
+        for e in spans:
+            self.assertEqual(e["ph"], "X")
+            self.assertGreaterEqual(e["dur"], 0)
+
+        lookups = [e for e in spans
+                   if e["cat"] == "node" and e["name"] == "ip4-lookup"]
+        self.assertGreater(len(lookups), 0)
+        self.assertEqual(sum(e["args"]["vectors"] for e in lookups), 17)
+        self.assertTrue(any(e["cat"] == "api" and
+                            e["name"].startswith("cli_inband")
+                            for e in spans))
+
+        # nothing is recorded once off, what was recorded is kept
+        self.vapi.cli("set timeline off")
+        self.assertIn("timeline off", self.vapi.cli("show timeline"))
+        n_recorded = self.recorded()
+        self.assertGreater(n_recorded, 0)
+        self.send_traffic(17)
+        self.assertEqual(self.recorded(), n_recorded)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
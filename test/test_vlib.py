@@ -7,6 +7,11 @@ import signal
 from framework import VppTestCase, VppTestRunner, running_extended_tests
 from framework import running_gcov_tests
 from vpp_ip_route import VppIpTable, VppIpRoute, VppRoutePath
+from vpp_lo_interface import VppLoInterface
+from vpp_papi_provider import CliFailedCommandError
+from scapy.layers.inet import IP, UDP
+from scapy.layers.l2 import Ether
+from scapy.packet import Raw
 
 
 class TestVlib(VppTestCase):
@@ -218,5 +223,287 @@ class TestVlib(VppTestCase):
                 else:
                     self.logger.info(cmd + " FAIL retval " + str(r.retval))
 
+    def test_frame_queue_congestion(self):
+        """ Frame Queue Handoff Under Congestion Test """
+
+        n_threads = 1 + self.vpp_worker_count
+        for nelts in [8, 64]:
+            error = self.vapi.cli("test handoff-congestion nelts %d" % nelts)
+            self.logger.info(error)
+            # the queue size is split between the sending threads
+            ring = max(8, nelts // n_threads)
+            self.assertIn("%d of %d frames queued" % (ring, 2 * ring),
+                          error)
+            # congested from 3/4 of the ring on, dropped once it is full
+            threshold = ring - ring // 4
+            self.assertIn("%d congested, %d dropped" %
+                          (2 * ring - threshold + 1, ring), error)
+
+
+class TestVlibWorkStealing(VppTestCase):
+    """ Vlib work stealing between workers """
+    vpp_worker_count = 3
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestVlibWorkStealing, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        for i in cls.pg_interfaces:
+            i.unconfig_ip4()
+            i.admin_down()
+        super(TestVlibWorkStealing, cls).tearDownClass()
+
+    def tearDown(self):
+        self.vapi.cli("set work-stealing off")
+        super(TestVlibWorkStealing, self).tearDown()
+
+    def test_work_stealing_once(self):
+        """ Stolen frames are forwarded exactly once """
+
+        # every full ip4-lookup frame is eligible, idle workers advertise
+        # after a single idle loop
+        self.vapi.cli("set work-stealing on idle-loops 1 min-vectors 1")
+
+        n_pkts = 1024
+        pkts = [(Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1024 + i, dport=1234) /
+                 Raw(b'\xa5' * 100)) for i in range(n_pkts)]
+
+        for worker in [0, 1, 2]:
+            rx = self.send_and_expect(self.pg0, pkts, self.pg1,
+                                      worker=worker)
+            # stolen packets may be reordered, but none may be duplicated
+            # or lost
+            sports = sorted(p[UDP].sport for p in rx)
+            self.assertEqual(sports, [1024 + i for i in range(n_pkts)])
+
+        self.logger.info(self.vapi.cli("show work-stealing"))
+
+
+class TestVlibFrameCoalescing(VppTestCase):
+    """ Vlib frame coalescing """
+    vpp_worker_count = 1
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestVlibFrameCoalescing, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        for i in cls.pg_interfaces:
+            i.unconfig_ip4()
+            i.admin_down()
+        super(TestVlibFrameCoalescing, cls).tearDownClass()
+
+    def tearDown(self):
+        self.vapi.cli("set node coalescing test-coalesce-sink off")
+        self.vapi.cli("set node coalescing ip4-lookup off")
+        self.vapi.cli("set frame-coalescing off")
+        super(TestVlibFrameCoalescing, self).tearDown()
+
+    def test_coalesce_small_frames(self):
+        """ Small frames are merged, traced frames keep their traces """
+
+        self.vapi.cli("set frame-coalescing on budget-us 1000 "
+                      "min-vectors 256")
+        self.vapi.cli("set node coalescing test-coalesce-sink")
+        self.vapi.cli("clear trace")
+        self.vapi.cli("trace add test-coalesce-sink 100")
+
+        # 32 frames of 4 packets, the first 4 frames traced
+        reply = self.vapi.cli("test frame-coalescing frames 32 vectors 4 "
+                              "traced 4")
+        self.logger.info(reply)
+        self.assertNotIn("failed", reply)
+        self.assertIn("128 packets", reply)
+        self.assertIn("16 traced", reply)
+
+        trace = self.vapi.cli("show trace max 100")
+        self.assertEqual(trace.count(": test-coalesce-sink"), 16)
+
+        # without traced frames everything fits in a single call
+        reply = self.vapi.cli("test frame-coalescing frames 64 vectors 2 "
+                              "traced 0")
+        self.logger.info(reply)
+        self.assertIn("128 packets in 1 calls, 0 traced", reply)
+
+    def test_coalesce_refork(self):
+        """ Frames held across a worker refork are not lost """
+
+        # hold the small ip4-lookup frames of the worker for long enough
+        # to create an interface, which reforks the worker node runtimes
+        self.vapi.cli("set frame-coalescing on budget-us 500000 "
+                      "min-vectors 256")
+        self.vapi.cli("set node coalescing ip4-lookup")
+
+        n_pkts = 17
+        pkts = [(Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1024 + i, dport=1234) /
+                 Raw(b'\xa5' * 100)) for i in range(n_pkts)]
+
+        self.pg0.add_stream(pkts, worker=1)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+
+        lo = VppLoInterface(self)
+        rx = self.pg1.get_capture(n_pkts)
+        lo.remove_vpp_config()
+
+        sports = sorted(p[UDP].sport for p in rx)
+        self.assertEqual(sports, [1024 + i for i in range(n_pkts)])
+
+        # every traced packet went through ip4-lookup exactly once
+        trace = self.vapi.cli("show trace max 1000")
+        self.assertEqual(trace.count(": ip4-lookup"), n_pkts)
+
+        coalescing = self.vapi.cli("show frame-coalescing")
+        self.logger.info(coalescing)
+        deferred = int(coalescing.splitlines()[-1].split()[2])
+        self.assertGreater(deferred, 0)
+
+
+class TestVlibWorkerSleep(VppTestCase):
+    """ Vlib worker sleep policy """
+    vpp_worker_count = 1
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestVlibWorkerSleep, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        for i in cls.pg_interfaces:
+            i.unconfig_ip4()
+            i.admin_down()
+        super(TestVlibWorkerSleep, cls).tearDownClass()
+
+    def tearDown(self):
+        self.vapi.cli("set worker-sleep off")
+        super(TestVlibWorkerSleep, self).tearDown()
+
+    def worker_sleeps(self):
+        """ Sleeps of the worker, from the policy enable on """
+        reply = self.vapi.cli("show worker-sleep")
+        self.logger.info(reply)
+        row = reply.splitlines()[1].split()
+        self.assertEqual(row[:3], ["1", "on", "16"])
+        return int(row[5])
+
+    def test_worker_sleep(self):
+        """ Idle worker sleeps, and wakes up for traffic """
+
+        with self.assertRaises(CliFailedCommandError):
+            self.vapi.cli("set worker-sleep workers 1 on")
+
+        self.vapi.cli("set worker-sleep workers 0 on empty-polls 16 "
+                      "max-busy-poll-us 100")
+
+        # no polling rx queue, so the worker sleeps once the API calls
+        # above are half a second behind
+        self.sleep(1.5)
+        n_sleeps = self.worker_sleeps()
+        self.assertGreater(n_sleeps, 0)
+
+        # traffic is still forwarded, the worker goes back to sleep after
+        n_pkts = 17
+        pkts = [(Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1024 + i, dport=1234) /
+                 Raw(b'\xa5' * 100)) for i in range(n_pkts)]
+        self.send_and_expect(self.pg0, pkts, self.pg1, worker=0)
+        self.sleep(1.5)
+        self.assertGreater(self.worker_sleeps(), n_sleeps)
+
+        self.vapi.cli("set worker-sleep off")
+        reply = self.vapi.cli("show worker-sleep")
+        self.assertEqual(reply.splitlines()[1].split(), ["1", "off"])
+
+
+class TestVlibApiBarrier(VppTestCase):
+    """ Vlib API barrier """
+    vpp_worker_count = 1
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestVlibApiBarrier, cls).setUpClass()
+        cls.create_pg_interfaces(range(1))
+
+    def tearDown(self):
+        self.vapi.cli("set api barrier read-only off")
+        super(TestVlibApiBarrier, self).tearDown()
+
+    def barrier_syncs(self):
+        """ Barrier syncs, counting the one of this CLI call """
+        reply = self.vapi.cli("show api barrier")
+        self.logger.info(reply)
+        return int(reply.splitlines()[1].split()[2])
+
+    def barrier_holds(self, name=None):
+        """ Samples in the barrier hold histograms, or the CLI row """
+        if name is None:
+            return sum(sum(sum(buckets) for buckets in thread)
+                       for thread in
+                       self.statistics.get_counter("/sys/api/barrier-hold"))
+        for row in self.vapi.cli("show api barrier").splitlines()[3:]:
+            row = row.split()
+            if row[1].startswith(name):
+                return int(row[2])
+        return 0
+
+    def read_only_calls(self):
+        self.vapi.show_threads()
+        self.vapi.ip_table_dump()
+        self.vapi.sw_interface_get_table(sw_if_index=self.pg0.sw_if_index)
+        self.vapi.sw_interface_dump()
+
+    def test_api_barrier(self):
+        """ Read-only API calls do not take the barrier """
+
+        # the CLI calls reading the counts take the barrier themselves
+        self.vapi.cli("clear api barrier")
+        n_syncs = self.barrier_syncs()
+        n_holds = self.barrier_holds()
+        self.read_only_calls()
+        self.assertEqual(self.barrier_syncs(), n_syncs + 1)
+        self.assertEqual(self.barrier_holds(), n_holds + 1)
+        self.assertEqual(self.barrier_holds("show_threads"), 0)
+        self.assertEqual(self.barrier_holds("ip_table_dump"), 0)
+
+        # a call which is not thread-safe takes it, and is recorded
+        n_syncs = self.barrier_syncs()
+        n_holds = self.barrier_holds()
+        self.pg0.admin_up()
+        self.assertEqual(self.barrier_syncs(), n_syncs + 2)
+        self.assertEqual(self.barrier_holds(), n_holds + 2)
+        self.assertEqual(self.barrier_holds("sw_interface_set_flags"), 1)
+
+        # read-only calls take it again on request, thread-safe ones not
+        self.vapi.cli("set api barrier read-only on")
+        n_syncs = self.barrier_syncs()
+        self.read_only_calls()
+        self.assertEqual(self.barrier_syncs(), n_syncs + 4)
+        self.assertEqual(self.barrier_holds("show_threads"), 1)
+        self.assertEqual(self.barrier_holds("sw_interface_dump"), 0)
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
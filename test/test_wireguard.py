@@ -600,6 +600,58 @@ class TestWg(VppTestCase):
         peer_1.remove_vpp_config()
         wg0.remove_vpp_config()
 
+    def test_wg_handshake_and_data_one_frame(self):
+        """ Handshake and data of the replaced keypair in one frame """
+        port = 12353
+
+        wg0 = VppWgInterface(self,
+                             self.pg1.local_ip4,
+                             port).add_vpp_config()
+        wg0.admin_up()
+        wg0.config_ip4()
+
+        peer_1 = VppWgPeer(self,
+                           wg0,
+                           self.pg1.remote_ip4,
+                           port+1,
+                           ["10.11.2.0/24",
+                            "10.11.3.0/24"]).add_vpp_config()
+
+        # the peer initiates, vpp's keypair is unconfirmed (next)
+        p = peer_1.mk_handshake(self.pg1)
+        rx = self.send_and_expect(self.pg1, [p], self.pg1)
+        peer_1.consume_response(rx[0])
+
+        # data encrypted with that keypair
+        n_data = 10
+        pkts = [(peer_1.mk_tunnel_header(self.pg1) /
+                 Wireguard(message_type=4, reserved_zero=0) /
+                 WireguardTransport(
+                     receiver_index=peer_1.sender,
+                     counter=ii,
+                     encrypted_encapsulated_packet=peer_1.encrypt_transport(
+                         (IP(src="10.11.3.1", dst=self.pg0.remote_ip4,
+                             ttl=20) /
+                          UDP(sport=222, dport=223) /
+                          Raw())))) for ii in range(n_data)]
+
+        # followed, in the same frame, by a new handshake which replaces
+        # the keypair the data packets were looked up with
+        pkts.append(peer_1.mk_handshake(self.pg1))
+
+        self.pg_send(self.pg1, pkts)
+        rxs = self.pg0.get_capture(n_data)
+        for rx in rxs:
+            self.assertEqual(rx[IP].dst, self.pg0.remote_ip4)
+            self.assertEqual(rx[IP].ttl, 19)
+
+        # the handshake is still answered
+        rx = self.pg1.get_capture(1)
+        peer_1.consume_response(rx[0])
+
+        peer_1.remove_vpp_config()
+        wg0.remove_vpp_config()
+
     def test_wg_multi_peer(self):
         """ multiple peer setup """
         port = 12343